@@ -0,0 +1,170 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double timeIterations(const BenchmarkSuite::Body& body, uint64_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  body(iterations);
+  return seconds(start);
+}
+
+// value at quantile q of sorted samples, interpolated between neighbours
+double quantile(const std::vector<double>& sorted, double q) {
+  double position = q * (sorted.size() - 1);
+  size_t i = size_t(position);
+  if (i + 1 >= sorted.size())
+    return sorted.back();
+  return sorted[i] + (position - i) * (sorted[i + 1] - sorted[i]);
+}
+
+// the names are written by writeJson, only quotes and backslashes need escaping
+std::string quoted(const std::string& text) {
+  std::string result = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+}  // namespace
+
+void BenchmarkSuite::add(std::string name, Body body, int repetitions) {
+  cases.push_back({std::move(name), std::move(body), repetitions});
+}
+
+BenchmarkResult BenchmarkSuite::measure(const Case& c, const BenchmarkOptions& options) const {
+  BenchmarkResult result;
+  result.name = c.name;
+
+  // warm up caches, allocators and lazy initialisation, which also gives the
+  // time of one iteration for the calibration
+  auto start = std::chrono::steady_clock::now();
+  uint64_t warmup_iterations = 0;
+  do {
+    c.body(1);
+    ++warmup_iterations;
+  } while (c.repetitions == 0 && seconds(start) < options.warmup_time);
+  double iteration_time = seconds(start) / warmup_iterations;
+
+  result.iterations = 1;
+  if (c.repetitions == 0)
+    result.iterations = std::max<uint64_t>(1, uint64_t(options.repetition_time / std::max(iteration_time, 1e-9)));
+
+  std::vector<double> samples;
+  start = std::chrono::steady_clock::now();
+  while (c.repetitions ? int(samples.size()) < c.repetitions
+                       : int(samples.size()) < options.min_repetitions ||
+                         (seconds(start) < options.min_time && int(samples.size()) < options.max_repetitions))
+    samples.push_back(timeIterations(c.body, result.iterations) * 1e9 / result.iterations);
+
+  std::sort(samples.begin(), samples.end());
+  result.repetitions = samples.size();
+  result.median = quantile(samples, 0.5);
+  result.p99 = quantile(samples, 0.99);
+  result.min = samples.front();
+  double sum = 0.0;
+  for (double sample : samples)
+    sum += sample;
+  result.mean = sum / samples.size();
+  return result;
+}
+
+std::vector<BenchmarkResult> BenchmarkSuite::run(const BenchmarkOptions& options) const {
+  std::vector<BenchmarkResult> results;
+  std::printf("%-48s %12s %12s %12s %8s\n", "benchmark", "median", "p99", "min", "reps");
+  for (auto& c : cases) {
+    if (c.name.find(options.filter) == std::string::npos)
+      continue;
+    BenchmarkResult result = measure(c, options);
+    std::printf("%-48s %10.0fns %10.0fns %10.0fns %8d\n", result.name.c_str(), result.median, result.p99,
+                result.min, result.repetitions);
+    std::fflush(stdout);
+    results.push_back(result);
+  }
+  return results;
+}
+
+void writeJson(const std::string& path, const std::vector<BenchmarkResult>& results) {
+  std::ofstream file(path);
+  if (!file)
+    throw std::runtime_error("Could not write " + path);
+  file.precision(10);
+  file << "{\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& r = results[i];
+    file << (i ? ",\n" : "\n") << "    {\"name\": " << quoted(r.name) << ", \"repetitions\": " << r.repetitions
+         << ", \"iterations\": " << r.iterations << ", \"median_ns\": " << r.median << ", \"p99_ns\": " << r.p99
+         << ", \"mean_ns\": " << r.mean << ", \"min_ns\": " << r.min << "}";
+  }
+  file << "\n  ]\n}\n";
+}
+
+std::vector<BenchmarkResult> readJson(const std::string& path) {
+  std::ifstream file(path);
+  if (!file)
+    throw std::runtime_error("Could not read " + path);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const std::string text = buffer.str();
+
+  // every benchmark is one object on its own line with known keys
+  auto number = [&](size_t object, const std::string& key) {
+    size_t at = text.find("\"" + key + "\":", object);
+    if (at == std::string::npos)
+      throw std::runtime_error("Missing " + key + " in " + path);
+    return std::strtod(text.c_str() + at + key.size() + 3, nullptr);
+  };
+  std::vector<BenchmarkResult> results;
+  for (size_t at = text.find("{\"name\": \""); at != std::string::npos; at = text.find("{\"name\": \"", at + 1)) {
+    BenchmarkResult r;
+    for (size_t i = at + 10; i < text.size() && text[i] != '"'; ++i) {
+      if (text[i] == '\\')
+        ++i;
+      r.name += text[i];
+    }
+    r.repetitions = int(number(at, "repetitions"));
+    r.iterations = uint64_t(number(at, "iterations"));
+    r.median = number(at, "median_ns");
+    r.p99 = number(at, "p99_ns");
+    r.mean = number(at, "mean_ns");
+    r.min = number(at, "min_ns");
+    results.push_back(r);
+  }
+  return results;
+}
+
+int compareWithBaseline(const std::vector<BenchmarkResult>& results,
+                        const std::vector<BenchmarkResult>& baseline, double threshold) {
+  int slower = 0;
+  std::printf("\n%-48s %12s %12s %8s\n", "benchmark", "baseline", "median", "change");
+  for (auto& result : results) {
+    auto base = std::find_if(baseline.begin(), baseline.end(),
+                             [&](const BenchmarkResult& b) { return b.name == result.name; });
+    if (base == baseline.end()) {
+      std::printf("%-48s %12s %10.0fns %8s\n", result.name.c_str(), "-", result.median, "new");
+      continue;
+    }
+    double change = result.median / base->median - 1.0;
+    bool regression = change > threshold;
+    slower += regression;
+    std::printf("%-48s %10.0fns %10.0fns %+7.1f%%%s\n", result.name.c_str(), base->median, result.median,
+                100.0 * change, regression ? "  SLOWER" : "");
+  }
+  return slower;
+}
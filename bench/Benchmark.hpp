@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Small self-contained benchmark harness. Every case is warmed up, then timed
+// for a number of repetitions of a calibrated number of iterations. Medians
+// and 99th percentiles per iteration are printed, can be written to JSON and
+// compared with the JSON of an earlier run.
+struct BenchmarkOptions {
+  std::string filter;          // run only the cases whose name contains it
+  double warmup_time = 0.1;    // seconds
+  double min_time = 0.5;       // seconds of measured repetitions per case
+  int min_repetitions = 10;
+  int max_repetitions = 10000;
+  double repetition_time = 1e-3;  // seconds, the iterations are calibrated to it
+};
+
+struct BenchmarkResult {
+  std::string name;
+  int repetitions = 0;
+  uint64_t iterations = 0;  // per repetition
+  // nanoseconds per iteration
+  double median = 0.0, p99 = 0.0, mean = 0.0, min = 0.0;
+};
+
+class BenchmarkSuite {
+public:
+  // body runs the measured code the given number of times
+  using Body = std::function<void(uint64_t iterations)>;
+
+  // repetitions > 0 fixes the number of repetitions of one iteration each,
+  // for cases that take much longer than a millisecond
+  void add(std::string name, Body body, int repetitions = 0);
+
+  std::vector<BenchmarkResult> run(const BenchmarkOptions& options) const;
+
+private:
+  struct Case {
+    std::string name;
+    Body body;
+    int repetitions;
+  };
+  std::vector<Case> cases;
+
+  BenchmarkResult measure(const Case& c, const BenchmarkOptions& options) const;
+};
+
+void writeJson(const std::string& path, const std::vector<BenchmarkResult>& results);
+// reads the files written by writeJson
+std::vector<BenchmarkResult> readJson(const std::string& path);
+
+// prints the change of every median against the baseline and returns the
+// number of cases slower by more than threshold (0.1 is 10%)
+int compareWithBaseline(const std::vector<BenchmarkResult>& results,
+                        const std::vector<BenchmarkResult>& baseline, double threshold);
+
+// keeps the compiler from dropping a computation whose result is unused
+template <class T>
+inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,662 @@
+// graphs_bench [--filter <text>] [--min-time <seconds>] [--json <file>]
+//              [--baseline <file>] [--threshold <fraction>] [--compare <file>]
+//
+// Times the hot paths of graphs. With --baseline the medians are compared
+// with an earlier --json output and the exit code is 2 when a case got slower
+// by more than the threshold (default 0.1). --compare takes the results from
+// a file instead of running the cases, such as the profile of a replayed
+// session written by `graphs --replay <log> --profile <file>`.
+
+#include "Benchmark.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <BatchRuns.hpp>
+#include <CriticalPoints.hpp>
+#include <FontAtlas.hpp>
+#include <HeightPyramid.hpp>
+#include <HermiteGrid.hpp>
+#include <Mesh.hpp>
+#include <MeshExporter.hpp>
+#include <NdOptimizers.hpp>
+#include <NormalMap.hpp>
+#include <Objectives.hpp>
+#include <Optimizers.hpp>
+#include <PopulationOptimizers.hpp>
+#include <ProcessPool.hpp>
+#include <ProgressiveGrid.hpp>
+#include <QuiverField.hpp>
+#include <RegionStats.hpp>
+#include <Shader.hpp>
+#include <SurfaceLayout.hpp>
+#include <SurfaceStream.hpp>
+#include <Surrogate.hpp>
+#include <ThreadPool.hpp>
+#include <VectorKernels.hpp>
+#include <asset.hpp>
+#include <utils.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+#ifdef _WIN32
+const char* null_device = "NUL";
+#else
+const char* null_device = "/dev/null";
+#endif
+
+// heights of the lattice createGraph() samples at the default camera distance
+std::vector<float> graphHeights(int size, float diff) {
+  const int n = size + 2;
+  std::vector<glm::vec2> positions(n * n);
+  for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x)
+      positions[y * n + x] = diff * glm::vec2(x - size / 2, y - size / 2);
+  std::vector<float> heights(n * n);
+  evaluateBatch(defaultObjective().function, std::nullopt, positions.data(), heights.data(), heights.size());
+  return heights;
+}
+
+void addMeshBenchmarks(BenchmarkSuite& suite) {
+  suite.add("getHeightMap", [function = defaultObjective().function](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(getHeightMap(glm::vec2(0.004f * (i % 200), 0.004f * (i / 200 % 200)), 0.004f, function));
+  });
+
+  const int size = 200;
+  const float diff = 26 * 0.004f;
+  suite.add("createGraph/heights", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(graphHeights(size, diff));
+  });
+
+  for (auto mode : {SurfaceLayout::Mode::Triangles, SurfaceLayout::Mode::OptimizedTriangles,
+                    SurfaceLayout::Mode::Strips}) {
+    auto layout = std::make_shared<SurfaceLayout>(size, 32, mode);
+    auto heights = std::make_shared<std::vector<float>>(graphHeights(size, diff));
+    auto vertices = std::make_shared<std::vector<VertexType>>(layout->vertexCount());
+    suite.add("createGraph/assembly/" + SurfaceLayout::modeName(mode), [=](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        assembleSurface(*layout, heights->data(), -size / 2, -size / 2, diff, vertices->data());
+        keep(vertices->back());
+      }
+    });
+  }
+}
+
+// a refresh of an animated 512 x 512 graph: every height at the next t and
+// every tile assembled again, the work of a frame when the budget allows it
+void addAnimationBenchmarks(BenchmarkSuite& suite) {
+  const int size = 512;
+  const float diff = 26 * 0.004f;
+  TimedFunction wave = waveObjective();
+  auto pool = std::make_shared<ThreadPool>();
+  auto stream = std::make_shared<SurfaceStream>(wave, *pool);
+  auto layout = std::make_shared<SurfaceLayout>(size, 32, SurfaceLayout::Mode::OptimizedTriangles);
+  auto vertices = std::make_shared<std::vector<VertexType>>(layout->vertexCount());
+  auto t = std::make_shared<float>(0.0f);
+  suite.add("animate/refresh/512", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      *t += 1.0f / 60.0f;
+      stream->refresh(size + 2, diff, -size / 2, -size / 2, *t, 1e9);
+      pool->parallelFor(0, layout->getTiles().size(), [&](size_t tile) {
+        assembleTile(*layout, tile, stream->heights(), -size / 2, -size / 2, diff, vertices->data());
+      });
+      keep(vertices->back());
+    }
+  });
+}
+
+// the progressive grid of a 200 x 200 graph: the first pass shown right after
+// a jump, the whole refinement from scratch, and a pan by 3 lattice steps of
+// a refined grid, which samples the new columns only; and the graph
+// reconstructed from Hermite patches from scratch
+void addRefineBenchmarks(BenchmarkSuite& suite) {
+  constexpr int size = 200;
+  constexpr float unit = 0.004f;
+  constexpr int level = 26;
+  Objective function = defaultObjective();
+  // the cases keep the pool of the grid alive
+  auto pool = std::make_shared<ThreadPool>();
+  auto grid = std::make_shared<ProgressiveGrid>([function](const glm::vec2* points, float* values, size_t count) {
+    evaluateBatch(function.function, std::nullopt, points, values, count);
+  }, *pool);
+  suite.add("refine/first-pass/200", [grid, pool](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      grid->invalidate();
+      grid->refine(size + 2, level, unit, -size / 2, -size / 2, 0.0);
+      keep(grid->heights()[0]);
+    }
+  });
+  suite.add("refine/full/200", [grid, pool](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      grid->invalidate();
+      grid->refine(size + 2, level, unit, -size / 2, -size / 2, 1e9);
+      keep(grid->heights()[0]);
+    }
+  });
+  suite.add("refine/pan/200", [grid, pool](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      grid->refine(size + 2, level, unit, -size / 2 + 3 * int(i % 2), -size / 2, 1e9);
+      keep(grid->heights()[0]);
+    }
+  });
+  // the same graph from Hermite patches of values, gradients and twists
+  auto hermite = std::make_shared<HermiteGrid>(
+    [function](const glm::vec2* points, size_t count, float* values, glm::vec2* gradients, float* twists) {
+      evaluateBatch(function.function, std::nullopt, points, values, count);
+      for (size_t i = 0; gradients && i < count; ++i) {
+        gradients[i] = (*function.gradient)(points[i]);
+        twists[i] = (*function.hessian)(points[i])[0][1];
+      }
+    },
+    *pool);
+  suite.add("refine/hermite/200", [hermite, pool](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      hermite->invalidate();
+      hermite->refine(size + 2, level, unit, -size / 2, -size / 2);
+      keep(hermite->heights()[0]);
+    }
+  });
+}
+
+// the surrogate of an expensive function fitted to 1000 true values: a
+// refit after a batch of 16 more, the choice of the next batch, and the graph
+// of the model sampled in full
+void addSurrogateBenchmarks(BenchmarkSuite& suite) {
+  constexpr int size = 200;
+  constexpr float unit = 0.004f;
+  constexpr int level = 26;
+  const float half = size / 2 * level * unit;
+  func_t function = defaultObjective().function;
+  std::vector<SurrogateModel::Sample> samples;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    // a Halton sequence over the graph
+    float u = 0.0f, v = 0.0f;
+    for (uint32_t k = i + 1, b = 2; k; k /= 2, b *= 2)
+      u += float(k % 2) / b;
+    for (uint32_t k = i + 1, b = 3; k; k /= 3, b *= 3)
+      v += float(k % 3) / b;
+    glm::vec2 p = half * (2.0f * glm::vec2(u, v) - 1.0f);
+    samples.push_back({p, function(p)});
+  }
+  auto model = std::make_shared<const SurrogateModel>(samples);
+  suite.add("surrogate/refit/1000", [model, samples](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(model->refit(samples.data(), 16)->lengthScale());
+  });
+  suite.add("surrogate/choose/16", [=](uint64_t iterations) {
+    std::vector<glm::vec2> points;
+    for (uint64_t i = 0; i < iterations; ++i) {
+      points.clear();
+      keep(model->mostUncertain(glm::vec2(-half), glm::vec2(half), 16, uint32_t(i), points));
+    }
+  });
+  auto pool = std::make_shared<ThreadPool>();
+  auto grid = std::make_shared<ProgressiveGrid>([model](const glm::vec2* points, float* values, size_t count) {
+    model->evaluate(points, values, count);
+  }, *pool);
+  suite.add("surrogate/graph/200", [grid, pool](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      grid->invalidate();
+      grid->refine(size + 2, level, unit, -size / 2, -size / 2, 1e9);
+      keep(grid->heights()[0]);
+    }
+  });
+}
+
+// the gradient overlay of a 200 x 200 graph: every gradient evaluated anew,
+// a pan of a lattice step of the arrows (the gradients are kept), and the
+// arrows written for the mesh
+void addQuiverBenchmarks(BenchmarkSuite& suite) {
+  constexpr int size = 200;
+  constexpr float unit = 0.004f;
+  constexpr int level = 26;
+  // the cases keep the pool of the field alive
+  auto pool = std::make_shared<ThreadPool>();
+  auto field = std::make_shared<QuiverField>(*pool);
+  auto gradient = [function = *defaultObjective().gradient](const glm::vec2* points, glm::vec2* gradients,
+                                                             size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      gradients[i] = function(points[i]);
+  };
+  suite.add("quiver/update/200", [field, pool, gradient](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      field->invalidate();
+      field->update(size + 2, level, unit, -size / 2, -size / 2, gradient);
+      keep(field->evaluatedCount());
+    }
+  });
+  suite.add("quiver/pan/200", [field, pool, gradient](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      field->update(size + 2, level, unit, -size / 2 + 8 * int(i % 2), -size / 2, gradient);
+      keep(field->evaluatedCount());
+    }
+  });
+  auto heights = std::make_shared<std::vector<float>>(graphHeights(size, level * unit));
+  auto arrows = std::make_shared<std::vector<QuiverArrow>>();
+  suite.add("quiver/arrows/200", [=](uint64_t iterations) {
+    field->update(size + 2, level, unit, -size / 2, -size / 2, gradient);
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(field->arrows(heights->data(), *arrows));
+  });
+}
+
+// the normal map of a 200 x 200 graph: every texel evaluated anew, every
+// texel taken from the slope of the heights (no budget), and a pan of a
+// vertex (four columns of texels evaluated)
+void addNormalMapBenchmarks(BenchmarkSuite& suite) {
+  constexpr int size = 200;
+  constexpr float unit = 0.004f;
+  constexpr int level = 26;
+  // the cases keep the pool of the map alive
+  auto pool = std::make_shared<ThreadPool>();
+  auto map = std::make_shared<NormalMap>(*pool);
+  auto heights = std::make_shared<std::vector<float>>(graphHeights(size, level * unit));
+  NormalMap::gradient_t gradient = [function = *defaultObjective().gradient](const glm::vec2* points,
+                                                                              glm::vec2* gradients, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      gradients[i] = function(points[i]);
+  };
+  suite.add("normalmap/update/200", [map, pool, heights, gradient](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      map->invalidate();
+      map->update(size, level, unit, -size / 2, -size / 2, heights->data(), gradient, 1e9, i + 1);
+      keep(map->evaluatedCount());
+    }
+  });
+  suite.add("normalmap/slope/200", [map, pool, heights, gradient](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      map->invalidate();
+      map->update(size, level, unit, -size / 2, -size / 2, heights->data(), gradient, 0.0, i + 1);
+      keep(map->pendingCount());
+    }
+  });
+  suite.add("normalmap/pan/200", [map, pool, heights, gradient](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      map->update(size, level, unit, -size / 2 + int(i % 2), -size / 2, heights->data(), gradient, 1e9, i + 1);
+      keep(map->evaluatedCount());
+    }
+  });
+}
+
+// the default function evaluated by worker processes, 16384 points from
+// four threads at once; the function is cheap, so this is the cost of the
+// shared memory and the messages. The workers are started by the first
+// iteration of a case.
+void addProcessPoolBenchmarks(BenchmarkSuite& suite) {
+  auto threads = std::make_shared<ThreadPool>(4);
+  auto points = std::make_shared<std::vector<glm::vec2>>(16384);
+  for (size_t i = 0; i < points->size(); ++i)
+    (*points)[i] = 0.01f * glm::vec2(float(i % 128), float(i / 128));
+  auto values = std::make_shared<std::vector<float>>(points->size());
+  for (unsigned workers : {1u, 4u}) {
+    auto pool = std::make_shared<std::unique_ptr<ProcessPool>>();
+    suite.add("workers/batch/" + std::to_string(workers), [=](uint64_t iterations) {
+      if (!*pool)
+        *pool = std::make_unique<ProcessPool>("", workers);
+      const size_t part = points->size() / 4;
+      for (uint64_t i = 0; i < iterations; ++i)
+        threads->parallelFor(0, 4, [&](size_t k) {
+          (*pool)->evaluate(ProcessPool::Kind::Value, points->data() + k * part, values->data() + k * part, part);
+        });
+      keep(values->front());
+    });
+  }
+}
+
+void addPickBenchmarks(BenchmarkSuite& suite) {
+  // the pyramid every mesh job builds, and hover queries on a grid of 4M
+  // samples from a camera looking down at 45 degrees
+  auto heights = std::make_shared<std::vector<float>>(graphHeights(200, 0.004f * 22));
+  auto pyramid = std::make_shared<HeightPyramid>();
+  suite.add("pick/build/200", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      pyramid->build(heights->data(), 202, 201, glm::vec2(-100 * 0.088f), 0.088f);
+      keep(pyramid->empty());
+    }
+  });
+
+  const int samples = 2049;
+  const float diff = 0.01f;
+  auto large = std::make_shared<HeightPyramid>();
+  {
+    std::vector<float> grid = graphHeights(samples - 1, diff);
+    large->build(grid.data(), samples + 1, samples, diff * glm::vec2(-(samples - 1) / 2), diff);
+  }
+  auto rays = std::make_shared<std::vector<glm::vec3>>();
+  for (int i = 0; i < 64; ++i) {
+    glm::vec3 target(diff * (i % 8 - 4) * 100, diff * (i / 8 - 4) * 100, 0.0f);
+    rays->push_back(target + glm::vec3(15.0f, 15.0f, 21.2f));
+    rays->push_back(target - rays->back());
+  }
+  suite.add("pick/hover/2048", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      size_t ray = 2 * (i % 64);
+      keep(large->intersect((*rays)[ray], (*rays)[ray + 1]).has_value());
+    }
+  });
+}
+
+void addCriticalBenchmarks(BenchmarkSuite& suite) {
+  // one job of the critical point search at the default zoom level, with
+  // the sample bounds of the gradient
+  Objective function = defaultObjective();
+  auto pool = std::make_shared<ThreadPool>();
+  auto finder = std::make_shared<CriticalPointFinder>(function.function, *function.gradient, *function.hessian,
+                                                      std::nullopt, *pool);
+  auto regions = std::make_shared<std::vector<CriticalRegion>>();
+  CriticalPointFinder::regionsOver(22, glm::vec2(-8.0f), glm::vec2(8.0f), *regions);
+  regions->resize(16);
+  auto points = std::make_shared<std::vector<std::vector<CriticalPoint>>>();
+  suite.add("critical/find/16", [pool, finder, regions, points](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      finder->find(*regions, *points);
+      keep(points->size());
+    }
+  });
+}
+
+void addRegionBenchmarks(BenchmarkSuite& suite) {
+  // the statistics of the region of the default view, from start to done,
+  // capped at 2^20 evaluations as a panel that is left open
+  RegionIntegrator::Settings settings;
+  settings.lower = glm::vec2(-10.0f);
+  settings.upper = glm::vec2(10.0f);
+  settings.tolerance = 1e-4;
+  settings.max_evaluations = size_t(1) << 20;
+  auto pool = std::make_shared<ThreadPool>();
+  func_t function = defaultObjective().function;
+  suite.add("region/integrate/1M", [settings, pool, function](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      RegionIntegrator integrator(function, std::nullopt, *pool, settings);
+      while (!integrator.refine(1.0))
+        continue;
+      keep(integrator.statistics().integral.value);
+    }
+  });
+}
+
+void addOptimizerBenchmarks(BenchmarkSuite& suite) {
+  Objective function = defaultObjective();
+  auto newton = std::make_shared<Newton>(function.function, *function.gradient, *function.hessian);
+  suite.add("Optimizer::step/Newton", [=](uint64_t iterations) {
+    newton->reset(glm::vec2(1.0, 2.0));
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(newton->step());
+  });
+  auto descent = std::make_shared<GradientDescent>(function.function, *function.gradient, 0.1f);
+  suite.add("Optimizer::step/GradientDescent", [=](uint64_t iterations) {
+    descent->reset(glm::vec2(1.0, 2.0));
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(descent->step());
+  });
+  // a generation of the population optimizers, started again every 100
+  // before the population collapses
+  PopulationSettings settings;
+  settings.spread = 5.0f;
+  auto pool = std::make_shared<ThreadPool>();
+  std::shared_ptr<PopulationOptimizer> populations[] = {
+    std::make_shared<CmaEs>(function.function, std::nullopt, nullptr, settings),
+    std::make_shared<DifferentialEvolution>(function.function, std::nullopt, nullptr, settings),
+    std::make_shared<CmaEs>(function.function, std::nullopt, pool.get(), settings),
+  };
+  const char* names[] = {"Optimizer::step/CMA-ES", "Optimizer::step/DifferentialEvolution",
+                         "Optimizer::step/CMA-ES/pool"};
+  for (int k = 0; k < 3; ++k)
+    suite.add(names[k], [optimizer = populations[k], pool](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i) {
+        if (i % 100 == 0)
+          optimizer->reset(glm::vec2(1.0, 2.0));
+        keep(optimizer->step());
+      }
+    });
+}
+
+// vector kernels and a Newton-CG step on the N-D function of src/Objectives.cpp
+void addNdBenchmarks(BenchmarkSuite& suite) {
+  const size_t n = 4096;
+  auto a = std::make_shared<std::vector<double>>(n, 0.5);
+  auto b = std::make_shared<std::vector<double>>(n, 0.25);
+  suite.add("nd/dot/4096", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(dot(a->data(), b->data(), n));
+  });
+  suite.add("nd/axpy/4096", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      axpy(1e-9, a->data(), b->data(), n);
+      keep((*b)[0]);
+    }
+  });
+
+  const size_t dimension = 1000;
+  NdFunction function = neighborObjective(dimension);
+  // Hessian-vector products from the gradient, as for functions that do not
+  // give them
+  function.hessian_vector.reset();
+  auto newton = std::make_shared<NdNewtonCG>(function);
+  auto start = std::make_shared<std::vector<double>>(dimension, 0.3);
+  suite.add("nd/NewtonCG/step/1000", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      newton->reset(start->data());
+      keep(newton->step()[0]);
+    }
+  });
+}
+
+// the font of renderText()
+void addTextBenchmarks(BenchmarkSuite& suite) {
+  // the startup cost of the font: rasterizing the glyphs with FreeType as
+  // graphs used to, or loading the atlas baked at build time
+  suite.add("startup/font/freetype", [](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+      FT_Library ft;
+      FT_Face face;
+      if (FT_Init_FreeType(&ft) || FT_New_Face(ft, SHADER_DIR "/liberation-sans.ttf", 0, &face))
+        throw std::runtime_error("Font not available");
+      FT_Set_Pixel_Sizes(face, 0, 16);
+      for (char c = FontAtlas::first; c <= FontAtlas::last; ++c)
+        FT_Load_Char(face, c, FT_LOAD_RENDER);
+      keep(face->glyph->bitmap.buffer);
+      FT_Done_Face(face);
+      FT_Done_FreeType(ft);
+    }
+  });
+  std::shared_ptr<FontAtlas> atlas;
+  try {
+    atlas = std::make_shared<FontAtlas>(FontAtlas::load(FONT_ATLAS));
+  } catch (const std::exception& e) {
+    std::cerr << "[Info] " << e.what() << ", skipping the font atlas" << std::endl;
+    return;
+  }
+  suite.add("startup/font/atlas", [](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(FontAtlas::load(FONT_ATLAS).pixels.data());
+  });
+  const std::string line = "x:1.234567, y:-0.345678, z: 0.000000, f(x,y): -0.912345";
+  auto vertices = std::make_shared<std::vector<float>>(24 * line.size());
+  suite.add("renderText/layout", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(atlas->layout(line.c_str(), -0.9f, -0.9f, 0.003f, 0.004f, vertices->data()));
+  });
+}
+
+// needs a GL context, skipped when no window can be created
+void addShaderBenchmarks(BenchmarkSuite& suite) {
+  if (!glfwInit()) {
+    std::cerr << "[Info] No display, skipping setUniform" << std::endl;
+    return;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "graphs_bench", NULL, NULL);
+  if (!window) {
+    std::cerr << "[Info] No OpenGL context, skipping setUniform" << std::endl;
+    return;
+  }
+  glfwMakeContextCurrent(window);
+  glewExperimental = GL_TRUE;
+  if (glewInit() != GLEW_OK) {
+    std::cerr << "[Info] GLEW failed, skipping setUniform" << std::endl;
+    return;
+  }
+
+  // shader programs compiled from source, or loaded from a warm program
+  // binary cache
+  auto cache_dir = (std::filesystem::temp_directory_path() / "graphs_bench_programs").string();
+  auto createProgram = [](const std::string& cache_dir) {
+    ShaderProgram program({{SHADER_DIR "/shader.vert.glsl", GL_VERTEX_SHADER},
+                           {SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER}}, cache_dir);
+    glDeleteProgram(program.getHandle());
+    return program.fromCache();
+  };
+  suite.add("startup/program/compile", [=](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(createProgram(""));
+  }, 20);
+  if (!createProgram(cache_dir) && !createProgram(cache_dir))
+    std::cerr << "[Info] No program binaries, skipping startup/program/cache" << std::endl;
+  else
+    suite.add("startup/program/cache", [=](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i)
+        keep(createProgram(cache_dir));
+    }, 20);
+
+#ifdef GRAPHS_EXECUTABLE
+  // the whole startup of graphs, until its first frame is on screen
+  suite.add("startup/first-frame", [](uint64_t iterations) {
+    std::string command = std::string("\"" GRAPHS_EXECUTABLE "\" --first-frame > ") + null_device;
+    for (uint64_t i = 0; i < iterations; ++i)
+      if (std::system(command.c_str()) != 0)
+        throw std::runtime_error("graphs failed to start");
+  }, 5);
+#endif
+
+  static Shader vertexShader(SHADER_DIR "/shader.vert.glsl", GL_VERTEX_SHADER);
+  static Shader fragmentShader(SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER);
+  static ShaderProgram program({vertexShader, fragmentShader});
+  program.use();
+  suite.add("ShaderProgram::setUniform/mat4", [](uint64_t iterations) {
+    glm::mat4 model(1.0);
+    for (uint64_t i = 0; i < iterations; ++i) {
+      model[3][0] = float(i);
+      program.setUniform("model", model);
+    }
+    glFinish();
+  });
+}
+
+// evaluation, assembly and encoding of the whole export, written to the null
+// device so the disk is not measured
+void addHeadlessBenchmarks(BenchmarkSuite& suite) {
+  for (uint32_t samples : {200u, 1000u, 4000u}) {
+    ExportSettings settings;
+    settings.samples = samples;
+    settings.progress = false;
+    suite.add("headless/ply/" + std::to_string(samples), [settings](uint64_t iterations) {
+      for (uint64_t i = 0; i < iterations; ++i)
+        MeshExporter(defaultObjective().function, settings).exportPly(null_device);
+    }, samples >= 4000 ? 3 : samples >= 1000 ? 5 : 0);
+  }
+
+  // the batch computations of graphs_cli, on all cores
+  auto starts = std::make_shared<std::vector<glm::vec2>>();
+  for (int i = 0; i < 1000; ++i)
+    starts->push_back(glm::vec2(i % 40 - 20.0f, i / 40 * 1.6f - 20.0f));
+  suite.add("headless/optimize/1000", [starts](uint64_t iterations) {
+    Objective function = defaultObjective();
+    RunSettings settings;
+    settings.max_steps = 100;
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(runOptimizers(function, OptimizerMethod::Newton, *starts, settings).size());
+  }, 5);
+  suite.add("headless/sample/1000", [](uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; ++i)
+      keep(sampleGrid(defaultObjective().function, std::nullopt, glm::vec2(-10.0f), 0.02f, 1000)[0]);
+  }, 5);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  // a process of the workers cases, see ProcessPool
+  if (argc > 1 && std::string(argv[1]) == "--eval-worker")
+    return ProcessPool::workerMain(std::vector<std::string>(argv + 2, argv + argc));
+  BenchmarkOptions options;
+  std::string json_path, baseline_path, compare_path;
+  double threshold = 0.1;
+  try {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i) {
+      auto next = [&]() {
+        if (i + 1 >= args.size())
+          throw std::invalid_argument("Missing value for " + args[i]);
+        return args[++i];
+      };
+      if (args[i] == "--filter")
+        options.filter = next();
+      else if (args[i] == "--min-time")
+        options.min_time = std::stod(next());
+      else if (args[i] == "--json")
+        json_path = next();
+      else if (args[i] == "--baseline")
+        baseline_path = next();
+      else if (args[i] == "--threshold")
+        threshold = std::stod(next());
+      else if (args[i] == "--compare")
+        compare_path = next();
+      else
+        throw std::invalid_argument("Unknown option " + args[i]);
+    }
+
+    std::vector<BenchmarkResult> results;
+    if (!compare_path.empty())
+      results = readJson(compare_path);
+    else {
+      BenchmarkSuite suite;
+      addMeshBenchmarks(suite);
+      addAnimationBenchmarks(suite);
+      addRefineBenchmarks(suite);
+      addSurrogateBenchmarks(suite);
+      addQuiverBenchmarks(suite);
+      addNormalMapBenchmarks(suite);
+      addProcessPoolBenchmarks(suite);
+      addPickBenchmarks(suite);
+      addCriticalBenchmarks(suite);
+      addRegionBenchmarks(suite);
+      addOptimizerBenchmarks(suite);
+      addNdBenchmarks(suite);
+      addTextBenchmarks(suite);
+      addShaderBenchmarks(suite);
+      addHeadlessBenchmarks(suite);
+      results = suite.run(options);
+    }
+
+    if (!json_path.empty())
+      writeJson(json_path, results);
+    if (!baseline_path.empty()) {
+      int slower = compareWithBaseline(results, readJson(baseline_path), threshold);
+      if (slower) {
+        std::cout << slower << " benchmarks slower than the baseline" << std::endl;
+        return 2;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,465 @@
+// graphs_cli optimize [--method gd|newton|cmaes|de] [--starts N] [--seed S] [--steps N]
+//                     [--tolerance T] [--step-size S] [--population N] [--spread S]
+//                     [--extent E] [--center X Y]
+// graphs_cli sample [--samples N] [--extent E] [--center X Y]
+// graphs_cli integrate [--extent E] [--center X Y] [--threshold T] [--tolerance T]
+//                      [--evaluations N] [--seed S]
+// graphs_cli export <file.ply|file.gltf> [--samples N] [--tile N] [--extent E]
+//                   [--center X Y] [--threads N]
+// graphs_cli pack <points.csv> <file.points>
+//
+// with [--plugin <file.so> | --data <file> | --dimension N] [--workers N] [--threads N]
+//      [--format csv|json] [--output <file>]
+//
+// The computations of graphs without a window, for batch studies on machines
+// without a display: optimizers run from random starts in the square (the
+// cube with --dimension) of side extent around center, or the function
+// sampled on a grid over it, on all cores. The results go to the output (the
+// standard output by default) as CSV or JSON, a summary to the standard error.
+// cmaes and de are derivative free, a step is a generation of their population.
+// sample also writes the grid file of --data (--format grid), pack converts
+// x,y,value lines to the point file of --data. integrate estimates the
+// integral, mean, extremes and volume and area above the threshold over the
+// square, with their error bars.
+
+#include <BatchRuns.hpp>
+#include <CommandLine.hpp>
+#include <DataSource.hpp>
+#include <Objectives.hpp>
+#include <Plugin.hpp>
+#include <ProcessPool.hpp>
+#include <RegionStats.hpp>
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// numbers in the output, JSON has no NaN nor infinities
+void writeNumber(std::ostream& out, double x, bool json) {
+  if (json && !std::isfinite(x))
+    out << "null";
+  else
+    out << x;
+}
+
+void writeVector(std::ostream& out, const std::vector<double>& x, bool json) {
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (i)
+      out << (json ? ", " : ",");
+    writeNumber(out, x[i], json);
+  }
+}
+
+double elapsedSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int optimize(const Objective& objective, const std::optional<NdFunction>& nd_function,
+             std::vector<std::string> args, bool json, std::ostream& out) {
+  OptimizerMethod method = OptimizerMethod::GradientDescent;
+  RunSettings settings;
+  size_t start_count = 100;
+  unsigned seed = 0;
+  float extent = 20.0f;
+  glm::vec2 center(0.0f);
+  for (size_t i = 0; i < args.size(); ++i) {
+    auto next = [&]() {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument("Missing value for " + args[i]);
+      return args[++i];
+    };
+    if (args[i] == "--method")
+      method = optimizerMethod(next());
+    else if (args[i] == "--starts")
+      start_count = std::stoul(next());
+    else if (args[i] == "--seed")
+      seed = std::stoul(next());
+    else if (args[i] == "--steps")
+      settings.max_steps = std::stoul(next());
+    else if (args[i] == "--tolerance")
+      settings.tolerance = std::stod(next());
+    else if (args[i] == "--step-size")
+      settings.step_size = std::stod(next());
+    else if (args[i] == "--population")
+      settings.population = std::stoul(next());
+    else if (args[i] == "--spread")
+      settings.spread = std::stod(next());
+    else if (args[i] == "--threads")
+      settings.threads = std::stoul(next());
+    else if (args[i] == "--extent")
+      extent = std::stof(next());
+    else if (args[i] == "--center") {
+      center.x = std::stof(next());
+      center.y = std::stof(next());
+    }
+    else
+      throw std::invalid_argument("Unknown option " + args[i]);
+  }
+
+  // the starts are drawn before the runs, so they only depend on the seed
+  settings.seed = seed;
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> offset(-0.5 * extent, 0.5 * extent);
+  size_t n = nd_function ? nd_function->dimension : 2;
+  auto start_time = std::chrono::steady_clock::now();
+  std::vector<OptimizerRun> runs;
+  if (nd_function) {
+    std::vector<std::vector<double>> starts(start_count, std::vector<double>(n));
+    for (auto &start : starts)
+      for (size_t k = 0; k < n; ++k)
+        start[k] = (k == 0 ? center.x : k == 1 ? center.y : 0.0) + offset(random);
+    runs = runOptimizers(*nd_function, method, starts, settings);
+  }
+  else {
+    std::vector<glm::vec2> starts(start_count);
+    for (auto &start : starts) {
+      start.x = center.x + offset(random);
+      start.y = center.y + offset(random);
+    }
+    runs = runOptimizers(objective, method, starts, settings);
+  }
+  double seconds = elapsedSince(start_time);
+
+  out.precision(nd_function ? 17 : 9);
+  if (json) {
+    out << "{\"method\": \"" << optimizerMethodName(method) << "\", \"dimension\": " << n << ", \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+      const OptimizerRun& run = runs[i];
+      out << "  {\"start\": [";
+      writeVector(out, run.start, true);
+      out << "], \"end\": [";
+      writeVector(out, run.end, true);
+      out << "], \"value\": ";
+      writeNumber(out, run.value, true);
+      out << ", \"gradient_norm\": ";
+      writeNumber(out, run.gradient_norm, true);
+      out << ", \"steps\": " << run.steps << ", \"status\": \"" << runStatusName(run.status) << "\"}"
+          << (i + 1 < runs.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+  }
+  else {
+    out << "run";
+    for (size_t k = 0; k < n; ++k)
+      out << ",start_" << k;
+    for (size_t k = 0; k < n; ++k)
+      out << ",end_" << k;
+    out << ",value,gradient_norm,steps,status\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+      const OptimizerRun& run = runs[i];
+      out << i << ',';
+      writeVector(out, run.start, false);
+      out << ',';
+      writeVector(out, run.end, false);
+      out << ',' << run.value << ',' << run.gradient_norm << ',' << run.steps << ','
+          << runStatusName(run.status) << '\n';
+    }
+  }
+
+  size_t converged = std::count_if(runs.begin(), runs.end(), [](const OptimizerRun& run) {
+    return run.status == OptimizerRun::Status::Converged;
+  });
+  auto best = std::min_element(runs.begin(), runs.end(), [](const OptimizerRun& a, const OptimizerRun& b) {
+    return a.status != OptimizerRun::Status::Failed &&
+           (b.status == OptimizerRun::Status::Failed || a.value < b.value);
+  });
+  std::cerr << "[Info] " << runs.size() << " runs in " << int(std::round(1000.0 * seconds)) << " ms, "
+            << converged << " converged";
+  if (best != runs.end() && best->status != OptimizerRun::Status::Failed)
+    std::cerr << ", best f: " << best->value << " after " << best->steps << " steps";
+  if (method == OptimizerMethod::CmaEs || method == OptimizerMethod::DifferentialEvolution) {
+    size_t evaluations = 0;
+    for (auto &run : runs)
+      evaluations += run.evaluations;
+    std::cerr << ", " << evaluations / std::max<size_t>(runs.size(), 1) << " evaluations per run";
+  }
+  std::cerr << std::endl;
+  return 0;
+}
+
+int sample(const Objective& objective, std::vector<std::string> args, const std::string& format, std::ostream& out) {
+  uint32_t samples = 256;
+  unsigned threads = 0;
+  float extent = 20.0f;
+  glm::vec2 center(0.0f);
+  for (size_t i = 0; i < args.size(); ++i) {
+    auto next = [&]() {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument("Missing value for " + args[i]);
+      return args[++i];
+    };
+    if (args[i] == "--samples")
+      samples = std::stoul(next());
+    else if (args[i] == "--threads")
+      threads = std::stoul(next());
+    else if (args[i] == "--extent")
+      extent = std::stof(next());
+    else if (args[i] == "--center") {
+      center.x = std::stof(next());
+      center.y = std::stof(next());
+    }
+    else
+      throw std::invalid_argument("Unknown option " + args[i]);
+  }
+  if (samples < 2)
+    throw std::invalid_argument("--samples must be at least 2");
+
+  glm::vec2 origin = center - glm::vec2(0.5f * extent);
+  float spacing = extent / (samples - 1);
+  auto start_time = std::chrono::steady_clock::now();
+  std::vector<float> values = sampleGrid(objective.function, objective.batch, origin, spacing, samples, threads);
+  double seconds = elapsedSince(start_time);
+
+  out.precision(9);
+  if (format == "grid") {
+    GridSource::writeHeader(out, samples, samples, origin, glm::dvec2(spacing));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  }
+  else if (format == "json") {
+    out << "{\"samples\": " << samples << ", \"origin\": [" << origin.x << ", " << origin.y
+        << "], \"spacing\": " << spacing << ", \"values\": [\n";
+    for (uint32_t y = 0; y < samples; ++y) {
+      out << "  [";
+      for (uint32_t x = 0; x < samples; ++x) {
+        if (x)
+          out << ", ";
+        writeNumber(out, values[size_t(y) * samples + x], true);
+      }
+      out << (y + 1 < samples ? "],\n" : "]\n");
+    }
+    out << "]}\n";
+  }
+  else {
+    out << "x,y,value\n";
+    for (uint32_t y = 0; y < samples; ++y)
+      for (uint32_t x = 0; x < samples; ++x) {
+        glm::vec2 p = origin + spacing * glm::vec2(x, y);
+        out << p.x << ',' << p.y << ',' << values[size_t(y) * samples + x] << '\n';
+      }
+  }
+
+  float lowest = INFINITY, highest = -INFINITY;
+  for (float value : values)
+    if (std::isfinite(value)) {
+      lowest = std::min(lowest, value);
+      highest = std::max(highest, value);
+    }
+  std::cerr << "[Info] " << values.size() << " samples in " << int(std::round(1000.0 * seconds)) << " ms, "
+            << int(values.size() / std::max(seconds, 1e-9) / 1e6) << " M samples/s, f in [" << lowest << ", "
+            << highest << "]" << std::endl;
+  return 0;
+}
+
+int integrate(const Objective& objective, std::vector<std::string> args, bool json, std::ostream& out) {
+  RegionIntegrator::Settings settings;
+  unsigned threads = 0;
+  float extent = 20.0f;
+  glm::vec2 center(0.0f);
+  for (size_t i = 0; i < args.size(); ++i) {
+    auto next = [&]() {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument("Missing value for " + args[i]);
+      return args[++i];
+    };
+    if (args[i] == "--threshold")
+      settings.threshold = std::stof(next());
+    else if (args[i] == "--tolerance")
+      settings.tolerance = std::stod(next());
+    else if (args[i] == "--evaluations")
+      settings.max_evaluations = std::stoull(next());
+    else if (args[i] == "--seed")
+      settings.seed = std::stoul(next());
+    else if (args[i] == "--threads")
+      threads = std::stoul(next());
+    else if (args[i] == "--extent")
+      extent = std::stof(next());
+    else if (args[i] == "--center") {
+      center.x = std::stof(next());
+      center.y = std::stof(next());
+    }
+    else
+      throw std::invalid_argument("Unknown option " + args[i]);
+  }
+  if (!(extent > 0.0f))
+    throw std::invalid_argument("--extent must be positive");
+
+  settings.lower = center - glm::vec2(0.5f * extent);
+  settings.upper = center + glm::vec2(0.5f * extent);
+  ThreadPool pool(threads);
+  RegionIntegrator integrator(objective.function, objective.batch, pool, settings);
+  auto start_time = std::chrono::steady_clock::now();
+  while (!integrator.refine(1.0))
+    continue;
+  double seconds = elapsedSince(start_time);
+  const RegionStatistics& stats = integrator.statistics();
+
+  struct Row {
+    const char* name;
+    double value, error;
+  };
+  const Row rows[] = {
+    {"integral", stats.integral.value, stats.integral.error},
+    {"mean", stats.mean.value, stats.mean.error},
+    {"volume_above", stats.volume.value, stats.volume.error},
+    {"qmc_integral", stats.qmc_integral.value, stats.qmc_integral.error},
+    {"qmc_volume_above", stats.qmc_volume.value, stats.qmc_volume.error},
+    {"qmc_area_above", stats.qmc_area.value, stats.qmc_area.error},
+    {"min", stats.min, 0.0},
+    {"max", stats.max, 0.0},
+  };
+  out.precision(17);
+  if (json) {
+    out << "{\"threshold\": " << settings.threshold << ", \"statistics\": {\n";
+    for (size_t i = 0; i < std::size(rows); ++i) {
+      out << "  \"" << rows[i].name << "\": {\"value\": ";
+      writeNumber(out, rows[i].value, true);
+      out << ", \"error\": ";
+      writeNumber(out, rows[i].error, true);
+      out << (i + 1 < std::size(rows) ? "},\n" : "}\n");
+    }
+    out << "}, \"argmin\": [" << stats.argmin.x << ", " << stats.argmin.y << "], \"argmax\": [" << stats.argmax.x
+        << ", " << stats.argmax.y << "], \"evaluations\": " << stats.evaluations << ", \"converged\": "
+        << (stats.converged ? "true" : "false") << "}\n";
+  }
+  else {
+    out << "statistic,value,error\n";
+    for (auto &row : rows)
+      out << row.name << ',' << row.value << ',' << row.error << '\n';
+  }
+  std::cerr << "[Info] " << stats.evaluations << " evaluations in " << int(std::round(1000.0 * seconds)) << " ms, "
+            << stats.boxes << " boxes, " << stats.qmc_points << " QMC points per shift, "
+            << (stats.converged ? "converged" : "not converged") << std::endl;
+  return 0;
+}
+
+// streams the lines x,y,value of a CSV file into a point file, lines that do
+// not start with a number (a header) are skipped
+int pack(const std::vector<std::string>& args) {
+  if (args.size() != 2)
+    throw std::invalid_argument("Usage: graphs_cli pack <points.csv> <file.points>");
+  std::ifstream in(args[0]);
+  if (!in)
+    throw std::runtime_error("Cannot read " + args[0]);
+  std::ofstream out(args[1], std::ios::binary);
+  if (!out)
+    throw std::runtime_error("Cannot write " + args[1]);
+  // the count is known at the end, the header is written again then
+  PointSource::writeHeader(out, 0);
+  uint64_t count = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+    PointSource::Point point;
+    if (!(fields >> point.x >> point.y >> point.height))
+      continue;
+    out.write(reinterpret_cast<const char*>(&point), sizeof(point));
+    ++count;
+  }
+  out.seekp(0);
+  PointSource::writeHeader(out, count);
+  if (!out)
+    throw std::runtime_error("Cannot write " + args[1]);
+  std::cerr << "[Info] " << count << " points written to " << args[1] << std::endl;
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  // a process of --workers, see ProcessPool
+  if (argc > 1 && std::string(argv[1]) == "--eval-worker")
+    return ProcessPool::workerMain(std::vector<std::string>(argv + 2, argv + argc));
+  std::vector<std::string> args(argv + 1, argv + argc);
+  try {
+    if (args.empty())
+      throw std::invalid_argument("Usage: graphs_cli optimize|sample|integrate|export|pack [options], "
+                                  "see cli/main.cpp");
+    std::string command = args[0];
+    args.erase(args.begin());
+    if (command == "pack")
+      return pack(args);
+
+    Objective objective = defaultObjective();
+    std::optional<NdFunction> nd_function;
+    std::shared_ptr<Plugin> plugin;
+    std::string plugin_path = takeOption(args, "--plugin");
+    if (!plugin_path.empty()) {
+      plugin = std::make_shared<Plugin>(plugin_path);
+      objective = Objective{plugin->function(), plugin->gradient(), plugin->hessian(), plugin->batch()};
+    }
+    std::shared_ptr<DataSource> data;
+    std::string data_path = takeOption(args, "--data");
+    if (!data_path.empty()) {
+      if (plugin)
+        throw std::invalid_argument("--data cannot be combined with --plugin");
+      data = DataSource::open(data_path);
+      objective = Objective{data->function(), data->gradientFunction(), std::nullopt, data->batch()};
+    }
+    std::string dimension = takeOption(args, "--dimension");
+    if (!dimension.empty()) {
+      int n = std::stoi(dimension);
+      if (n < 2)
+        throw std::invalid_argument("--dimension must be at least 2");
+      if (plugin || data)
+        throw std::invalid_argument("--dimension cannot be combined with --plugin or --data");
+      nd_function = neighborObjective(n);
+      // sampling and exports show the first two axes
+      objective = Objective{firstAxes(*nd_function)};
+    }
+    std::shared_ptr<ProcessPool> process_pool;
+    std::string workers = takeOption(args, "--workers");
+    if (!workers.empty()) {
+      if (data || nd_function)
+        throw std::invalid_argument("--workers cannot be combined with --data or --dimension");
+      process_pool = std::make_shared<ProcessPool>(plugin_path, std::stoul(workers));
+      objective = Objective{process_pool->function(), process_pool->gradient(), process_pool->hessian(),
+                            process_pool->batch()};
+    }
+
+    if (command == "export")
+      return exportMesh(objective.function, objective.batch, [&]() {
+        std::vector<std::string> export_args{"--export"};
+        export_args.insert(export_args.end(), args.begin(), args.end());
+        return export_args;
+      }());
+
+    std::string format = takeOption(args, "--format");
+    if (!format.empty() && format != "csv" && format != "json" && !(command == "sample" && format == "grid"))
+      throw std::invalid_argument("Unknown format " + format + ", expected csv or json");
+    bool json = format == "json";
+    std::string output_path = takeOption(args, "--output");
+    if (format == "grid" && output_path.empty())
+      throw std::invalid_argument("--format grid needs --output");
+    std::ofstream file;
+    if (!output_path.empty()) {
+      file.open(output_path, std::ios::binary);
+      if (!file)
+        throw std::runtime_error("Cannot write " + output_path);
+    }
+    std::ostream& out = output_path.empty() ? std::cout : file;
+
+    if (command == "optimize")
+      return optimize(objective, nd_function, args, json, out);
+    if (command == "sample")
+      return sample(objective, args, format, out);
+    if (command == "integrate")
+      return integrate(objective, args, json, out);
+    throw std::invalid_argument("Unknown command " + command +
+                                ", expected optimize, sample, integrate, export or pack");
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
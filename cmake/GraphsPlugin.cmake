@@ -0,0 +1,18 @@
+# add_graphs_plugin(<name> <sources>...)
+#
+# Builds a function plugin that can be loaded with `graphs --plugin`. Only the
+# symbols marked FGI_EXPORT are visible.
+
+set(GRAPHS_PLUGIN_INCLUDE_DIR ${CMAKE_CURRENT_LIST_DIR}/../src)
+
+function(add_graphs_plugin name)
+  add_library(${name} MODULE ${ARGN})
+  set_target_properties(${name} PROPERTIES
+    PREFIX ""
+    CXX_STANDARD 17
+    CXX_VISIBILITY_PRESET hidden
+    VISIBILITY_INLINES_HIDDEN ON
+  )
+  target_include_directories(${name} PRIVATE ${GRAPHS_PLUGIN_INCLUDE_DIR})
+  target_compile_options(${name} PRIVATE -Wall)
+endfunction()
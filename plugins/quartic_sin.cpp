@@ -0,0 +1,32 @@
+// The default function of src/Objectives.cpp as a plugin:
+//   f(x, y) = 0.0001 x^4 + 0.0001 y^4 + sin(x + y)
+#include <PluginAbi.h>
+#include <cmath>
+
+FGI_EXPORT uint32_t fgi_abi_version() {
+  return FGI_PLUGIN_ABI_VERSION;
+}
+
+FGI_EXPORT float fgi_value(float x, float y) {
+  return 0.0001f * std::pow(x, 4) + 0.0001f * std::pow(y, 4) + std::sin(x + y);
+}
+
+FGI_EXPORT void fgi_gradient(float x, float y, float* gradient) {
+  gradient[0] = 0.0001f * 4 * std::pow(x, 3) + std::cos(x + y);
+  gradient[1] = 0.0001f * 4 * std::pow(y, 3) + std::cos(x + y);
+}
+
+FGI_EXPORT void fgi_hessian(float x, float y, float* hessian) {
+  hessian[0] = 0.0001f * 12.0f * x * x - std::sin(x + y);
+  hessian[1] = -std::sin(x + y);
+  hessian[2] = -std::sin(x + y);
+  hessian[3] = 0.0001f * 12.0f * y * y - std::sin(x + y);
+}
+
+FGI_EXPORT void fgi_value_batch(const float* points, float* values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    float x = points[2 * i], y = points[2 * i + 1];
+    float x2 = x * x, y2 = y * y;
+    values[i] = 0.0001f * (x2 * x2 + y2 * y2) + std::sin(x + y);
+  }
+}
@@ -0,0 +1,35 @@
+#version 150
+
+// one arrow of the gradient overlay per instance
+in vec2 shape;         // along the arrow from 0 to 1, across it
+in vec4 arrow_base;    // per instance: on the graph; w: width of the shaft
+in vec4 arrow_vector;  // per instance: uphill, as long as the arrow; w: relative magnitude
+
+uniform mat4 projection;
+uniform mat4 view;
+
+out vec4 fPosition;
+out vec4 fColor;
+out vec4 fLightPosition;
+out vec3 fNormal;
+out vec2 fGround;
+
+void main(void)
+{
+    vec3 along = arrow_vector.xyz;
+    vec3 across = vec3(-along.y, along.x, 0.0);
+    float l = length(across);
+    across = l > 0.0 ? across / l : vec3(1.0, 0.0, 0.0);
+    float width = arrow_base.w * (0.3 + 0.7 * arrow_vector.w);
+    vec3 position = arrow_base.xyz + shape.x * along + shape.y * width * across;
+
+    fPosition = view * vec4(position, 1.0);
+    fLightPosition = view * vec4(0.0, 0.0, 100.0, 1.0);
+    // blue for the smallest gradients to red for the largest
+    fColor = vec4(mix(vec3(0.1, 0.3, 1.0), vec3(1.0, 0.15, 0.1), arrow_vector.w), 1.0);
+    vec3 normal = cross(along, across);
+    fNormal = vec3(view * vec4(length(normal) > 0.0 ? normalize(normal) : vec3(0.0, 0.0, 1.0), 0.0));
+    fGround = position.xy;
+
+    gl_Position = projection * fPosition;
+}
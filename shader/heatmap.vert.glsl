@@ -0,0 +1,15 @@
+#version 150
+
+// the graph seen from above, one quad drawn as a strip of 4 vertices
+uniform mat4 projection;
+uniform vec4 region;  // xy: first sample, z: side, w: samples per side
+
+out vec2 texcoord;
+
+void main(void)
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    // the samples are at the texel centers
+    texcoord = (0.5 + corner * (region.w - 1.0)) / region.w;
+    gl_Position = projection * vec4(region.xy + region.z * corner, 0.0, 1.0);
+}
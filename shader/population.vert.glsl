@@ -0,0 +1,31 @@
+#version 150
+
+// one member of the population of an optimizer per instance
+in vec3 position;  // of the helper sphere, of radius 1
+in vec3 normal;
+in vec4 member;    // per instance: on the graph; w: rank, 0 for the best to 1 for the worst
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform float radius;
+
+out vec4 fPosition;
+out vec4 fColor;
+out vec4 fLightPosition;
+out vec3 fNormal;
+out vec2 fGround;
+
+void main(void)
+{
+    // the best members are the largest
+    vec3 world = member.xyz + radius * (1.0 - 0.5 * member.w) * position;
+
+    fPosition = view * vec4(world, 1.0);
+    fLightPosition = view * vec4(0.0, 0.0, 100.0, 1.0);
+    // yellow for the best to purple for the worst
+    fColor = vec4(mix(vec3(1.0, 0.85, 0.1), vec3(0.55, 0.1, 0.8), member.w), 1.0);
+    fNormal = vec3(view * vec4(normal, 0.0));
+    fGround = world.xy;
+
+    gl_Position = projection * fPosition;
+}
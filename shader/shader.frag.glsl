@@ -4,6 +4,16 @@ in vec4 fPosition;
 in vec4 fColor;
 in vec4 fLightPosition;
 in vec3 fNormal;
+in vec2 fGround;
+
+uniform mat4 view;
+// normal map of the graph: gradients on a lattice of spacing normal_spacing,
+// lattice point p in texel p mod normal_texels
+uniform int normal_mapping;
+uniform sampler2D normal_map;
+uniform float normal_texels;
+uniform float normal_spacing;
+uniform float normal_scale;
 
 // output
 out vec4 color;
@@ -12,6 +22,10 @@ void main(void)
 {       
     vec3 o = -normalize(fPosition.xyz);
     vec3 n = normalize(fNormal);
+    if (normal_mapping != 0) {
+        vec2 g = texture(normal_map, (fGround / normal_spacing + 0.5) / normal_texels).rg;
+        n = normalize(vec3(view * vec4(-normal_scale * g, 1.0, 0.0)));
+    }
     vec3 r = reflect(o,n);
     vec3 l = normalize(fLightPosition.xyz - fPosition.xyz);
 
@@ -12,6 +12,7 @@ out vec4 fPosition;
 out vec4 fColor;
 out vec4 fLightPosition;
 out vec3 fNormal;
+out vec2 fGround;  // world position under the fragment, of the normal map
 
 void main(void)
 {
@@ -20,6 +21,7 @@ void main(void)
 
     fColor = color;
     fNormal = vec3(view * vec4(normal, 0.0));
+    fGround = (model * vec4(position, 1.0)).xy;
 
     gl_Position = projection * fPosition;
     /*gl_Position.x *= 1000.0f;*/
@@ -0,0 +1,71 @@
+#include "AllocationCounter.hpp"
+
+#ifdef GRAPHS_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local uint64_t allocations = 0;
+
+void* allocate(std::size_t size) {
+  ++allocations;
+  return std::malloc(size ? size : 1);
+}
+}  // namespace
+
+uint64_t threadAllocationCount() {
+  return allocations;
+}
+
+void* operator new(std::size_t size) {
+  if (void* p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  if (void* p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+#else
+
+uint64_t threadAllocationCount() {
+  return 0;
+}
+
+#endif
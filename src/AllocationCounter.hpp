@@ -0,0 +1,17 @@
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+#include <cstdint>
+
+// Heap allocations made by the calling thread through operator new. They are
+// only counted when built with GRAPHS_COUNT_ALLOCATIONS, which replaces the
+// global operators of the whole program; the count stays 0 otherwise.
+#ifdef GRAPHS_COUNT_ALLOCATIONS
+constexpr bool counting_allocations = true;
+#else
+constexpr bool counting_allocations = false;
+#endif
+
+uint64_t threadAllocationCount();
+
+#endif // ALLOCATIONCOUNTER_HPP
@@ -0,0 +1,68 @@
+#ifndef ANIMATION_HPP
+#define ANIMATION_HPP
+
+#include <utils.hpp>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+// Functions that also depend on a parameter t: the time of an animation, or
+// the value swept by a slider over a family of functions
+using timed_func_t = std::function<float(glm::vec2, float)>;
+using timed_grad_t = std::function<glm::vec2(glm::vec2, float)>;
+using timed_hess_t = std::function<glm::mat2(glm::vec2, float)>;
+
+// batch_t of a timed function, all points at the same t
+struct timed_batch_t {
+  void (*evaluate)(const void* context, const glm::vec2* points, float t, float* values, size_t count) = nullptr;
+  const void* context = nullptr;
+
+  void operator()(const glm::vec2* points, float t, float* values, size_t count) const {
+    evaluate(context, points, t, values, count);
+  }
+};
+
+struct TimedFunction {
+  timed_func_t value;
+  std::optional<timed_grad_t> gradient;
+  std::optional<timed_hess_t> hessian;
+  std::optional<timed_batch_t> batch;
+
+  // values at count points at t, in one batch call when batch is given
+  void evaluate(const glm::vec2* points, float t, float* values, size_t count) const {
+    if (batch) {
+      (*batch)(points, t, values, count);
+      return;
+    }
+    for (size_t i = 0; i < count; ++i)
+      values[i] = value(points[i], t);
+  }
+
+  // the function at a fixed t
+  func_t at(float t) const {
+    return [value = value, t](glm::vec2 position) { return value(position, t); };
+  }
+};
+
+// Playback of t, advanced by the update thread
+struct Animation {
+  float begin = 0.0f, end = 2.0f * float(M_PI);  // t wraps around [begin, end)
+  float speed = 1.0f;  // t per second
+  bool playing = true;
+  double budget = 0.008;  // seconds of evaluation per refresh of the graph
+  float t = 0.0f;
+
+  // moves t by seconds of playback
+  void advance(double seconds) {
+    float length = end - begin;
+    if (length <= 0.0f) {
+      t = begin;
+      return;
+    }
+    float offset = std::fmod(t - begin + float(seconds * speed), length);
+    t = begin + (offset < 0.0f ? offset + length : offset);
+  }
+};
+
+#endif // ANIMATION_HPP
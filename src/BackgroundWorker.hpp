@@ -0,0 +1,87 @@
+#ifndef BACKGROUNDWORKER_HPP
+#define BACKGROUNDWORKER_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs one job at a time on a thread of its own. Unlike std::async, starting
+// and collecting a job does not allocate: the job is a value that is moved to
+// the worker, processed in place and moved back.
+template <class Job>
+class BackgroundWorker {
+public:
+  explicit BackgroundWorker(std::function<void(Job&)> process)
+      : process(std::move(process)), thread([this]() { work(); }) {}
+
+  ~BackgroundWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+  }
+
+  // no job is running or waiting to be collected
+  bool idle() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state == State::Idle;
+  }
+
+  // hands a job to the worker, which must be idle
+  void start(Job next) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = std::move(next);
+      state = State::Running;
+    }
+    changed.notify_all();
+  }
+
+  // moves the finished job to out and makes the worker idle, returns false
+  // while the job runs or when there is none
+  bool finish(Job& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (state != State::Finished)
+      return false;
+    out = std::move(job);
+    state = State::Idle;
+    return true;
+  }
+
+  // blocks until the running job, if any, is finished
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return state != State::Running; });
+  }
+
+private:
+  enum class State { Idle, Running, Finished };
+
+  std::function<void(Job&)> process;
+  mutable std::mutex mutex;
+  std::condition_variable changed;
+  State state = State::Idle;
+  bool stopping = false;
+  Job job;
+  std::thread thread;
+
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      changed.wait(lock, [this]() { return stopping || state == State::Running; });
+      if (stopping)
+        return;
+      // the job is only touched by this thread while it runs
+      lock.unlock();
+      process(job);
+      lock.lock();
+      state = State::Finished;
+      changed.notify_all();
+    }
+  }
+};
+
+#endif // BACKGROUNDWORKER_HPP
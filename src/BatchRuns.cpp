@@ -0,0 +1,190 @@
+#include "BatchRuns.hpp"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include "NdOptimizers.hpp"
+#include "Optimizers.hpp"
+#include "PopulationOptimizers.hpp"
+#include "ThreadPool.hpp"
+#include "VectorKernels.hpp"
+
+OptimizerMethod optimizerMethod(const std::string& name) {
+  if (name == "gd")
+    return OptimizerMethod::GradientDescent;
+  if (name == "newton")
+    return OptimizerMethod::Newton;
+  if (name == "cmaes")
+    return OptimizerMethod::CmaEs;
+  if (name == "de")
+    return OptimizerMethod::DifferentialEvolution;
+  throw std::invalid_argument("Unknown method " + name + ", expected gd, newton, cmaes or de");
+}
+
+const char* optimizerMethodName(OptimizerMethod method) {
+  switch (method) {
+    case OptimizerMethod::GradientDescent:
+      return "gd";
+    case OptimizerMethod::Newton:
+      return "newton";
+    case OptimizerMethod::CmaEs:
+      return "cmaes";
+    case OptimizerMethod::DifferentialEvolution:
+      return "de";
+  }
+  return "";
+}
+
+namespace {
+
+bool populationMethod(OptimizerMethod method) {
+  return method == OptimizerMethod::CmaEs || method == OptimizerMethod::DifferentialEvolution;
+}
+
+// a population method from every start, each run evaluates its generations
+// on its own thread
+std::vector<OptimizerRun> runPopulations(const Objective& objective, OptimizerMethod method,
+                                         const std::vector<glm::vec2>& starts, const RunSettings& settings) {
+  std::vector<OptimizerRun> runs(starts.size());
+  ThreadPool pool(settings.threads);
+  pool.parallelFor(0, starts.size(), [&](size_t i) {
+    PopulationSettings population;
+    population.population = settings.population;
+    population.spread = float(settings.spread);
+    population.seed = uint32_t(settings.seed + i);
+    std::unique_ptr<PopulationOptimizer> optimizer;
+    if (method == OptimizerMethod::CmaEs)
+      optimizer = std::make_unique<CmaEs>(objective.function, objective.batch, nullptr, population);
+    else
+      optimizer = std::make_unique<DifferentialEvolution>(objective.function, objective.batch, nullptr,
+                                                          population);
+    OptimizerRun& run = runs[i];
+    optimizer->reset(starts[i]);
+    while (!optimizer->converged(float(settings.tolerance)) && run.steps < settings.max_steps) {
+      optimizer->step();
+      ++run.steps;
+    }
+    glm::vec2 point = optimizer->best();
+    run.start = {starts[i].x, starts[i].y};
+    run.end = {point.x, point.y};
+    run.value = optimizer->bestValue();
+    run.gradient_norm = objective.gradient ? glm::length((*objective.gradient)(point)) : std::numeric_limits<double>::quiet_NaN();
+    run.evaluations = optimizer->evaluationCount();
+    if (!std::isfinite(run.value))
+      run.status = OptimizerRun::Status::Failed;
+    else if (optimizer->converged(float(settings.tolerance)))
+      run.status = OptimizerRun::Status::Converged;
+  });
+  return runs;
+}
+
+} // namespace
+
+const char* runStatusName(OptimizerRun::Status status) {
+  switch (status) {
+    case OptimizerRun::Status::Converged:
+      return "converged";
+    case OptimizerRun::Status::MaxSteps:
+      return "max-steps";
+    case OptimizerRun::Status::Failed:
+      return "failed";
+  }
+  return "";
+}
+
+std::vector<OptimizerRun> runOptimizers(const Objective& objective, OptimizerMethod method,
+                                        const std::vector<glm::vec2>& starts, const RunSettings& settings) {
+  if (populationMethod(method))
+    return runPopulations(objective, method, starts, settings);
+  if (!objective.gradient)
+    throw std::invalid_argument("runOptimizers: the gradient is not defined");
+  if (method == OptimizerMethod::Newton && !objective.hessian)
+    throw std::invalid_argument("runOptimizers: the Hessian is not defined");
+  const grad_t& gradient = *objective.gradient;
+  std::vector<OptimizerRun> runs(starts.size());
+  ThreadPool pool(settings.threads);
+  pool.parallelFor(0, starts.size(), [&](size_t i) {
+    std::unique_ptr<Optimizer> optimizer;
+    if (method == OptimizerMethod::Newton)
+      optimizer = std::make_unique<Newton>(objective.function, gradient, *objective.hessian);
+    else
+      optimizer = std::make_unique<GradientDescent>(objective.function, gradient, float(settings.step_size));
+    OptimizerRun& run = runs[i];
+    glm::vec2 point = starts[i];
+    optimizer->reset(point);
+    // the gradient at the iterate decides when to stop
+    float norm = glm::length(gradient(point));
+    while (std::isfinite(norm) && norm > settings.tolerance && run.steps < settings.max_steps) {
+      point = optimizer->step();
+      norm = glm::length(gradient(point));
+      ++run.steps;
+    }
+    float value = objective.function(point);
+    run.start = {starts[i].x, starts[i].y};
+    run.end = {point.x, point.y};
+    run.value = value;
+    run.gradient_norm = norm;
+    if (!std::isfinite(norm) || !std::isfinite(value))
+      run.status = OptimizerRun::Status::Failed;
+    else if (norm <= settings.tolerance)
+      run.status = OptimizerRun::Status::Converged;
+  });
+  return runs;
+}
+
+std::vector<OptimizerRun> runOptimizers(const NdFunction& function, OptimizerMethod method,
+                                        const std::vector<std::vector<double>>& starts, const RunSettings& settings) {
+  if (populationMethod(method))
+    throw std::invalid_argument(std::string("runOptimizers: ") + optimizerMethodName(method) + " is 2D only");
+  if (!function.gradient)
+    throw std::invalid_argument("runOptimizers: the gradient is not defined");
+  size_t n = function.dimension;
+  for (auto &start : starts)
+    if (start.size() != n)
+      throw std::invalid_argument("runOptimizers: a start has the wrong dimension");
+  std::vector<OptimizerRun> runs(starts.size());
+  ThreadPool pool(settings.threads);
+  pool.parallelFor(0, starts.size(), [&](size_t i) {
+    std::unique_ptr<NdOptimizer> optimizer;
+    if (method == OptimizerMethod::Newton)
+      optimizer = std::make_unique<NdNewtonCG>(function);
+    else
+      optimizer = std::make_unique<NdGradientDescent>(function, settings.step_size);
+    OptimizerRun& run = runs[i];
+    run.start = starts[i];
+    run.end = starts[i];
+    std::vector<double> gradient(n);
+    optimizer->reset(run.end.data());
+    (*function.gradient)(run.end.data(), gradient.data());
+    double norm = ::norm(gradient.data(), n);
+    while (std::isfinite(norm) && norm > settings.tolerance && run.steps < settings.max_steps) {
+      run.end = optimizer->step();
+      (*function.gradient)(run.end.data(), gradient.data());
+      norm = ::norm(gradient.data(), n);
+      ++run.steps;
+    }
+    run.value = function.value(run.end.data());
+    run.gradient_norm = norm;
+    if (!std::isfinite(norm) || !std::isfinite(run.value))
+      run.status = OptimizerRun::Status::Failed;
+    else if (norm <= settings.tolerance)
+      run.status = OptimizerRun::Status::Converged;
+  });
+  return runs;
+}
+
+std::vector<float> sampleGrid(const func_t& function, const std::optional<batch_t>& batch, glm::vec2 origin,
+                              float spacing, uint32_t samples, unsigned threads) {
+  std::vector<float> values(size_t(samples) * samples);
+  ThreadPool pool(threads);
+  // a row per batch call
+  pool.parallelFor(0, samples, [&](size_t y) {
+    std::vector<glm::vec2> points(samples);
+    for (uint32_t x = 0; x < samples; ++x)
+      points[x] = origin + spacing * glm::vec2(x, y);
+    evaluateBatch(function, batch, points.data(), values.data() + y * samples, samples);
+  });
+  return values;
+}
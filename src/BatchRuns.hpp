@@ -0,0 +1,59 @@
+#ifndef BATCHRUNS_HPP
+#define BATCHRUNS_HPP
+
+#include <NdFunction.hpp>
+#include <Objectives.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Computations of batch studies, without a window: optimizers run from many
+// starts and the graph sampled on a grid, both split across a thread pool.
+// The results do not depend on the number of threads.
+
+enum class OptimizerMethod { GradientDescent, Newton, CmaEs, DifferentialEvolution };
+
+// "gd", "newton", "cmaes" or "de", throws on other names
+OptimizerMethod optimizerMethod(const std::string& name);
+const char* optimizerMethodName(OptimizerMethod method);
+
+struct RunSettings {
+  size_t max_steps = 1000;
+  double tolerance = 1e-6;  // of the norm of the gradient, of the spread of a population
+  double step_size = 0.1;   // of gradient descent
+  unsigned threads = 0;     // 0 means all hardware threads
+  // of CMA-ES and differential evolution: members (0 for the default), the
+  // spread of the first population, the seed of the first run (run i has seed + i)
+  size_t population = 0;
+  double spread = 1.0;
+  uint32_t seed = 0;
+};
+
+struct OptimizerRun {
+  enum class Status { Converged, MaxSteps, Failed };
+
+  std::vector<double> start, end;
+  double value = 0.0;          // at end
+  double gradient_norm = 0.0;  // at end, NaN for a population method without gradient
+  size_t steps = 0;            // generations of a population method
+  size_t evaluations = 0;      // of the function by a population method
+  Status status = Status::MaxSteps;
+};
+
+const char* runStatusName(OptimizerRun::Status status);
+
+// Gradient Descent, Newton's method, CMA-ES or differential evolution from
+// every start; the first two need the gradient and Newton's method the
+// Hessian of the objective, the population methods neither
+std::vector<OptimizerRun> runOptimizers(const Objective& objective, OptimizerMethod method,
+                                        const std::vector<glm::vec2>& starts, const RunSettings& settings);
+// Gradient Descent or Newton-CG from every start, both need the gradient; the
+// population methods are 2D only
+std::vector<OptimizerRun> runOptimizers(const NdFunction& function, OptimizerMethod method,
+                                        const std::vector<std::vector<double>>& starts, const RunSettings& settings);
+
+// samples x samples values at origin + spacing * (x, y), row by row
+std::vector<float> sampleGrid(const func_t& function, const std::optional<batch_t>& batch, glm::vec2 origin,
+                              float spacing, uint32_t samples, unsigned threads = 0);
+
+#endif // BATCHRUNS_HPP
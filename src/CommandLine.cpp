@@ -0,0 +1,65 @@
+#include "CommandLine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "MeshExporter.hpp"
+
+std::string takeOption(std::vector<std::string>& args, const std::string& name) {
+  auto it = std::find(args.begin(), args.end(), name);
+  if (it == args.end())
+    return "";
+  if (it + 1 == args.end())
+    throw std::invalid_argument("Missing value for " + name);
+  std::string value = *(it + 1);
+  args.erase(it, it + 2);
+  return value;
+}
+
+bool takeFlag(std::vector<std::string>& args, const std::string& name) {
+  auto it = std::find(args.begin(), args.end(), name);
+  if (it == args.end())
+    return false;
+  args.erase(it);
+  return true;
+}
+
+bool takeRange(std::vector<std::string>& args, const std::string& name, float& begin, float& end) {
+  auto it = std::find(args.begin(), args.end(), name);
+  if (it == args.end())
+    return false;
+  if (args.end() - it < 3)
+    throw std::invalid_argument("Missing values for " + name);
+  begin = std::stof(*(it + 1));
+  end = std::stof(*(it + 2));
+  args.erase(it, it + 3);
+  return true;
+}
+
+int exportMesh(func_t function, std::optional<batch_t> batch, std::vector<std::string> args) {
+  ExportSettings settings;
+  std::string path = takeOption(args, "--export");
+  for (size_t i = 0; i < args.size(); ++i) {
+    auto next = [&]() {
+      if (i + 1 >= args.size())
+        throw std::invalid_argument("Missing value for " + args[i]);
+      return args[++i];
+    };
+    if (args[i] == "--samples")
+      settings.samples = std::stoul(next());
+    else if (args[i] == "--tile")
+      settings.tile = std::stoul(next());
+    else if (args[i] == "--extent")
+      settings.extent = std::stof(next());
+    else if (args[i] == "--threads")
+      settings.threads = std::stoul(next());
+    else if (args[i] == "--center") {
+      settings.center.x = std::stof(next());
+      settings.center.y = std::stof(next());
+    }
+    else
+      throw std::invalid_argument("Unknown option " + args[i]);
+  }
+  MeshExporter(function, settings, batch).exportFile(path);
+  return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef COMMANDLINE_HPP
+#define COMMANDLINE_HPP
+
+#include <utils.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Options are taken out of the arguments one by one, whatever is left at the
+// end is unknown
+
+// removes "name value" from args and returns value, or "" when absent
+std::string takeOption(std::vector<std::string>& args, const std::string& name);
+
+// removes the flag name from args and returns whether it was there
+bool takeFlag(std::vector<std::string>& args, const std::string& name);
+
+// removes "name begin end" from args into range, returns whether it was there
+bool takeRange(std::vector<std::string>& args, const std::string& name, float& begin, float& end);
+
+// --export <file.ply|file.gltf> [--samples N] [--tile N] [--extent E]
+//          [--center X Y] [--threads N]
+int exportMesh(func_t function, std::optional<batch_t> batch, std::vector<std::string> args);
+
+#endif // COMMANDLINE_HPP
@@ -0,0 +1,135 @@
+#include "CriticalPoints.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+CriticalPointFinder::CriticalPointFinder(func_t function, grad_t gradient, std::optional<hess_t> hessian,
+                                         std::optional<interval_grad_t> interval_gradient, ThreadPool& pool)
+    : function(std::move(function)), gradient(std::move(gradient)), hessian(std::move(hessian)),
+      interval_gradient(std::move(interval_gradient)), pool(pool) {}
+
+void CriticalPointFinder::regionsOver(int level, glm::vec2 lo, glm::vec2 hi, std::vector<CriticalRegion>& out) {
+  float side = regionSide(level);
+  int x0 = int(std::floor(lo.x / side)), x1 = int(std::floor(hi.x / side));
+  int y0 = int(std::floor(lo.y / side)), y1 = int(std::floor(hi.y / side));
+  for (int y = y0; y <= y1; ++y)
+    for (int x = x0; x <= x1; ++x)
+      out.push_back({level, x, y});
+}
+
+CriticalPoint::Kind CriticalPointFinder::classify(glm::mat2 hessian, glm::vec2& eigenvalues) {
+  // symmetric 2x2: mean -+ radius
+  float a = hessian[0][0], b = 0.5f * (hessian[0][1] + hessian[1][0]), d = hessian[1][1];
+  float mean = 0.5f * (a + d);
+  float radius = std::sqrt(0.25f * (a - d) * (a - d) + b * b);
+  eigenvalues = glm::vec2(mean - radius, mean + radius);
+  float tolerance = 1e-6f * std::max(1.0f, std::abs(mean) + radius);
+  if (eigenvalues.x > tolerance)
+    return CriticalPoint::Kind::Minimum;
+  if (eigenvalues.y < -tolerance)
+    return CriticalPoint::Kind::Maximum;
+  if (eigenvalues.x < -tolerance && eigenvalues.y > tolerance)
+    return CriticalPoint::Kind::Saddle;
+  return CriticalPoint::Kind::Degenerate;
+}
+
+bool CriticalPointFinder::mayVanish(glm::vec2 lo, float side) const {
+  if (interval_gradient) {
+    auto g = (*interval_gradient)(Interval(lo.x, lo.x + side), Interval(lo.y, lo.y + side));
+    return g[0].contains(0.0) && g[1].contains(0.0);
+  }
+  glm::vec2 low(INFINITY), high(-INFINITY);
+  for (int y = 0; y <= 2; ++y)
+    for (int x = 0; x <= 2; ++x) {
+      glm::vec2 g = gradient(lo + 0.5f * side * glm::vec2(x, y));
+      low = glm::min(low, g);
+      high = glm::max(high, g);
+    }
+  for (int c = 0; c < 2; ++c) {
+    float spread = high[c] - low[c];
+    if (low[c] > spread || high[c] < -spread)
+      return false;
+  }
+  return true;
+}
+
+glm::mat2 CriticalPointFinder::hessianAt(glm::vec2 p, float step) const {
+  if (hessian)
+    return (*hessian)(p);
+  // central differences of the gradient, the columns are d/dx and d/dy
+  glm::vec2 dx = (gradient(p + glm::vec2(step, 0.0f)) - gradient(p - glm::vec2(step, 0.0f))) / (2.0f * step);
+  glm::vec2 dy = (gradient(p + glm::vec2(0.0f, step)) - gradient(p - glm::vec2(0.0f, step))) / (2.0f * step);
+  return glm::mat2(dx, dy);
+}
+
+std::optional<CriticalPoint> CriticalPointFinder::polish(glm::vec2 lo, float side) const {
+  const int max_iterations = 20;
+  // Newton may leave the cell by half its side, the neighbours cover the rest
+  glm::vec2 bound_lo = lo - 0.5f * side, bound_hi = lo + 1.5f * side;
+  float step = 1e-3f * side;
+  glm::vec2 p = lo + 0.5f * side;
+  float start_norm = glm::length(gradient(p));
+  for (int i = 0; i < max_iterations; ++i) {
+    glm::vec2 g = gradient(p);
+    glm::mat2 h = hessianAt(p, step);
+    float det = glm::determinant(h);
+    if (!std::isfinite(det) || std::abs(det) < 1e-20f)
+      return std::nullopt;
+    glm::vec2 delta = glm::inverse(h) * g;
+    p -= delta;
+    if (!(p.x >= bound_lo.x && p.x <= bound_hi.x && p.y >= bound_lo.y && p.y <= bound_hi.y))
+      return std::nullopt;
+    if (glm::length(delta) < 1e-5f * side)
+      break;
+  }
+  // converged to a point where the gradient is small compared to the cell
+  if (!(glm::length(gradient(p)) <= 1e-3f * (1.0f + start_norm)))
+    return std::nullopt;
+  CriticalPoint point;
+  point.position = p;
+  point.value = function(p);
+  point.kind = classify(hessianAt(p, step), point.eigenvalues);
+  return point;
+}
+
+void CriticalPointFinder::find(const std::vector<CriticalRegion>& regions,
+                               std::vector<std::vector<CriticalPoint>>& points) {
+  const int cells = region_cells * region_cells;
+  std::vector<std::optional<CriticalPoint>> found(regions.size() * cells);
+  std::vector<uint8_t> cell_rejected(found.size());
+  pool.parallelFor(0, found.size(), [&](size_t i) {
+    const CriticalRegion& region = regions[i / cells];
+    float region_side = regionSide(region.level), side = region_side / region_cells;
+    int cell = i % cells;
+    glm::vec2 lo = region_side * glm::vec2(region.x, region.y) +
+                   side * glm::vec2(cell % region_cells, cell / region_cells);
+    if (!mayVanish(lo, side)) {
+      cell_rejected[i] = 1;
+      return;
+    }
+    found[i] = polish(lo, side);
+  });
+
+  points.resize(regions.size());
+  for (size_t r = 0; r < regions.size(); ++r) {
+    float region_side = regionSide(regions[r].level), side = region_side / region_cells;
+    glm::vec2 lo = region_side * glm::vec2(regions[r].x, regions[r].y);
+    points[r].clear();
+    for (int cell = 0; cell < cells; ++cell) {
+      size_t i = r * cells + cell;
+      searched += 1;
+      rejected += cell_rejected[i];
+      if (!found[i])
+        continue;
+      // a region keeps the points inside it, merged with the ones close by
+      glm::vec2 p = found[i]->position;
+      if (p.x < lo.x || p.y < lo.y || p.x >= lo.x + region_side || p.y >= lo.y + region_side)
+        continue;
+      bool duplicate = std::any_of(points[r].begin(), points[r].end(), [&](const CriticalPoint& other) {
+        return glm::length(other.position - p) < 0.05f * side;
+      });
+      if (!duplicate)
+        points[r].push_back(*found[i]);
+    }
+  }
+}
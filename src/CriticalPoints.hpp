@@ -0,0 +1,83 @@
+#ifndef CRITICALPOINTS_HPP
+#define CRITICALPOINTS_HPP
+
+#include <utils.hpp>
+#include <ThreadPool.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Interval.hpp"
+
+struct CriticalPoint {
+  enum class Kind { Minimum, Maximum, Saddle, Degenerate };
+
+  glm::vec2 position;
+  float value;
+  glm::vec2 eigenvalues;  // of the Hessian, ascending
+  Kind kind;
+};
+
+// Square region of the plane searched as a whole. Regions are tied to the
+// zoom level of the graph (the level of createGraph), so every level has its
+// own grid of regions whose cells are a few lattice steps wide.
+struct CriticalRegion {
+  int level, x, y;
+
+  bool operator==(const CriticalRegion& other) const {
+    return level == other.level && x == other.x && y == other.y;
+  }
+  bool operator<(const CriticalRegion& other) const {
+    return level != other.level ? level < other.level : x != other.x ? x < other.x : y < other.y;
+  }
+};
+
+// Finds the critical points of a function region by region. A region is split
+// into cells and a cell is rejected when the gradient can not vanish on it:
+// when a component of the interval gradient excludes 0, or, without the
+// interval extension, when a component has the same sign at 3x3 samples of
+// the cell by a margin larger than its spread over them (a heuristic). Newton's
+// method on the gradient is started at the center of every cell that is not
+// skipped, the points it converges to within their region are merged and
+// classified by the eigenvalues of the Hessian.
+class CriticalPointFinder {
+public:
+  static constexpr int region_cells = 16;  // cells per side of a region
+
+  // the Hessian is approximated from the gradient when not given; the cells
+  // are searched on the threads of pool, which has to outlive the finder
+  CriticalPointFinder(func_t function, grad_t gradient, std::optional<hess_t> hessian,
+                      std::optional<interval_grad_t> interval_gradient, ThreadPool& pool);
+
+  CriticalPointFinder(const CriticalPointFinder&) = delete;
+  CriticalPointFinder& operator=(const CriticalPointFinder&) = delete;
+
+  static float regionSide(int level) { return level * 0.2f; }
+  // the regions of level that overlap [lo, hi], appended to out
+  static void regionsOver(int level, glm::vec2 lo, glm::vec2 hi, std::vector<CriticalRegion>& out);
+
+  // critical points of every region, points[i] of regions[i]; the cells of
+  // all regions are searched in parallel
+  void find(const std::vector<CriticalRegion>& regions, std::vector<std::vector<CriticalPoint>>& points);
+
+  // cells searched and rejected by all find() calls so far
+  uint64_t searchedCount() const { return searched; }
+  uint64_t rejectedCount() const { return rejected; }
+
+  static CriticalPoint::Kind classify(glm::mat2 hessian, glm::vec2& eigenvalues);
+
+private:
+  func_t function;
+  grad_t gradient;
+  std::optional<hess_t> hessian;
+  std::optional<interval_grad_t> interval_gradient;
+  ThreadPool& pool;
+  uint64_t searched = 0, rejected = 0;
+
+  bool mayVanish(glm::vec2 lo, float side) const;
+  glm::mat2 hessianAt(glm::vec2 p, float step) const;
+  // critical point near the center of the cell, Newton stays within it
+  std::optional<CriticalPoint> polish(glm::vec2 lo, float side) const;
+};
+
+#endif // CRITICALPOINTS_HPP
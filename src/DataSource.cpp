@@ -0,0 +1,418 @@
+#include "DataSource.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const char kGridMagic[8] = {'F', 'G', 'I', 'G', 'R', 'I', 'D', 0};
+const char kPointMagic[8] = {'F', 'G', 'I', 'P', 'T', 'S', 0, 0};
+const char kBinsMagic[8] = {'F', 'G', 'I', 'B', 'I', 'N', 'S', 0};
+const uint32_t kVersion = 1;
+
+// points per bin of the index, on average
+const uint64_t kPointsPerBin = 4;
+
+} // namespace
+
+DataSource::DataSource(const std::string& path) : path(path) {
+  fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("DataSource: could not open " + path);
+  // the destructor does not run when the constructor throws
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("DataSource: could not stat " + path);
+  }
+  size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    throw std::runtime_error("DataSource: " + path + " is empty");
+  }
+  void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    close(fd);
+    throw std::runtime_error("DataSource: could not map " + path);
+  }
+  data = static_cast<const char*>(p);
+}
+
+DataSource::~DataSource() {
+  if (data)
+    munmap(const_cast<char*>(data), size);
+  if (fd >= 0)
+    close(fd);
+}
+
+std::shared_ptr<DataSource> DataSource::open(const std::string& path) {
+  char magic[8] = {};
+  std::ifstream file(path, std::ios::binary);
+  if (!file.read(magic, sizeof(magic)))
+    throw std::runtime_error("DataSource: could not read " + path);
+  if (!memcmp(magic, kGridMagic, sizeof(magic)))
+    return std::make_shared<GridSource>(path);
+  if (!memcmp(magic, kPointMagic, sizeof(magic)))
+    return std::make_shared<PointSource>(path);
+  throw std::runtime_error("DataSource: " + path + " is neither a grid nor a point file");
+}
+
+void DataSource::evaluate(const glm::vec2* points, float* values, size_t count) const {
+  for (size_t i = 0; i < count; ++i)
+    values[i] = value(points[i]);
+}
+
+func_t DataSource::function() const {
+  return [this](glm::vec2 p) { return value(p); };
+}
+
+grad_t DataSource::gradientFunction() const {
+  return [this](glm::vec2 p) { return gradient(p); };
+}
+
+batch_t DataSource::batch() const {
+  return {&DataSource::batchEntry, this};
+}
+
+void DataSource::batchEntry(const void* context, const glm::vec2* points, float* values, size_t count) {
+  static_cast<const DataSource*>(context)->evaluate(points, values, count);
+}
+
+GridSource::GridSource(const std::string& path) : DataSource(path) {
+  Header header;
+  if (size < sizeof(header))
+    throw std::runtime_error("GridSource: " + path + " is too short");
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kGridMagic, sizeof(kGridMagic)) || header.version != kVersion)
+    throw std::runtime_error("GridSource: " + path + " is not a grid of version 1");
+  nx = header.nx;
+  ny = header.ny;
+  x0 = header.x0;
+  y0 = header.y0;
+  dx = header.dx;
+  dy = header.dy;
+  if (nx < 2 || ny < 2 || !(dx > 0.0) || !(dy > 0.0))
+    throw std::runtime_error("GridSource: " + path + " needs 2 x 2 points and positive spacings");
+  if ((size - sizeof(header)) / sizeof(float) / nx < ny)
+    throw std::runtime_error("GridSource: " + path + " is shorter than its grid");
+  heights = reinterpret_cast<const float*>(data + sizeof(header));
+  bounds_lower = glm::vec2(x0, y0);
+  bounds_upper = glm::vec2(x0 + (nx - 1) * dx, y0 + (ny - 1) * dy);
+}
+
+void GridSource::writeHeader(std::ostream& out, uint64_t nx, uint64_t ny, glm::dvec2 origin, glm::dvec2 spacing) {
+  Header header = {};
+  memcpy(header.magic, kGridMagic, sizeof(kGridMagic));
+  header.version = kVersion;
+  header.nx = nx;
+  header.ny = ny;
+  header.x0 = origin.x;
+  header.y0 = origin.y;
+  header.dx = spacing.x;
+  header.dy = spacing.y;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void GridSource::locate(glm::vec2 p, uint64_t& i, uint64_t& j, float& u, float& v, bool& inside_x, bool& inside_y) const {
+  double x = (p.x - x0) / dx, y = (p.y - y0) / dy;
+  inside_x = x >= 0.0 && x <= nx - 1;
+  inside_y = y >= 0.0 && y <= ny - 1;
+  // NaN ends up at the first cell
+  x = x > 0.0 ? std::min(x, double(nx - 1)) : 0.0;
+  y = y > 0.0 ? std::min(y, double(ny - 1)) : 0.0;
+  i = std::min(uint64_t(x), nx - 2);
+  j = std::min(uint64_t(y), ny - 2);
+  u = x - i;
+  v = y - j;
+}
+
+float GridSource::value(glm::vec2 p) const {
+  uint64_t i, j;
+  float u, v;
+  bool inside_x, inside_y;
+  locate(p, i, j, u, v, inside_x, inside_y);
+  float bottom = at(i, j) + u * (at(i + 1, j) - at(i, j));
+  float top = at(i, j + 1) + u * (at(i + 1, j + 1) - at(i, j + 1));
+  return bottom + v * (top - bottom);
+}
+
+glm::vec2 GridSource::gradient(glm::vec2 p) const {
+  uint64_t i, j;
+  float u, v;
+  bool inside_x, inside_y;
+  locate(p, i, j, u, v, inside_x, inside_y);
+  // of the bilinear patch of the cell, flat across the border outside
+  float du = (1.0f - v) * (at(i + 1, j) - at(i, j)) + v * (at(i + 1, j + 1) - at(i, j + 1));
+  float dv = (1.0f - u) * (at(i, j + 1) - at(i, j)) + u * (at(i + 1, j + 1) - at(i + 1, j));
+  return glm::vec2(inside_x ? du / dx : 0.0f, inside_y ? dv / dy : 0.0f);
+}
+
+void GridSource::evaluate(const glm::vec2* points, float* values, size_t count) const {
+  for (size_t k = 0; k < count; ++k)
+    values[k] = GridSource::value(points[k]);
+}
+
+struct PointSource::IndexHeader {
+  char magic[8];  // FGIBINS and a zero
+  uint32_t version;
+  uint32_t bins_x, bins_y;
+  uint32_t reserved;
+  uint64_t source_count;  // of the point file, which the index belongs to
+  int64_t source_time;
+  uint64_t stored;
+  float x0, y0, cell_x, cell_y;
+};
+
+PointSource::PointSource(const std::string& path) : DataSource(path) {
+  Header header;
+  if (size < sizeof(header))
+    throw std::runtime_error("PointSource: " + path + " is too short");
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kPointMagic, sizeof(kPointMagic)) || header.version != kVersion)
+    throw std::runtime_error("PointSource: " + path + " is not a point file of version 1");
+  if ((size - sizeof(header)) / sizeof(Point) < header.count)
+    throw std::runtime_error("PointSource: " + path + " is shorter than its points");
+  struct stat st;
+  fstat(fd, &st);
+  std::string index_path = path + ".bins";
+  if (!openIndex(index_path, header.count, st.st_mtime)) {
+    buildIndex(index_path, header.count, st.st_mtime);
+    if (!openIndex(index_path, header.count, st.st_mtime))
+      throw std::runtime_error("PointSource: could not read the index " + index_path);
+  }
+}
+
+PointSource::~PointSource() {
+  if (index)
+    munmap(const_cast<char*>(index), index_size);
+  if (index_fd >= 0)
+    close(index_fd);
+}
+
+void PointSource::writeHeader(std::ostream& out, uint64_t count) {
+  Header header = {};
+  memcpy(header.magic, kPointMagic, sizeof(kPointMagic));
+  header.version = kVersion;
+  header.count = count;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool PointSource::openIndex(const std::string& index_path, uint64_t count, int64_t modification_time) {
+  int file = ::open(index_path.c_str(), O_RDONLY);
+  if (file < 0)
+    return false;
+  struct stat st;
+  fstat(file, &st);
+  IndexHeader header;
+  if (size_t(st.st_size) < sizeof(header) || pread(file, &header, sizeof(header), 0) != ssize_t(sizeof(header)) ||
+      memcmp(header.magic, kBinsMagic, sizeof(kBinsMagic)) || header.version != kVersion ||
+      header.source_count != count || header.source_time != modification_time ||
+      size_t(st.st_size) != sizeof(header) + (uint64_t(header.bins_x) * header.bins_y + 1) * sizeof(uint64_t) +
+                            header.stored * sizeof(Point)) {
+    close(file);
+    return false;
+  }
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, file, 0);
+  if (p == MAP_FAILED) {
+    close(file);
+    return false;
+  }
+  index_fd = file;
+  index = static_cast<const char*>(p);
+  index_size = st.st_size;
+  stored = header.stored;
+  bins_x = header.bins_x;
+  bins_y = header.bins_y;
+  cell = glm::vec2(header.cell_x, header.cell_y);
+  bounds_lower = glm::vec2(header.x0, header.y0);
+  bounds_upper = bounds_lower + cell * glm::vec2(bins_x, bins_y);
+  offsets = reinterpret_cast<const uint64_t*>(index + sizeof(header));
+  points = reinterpret_cast<const Point*>(offsets + uint64_t(bins_x) * bins_y + 1);
+  return true;
+}
+
+void PointSource::buildIndex(const std::string& index_path, uint64_t count, int64_t modification_time) {
+  // a counting sort by bin in three passes over the mapped points: bounds,
+  // counts, scatter into the mapped index
+  const Point* source = reinterpret_cast<const Point*>(data + sizeof(Header));
+  glm::vec2 lower(INFINITY), upper(-INFINITY);
+  uint64_t finite = 0;
+  for (uint64_t k = 0; k < count; ++k) {
+    glm::vec2 p(source[k].x, source[k].y);
+    if (std::isfinite(p.x) && std::isfinite(p.y)) {
+      lower = glm::min(lower, p);
+      upper = glm::max(upper, p);
+      ++finite;
+    }
+  }
+  if (finite == 0)
+    throw std::runtime_error("PointSource: " + path + " has no points");
+
+  // square bins where the points spread in both directions
+  glm::vec2 extent = upper - lower;
+  float longest = std::max(std::max(extent.x, extent.y), 1e-6f);
+  extent = glm::max(extent, glm::vec2(1e-3f * longest));
+  double bins = double(std::max<uint64_t>(1, finite / kPointsPerBin));
+  IndexHeader header = {};
+  memcpy(header.magic, kBinsMagic, sizeof(kBinsMagic));
+  header.version = kVersion;
+  header.bins_x = uint32_t(std::clamp(std::round(std::sqrt(bins * extent.x / extent.y)), 1.0, 65536.0));
+  header.bins_y = uint32_t(std::clamp(std::ceil(bins / header.bins_x), 1.0, 65536.0));
+  header.source_count = count;
+  header.source_time = modification_time;
+  header.stored = finite;
+  header.x0 = lower.x;
+  header.y0 = lower.y;
+  // slightly larger, so that the upper bound falls into the last bin
+  header.cell_x = extent.x / header.bins_x * (1.0f + 1e-5f);
+  header.cell_y = extent.y / header.bins_y * (1.0f + 1e-5f);
+  uint64_t bin_count = uint64_t(header.bins_x) * header.bins_y;
+  size_t bytes = sizeof(header) + (bin_count + 1) * sizeof(uint64_t) + finite * sizeof(Point);
+
+  // written to a temporary file, renamed once complete
+  std::string temporary = index_path + ".tmp";
+  int file = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file < 0)
+    throw std::runtime_error("PointSource: could not create " + temporary);
+  if (ftruncate(file, bytes) != 0) {
+    close(file);
+    throw std::runtime_error("PointSource: could not resize " + temporary);
+  }
+  void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  if (mapped == MAP_FAILED) {
+    close(file);
+    throw std::runtime_error("PointSource: could not map " + temporary);
+  }
+  char* out = static_cast<char*>(mapped);
+  memcpy(out, &header, sizeof(header));
+  uint64_t* starts = reinterpret_cast<uint64_t*>(out + sizeof(header));
+  Point* sorted = reinterpret_cast<Point*>(starts + bin_count + 1);
+  auto binOf = [&](const Point& p) {
+    uint64_t bx = std::min<uint64_t>(uint64_t((p.x - header.x0) / header.cell_x), header.bins_x - 1);
+    uint64_t by = std::min<uint64_t>(uint64_t((p.y - header.y0) / header.cell_y), header.bins_y - 1);
+    return by * header.bins_x + bx;
+  };
+  // counts at b + 1, then the start of every bin, advanced while scattering
+  // until it is the start of the next one
+  for (uint64_t k = 0; k < count; ++k)
+    if (std::isfinite(source[k].x) && std::isfinite(source[k].y))
+      ++starts[binOf(source[k]) + 1];
+  for (uint64_t b = 0; b < bin_count; ++b)
+    starts[b + 1] += starts[b];
+  for (uint64_t k = 0; k < count; ++k)
+    if (std::isfinite(source[k].x) && std::isfinite(source[k].y))
+      sorted[starts[binOf(source[k])]++] = source[k];
+  for (uint64_t b = bin_count; b > 0; --b)
+    starts[b] = starts[b - 1];
+  starts[0] = 0;
+
+  bool written = msync(mapped, bytes, MS_SYNC) == 0;
+  munmap(mapped, bytes);
+  close(file);
+  if (!written || std::rename(temporary.c_str(), index_path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("PointSource: could not write " + index_path);
+  }
+}
+
+int PointSource::nearest(glm::vec2 p, const Point** found, float* distances) const {
+  // rings of bins around the bin of p, until the next ring is farther than
+  // the farthest neighbor found
+  glm::vec2 lower = bounds_lower;
+  int cx = int(std::clamp(std::floor((p.x - lower.x) / cell.x), 0.0f, float(bins_x - 1)));
+  int cy = int(std::clamp(std::floor((p.y - lower.y) / cell.y), 0.0f, float(bins_y - 1)));
+  if (!(p.x == p.x) || !(p.y == p.y))
+    cx = cy = 0;
+  int count = 0;
+  auto visit = [&](int bx, int by) {
+    uint64_t b = uint64_t(by) * bins_x + bx;
+    for (uint64_t k = offsets[b]; k < offsets[b + 1]; ++k) {
+      glm::vec2 d = glm::vec2(points[k].x, points[k].y) - p;
+      float distance = glm::dot(d, d);
+      if (count == neighbors && !(distance < distances[count - 1]))
+        continue;
+      // insertion into the sorted neighbors
+      int i = count < neighbors ? count++ : count - 1;
+      for (; i > 0 && distances[i - 1] > distance; --i) {
+        distances[i] = distances[i - 1];
+        found[i] = found[i - 1];
+      }
+      distances[i] = distance;
+      found[i] = &points[k];
+    }
+  };
+  for (int r = 0;; ++r) {
+    for (int by = cy - r; by <= cy + r; ++by) {
+      if (by < 0 || by >= int(bins_y))
+        continue;
+      // the whole first and last row of the ring, the ends of the others
+      int step = by == cy - r || by == cy + r ? 1 : 2 * r;
+      for (int bx = cx - r; bx <= cx + r; bx += step)
+        if (bx >= 0 && bx < int(bins_x))
+          visit(bx, by);
+    }
+    if (cx - r <= 0 && cy - r <= 0 && cx + r >= int(bins_x) - 1 && cy + r >= int(bins_y) - 1)
+      break;
+    float reach = std::min(std::min(p.x - (lower.x + (cx - r) * cell.x), lower.x + (cx + r + 1) * cell.x - p.x),
+                           std::min(p.y - (lower.y + (cy - r) * cell.y), lower.y + (cy + r + 1) * cell.y - p.y));
+    reach = std::max(reach, 0.0f);
+    if (count == neighbors && reach * reach >= distances[count - 1])
+      break;
+  }
+  return count;
+}
+
+float PointSource::interpolate(glm::vec2 p, glm::vec2* gradient) const {
+  // outside the bins the search would widen by a ring of bins at a time
+  // until it reaches the points, so p is moved onto the border
+  bool inside_x = p.x >= bounds_lower.x && p.x <= bounds_upper.x;
+  bool inside_y = p.y >= bounds_lower.y && p.y <= bounds_upper.y;
+  if (p.x == p.x && p.y == p.y)
+    p = glm::vec2(std::clamp(p.x, bounds_lower.x, bounds_upper.x), std::clamp(p.y, bounds_lower.y, bounds_upper.y));
+  const Point* found[neighbors];
+  float distances[neighbors];
+  int count = nearest(p, found, distances);
+  if (gradient)
+    *gradient = glm::vec2(0.0f);
+  if (count == 0)
+    return NAN;
+  if (distances[0] < 1e-30f)
+    return found[0]->height;
+  // f = sum w z / sum w with w = 1 / d^2, and dw/dp = -2 (p - x) w^2
+  float weights = 0.0f, weighted = 0.0f;
+  for (int i = 0; i < count; ++i) {
+    float w = 1.0f / distances[i];
+    weights += w;
+    weighted += w * found[i]->height;
+  }
+  float f = weighted / weights;
+  if (gradient) {
+    glm::vec2 sum(0.0f);
+    for (int i = 0; i < count; ++i) {
+      float w = 1.0f / distances[i];
+      sum += -2.0f * (p - glm::vec2(found[i]->x, found[i]->y)) * w * w * (found[i]->height - f);
+    }
+    *gradient = sum / weights;
+    *gradient = glm::vec2(inside_x ? gradient->x : 0.0f, inside_y ? gradient->y : 0.0f);
+  }
+  return f;
+}
+
+float PointSource::value(glm::vec2 p) const {
+  return interpolate(p, nullptr);
+}
+
+glm::vec2 PointSource::gradient(glm::vec2 p) const {
+  glm::vec2 result;
+  interpolate(p, &result);
+  return result;
+}
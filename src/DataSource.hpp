@@ -0,0 +1,144 @@
+#ifndef DATASOURCE_HPP
+#define DATASOURCE_HPP
+
+#include <utils.hpp>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+// Function given by samples in a file instead of a formula, such as a loss
+// landscape computed on a grid or the results of a sweep. The file is mapped
+// read only, so it may be larger than memory: the pages the graph and the
+// optimizers touch are read on demand and dropped by the kernel under memory
+// pressure. The functions returned below refer to the source, which has to
+// outlive them; every method is thread safe.
+class DataSource {
+public:
+  virtual ~DataSource();
+
+  DataSource(const DataSource&) = delete;
+  DataSource& operator=(const DataSource&) = delete;
+
+  // a GridSource or a PointSource, by the header of the file
+  static std::shared_ptr<DataSource> open(const std::string& path);
+
+  virtual float value(glm::vec2 p) const = 0;
+  virtual glm::vec2 gradient(glm::vec2 p) const = 0;
+  virtual void evaluate(const glm::vec2* points, float* values, size_t count) const;
+
+  // corners of the rectangle covered by the samples
+  glm::vec2 lower() const { return bounds_lower; }
+  glm::vec2 upper() const { return bounds_upper; }
+
+  func_t function() const;
+  grad_t gradientFunction() const;
+  batch_t batch() const;
+
+protected:
+  DataSource(const std::string& path);
+
+  std::string path;
+  int fd = -1;
+  const char* data = nullptr;  // the mapped file
+  size_t size = 0;
+  glm::vec2 bounds_lower = glm::vec2(0.0f), bounds_upper = glm::vec2(0.0f);
+
+  static void batchEntry(const void* context, const glm::vec2* points, float* values, size_t count);
+};
+
+// Heights on a regular nx x ny grid, interpolated bilinearly. Points outside
+// the grid take the height of the nearest point on its border.
+//
+// File: the header below, then nx * ny little endian floats row by row, the
+// height at (x0 + i * dx, y0 + j * dy) at index j * nx + i.
+class GridSource : public DataSource {
+public:
+  struct Header {
+    char magic[8];  // FGIGRID and a zero
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t nx, ny;
+    double x0, y0, dx, dy;
+  };
+
+  explicit GridSource(const std::string& path);
+
+  float value(glm::vec2 p) const override;
+  glm::vec2 gradient(glm::vec2 p) const override;
+  void evaluate(const glm::vec2* points, float* values, size_t count) const override;
+
+  // writes the header of a grid file to out, the heights follow it
+  static void writeHeader(std::ostream& out, uint64_t nx, uint64_t ny, glm::dvec2 origin, glm::dvec2 spacing);
+
+private:
+  uint64_t nx = 0, ny = 0;
+  double x0 = 0.0, y0 = 0.0, dx = 1.0, dy = 1.0;
+  const float* heights = nullptr;
+
+  // cell of p and the position in it, clamped to the grid, and whether p is
+  // within the grid along x and y
+  void locate(glm::vec2 p, uint64_t& i, uint64_t& j, float& u, float& v, bool& inside_x, bool& inside_y) const;
+  float at(uint64_t i, uint64_t j) const { return heights[j * nx + i]; }
+};
+
+// Heights at scattered points, interpolated by inverse distance weighting of
+// the nearest neighbors. The points are sorted into a uniform grid of bins of
+// a few points each, written next to the file (path with .bins suffix) and
+// reused while the file does not change; the sort streams over the points
+// and never holds them in memory. IDW takes the value of a point at the
+// point; it is continuous only where the set of nearest neighbors is fixed
+// and jumps where that set changes. Points outside the bins take the height
+// of the nearest point on their border, so a lookup reads the bins near the
+// border instead of all of them.
+//
+// File: the header below, then count records of three little endian floats
+// x, y, height.
+class PointSource : public DataSource {
+public:
+  struct Header {
+    char magic[8];  // FGIPTS and two zeros
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+  };
+  struct Point {
+    float x, y, height;
+  };
+
+  static constexpr int neighbors = 8;  // weighted by the inverse square distance
+
+  explicit PointSource(const std::string& path);
+  ~PointSource() override;
+
+  float value(glm::vec2 p) const override;
+  glm::vec2 gradient(glm::vec2 p) const override;
+
+  static void writeHeader(std::ostream& out, uint64_t count);
+
+  uint64_t pointCount() const { return stored; }
+  uint32_t binsX() const { return bins_x; }
+  uint32_t binsY() const { return bins_y; }
+
+private:
+  struct IndexHeader;
+
+  // the index file: header, bin offsets, points by bin
+  int index_fd = -1;
+  const char* index = nullptr;
+  size_t index_size = 0;
+  uint64_t stored = 0;  // points with finite coordinates
+  uint32_t bins_x = 0, bins_y = 0;
+  glm::vec2 cell = glm::vec2(1.0f);
+  const uint64_t* offsets = nullptr;  // bins + 1
+  const Point* points = nullptr;
+
+  void buildIndex(const std::string& index_path, uint64_t count, int64_t modification_time);
+  bool openIndex(const std::string& index_path, uint64_t count, int64_t modification_time);
+  // the nearest neighbors of p, by increasing distance; returns their count
+  int nearest(glm::vec2 p, const Point** found, float* distances) const;
+  // value and gradient of the IDW interpolant at p
+  float interpolate(glm::vec2 p, glm::vec2* gradient) const;
+};
+
+#endif // DATASOURCE_HPP
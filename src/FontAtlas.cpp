@@ -0,0 +1,82 @@
+#include "FontAtlas.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const char magic[4] = {'F', 'G', 'I', 'A'};
+const uint32_t version = 1;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  int32_t width, height, pixel_size;
+  uint32_t glyph_count;
+};
+
+} // namespace
+
+FontAtlas FontAtlas::load(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("FontAtlas: cannot open " + path);
+  Header header;
+  FontAtlas atlas;
+  file.read(reinterpret_cast<char*>(&header), sizeof header);
+  if (!file || std::memcmp(header.magic, magic, sizeof magic) != 0 || header.version != version ||
+      header.glyph_count != sizeof atlas.glyphs / sizeof atlas.glyphs[0] || header.width <= 0 || header.height <= 0)
+    throw std::runtime_error("FontAtlas: " + path + " is not a font atlas of this version");
+  atlas.width = header.width;
+  atlas.height = header.height;
+  atlas.pixel_size = header.pixel_size;
+  atlas.pixels.resize(size_t(atlas.width) * atlas.height);
+  file.read(reinterpret_cast<char*>(atlas.glyphs), sizeof atlas.glyphs);
+  file.read(reinterpret_cast<char*>(atlas.pixels.data()), atlas.pixels.size());
+  if (!file)
+    throw std::runtime_error("FontAtlas: " + path + " is truncated");
+  for (auto &g : atlas.glyphs)
+    if (g.x + g.width > atlas.width || g.y + g.height > atlas.height)
+      throw std::runtime_error("FontAtlas: " + path + " has a glyph outside the texture");
+  return atlas;
+}
+
+void FontAtlas::save(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  Header header;
+  std::memcpy(header.magic, magic, sizeof magic);
+  header.version = version;
+  header.width = width;
+  header.height = height;
+  header.pixel_size = pixel_size;
+  header.glyph_count = sizeof glyphs / sizeof glyphs[0];
+  file.write(reinterpret_cast<const char*>(&header), sizeof header);
+  file.write(reinterpret_cast<const char*>(glyphs), sizeof glyphs);
+  file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+  if (!file)
+    throw std::runtime_error("FontAtlas: cannot write " + path);
+}
+
+size_t FontAtlas::layout(const char* text, float x, float y, float sx, float sy, float* out) const {
+  size_t vertices = 0;
+  for (const char* p = text; *p; ++p) {
+    const Glyph* g = glyph(*p);
+    if (!g)
+      continue;
+    if (g->width && g->height) {
+      float x0 = x + g->left * sx, y0 = y + g->top * sy;
+      float x1 = x0 + g->width * sx, y1 = y0 - g->height * sy;
+      float u0 = float(g->x) / width, v0 = float(g->y) / height;
+      float u1 = float(g->x + g->width) / width, v1 = float(g->y + g->height) / height;
+      const float quad[6][4] = {
+        {x0, y0, u0, v0}, {x1, y0, u1, v0}, {x0, y1, u0, v1},
+        {x0, y1, u0, v1}, {x1, y0, u1, v0}, {x1, y1, u1, v1},
+      };
+      std::memcpy(out + 4 * vertices, quad, sizeof quad);
+      vertices += 6;
+    }
+    x += g->advance * sx;
+  }
+  return vertices;
+}
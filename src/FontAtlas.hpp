@@ -0,0 +1,43 @@
+#ifndef FONTATLAS_HPP
+#define FONTATLAS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Glyphs of the printable ASCII characters of one font at one pixel size,
+// packed into a single-channel texture. The atlas is baked from the font at
+// build time (tools/bake_font.cpp), so that the application loads it with one
+// read instead of rasterizing glyphs with FreeType.
+struct FontAtlas {
+  static constexpr char first = ' ', last = '~';
+
+  struct Glyph {
+    int16_t advance;     // in pixels
+    int16_t left, top;   // bearing of the bitmap
+    uint16_t width, height;
+    uint16_t x, y;       // of the bitmap in the texture
+  };
+
+  int width = 0, height = 0;  // of the texture
+  int pixel_size = 0;
+  Glyph glyphs[last - first + 1] = {};
+  std::vector<uint8_t> pixels;  // row by row, width x height
+
+  // throws std::runtime_error when the file is missing or not an atlas
+  static FontAtlas load(const std::string& path);
+  void save(const std::string& path) const;
+
+  // glyph of c, nullptr for the characters the atlas does not hold
+  const Glyph* glyph(char c) const {
+    return c >= first && c <= last ? &glyphs[c - first] : nullptr;
+  }
+
+  // two triangles (x, y, u, v) per visible character of text written to
+  // out, which holds 24 floats per character; the pen starts at (x, y) and
+  // sx, sy scale pixels to the target coordinates. Returns the vertex count.
+  size_t layout(const char* text, float x, float y, float sx, float sy, float* out) const;
+};
+
+#endif // FONTATLAS_HPP
@@ -0,0 +1,52 @@
+#ifndef FRAMEARENA_HPP
+#define FRAMEARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for the temporaries of one frame. Allocations bump an
+// offset in a block reserved up front and reset() releases all of them at
+// once. Requests that do not fit go to the heap until the next reset() and
+// are counted, so the block can be sized from overflowCount().
+class FrameArena {
+public:
+  explicit FrameArena(size_t capacity) : block(new unsigned char[capacity]), capacity(capacity) {}
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  // uninitialized storage for count objects, released without destruction
+  template <class T>
+  T* allocate(size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>, "FrameArena does not call destructors");
+    size_t begin = (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+    if (begin + count * sizeof(T) <= capacity) {
+      offset = begin + count * sizeof(T);
+      return reinterpret_cast<T*>(block.get() + begin);
+    }
+    ++overflow_count;
+    overflow.emplace_back(new unsigned char[count * sizeof(T) + alignof(T)]);
+    auto address = reinterpret_cast<uintptr_t>(overflow.back().get());
+    return reinterpret_cast<T*>((address + alignof(T) - 1) / alignof(T) * alignof(T));
+  }
+
+  void reset() {
+    offset = 0;
+    overflow.clear();
+  }
+
+  size_t used() const { return offset; }
+  size_t overflowCount() const { return overflow_count; }
+
+private:
+  std::unique_ptr<unsigned char[]> block;
+  size_t capacity;
+  size_t offset = 0;
+  std::vector<std::unique_ptr<unsigned char[]>> overflow;
+  size_t overflow_count = 0;
+};
+
+#endif // FRAMEARENA_HPP
@@ -0,0 +1,104 @@
+#ifndef FRAMESTATE_HPP
+#define FRAMESTATE_HPP
+
+#include <Mesh.hpp>
+#include <SurfaceLayout.hpp>
+#include <TextBuffer.hpp>
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Keyboard, mouse and window state sampled by the render thread, the only
+// thread allowed to talk to GLFW
+struct InputState {
+  static constexpr int key_count = 512;  // above GLFW_KEY_LAST
+
+  double time = 0.0;  // glfwGetTime() when sampled
+  int width = 640, height = 480;
+  std::bitset<key_count> keys;
+  bool mouse_left = false, mouse_right = false;
+  double cursor_x = 0.0, cursor_y = 0.0;
+  // number of input events so far, echoed back in the frame snapshot to
+  // measure the latency of every event
+  uint64_t sequence = 0;
+
+  bool key(int key) const { return key >= 0 && key < key_count && keys[key]; }
+};
+
+// Vertices of one refresh of the graph, in the order of the layout
+struct SurfaceMesh {
+  std::shared_ptr<const SurfaceLayout> layout;
+  std::vector<VertexType> vertices;
+  // refreshes are numbered, a tile keeps the number of the refresh that last
+  // changed its vertices so that uploads can skip the others
+  uint64_t version = 0;
+  std::vector<uint64_t> tile_versions;
+  // of the gradient overlay, empty when it is off
+  std::vector<QuiverArrow> arrows;
+  // heights of the vertices for the heat map, samples x samples from origin
+  // at spacing, row by row; empty when it is off
+  std::vector<float> heights;
+  int samples = 0;
+  glm::vec2 origin = glm::vec2(0.0f);
+  float spacing = 0.0f;
+  glm::vec2 height_range = glm::vec2(0.0f);  // lowest, highest
+  // gradients of the normal map, normal_side x normal_side texels wrapping
+  // around the lattice of spacing normal_spacing, and the version of each of
+  // their blocks; normal_side is 0 when it is off. normal_scale turns a
+  // gradient into the normal of the vertices, (-normal_scale * g, 1).
+  std::vector<glm::vec2> normal_texels;
+  std::vector<uint64_t> normal_versions;
+  int normal_side = 0;
+  float normal_spacing = 0.0f, normal_scale = 0.0f;
+};
+
+// Everything the render thread needs to draw one frame, produced by the
+// update thread. Big buffers are shared and only replaced when they change,
+// so the render thread uploads them again only when the pointer differs.
+struct FrameSnapshot {
+  glm::mat4 projection = glm::mat4(1.0);
+  glm::mat4 view = glm::mat4(1.0);
+  glm::vec3 point_position = glm::vec3(0.0);
+  float camera_distance = 1.0;
+
+  std::shared_ptr<const SurfaceMesh> mesh;
+  std::vector<glm::vec3> points;  // optimizer trajectory
+  std::optional<glm::vec3> best_point;  // of the global search
+  std::optional<glm::vec3> picked_point;  // clicked on the graph
+  std::shared_ptr<const std::vector<VertexType>> search_boxes;  // GL_LINES
+  std::shared_ptr<const std::vector<VertexType>> critical_markers;  // GL_LINES
+  // members of the population of an optimizer on the graph, w: rank from 0
+  // for the best to 1 for the worst
+  std::shared_ptr<const std::vector<glm::vec4>> population;
+  bool heat_map = false;  // split view, the heat map of the mesh on the right
+
+  // HUD lines, formatted in place so that publishing does not allocate
+  struct TextLine {
+    TextBuffer<192> text;
+    float x, y;  // normalized device coordinates
+  };
+  static constexpr int max_text_lines = 13;
+  TextLine text[max_text_lines];
+  int text_lines = 0;
+  // next free line, the last one is overwritten when all are taken
+  TextBuffer<192>& addText(float x, float y) {
+    TextLine& line = text[std::min(text_lines++, max_text_lines - 1)];
+    text_lines = std::min(text_lines, max_text_lines);
+    line.text.clear();
+    line.x = x;
+    line.y = y;
+    return line.text;
+  }
+
+  // last input event the update thread has seen
+  uint64_t input_sequence = 0;
+  uint64_t update_count = 0;
+  // heap allocations of the update step that produced the snapshot
+  uint64_t update_allocations = 0;
+};
+
+#endif // FRAMESTATE_HPP
@@ -0,0 +1,145 @@
+#include "GlobalMinimizer.hpp"
+
+#include <chrono>
+#include <limits>
+
+GlobalMinimizer::GlobalMinimizer(interval_func_t function, std::optional<interval_grad_t> gradient,
+                                 GlobalSearchSettings settings)
+    : function(function),
+      gradient(settings.monotonicity ? gradient : std::nullopt),
+      settings(settings),
+      pool(settings.threads),
+      upper_bound(std::numeric_limits<double>::infinity()) {}
+
+void GlobalMinimizer::cancel() {
+  pool.stop();
+}
+
+void GlobalMinimizer::record(unsigned worker, const SearchBox& box, Interval value,
+                             GlobalSearchResult::Status status) {
+  if (visited[worker].size() < settings.max_recorded / pool.size())
+    visited[worker].push_back({box, value, status});
+}
+
+void GlobalMinimizer::improve(const SearchBox& box) {
+  // the value at a point is enclosed by the extension on the degenerate box
+  glm::vec2 point(box.x.mid(), box.y.mid());
+  double value = function(Interval(box.x.mid()), Interval(box.y.mid())).hi;
+  double current = upper_bound;
+  while (value < current) {
+    if (upper_bound.compare_exchange_weak(current, value)) {
+      std::lock_guard<std::mutex> lock(best_mutex);
+      if (value <= upper_bound)
+        best_point = point;
+      break;
+    }
+  }
+}
+
+template <class Spawn>
+void GlobalMinimizer::process(const Item& item, Spawn& spawn, unsigned worker) {
+  using Status = GlobalSearchResult::Status;
+  if (++processed >= settings.max_boxes)
+    pool.stop();
+
+  SearchBox box = item.box;
+  Interval value = function(box.x, box.y);
+  if (value.lo > upper_bound) {
+    ++pruned;
+    record(worker, box, value, Status::Pruned);
+    return;
+  }
+
+  if (gradient) {
+    std::array<Interval, 2> g = (*gradient)(box.x, box.y);
+    Interval* sides[] = {&box.x, &box.y};
+    const Interval* domain[] = {&settings.domain.x, &settings.domain.y};
+    bool reduced = false;
+    for (int i = 0; i < 2; ++i) {
+      Interval &side = *sides[i];
+      // increasing: the minimum over the box lies on its lower face, which is
+      // only a candidate when it is on the domain boundary
+      if (g[i].lo > 0.0 && side.width() > 0.0) {
+        if (side.lo > domain[i]->lo) {
+          ++pruned;
+          record(worker, item.box, value, Status::Pruned);
+          return;
+        }
+        side = Interval(side.lo);
+        reduced = true;
+      }
+      else if (g[i].hi < 0.0 && side.width() > 0.0) {
+        if (side.hi < domain[i]->hi) {
+          ++pruned;
+          record(worker, item.box, value, Status::Pruned);
+          return;
+        }
+        side = Interval(side.hi);
+        reduced = true;
+      }
+    }
+    if (reduced) {
+      value = function(box.x, box.y);
+      if (value.lo > upper_bound) {
+        ++pruned;
+        record(worker, item.box, value, Status::Pruned);
+        return;
+      }
+    }
+  }
+
+  improve(box);
+
+  if (std::max(box.x.width(), box.y.width()) <= settings.tolerance) {
+    candidates[worker].push_back(box);
+    record(worker, box, value, Status::Candidate);
+    return;
+  }
+
+  record(worker, box, value, Status::Split);
+  if (box.x.width() >= box.y.width()) {
+    double m = box.x.mid();
+    spawn(Item{{Interval(box.x.lo, m), box.y}, value.lo});
+    spawn(Item{{Interval(m, box.x.hi), box.y}, value.lo});
+  }
+  else {
+    double m = box.y.mid();
+    spawn(Item{{box.x, Interval(box.y.lo, m)}, value.lo});
+    spawn(Item{{box.x, Interval(m, box.y.hi)}, value.lo});
+  }
+}
+
+GlobalSearchResult GlobalMinimizer::run() {
+  auto start = std::chrono::steady_clock::now();
+  candidates.assign(pool.size(), {});
+  visited.assign(pool.size(), {});
+  best_point = glm::vec2(settings.domain.x.mid(), settings.domain.y.mid());
+
+  pool.run({Item{settings.domain, -std::numeric_limits<double>::infinity()}},
+           [this](const Item& item, auto& spawn, unsigned worker) { process(item, spawn, worker); });
+
+  GlobalSearchResult result;
+  result.complete = !pool.isStopped();
+  double lower = std::numeric_limits<double>::infinity();
+  for (unsigned w = 0; w < pool.size(); ++w) {
+    for (auto &box : candidates[w]) {
+      // boxes found before the upper bound improved may be dominated by now
+      Interval value = function(box.x, box.y);
+      if (value.lo > upper_bound)
+        continue;
+      lower = std::min(lower, value.lo);
+      result.candidates.push_back(box);
+    }
+    result.visited.insert(result.visited.end(), visited[w].begin(), visited[w].end());
+  }
+  // unresolved boxes of a stopped search still bound the minimum from below
+  pool.forEachRemaining([&](const Item& item) { lower = std::min(lower, item.lower); });
+
+  result.minimum = Interval(std::min(lower, double(upper_bound)), upper_bound);
+  result.best_point = best_point;
+  result.processed = processed;
+  result.pruned = pruned;
+  result.steals = pool.stealCount();
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
@@ -0,0 +1,90 @@
+#ifndef GLOBALMINIMIZER_HPP
+#define GLOBALMINIMIZER_HPP
+
+#include <utils.hpp>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Interval.hpp"
+#include "WorkStealingPool.hpp"
+
+struct SearchBox {
+  Interval x, y;
+};
+
+struct GlobalSearchSettings {
+  SearchBox domain;
+  double tolerance = 1e-4;         // boxes narrower than this are not split
+  uint64_t max_boxes = 20000000;   // give up after processing this many boxes
+  size_t max_recorded = 40000;     // boxes kept for display
+  bool monotonicity = true;        // use the interval gradient when given
+  unsigned threads = 0;
+};
+
+struct GlobalSearchResult {
+  enum class Status { Split, Pruned, Candidate };
+  struct VisitedBox {
+    SearchBox box;
+    Interval value;
+    Status status;
+  };
+
+  // encloses the global minimum of the function over the domain
+  Interval minimum;
+  // point where the upper bound of the minimum was attained
+  glm::vec2 best_point;
+  // boxes that may contain a global minimizer
+  std::vector<SearchBox> candidates;
+  std::vector<VisitedBox> visited;
+  uint64_t processed = 0, pruned = 0, steals = 0;
+  double seconds = 0.0;
+  // false when the search was stopped before every box was resolved
+  bool complete = true;
+
+  double boxesPerSecond() const { return seconds > 0.0 ? processed / seconds : 0.0; }
+};
+
+// Interval branch and bound: a box is discarded when the interval extension
+// of the function shows it can not go below the best value found so far, or
+// when the interval gradient shows the function is monotone on it (the box
+// is then reduced to its face on the domain boundary, if it has one). Other
+// boxes are bisected along their widest side until they reach tolerance.
+class GlobalMinimizer {
+public:
+  GlobalMinimizer(interval_func_t function, std::optional<interval_grad_t> gradient,
+                  GlobalSearchSettings settings);
+
+  GlobalSearchResult run();
+  // may be called from another thread, run() then returns the partial result
+  void cancel();
+  uint64_t processedCount() const { return processed; }
+  double upperBound() const { return upper_bound; }
+
+private:
+  struct Item {
+    SearchBox box;
+    double lower;  // lower bound of the function on the parent box
+  };
+
+  interval_func_t function;
+  std::optional<interval_grad_t> gradient;
+  GlobalSearchSettings settings;
+  WorkStealingPool<Item> pool;
+
+  std::atomic<uint64_t> processed{0}, pruned{0};
+  std::atomic<double> upper_bound;
+  std::mutex best_mutex;
+  glm::vec2 best_point;
+
+  std::vector<std::vector<SearchBox>> candidates;
+  std::vector<std::vector<GlobalSearchResult::VisitedBox>> visited;
+
+  template <class Spawn>
+  void process(const Item& item, Spawn& spawn, unsigned worker);
+  void record(unsigned worker, const SearchBox& box, Interval value, GlobalSearchResult::Status status);
+  void improve(const SearchBox& box);
+};
+
+#endif // GLOBALMINIMIZER_HPP
@@ -0,0 +1,158 @@
+#include "HeightPyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// s of the hit of the ray with triangle (a, b, c), Möller-Trumbore
+bool intersectTriangle(glm::vec3 origin, glm::vec3 direction, glm::vec3 a, glm::vec3 b, glm::vec3 c, float& s) {
+  glm::vec3 ab = b - a, ac = c - a;
+  glm::vec3 p = glm::cross(direction, ac);
+  float det = glm::dot(ab, p);
+  if (std::abs(det) < 1e-12f)
+    return false;
+  float inverse = 1.0f / det;
+  glm::vec3 to_origin = origin - a;
+  float u = glm::dot(to_origin, p) * inverse;
+  if (u < 0.0f || u > 1.0f)
+    return false;
+  glm::vec3 q = glm::cross(to_origin, ab);
+  float v = glm::dot(direction, q) * inverse;
+  if (v < 0.0f || u + v > 1.0f)
+    return false;
+  s = glm::dot(ac, q) * inverse;
+  return s >= 0.0f;
+}
+
+} // namespace
+
+void HeightPyramid::build(const float* heights, int stride, int samples, glm::vec2 origin, float spacing) {
+  this->origin = origin;
+  this->spacing = spacing;
+  cells = std::max(samples - 1, 0);
+  if (cells == 0)
+    return;
+  this->heights.resize(size_t(samples) * samples);
+  for (int y = 0; y < samples; ++y)
+    std::copy_n(heights + size_t(y) * stride, samples, this->heights.begin() + size_t(y) * samples);
+
+  level_offset.clear();
+  level_size.clear();
+  size_t count = 0;
+  for (int size = cells;; size = (size + 1) / 2) {
+    level_offset.push_back(count);
+    level_size.push_back(size);
+    count += size_t(size) * size;
+    if (size == 1)
+      break;
+  }
+  bounds.resize(count);
+
+  // cells bound their four corners, nodes their (up to) four children
+  for (int y = 0; y < cells; ++y)
+    for (int x = 0; x < cells; ++x) {
+      float a = height(x, y), b = height(x + 1, y), c = height(x, y + 1), d = height(x + 1, y + 1);
+      bounds[size_t(y) * cells + x] = glm::vec2(std::min({a, b, c, d}), std::max({a, b, c, d}));
+    }
+  for (size_t level = 1; level < level_size.size(); ++level) {
+    const glm::vec2* below = bounds.data() + level_offset[level - 1];
+    glm::vec2* nodes = bounds.data() + level_offset[level];
+    int below_size = level_size[level - 1], size = level_size[level];
+    for (int y = 0; y < size; ++y)
+      for (int x = 0; x < size; ++x) {
+        glm::vec2 node(std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity());
+        for (int cy = 2 * y; cy < std::min(2 * y + 2, below_size); ++cy)
+          for (int cx = 2 * x; cx < std::min(2 * x + 2, below_size); ++cx) {
+            glm::vec2 child = below[size_t(cy) * below_size + cx];
+            node = glm::vec2(std::min(node.x, child.x), std::max(node.y, child.y));
+          }
+        nodes[size_t(y) * size + x] = node;
+      }
+  }
+}
+
+bool HeightPyramid::intersectCell(int x, int y, glm::vec3 origin, glm::vec3 direction, float& s_max) const {
+  glm::vec2 p = this->origin + spacing * glm::vec2(x, y);
+  glm::vec3 p00(p, height(x, y)), p10(p.x + spacing, p.y, height(x + 1, y));
+  glm::vec3 p01(p.x, p.y + spacing, height(x, y + 1)), p11(p + spacing, height(x + 1, y + 1));
+  // the diagonal of the surface layout
+  float s;
+  bool hit = false;
+  if (intersectTriangle(origin, direction, p00, p10, p11, s) && s < s_max) {
+    s_max = s;
+    hit = true;
+  }
+  if (intersectTriangle(origin, direction, p11, p01, p00, s) && s < s_max) {
+    s_max = s;
+    hit = true;
+  }
+  return hit;
+}
+
+std::optional<glm::vec3> HeightPyramid::intersect(glm::vec3 origin, glm::vec3 direction) const {
+  if (cells == 0)
+    return std::nullopt;
+  glm::vec3 inverse = 1.0f / direction;
+
+  // s where the ray enters the bounding box of a node, infinity if it misses
+  const float miss = std::numeric_limits<float>::infinity();
+  auto enter = [&](int level, int x, int y) {
+    int size = level_size[level];
+    glm::vec2 range = bounds[level_offset[level] + size_t(y) * size + x];
+    int x0 = x << level, y0 = y << level;
+    int x1 = std::min((x + 1) << level, cells), y1 = std::min((y + 1) << level, cells);
+    glm::vec3 lo(this->origin + spacing * glm::vec2(x0, y0), range.x);
+    glm::vec3 hi(this->origin + spacing * glm::vec2(x1, y1), range.y);
+    glm::vec3 a = (lo - origin) * inverse, b = (hi - origin) * inverse;
+    // fmin and fmax drop the NaN of a ray in the plane of a face
+    float s0 = std::fmax(std::fmax(std::fmin(a.x, b.x), std::fmin(a.y, b.y)), std::fmax(std::fmin(a.z, b.z), 0.0f));
+    float s1 = std::fmin(std::fmin(std::fmax(a.x, b.x), std::fmax(a.y, b.y)), std::fmax(a.z, b.z));
+    return s0 <= s1 ? s0 : miss;
+  };
+
+  // depth-first, the nearest child on top; at most three siblings wait per
+  // level, so the stack has a fixed size
+  struct Node {
+    int level, x, y;
+    float s;
+  };
+  Node stack[4 * 32];
+  int top = 0;
+  int root = int(level_size.size()) - 1;
+  float s_root = enter(root, 0, 0);
+  if (s_root == miss)
+    return std::nullopt;
+  stack[top++] = {root, 0, 0, s_root};
+
+  float best = miss;
+  while (top > 0) {
+    Node node = stack[--top];
+    if (node.s >= best)
+      continue;
+    if (node.level == 0) {
+      intersectCell(node.x, node.y, origin, direction, best);
+      continue;
+    }
+    int level = node.level - 1, size = level_size[level];
+    Node children[4];
+    int count = 0;
+    for (int y = 2 * node.y; y < std::min(2 * node.y + 2, size); ++y)
+      for (int x = 2 * node.x; x < std::min(2 * node.x + 2, size); ++x) {
+        float s = enter(level, x, y);
+        if (s >= best)
+          continue;
+        // insertion by decreasing s
+        int i = count++;
+        for (; i > 0 && children[i - 1].s < s; --i)
+          children[i] = children[i - 1];
+        children[i] = {level, x, y, s};
+      }
+    for (int i = 0; i < count; ++i)
+      stack[top++] = children[i];
+  }
+  if (best == miss)
+    return std::nullopt;
+  return origin + best * direction;
+}
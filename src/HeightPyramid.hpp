@@ -0,0 +1,46 @@
+#ifndef HEIGHTPYRAMID_HPP
+#define HEIGHTPYRAMID_HPP
+
+#include <glm/glm.hpp>
+#include <optional>
+#include <vector>
+
+// Min/max mip pyramid over a square grid of heights, an implicit quadtree
+// whose node at level k bounds the heights of 2^k x 2^k cells. Rays are
+// intersected with the graph of the heights, triangulated like the surface,
+// by descending only into the nodes whose bounding boxes they cross, nearest
+// first, so a query visits O(log n) nodes over most of the grid.
+class HeightPyramid {
+public:
+  // samples x samples heights, row y starting at heights + y * stride, at the
+  // points origin + spacing * (x, y); keeps the capacity of the last build
+  void build(const float* heights, int stride, int samples, glm::vec2 origin, float spacing);
+
+  bool empty() const { return cells == 0; }
+
+  // the heights it was built from, sampleCount()^2 at sampleOrigin() +
+  // sampleSpacing() * (x, y), row by row
+  int sampleCount() const { return cells + 1; }
+  glm::vec2 sampleOrigin() const { return origin; }
+  float sampleSpacing() const { return spacing; }
+  const std::vector<float>& samples() const { return heights; }
+
+  // first point of the graph along origin + s * direction for s >= 0
+  std::optional<glm::vec3> intersect(glm::vec3 origin, glm::vec3 direction) const;
+
+private:
+  int cells = 0;  // per side of level 0
+  glm::vec2 origin = glm::vec2(0.0f);
+  float spacing = 1.0f;
+  std::vector<float> heights;  // (cells + 1)^2 samples
+  // (min, max) of every node, level by level from the cells up
+  std::vector<glm::vec2> bounds;
+  std::vector<size_t> level_offset;
+  std::vector<int> level_size;  // nodes per side
+
+  float height(int x, int y) const { return heights[size_t(y) * (cells + 1) + x]; }
+  // nearest hit of the two triangles of cell (x, y) before s_max
+  bool intersectCell(int x, int y, glm::vec3 origin, glm::vec3 direction, float& s_max) const;
+};
+
+#endif // HEIGHTPYRAMID_HPP
@@ -0,0 +1,256 @@
+#include "HermiteGrid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// cubic Hermite basis at t in [0, 1]: of the value at 0 and 1 (h0, h1) and of
+// the derivative at 0 and 1 (d0, d1)
+struct Basis {
+  double h0, h1, d0, d1;
+
+  explicit Basis(double t) {
+    double t2 = t * t, t3 = t2 * t;
+    h0 = 2.0 * t3 - 3.0 * t2 + 1.0;
+    h1 = -2.0 * t3 + 3.0 * t2;
+    d0 = t3 - 2.0 * t2 + t;
+    d1 = t3 - t2;
+  }
+};
+
+void removeDuplicates(std::vector<uint32_t>& indices) {
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+} // namespace
+
+HermiteGrid::HermiteGrid(sample_t sample, ThreadPool& pool) : sample(std::move(sample)), pool(pool) {}
+
+void HermiteGrid::moveTo(const LatticeWindow& to) {
+  // the samples of the old region at the lattice points of the new one, the
+  // gradients are per unit of the plane and do not depend on the level
+  LatticeRegion old = region;
+  region = LatticeRegion::around(to, coarsest);
+  values.swap(old_values);
+  gradients.swap(old_gradients);
+  twists.swap(old_twists);
+  known.swap(old_known);
+
+  size_t count = region.size();
+  values.assign(count, 0.0f);
+  gradients.assign(count, glm::vec2(0.0f));
+  twists.assign(count, NAN);
+  known.assign(count, None);
+  surface.resize(count);
+  if (valid)
+    region.forEachKept(old, columns, rows, [&](size_t i, size_t old_i) {
+      if (old_known[old_i] == None)
+        return;
+      known[i] = old_known[old_i];
+      values[i] = old_values[old_i];
+      gradients[i] = old_gradients[old_i];
+      twists[i] = old_twists[old_i];
+    });
+  window.resize(size_t(to.n) * to.n);
+  valid = true;
+}
+
+void HermiteGrid::refine(int n, int level, float unit, int i0, int j0) {
+  LatticeWindow to{n, level, unit, i0, j0};
+  refreshed_all = !valid || to != region.window;
+  if (refreshed_all)
+    moveTo(to);
+
+  // the patches level by level from the coarsest, the ones that fail their
+  // check are replaced by their quarters within the window
+  uint64_t first = evaluated;
+  float limit = tolerance * level * unit;
+  const int width = region.width, height = region.height;
+  const int x0 = i0 - region.a0, y0 = j0 - region.b0;
+  auto inWindow = [&](const Patch& p) {
+    return p.x <= x0 + n - 1 && p.x + p.stride >= x0 && p.y <= y0 + n - 1 && p.y + p.stride >= y0;
+  };
+  stats = HermiteStats();
+  stats.tolerance = limit;
+  patches.clear();
+  accepted.clear();
+  for (int y = 0; y + coarsest < height; y += coarsest)
+    for (int x = 0; x + coarsest < width; x += coarsest)
+      patches.push_back({x, y, coarsest});
+  while (!patches.empty()) {
+    pending.clear();
+    for (auto &p : patches)
+      for (int corner = 0; corner < 4; ++corner) {
+        size_t i = size_t(p.y + (corner / 2) * p.stride) * width + p.x + (corner % 2) * p.stride;
+        if (known[i] != Node)
+          pending.push_back(uint32_t(i));
+      }
+    removeDuplicates(pending);
+    samplePending(true);
+
+    pending.clear();
+    for (auto &p : patches)
+      for (int k = 0; k < checks(p); ++k) {
+        size_t i = checkIndex(p, k);
+        if (known[i] == None)
+          pending.push_back(uint32_t(i));
+      }
+    removeDuplicates(pending);
+    samplePending(false);
+
+    // a patch of stride 2 that fails is sampled in full
+    next_patches.clear();
+    pending.clear();
+    for (auto &p : patches) {
+      int h = p.stride / 2;
+      Corners c = corners(p);
+      float error = 0.0f, allowed = limit;
+      for (int k = 0; k < checks(p); ++k) {
+        glm::vec2 uv = checkPoint(k);
+        float value = values[checkIndex(p, k)];
+        // in the last bits of large heights the rounding of the floats
+        // would split every patch
+        allowed = std::max(allowed, 4.0f * std::numeric_limits<float>::epsilon() * std::abs(value));
+        error = std::max(error, std::abs(interpolate(c, uv.x, uv.y) - value));
+      }
+      if (error <= allowed) {
+        stats.worst_error = std::max(stats.worst_error, error);
+        accepted.push_back(p);
+        continue;
+      }
+      ++stats.split;
+      if (p.stride == 2) {
+        const int edges[4][2] = {{0, 1}, {2, 1}, {1, 0}, {1, 2}};  // midpoints, (x, y)
+        for (auto &edge : edges) {
+          size_t i = size_t(p.y + edge[1]) * width + p.x + edge[0];
+          if (known[i] == None)
+            pending.push_back(uint32_t(i));
+        }
+        accepted.push_back(p);
+        continue;
+      }
+      for (int k = 0; k < 4; ++k) {
+        Patch child{p.x + (k % 2) * h, p.y + (k / 2) * h, h};
+        if (inWindow(child))
+          next_patches.push_back(child);
+      }
+    }
+    removeDuplicates(pending);
+    samplePending(false);
+    patches.swap(next_patches);
+  }
+  stats.patches = accepted.size();
+  stats.heights = size_t(n) * n;
+  for (uint8_t k : known) {
+    stats.values += k != None;
+    stats.gradients += k == Node;
+  }
+
+  blocks.reset(n, refreshed_all);
+  if (!refreshed_all && evaluated == first)
+    return;
+  // the patches do not overlap, each writes its lower and left edges
+  pool.parallelFor(0, accepted.size(), [&](size_t k) { tessellate(accepted[k]); });
+  blocks.copy(surface.data(), width, x0, y0, window.data());
+}
+
+int HermiteGrid::checks(const Patch& patch) {
+  // the quarter points of a patch of stride 2 are not on the lattice
+  return patch.stride >= 4 ? 5 : 1;
+}
+
+glm::vec2 HermiteGrid::checkPoint(int k) {
+  const glm::vec2 points[5] = {{0.5f, 0.5f}, {0.25f, 0.25f}, {0.75f, 0.25f}, {0.25f, 0.75f}, {0.75f, 0.75f}};
+  return points[k];
+}
+
+size_t HermiteGrid::checkIndex(const Patch& patch, int k) const {
+  glm::ivec2 offset = glm::ivec2(checkPoint(k) * float(patch.stride));
+  return size_t(patch.y + offset.y) * region.width + patch.x + offset.x;
+}
+
+void HermiteGrid::samplePending(bool nodes) {
+  if (pending.empty())
+    return;
+  positions.resize(pending.size());
+  staged_values.resize(pending.size());
+  staged_gradients.resize(pending.size());
+  staged_twists.resize(pending.size());
+  for (size_t k = 0; k < pending.size(); ++k)
+    positions[k] = region.position(pending[k]);
+
+  const size_t chunk = 32;
+  std::atomic<size_t> next{0};
+  pool.parallelFor(0, pool.size(), [&](size_t) {
+    for (;;) {
+      size_t k = next.fetch_add(chunk);
+      if (k >= pending.size())
+        return;
+      size_t count = std::min(chunk, pending.size() - k);
+      sample(positions.data() + k, count, staged_values.data() + k, nodes ? staged_gradients.data() + k : nullptr,
+             nodes ? staged_twists.data() + k : nullptr);
+    }
+  });
+  for (size_t k = 0; k < pending.size(); ++k) {
+    uint32_t i = pending[k];
+    values[i] = staged_values[k];
+    if (nodes) {
+      gradients[i] = staged_gradients[k];
+      twists[i] = staged_twists[k];
+    }
+    known[i] = nodes ? Node : Value;
+  }
+  evaluated += pending.size();
+}
+
+HermiteGrid::Corners HermiteGrid::corners(const Patch& patch) const {
+  Corners c;
+  c.side = patch.stride * region.window.level * region.window.unit;
+  for (int b = 0; b < 2; ++b)
+    for (int a = 0; a < 2; ++a) {
+      size_t i = size_t(patch.y + b * patch.stride) * region.width + patch.x + a * patch.stride;
+      c.value[b][a] = values[i];
+      c.gradient[b][a] = gradients[i];
+      c.twist[b][a] = twists[i];
+    }
+  for (int b = 0; b < 2; ++b)
+    for (int a = 0; a < 2; ++a)
+      if (!std::isfinite(c.twist[b][a])) {
+        // the slope of f_y along the edge in x and of f_x along the edge in y
+        float along_x = (c.gradient[b][1].y - c.gradient[b][0].y) / c.side;
+        float along_y = (c.gradient[1][a].x - c.gradient[0][a].x) / c.side;
+        c.twist[b][a] = 0.5f * (along_x + along_y);
+      }
+  return c;
+}
+
+float HermiteGrid::interpolate(const Corners& c, float u, float v) {
+  // in doubles, the terms of large heights cancel
+  Basis bu(u), bv(v);
+  const double hu[2] = {bu.h0, bu.h1}, du[2] = {bu.d0, bu.d1};
+  const double hv[2] = {bv.h0, bv.h1}, dv[2] = {bv.d0, bv.d1};
+  double h = c.side, result = 0.0;
+  for (int b = 0; b < 2; ++b)
+    for (int a = 0; a < 2; ++a)
+      result += hu[a] * hv[b] * c.value[b][a] +
+                h * (du[a] * hv[b] * c.gradient[b][a].x + hu[a] * dv[b] * c.gradient[b][a].y) +
+                h * h * du[a] * dv[b] * c.twist[b][a];
+  return float(result);
+}
+
+void HermiteGrid::tessellate(const Patch& patch) {
+  // the upper and right edges too at the border of the region
+  Corners c = corners(patch);
+  float s = float(patch.stride);
+  int xs = patch.x + patch.stride == region.width - 1 ? patch.stride + 1 : patch.stride;
+  int ys = patch.y + patch.stride == region.height - 1 ? patch.stride + 1 : patch.stride;
+  for (int y = 0; y < ys; ++y)
+    for (int x = 0; x < xs; ++x) {
+      size_t i = size_t(patch.y + y) * region.width + patch.x + x;
+      surface[i] = known[i] != None ? values[i] : interpolate(c, x / s, y / s);
+    }
+}
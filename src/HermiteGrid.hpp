@@ -0,0 +1,118 @@
+#ifndef HERMITEGRID_HPP
+#define HERMITEGRID_HPP
+
+#include <LatticeRegion.hpp>
+#include <ThreadPool.hpp>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+
+// of the nodes and patches of the last refine of a HermiteGrid
+struct HermiteStats {
+  size_t values = 0;     // true values in the region, nodes and checks
+  size_t gradients = 0;  // nodes, with a gradient
+  size_t heights = 0;    // of the window
+  size_t patches = 0;    // accepted
+  size_t split = 0;      // patches whose check failed
+  float worst_error = 0.0f;  // of the checks of the accepted patches
+  float tolerance = 0.0f;    // of the checks
+};
+
+// Heights of the graph reconstructed from a sparse lattice of values and
+// gradients: patches of coarsest x coarsest lattice steps are bicubic Hermite
+// interpolants of the value, gradient and twist (the mixed derivative, from
+// the Hessian when given and from the differences of the gradients along the
+// edges otherwise) at their corners. Every patch is checked against true
+// values at its center and the centers of its quarters and split in four when
+// it is off by more than the tolerance, down to a stride of 2, whose lattice
+// points are all sampled.
+// Smooth functions take a few percent of the true values of the lattice.
+// Samples are kept when the grid moves, like in the ProgressiveGrid.
+class HermiteGrid {
+public:
+  static constexpr int coarsest = 16;  // stride of the first patches
+  static constexpr int block = WindowBlocks::block;  // heights per side of a block of changed()
+  static constexpr float tolerance = 0.25f;  // largest error of a check, in lattice steps
+
+  // values of the points and, when gradients is not null, their gradients and
+  // twists, NaN for a twist that is not known
+  using sample_t = std::function<void(const glm::vec2* points, size_t count, float* values, glm::vec2* gradients,
+                                      float* twists)>;
+
+  // sample is called on the threads of pool, with a few points at a time
+  HermiteGrid(sample_t sample, ThreadPool& pool);
+
+  HermiteGrid(const HermiteGrid&) = delete;
+  HermiteGrid& operator=(const HermiteGrid&) = delete;
+
+  // moves the grid to the n x n lattice points level * unit * (i0 + x, j0 + y)
+  // and reconstructs it
+  void refine(int n, int level, float unit, int i0, int j0);
+  // the samples are dropped by the next refine, e.g. after the function changed
+  void invalidate() { valid = false; }
+
+  // n x n heights, row by row
+  const float* heights() const { return window.data(); }
+  // whether a height of [x0, x1) x [y0, y1) changed in the last refine
+  bool changed(int x0, int y0, int x1, int y1) const { return blocks.changed(x0, y0, x1, y1); }
+  // the last refine moved the grid, every height changed
+  bool refreshedAll() const { return refreshed_all; }
+  const HermiteStats& statistics() const { return stats; }
+  // values and gradients evaluated by all refine() calls so far
+  uint64_t evaluatedCount() const { return evaluated; }
+
+private:
+  enum Known : uint8_t { None, Value, Node };
+  struct Patch {
+    int x, y, stride;  // lower corner in the region
+  };
+  // of the corners (a, b) of a patch, as [b][a]
+  struct Corners {
+    float value[2][2];
+    glm::vec2 gradient[2][2];
+    float twist[2][2];
+    float side;  // of the patch in the plane
+  };
+
+  sample_t sample;
+  ThreadPool& pool;
+
+  // the window of the graph, within a lattice region whose corners are on
+  // the first patches
+  LatticeRegion region;
+  WindowBlocks blocks;
+  bool valid = false, refreshed_all = false;
+  uint64_t evaluated = 0;
+  HermiteStats stats;
+
+  // of the region
+  std::vector<float> values, old_values;
+  std::vector<glm::vec2> gradients, old_gradients;
+  std::vector<float> twists, old_twists;
+  std::vector<uint8_t> known, old_known;
+  std::vector<float> surface;
+  std::vector<int> columns, rows;  // of the old region, -1 when none
+
+  std::vector<Patch> patches, next_patches, accepted;
+  std::vector<uint32_t> pending;  // indices into the region
+  std::vector<glm::vec2> positions;  // of pending
+  std::vector<float> staged_values, staged_twists;
+  std::vector<glm::vec2> staged_gradients;
+  std::vector<float> window;
+
+  void moveTo(const LatticeWindow& to);
+  // samples the points of pending, with their gradients when nodes is set
+  void samplePending(bool nodes);
+  // the points a patch is checked at, its center first and then the centers
+  // of its quarters, so that a split patch has the checks of its children
+  static int checks(const Patch& patch);
+  static glm::vec2 checkPoint(int k);  // in [0, 1]^2
+  size_t checkIndex(const Patch& patch, int k) const;
+  Corners corners(const Patch& patch) const;
+  // the interpolant at (u, v) in [0, 1]^2
+  static float interpolate(const Corners& corners, float u, float v);
+  void tessellate(const Patch& patch);
+};
+
+#endif // HERMITEGRID_HPP
@@ -0,0 +1,233 @@
+#include "InputLog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char magic[8] = {'F', 'G', 'I', 'I', 'N', 'P', 'U', 'T'};
+const uint32_t version = 2;
+
+enum Kind : uint8_t { KindInput = 1, KindEvent = 2, KindEnd = 3, KindPick = 4 };
+enum Changed : uint8_t { ChangedKeys = 1, ChangedButtons = 2, ChangedCursor = 4, ChangedSize = 8 };
+
+template <class T>
+void put(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void putVarint(std::ostream& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.put(char(value | 0x80));
+    value >>= 7;
+  }
+  out.put(char(value));
+}
+
+// reads from the buffer of the whole file
+class Reader {
+public:
+  Reader(std::vector<char> data, const std::string& path) : data(std::move(data)), path(path) {}
+
+  bool done() const { return at == data.size(); }
+
+  template <class T>
+  T get() {
+    T value;
+    need(sizeof(T));
+    std::memcpy(&value, data.data() + at, sizeof(T));
+    at += sizeof(T);
+    return value;
+  }
+
+  uint64_t getVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = get<uint8_t>();
+      value |= uint64_t(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return value;
+    }
+    throw std::runtime_error("InputReplay: bad varint in " + path);
+  }
+
+private:
+  std::vector<char> data;
+  std::string path;
+  size_t at = 0;
+
+  void need(size_t bytes) {
+    if (data.size() - at < bytes)
+      throw std::runtime_error("InputReplay: truncated " + path);
+  }
+};
+
+}  // namespace
+
+InputRecorder::InputRecorder(const std::string& path, double update_period)
+    : file(path, std::ios::binary) {
+  if (!file)
+    throw std::runtime_error("InputRecorder: could not open " + path);
+  file.write(magic, sizeof(magic));
+  put(file, version);
+  put(file, update_period);
+}
+
+InputRecorder::~InputRecorder() {
+  // the replay lasts up to the last recorded step
+  header(KindEnd, end_step);
+}
+
+void InputRecorder::header(uint8_t kind, uint64_t step) {
+  put(file, kind);
+  putVarint(file, step - last_step);
+  last_step = step;
+}
+
+void InputRecorder::record(uint64_t step, const InputState& state) {
+  end_step = std::max(end_step, step);
+  std::bitset<InputState::key_count> keys = state.keys ^ last.keys;
+  uint8_t changed = (keys.any() ? ChangedKeys : 0) |
+    (state.mouse_left != last.mouse_left || state.mouse_right != last.mouse_right ? ChangedButtons : 0) |
+    (state.cursor_x != last.cursor_x || state.cursor_y != last.cursor_y ? ChangedCursor : 0) |
+    (state.width != last.width || state.height != last.height ? ChangedSize : 0);
+  if (!changed)
+    return;
+
+  header(KindInput, step);
+  put(file, changed);
+  if (changed & ChangedKeys) {
+    putVarint(file, keys.count());
+    for (int key = 0; key < InputState::key_count; ++key)
+      if (keys[key])
+        putVarint(file, uint64_t(key) << 1 | state.keys[key]);
+  }
+  if (changed & ChangedButtons)
+    put(file, uint8_t(state.mouse_left | state.mouse_right << 1));
+  if (changed & ChangedCursor) {
+    put(file, state.cursor_x);
+    put(file, state.cursor_y);
+  }
+  if (changed & ChangedSize) {
+    put(file, int32_t(state.width));
+    put(file, int32_t(state.height));
+  }
+  last = state;
+}
+
+void InputRecorder::event(uint64_t step, OptimizerEvent event, glm::vec2 point) {
+  end_step = std::max(end_step, step);
+  header(KindEvent, step);
+  put(file, event);
+  put(file, point.x);
+  put(file, point.y);
+}
+
+void InputRecorder::pick(uint64_t step, glm::vec3 point) {
+  end_step = std::max(end_step, step);
+  header(KindPick, step);
+  put(file, point.x);
+  put(file, point.y);
+  put(file, point.z);
+}
+
+InputReplay::InputReplay(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("InputReplay: could not open " + path);
+  Reader reader(std::vector<char>(std::istreambuf_iterator<char>(file), {}), path);
+
+  char file_magic[sizeof(magic)];
+  for (char& c : file_magic)
+    c = reader.get<char>();
+  uint32_t file_version = std::memcmp(file_magic, magic, sizeof(magic)) ? 0 : reader.get<uint32_t>();
+  if (file_version < 1 || file_version > version)
+    throw std::runtime_error("InputReplay: " + path + " is not an input log");
+  has_picks = file_version >= 2;
+  update_period = reader.get<double>();
+
+  InputState state;
+  uint64_t step = 0;
+  while (!reader.done()) {
+    uint8_t kind = reader.get<uint8_t>();
+    step += reader.getVarint();
+    if (kind == KindInput) {
+      uint8_t changed = reader.get<uint8_t>();
+      if (changed & ChangedKeys) {
+        for (uint64_t count = reader.getVarint(); count; --count) {
+          uint64_t key = reader.getVarint();
+          if ((key >> 1) >= uint64_t(InputState::key_count))
+            throw std::runtime_error("InputReplay: bad key in " + path);
+          state.keys[key >> 1] = key & 1;
+        }
+      }
+      if (changed & ChangedButtons) {
+        uint8_t buttons = reader.get<uint8_t>();
+        state.mouse_left = buttons & 1;
+        state.mouse_right = buttons & 2;
+      }
+      if (changed & ChangedCursor) {
+        state.cursor_x = reader.get<double>();
+        state.cursor_y = reader.get<double>();
+      }
+      if (changed & ChangedSize) {
+        state.width = reader.get<int32_t>();
+        state.height = reader.get<int32_t>();
+      }
+      inputs.push_back({step, state});
+    }
+    else if (kind == KindEvent) {
+      Event event;
+      event.step = step;
+      event.event = reader.get<OptimizerEvent>();
+      event.point.x = reader.get<float>();
+      event.point.y = reader.get<float>();
+      events.push_back(event);
+    }
+    else if (kind == KindPick) {
+      Pick pick;
+      pick.step = step;
+      pick.point.x = reader.get<float>();
+      pick.point.y = reader.get<float>();
+      pick.point.z = reader.get<float>();
+      picks.push_back(pick);
+    }
+    else if (kind != KindEnd)
+      throw std::runtime_error("InputReplay: bad record in " + path);
+    end_step = step;
+  }
+  std::cout << "[Info] Replaying " << path << ": " << end_step << " steps, " << inputs.size() << " input changes, "
+            << picks.size() << " picks, " << events.size() << " optimizer events" << std::endl;
+}
+
+bool InputReplay::apply(uint64_t step, InputState& state) {
+  for (; next_input < inputs.size() && inputs[next_input].step <= step; ++next_input)
+    current = inputs[next_input].state;
+  state.keys = current.keys;
+  state.mouse_left = current.mouse_left;
+  state.mouse_right = current.mouse_right;
+  state.cursor_x = current.cursor_x;
+  state.cursor_y = current.cursor_y;
+  state.width = current.width;
+  state.height = current.height;
+  return step <= end_step;
+}
+
+std::optional<glm::vec3> InputReplay::picked(uint64_t step) {
+  while (next_pick < picks.size() && picks[next_pick].step < step)
+    ++next_pick;
+  if (next_pick < picks.size() && picks[next_pick].step == step)
+    return picks[next_pick++].point;
+  return std::nullopt;
+}
+
+void InputReplay::check(uint64_t step, OptimizerEvent event, glm::vec2 point) {
+  bool same = next_event < events.size() && events[next_event].step == step &&
+              events[next_event].event == event && events[next_event].point == point;
+  if (!same && !divergence_count)
+    std::cout << "[Info] Replay diverged from the recording at step " << step << std::endl;
+  divergence_count += !same;
+  ++next_event;
+}
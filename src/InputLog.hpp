@@ -0,0 +1,95 @@
+#ifndef INPUTLOG_HPP
+#define INPUTLOG_HPP
+
+#include <FrameState.hpp>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Binary log of a session: the input the update thread consumed at every
+// update step (only what changed since the previous step), the points picked
+// by clicks and the optimizer events it produced. The update steps run on a
+// simulated clock, so feeding the same input at the same steps reproduces
+// the camera and the optimizer exactly, and the recorded events tell whether
+// it did. A click is resolved against the graph of whichever mesh job has
+// finished, so the picked points are replayed rather than picked again.
+//
+// File layout, little endian: "FGIINPUT", uint32 version, double update
+// period, then records of a uint8 kind, a varint step delta and a payload.
+// Version 1 logs have no picks.
+
+enum class OptimizerEvent : uint8_t {
+  Cleared,
+  Newton,                 // started at the point
+  GradientDescent,        // started at the point
+  Step,                   // moved to the point
+  StepFailed,
+  CmaEs,                  // started at the point
+  DifferentialEvolution   // started at the point
+};
+
+class InputRecorder {
+public:
+  InputRecorder(const std::string& path, double update_period);
+  ~InputRecorder();
+
+  void record(uint64_t step, const InputState& state);
+  void event(uint64_t step, OptimizerEvent event, glm::vec2 point);
+  void pick(uint64_t step, glm::vec3 point);
+
+private:
+  std::ofstream file;
+  InputState last;
+  uint64_t last_step = 0;  // of the last record
+  uint64_t end_step = 0;
+
+  void header(uint8_t kind, uint64_t step);
+};
+
+class InputReplay {
+public:
+  explicit InputReplay(const std::string& path);
+
+  double updatePeriod() const { return update_period; }
+  uint64_t lastStep() const { return end_step; }
+
+  // sets the recorded keyboard, mouse and window state of the step, returns
+  // false once the recorded session is over
+  bool apply(uint64_t step, InputState& state);
+  // compares an event of the replayed session with the recording
+  void check(uint64_t step, OptimizerEvent event, glm::vec2 point);
+  size_t divergences() const { return divergence_count; }
+  // false for a version 1 log, whose clicks are picked again
+  bool hasPicks() const { return has_picks; }
+  // the point a click picked at the step, if any
+  std::optional<glm::vec3> picked(uint64_t step);
+
+private:
+  struct Input {
+    uint64_t step;
+    InputState state;
+  };
+  struct Event {
+    uint64_t step;
+    OptimizerEvent event;
+    glm::vec2 point;
+  };
+  struct Pick {
+    uint64_t step;
+    glm::vec3 point;
+  };
+
+  double update_period;
+  uint64_t end_step = 0;
+  std::vector<Input> inputs;
+  std::vector<Event> events;
+  std::vector<Pick> picks;
+  bool has_picks = false;
+  InputState current;
+  size_t next_input = 0, next_event = 0, next_pick = 0;
+  size_t divergence_count = 0;
+};
+
+#endif // INPUTLOG_HPP
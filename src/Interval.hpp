@@ -0,0 +1,135 @@
+#ifndef INTERVAL_HPP
+#define INTERVAL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// The operations live in their own namespace and are found through argument
+// dependent lookup, so they do not compete with the <cmath> overloads for
+// plain numbers.
+namespace interval_arithmetic {
+
+// Closed interval of doubles. Every operation rounds its bounds outwards, so
+// the result encloses all values the operation can take on the operands.
+struct Interval {
+  double lo, hi;
+
+  Interval() : lo(0.0), hi(0.0) {}
+  Interval(double value) : lo(value), hi(value) {}
+  Interval(double lo, double hi) : lo(lo), hi(hi) {}
+
+  double width() const { return hi - lo; }
+  double mid() const { return 0.5 * (lo + hi); }
+  bool contains(double value) const { return lo <= value && value <= hi; }
+};
+
+namespace detail {
+
+inline double down(double x) {
+  return std::nextafter(x, -std::numeric_limits<double>::infinity());
+}
+
+inline double up(double x) {
+  return std::nextafter(x, std::numeric_limits<double>::infinity());
+}
+
+// libm results are not correctly rounded, allow a few ulps
+inline Interval widen(double lo, double hi) {
+  return {down(down(lo)), up(up(hi))};
+}
+
+} // namespace detail
+
+inline Interval operator+(const Interval& a, const Interval& b) {
+  return {detail::down(a.lo + b.lo), detail::up(a.hi + b.hi)};
+}
+
+inline Interval operator-(const Interval& a, const Interval& b) {
+  return {detail::down(a.lo - b.hi), detail::up(a.hi - b.lo)};
+}
+
+inline Interval operator-(const Interval& a) {
+  return {-a.hi, -a.lo};
+}
+
+inline Interval operator*(const Interval& a, const Interval& b) {
+  double p[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+  return {detail::down(*std::min_element(p, p + 4)), detail::up(*std::max_element(p, p + 4))};
+}
+
+inline Interval operator/(const Interval& a, const Interval& b) {
+  if (b.contains(0.0))
+    return {-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+  return a * Interval(detail::down(1.0 / b.hi), detail::up(1.0 / b.lo));
+}
+
+inline Interval& operator+=(Interval& a, const Interval& b) { return a = a + b; }
+inline Interval& operator-=(Interval& a, const Interval& b) { return a = a - b; }
+inline Interval& operator*=(Interval& a, const Interval& b) { return a = a * b; }
+
+inline Interval pow(const Interval& a, int n) {
+  if (n == 0)
+    return Interval(1.0);
+  if (n < 0)
+    return Interval(1.0) / pow(a, -n);
+  // odd powers are increasing, even powers are monotone on either side of 0
+  bool even = n % 2 == 0;
+  Interval base = a;
+  if (even && a.hi < 0.0)
+    base = -a;
+  else if (even && a.contains(0.0))
+    base = Interval(0.0, std::max(-a.lo, a.hi));
+  Interval lo_power(1.0), hi_power(1.0);
+  for (int i = 0; i < n; ++i) {
+    lo_power = lo_power * Interval(base.lo);
+    hi_power = hi_power * Interval(base.hi);
+  }
+  return {lo_power.lo, hi_power.hi};
+}
+
+inline Interval sqrt(const Interval& a) {
+  return detail::widen(std::sqrt(std::max(0.0, a.lo)), std::sqrt(std::max(0.0, a.hi)));
+}
+
+inline Interval exp(const Interval& a) {
+  return detail::widen(std::exp(a.lo), std::exp(a.hi));
+}
+
+inline Interval abs(const Interval& a) {
+  if (a.contains(0.0))
+    return {0.0, std::max(-a.lo, a.hi)};
+  return a.lo > 0.0 ? a : -a;
+}
+
+inline Interval sin(const Interval& a) {
+  const double pi = 3.14159265358979323846;
+  if (a.width() >= 2.0 * pi)
+    return {-1.0, 1.0};
+  double lo = std::min(std::sin(a.lo), std::sin(a.hi));
+  double hi = std::max(std::sin(a.lo), std::sin(a.hi));
+  // maxima at pi/2 + 2k pi and minima at -pi/2 + 2k pi inside the interval
+  if (std::floor((a.hi - pi / 2) / (2 * pi)) != std::floor((a.lo - pi / 2) / (2 * pi)))
+    hi = 1.0;
+  if (std::floor((a.hi + pi / 2) / (2 * pi)) != std::floor((a.lo + pi / 2) / (2 * pi)))
+    lo = -1.0;
+  Interval r = detail::widen(lo, hi);
+  return {std::max(-1.0, r.lo), std::min(1.0, r.hi)};
+}
+
+inline Interval cos(const Interval& a) {
+  const double pi = 3.14159265358979323846;
+  return sin(a + Interval(pi / 2));
+}
+
+} // namespace interval_arithmetic
+
+using Interval = interval_arithmetic::Interval;
+
+// interval extensions of the function and of its gradient
+using interval_func_t = std::function<Interval(Interval, Interval)>;
+using interval_grad_t = std::function<std::array<Interval, 2>(Interval, Interval)>;
+
+#endif // INTERVAL_HPP
@@ -0,0 +1,71 @@
+#include "LatticeRegion.hpp"
+
+#include <algorithm>
+
+LatticeRegion LatticeRegion::around(const LatticeWindow& window, int align) {
+  LatticeRegion region;
+  region.window = window;
+  region.a0 = floorTo(window.i0, align);
+  region.b0 = floorTo(window.j0, align);
+  region.width = floorTo(window.i0 + window.n - 1 + align - 1, align) - region.a0 + 1;
+  region.height = floorTo(window.j0 + window.n - 1 + align - 1, align) - region.b0 + 1;
+  return region;
+}
+
+LatticeRegion LatticeRegion::within(const LatticeWindow& window, int step) {
+  LatticeRegion region;
+  region.window = window;
+  region.step = step;
+  region.a0 = floorTo(window.i0 + step - 1, step);
+  region.b0 = floorTo(window.j0 + step - 1, step);
+  region.width = std::max(0, (window.i0 + window.n - 1 - region.a0) / step + 1);
+  region.height = std::max(0, (window.j0 + window.n - 1 - region.b0) / step + 1);
+  return region;
+}
+
+glm::vec2 LatticeRegion::position(size_t index) const {
+  float diff = window.level * window.unit;
+  return diff * glm::vec2(a0 + int(index % width) * step, b0 + int(index / width) * step);
+}
+
+void LatticeRegion::remap(std::vector<int>& out, int first, int count, int old_first, int old_count,
+                          int old_level) const {
+  // lattice point k of the new level is point k * level / old_level of the old one
+  out.resize(count);
+  for (int k = 0; k < count; ++k) {
+    int64_t p = int64_t(first + k * step) * window.level;
+    int64_t q = p / old_level - old_first;
+    out[k] = p % old_level == 0 && q % step == 0 && q >= 0 && q / step < old_count ? int(q / step) : -1;
+  }
+}
+
+void WindowBlocks::reset(int n, bool all) {
+  this->n = n;
+  blocks = (n + block - 1) / block;
+  block_changed.assign(size_t(blocks) * blocks, all);
+}
+
+void WindowBlocks::copy(const float* region, int width, int x0, int y0, float* window) {
+  for (int y = 0; y < n; ++y) {
+    const float* row = region + size_t(y0 + y) * width + x0;
+    float* out = window + size_t(y) * n;
+    for (int x = 0; x < n; ++x) {
+      if (out[x] != row[x]) {
+        out[x] = row[x];
+        block_changed[size_t(y / block) * blocks + x / block] = 1;
+      }
+    }
+  }
+}
+
+bool WindowBlocks::changed(int x0, int y0, int x1, int y1) const {
+  x0 = std::max(x0, 0) / block;
+  y0 = std::max(y0, 0) / block;
+  x1 = (std::min(x1, n) - 1) / block;
+  y1 = (std::min(y1, n) - 1) / block;
+  for (int by = y0; by <= y1; ++by)
+    for (int bx = x0; bx <= x1; ++bx)
+      if (block_changed[by * blocks + bx])
+        return true;
+  return false;
+}
@@ -0,0 +1,85 @@
+#ifndef LATTICEREGION_HPP
+#define LATTICEREGION_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// the multiples of stride, a power of two, rounded down, also for negative x
+inline int floorTo(int x, int stride) {
+  return x & ~(stride - 1);
+}
+
+// The n x n lattice points level * unit * (i0 + x, j0 + y) of the graph.
+struct LatticeWindow {
+  int n = 0, level = 0;
+  float unit = 0.0f;
+  int i0 = 0, j0 = 0;
+
+  bool operator==(const LatticeWindow& other) const {
+    return n == other.n && level == other.level && unit == other.unit && i0 == other.i0 && j0 == other.j0;
+  }
+  bool operator!=(const LatticeWindow& other) const { return !(*this == other); }
+};
+
+// Lattice points (a0 + step * x, b0 + step * y) of width x height points
+// around or within a window, whose samples are kept when the window moves:
+// after a pan the points still in the region, after a zoom the points of the
+// new level that coincide with ones of the old level.
+struct LatticeRegion {
+  LatticeWindow window;
+  int step = 1;
+  int a0 = 0, b0 = 0, width = 0, height = 0;
+
+  // every lattice point between the multiples of align around the window,
+  // align a power of two
+  static LatticeRegion around(const LatticeWindow& window, int align);
+  // the lattice points of the window that are multiples of step, a power of two
+  static LatticeRegion within(const LatticeWindow& window, int step);
+
+  size_t size() const { return size_t(width) * height; }
+  // of the point at index x + width * y, in the plane
+  glm::vec2 position(size_t index) const;
+
+  // calls keep(index, old_index) for every point of the region that is a
+  // point of old, none when the unit changed; columns and rows are scratch
+  template <class F>
+  void forEachKept(const LatticeRegion& old, std::vector<int>& columns, std::vector<int>& rows, F keep) const {
+    if (old.window.level == 0 || old.window.unit != window.unit)
+      return;
+    remap(columns, a0, width, old.a0, old.width, old.window.level);
+    remap(rows, b0, height, old.b0, old.height, old.window.level);
+    for (int y = 0; y < height; ++y) {
+      if (rows[y] < 0)
+        continue;
+      for (int x = 0; x < width; ++x)
+        if (columns[x] >= 0)
+          keep(size_t(y) * width + x, size_t(rows[y]) * old.width + columns[x]);
+    }
+  }
+
+private:
+  // the index in the old region of every point along an axis, -1 when none
+  void remap(std::vector<int>& out, int first, int count, int old_first, int old_count, int old_level) const;
+};
+
+// The blocks of block x block heights of an n x n window that changed when it
+// was last copied out of its region.
+class WindowBlocks {
+public:
+  static constexpr int block = 32;
+
+  // every block unchanged, or changed when all is set
+  void reset(int n, bool all);
+  // copies the n x n heights at (x0, y0) of a region of rows of width heights
+  // to window, marking the blocks whose heights differ
+  void copy(const float* region, int width, int x0, int y0, float* window);
+  // whether a height of [x0, x1) x [y0, y1) changed
+  bool changed(int x0, int y0, int x1, int y1) const;
+
+private:
+  int n = 0, blocks = 0;  // per side
+  std::vector<uint8_t> block_changed;
+};
+
+#endif // LATTICEREGION_HPP
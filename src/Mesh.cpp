@@ -0,0 +1,45 @@
+#include "Mesh.hpp"
+#include "SurfaceLayout.hpp"
+
+float sigmoid(float x) {
+  return 1.0 / (1.0 + exp(-x));
+}
+
+VertexType makeVertex(const glm::vec2 position, float h, float h_dx, float h_dy) {
+  VertexType v;
+  float hx = 100.f * (h_dx - h);
+  float hy = 100.f * (h_dy - h);
+
+  v.position = glm::vec3(position, h);
+  v.normal = glm::normalize(glm::vec3(-hx, -hy, 1.0));
+
+  float c = sigmoid(0.1f * h);
+  float c2 = sigmoid(h);
+  v.color = glm::vec4(c2, 1.0 - c2, c, 1.0);
+  return v;
+}
+
+VertexType getHeightMap(const glm::vec2 position, float diff, const func_t& func) {
+  const glm::vec2 dx(1.0, 0.0);
+  const glm::vec2 dy(0.0, 1.0);
+  return makeVertex(position, func(position), func(position + diff * dx), func(position + diff * dy));
+}
+
+void assembleSurface(const SurfaceLayout& layout, const float* heights, int i0, int j0, float diff,
+                     VertexType* out) {
+  for (size_t tile = 0; tile < layout.getTiles().size(); ++tile)
+    assembleTile(layout, tile, heights, i0, j0, diff, out);
+}
+
+void assembleTile(const SurfaceLayout& layout, size_t index, const float* heights, int i0, int j0, float diff,
+                  VertexType* out) {
+  const int n = layout.getSize() + 2;
+  const auto &tile = layout.getTiles()[index];
+  const auto &pattern = layout.getPatterns()[tile.pattern];
+  VertexType* vertex = out + tile.base_vertex;
+  for (auto [lx, ly] : pattern.vertices) {
+    int x = tile.x0 + lx, y = tile.y0 + ly;
+    *vertex++ = makeVertex(diff * glm::vec2(i0 + x, j0 + y), heights[y * n + x],
+                           heights[y * n + x + 1], heights[(y + 1) * n + x]);
+  }
+}
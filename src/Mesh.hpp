@@ -0,0 +1,39 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <utils.hpp>
+
+class SurfaceLayout;
+
+struct VertexType {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec4 color;
+};
+
+// instance of the arrow of the gradient overlay at one lattice point
+struct QuiverArrow {
+  glm::vec4 base;    // on the graph; w: width of the shaft
+  glm::vec4 vector;  // uphill along the graph, as long as the arrow; w: magnitude relative to the largest
+};
+
+float sigmoid(float x);
+
+// vertex of the graph at position with height h, where h_dx and h_dy are the
+// heights one grid step further along x and y
+VertexType makeVertex(const glm::vec2 position, float h, float h_dx, float h_dy);
+
+// vertex of the graph at position, the normal is taken from forward
+// differences with step diff
+VertexType getHeightMap(const glm::vec2 position, float diff, const func_t& func);
+
+// vertices of the graph in the order of layout, written to out. heights holds
+// the (size + 2) x (size + 2) samples of the lattice points (i0 + x, j0 + y) * diff,
+// row by row; the extra row and column give the normals of the last vertices
+void assembleSurface(const SurfaceLayout& layout, const float* heights, int i0, int j0, float diff,
+                     VertexType* out);
+// the same for the vertices of one tile of layout only
+void assembleTile(const SurfaceLayout& layout, size_t tile, const float* heights, int i0, int j0, float diff,
+                  VertexType* out);
+
+#endif // MESH_HPP
@@ -0,0 +1,292 @@
+#include "MeshExporter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "Mesh.hpp"
+#include "ThreadPool.hpp"
+
+static_assert(sizeof(MeshExporter::ExportVertex) == 28, "vertex record must be tightly packed");
+
+namespace {
+
+class ProgressReport {
+public:
+  ProgressReport(std::string label, std::string unit, uint64_t total, bool enabled)
+      : label(label), unit(unit), total(total), enabled(enabled), start(clock::now()), last(start) {}
+
+  void update(uint64_t samples_done, uint64_t bytes_done) {
+    samples = samples_done;
+    bytes = bytes_done;
+    auto now = clock::now();
+    if (!enabled || std::chrono::duration<double>(now - last).count() < 0.5)
+      return;
+    last = now;
+    print("\r");
+  }
+
+  void finish() {
+    if (!enabled)
+      return;
+    print("\r");
+    std::cout << std::endl;
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+  std::string label, unit;
+  uint64_t total, samples = 0, bytes = 0;
+  bool enabled;
+  clock::time_point start, last;
+
+  void print(const char* prefix) {
+    double seconds = std::max(1e-9, std::chrono::duration<double>(clock::now() - start).count());
+    std::printf("%s[Export] %s %5.1f%%  %.2f M%s/s  %.1f MB/s  %.1fs", prefix, label.c_str(),
+                100.0 * samples / std::max<uint64_t>(total, 1), samples / seconds * 1e-6,
+                unit.c_str(), bytes / seconds * 1e-6, seconds);
+    std::fflush(stdout);
+  }
+};
+
+void writeOrThrow(std::ofstream& out, const void* data, size_t bytes) {
+  out.write(static_cast<const char*>(data), bytes);
+  if (!out)
+    throw std::runtime_error("Export: write failed");
+}
+
+} // namespace
+
+MeshExporter::MeshExporter(func_t function, ExportSettings settings, std::optional<batch_t> batch)
+    : function(function), batch(batch), settings(settings) {
+  if (settings.samples < 2)
+    throw std::invalid_argument("Export: need at least 2 samples per side");
+  if (settings.tile < 2)
+    this->settings.tile = 2;
+  if (uint64_t(settings.samples) * settings.samples > std::numeric_limits<uint32_t>::max())
+    throw std::invalid_argument("Export: too many samples for 32-bit indices");
+  spacing = settings.extent / (settings.samples - 1);
+  tiles_per_side = (settings.samples + this->settings.tile - 1) / this->settings.tile;
+}
+
+uint64_t MeshExporter::vertexCount() const {
+  return uint64_t(settings.samples) * settings.samples;
+}
+
+uint64_t MeshExporter::triangleCount() const {
+  return 2 * uint64_t(settings.samples - 1) * (settings.samples - 1);
+}
+
+uint32_t MeshExporter::tileWidth(uint32_t t) const {
+  return std::min(settings.tile, settings.samples - t * settings.tile);
+}
+
+uint32_t MeshExporter::vertexIndex(uint32_t x, uint32_t y) const {
+  uint32_t tx = x / settings.tile, ty = y / settings.tile;
+  // all tile rows above are full height, tiles to the left share our height
+  uint64_t base = uint64_t(ty) * settings.tile * settings.samples +
+                  uint64_t(tileWidth(ty)) * tx * settings.tile;
+  return base + (y - ty * settings.tile) * tileWidth(tx) + (x - tx * settings.tile);
+}
+
+std::vector<MeshExporter::ExportVertex> MeshExporter::evaluateTile(uint32_t tx, uint32_t ty) const {
+  uint32_t w = tileWidth(tx), h = tileWidth(ty);
+  glm::vec2 corner = settings.center - 0.5f * settings.extent;
+
+  // one extra row and column of heights for the normals
+  const uint32_t n = w + 1;
+  std::vector<glm::vec2> positions(n * (h + 1));
+  for (uint32_t ly = 0; ly <= h; ++ly)
+    for (uint32_t lx = 0; lx <= w; ++lx)
+      positions[ly * n + lx] = corner + spacing * glm::vec2(tx * settings.tile + lx, ty * settings.tile + ly);
+  std::vector<float> heights(positions.size());
+  evaluateBatch(function, batch, positions.data(), heights.data(), positions.size());
+
+  std::vector<ExportVertex> tile(w * h);
+  for (uint32_t ly = 0; ly < h; ++ly)
+    for (uint32_t lx = 0; lx < w; ++lx) {
+      size_t i = ly * n + lx;
+      // the normals of makeVertex are scaled for the lattice of the viewer,
+      // the geometric ones come from the slopes over the export spacing
+      VertexType v = makeVertex(positions[i], heights[i], heights[i + 1], heights[i + n]);
+      glm::vec3 normal = glm::normalize(
+        glm::vec3(-(heights[i + 1] - heights[i]) / spacing, -(heights[i + n] - heights[i]) / spacing, 1.0f));
+      ExportVertex &out = tile[ly * w + lx];
+      for (int i = 0; i < 3; ++i) {
+        out.position[i] = v.position[i];
+        out.normal[i] = normal[i];
+      }
+      for (int i = 0; i < 4; ++i)
+        out.color[i] = uint8_t(glm::clamp(v.color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+  return tile;
+}
+
+std::vector<uint32_t> MeshExporter::tileTriangles(uint32_t tx, uint32_t ty) const {
+  // quads whose lower corner lies in the tile, same winding as createGraph()
+  uint32_t x_end = std::min(settings.samples - 1, (tx + 1) * settings.tile);
+  uint32_t y_end = std::min(settings.samples - 1, (ty + 1) * settings.tile);
+  std::vector<uint32_t> index;
+  for (uint32_t y = ty * settings.tile; y < y_end; ++y)
+    for (uint32_t x = tx * settings.tile; x < x_end; ++x) {
+      uint32_t a = vertexIndex(x, y), b = vertexIndex(x + 1, y);
+      uint32_t c = vertexIndex(x + 1, y + 1), d = vertexIndex(x, y + 1);
+      index.insert(index.end(), {a, b, c, c, d, a});
+    }
+  return index;
+}
+
+template <class Writer>
+void MeshExporter::streamVertices(Writer write) {
+  ThreadPool pool(settings.threads);
+  const size_t window = 2 * pool.size();
+  std::deque<std::future<std::vector<ExportVertex>>> in_flight;
+
+  bounds_min = glm::vec3(std::numeric_limits<float>::max());
+  bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+
+  ProgressReport progress("vertices", "samples", vertexCount(), settings.progress);
+  uint64_t samples_done = 0, bytes_done = 0;
+  auto flush = [&]() {
+    std::vector<ExportVertex> tile = in_flight.front().get();
+    in_flight.pop_front();
+    for (auto &v : tile)
+      for (int i = 0; i < 3; ++i) {
+        bounds_min[i] = std::min(bounds_min[i], v.position[i]);
+        bounds_max[i] = std::max(bounds_max[i], v.position[i]);
+      }
+    write(tile.data(), tile.size() * sizeof(ExportVertex));
+    samples_done += tile.size();
+    bytes_done += tile.size() * sizeof(ExportVertex);
+    progress.update(samples_done, bytes_done);
+  };
+
+  for (uint32_t ty = 0; ty < tiles_per_side; ++ty)
+    for (uint32_t tx = 0; tx < tiles_per_side; ++tx) {
+      if (in_flight.size() >= window)
+        flush();
+      in_flight.push_back(pool.submit([this, tx, ty]() { return evaluateTile(tx, ty); }));
+    }
+  while (!in_flight.empty())
+    flush();
+  progress.finish();
+}
+
+template <class Writer>
+void MeshExporter::streamTriangles(Writer write) {
+  ProgressReport progress("triangles", "triangles", triangleCount(), settings.progress);
+  uint64_t triangles_done = 0, bytes_done = 0;
+  for (uint32_t ty = 0; ty < tiles_per_side; ++ty)
+    for (uint32_t tx = 0; tx < tiles_per_side; ++tx) {
+      std::vector<uint32_t> index = tileTriangles(tx, ty);
+      bytes_done += write(index);
+      triangles_done += index.size() / 3;
+      progress.update(triangles_done, bytes_done);
+    }
+  progress.finish();
+}
+
+void MeshExporter::exportPly(const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    throw std::runtime_error("Export: could not open " + path);
+
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment FunctionGraphInspector3D export\n"
+         << "element vertex " << vertexCount() << "\n"
+         << "property float x\nproperty float y\nproperty float z\n"
+         << "property float nx\nproperty float ny\nproperty float nz\n"
+         << "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n"
+         << "element face " << triangleCount() << "\n"
+         << "property list uchar uint vertex_indices\n"
+         << "end_header\n";
+  std::string text = header.str();
+  writeOrThrow(out, text.data(), text.size());
+
+  streamVertices([&](const void* data, size_t bytes) { writeOrThrow(out, data, bytes); });
+
+  std::vector<char> faces;
+  streamTriangles([&](const std::vector<uint32_t>& index) {
+    const size_t record = 1 + 3 * sizeof(uint32_t);
+    faces.resize(index.size() / 3 * record);
+    char *p = faces.data();
+    for (size_t i = 0; i < index.size(); i += 3, p += record) {
+      *p = 3;
+      std::memcpy(p + 1, &index[i], 3 * sizeof(uint32_t));
+    }
+    writeOrThrow(out, faces.data(), faces.size());
+    return faces.size();
+  });
+}
+
+void MeshExporter::exportGltf(const std::string& path) {
+  std::string bin_path = path + ".bin";
+  std::ofstream bin(bin_path, std::ios::binary);
+  if (!bin)
+    throw std::runtime_error("Export: could not open " + bin_path);
+
+  streamVertices([&](const void* data, size_t bytes) { writeOrThrow(bin, data, bytes); });
+  streamTriangles([&](const std::vector<uint32_t>& index) {
+    writeOrThrow(bin, index.data(), index.size() * sizeof(uint32_t));
+    return index.size() * sizeof(uint32_t);
+  });
+  bin.close();
+
+  uint64_t vertex_bytes = vertexCount() * sizeof(ExportVertex);
+  uint64_t index_bytes = triangleCount() * 3 * sizeof(uint32_t);
+  std::string bin_name = bin_path.substr(bin_path.find_last_of("/\\") + 1);
+
+  std::ofstream json(path);
+  if (!json)
+    throw std::runtime_error("Export: could not open " + path);
+  json.precision(9);
+  json << "{\n"
+       << "  \"asset\": {\"version\": \"2.0\", \"generator\": \"FunctionGraphInspector3D\"},\n"
+       << "  \"scene\": 0,\n"
+       << "  \"scenes\": [{\"nodes\": [0]}],\n"
+       << "  \"nodes\": [{\"mesh\": 0}],\n"
+       << "  \"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0, \"NORMAL\": 1, \"COLOR_0\": 2}, "
+       << "\"indices\": 3, \"mode\": 4}]}],\n"
+       << "  \"buffers\": [{\"uri\": \"" << bin_name << "\", \"byteLength\": " << vertex_bytes + index_bytes << "}],\n"
+       << "  \"bufferViews\": [\n"
+       << "    {\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": " << vertex_bytes
+       << ", \"byteStride\": " << sizeof(ExportVertex) << ", \"target\": 34962},\n"
+       << "    {\"buffer\": 0, \"byteOffset\": " << vertex_bytes << ", \"byteLength\": " << index_bytes
+       << ", \"target\": 34963}\n"
+       << "  ],\n"
+       << "  \"accessors\": [\n"
+       << "    {\"bufferView\": 0, \"byteOffset\": " << offsetof(ExportVertex, position)
+       << ", \"componentType\": 5126, \"count\": " << vertexCount() << ", \"type\": \"VEC3\", "
+       << "\"min\": [" << bounds_min.x << ", " << bounds_min.y << ", " << bounds_min.z << "], "
+       << "\"max\": [" << bounds_max.x << ", " << bounds_max.y << ", " << bounds_max.z << "]},\n"
+       << "    {\"bufferView\": 0, \"byteOffset\": " << offsetof(ExportVertex, normal)
+       << ", \"componentType\": 5126, \"count\": " << vertexCount() << ", \"type\": \"VEC3\"},\n"
+       << "    {\"bufferView\": 0, \"byteOffset\": " << offsetof(ExportVertex, color)
+       << ", \"componentType\": 5121, \"normalized\": true, \"count\": " << vertexCount() << ", \"type\": \"VEC4\"},\n"
+       << "    {\"bufferView\": 1, \"byteOffset\": 0, \"componentType\": 5125, \"count\": " << triangleCount() * 3
+       << ", \"type\": \"SCALAR\"}\n"
+       << "  ]\n"
+       << "}\n";
+  if (!json)
+    throw std::runtime_error("Export: write failed");
+}
+
+void MeshExporter::exportFile(const std::string& path) {
+  auto endsWith = [&](const std::string& suffix) {
+    return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+  if (endsWith(".ply"))
+    exportPly(path);
+  else if (endsWith(".gltf"))
+    exportGltf(path);
+  else
+    throw std::invalid_argument("Export: unknown format of " + path + " (use .ply or .gltf)");
+}
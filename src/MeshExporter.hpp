@@ -0,0 +1,64 @@
+#ifndef MESHEXPORTER_HPP
+#define MESHEXPORTER_HPP
+
+#include <utils.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Headless export of the graph surface sampled on a samples x samples grid.
+// The grid is evaluated in tiles of tile x tile vertices on a thread pool and
+// streamed to disk in order, so memory use depends on the tile size only.
+struct ExportSettings {
+  glm::vec2 center = glm::vec2(0.0, 0.0);
+  float extent = 20.0;        // side length of the exported square
+  uint32_t samples = 1024;    // vertices per side
+  uint32_t tile = 256;        // vertices per tile side
+  unsigned threads = 0;       // 0 means all hardware threads
+  bool progress = true;
+};
+
+class MeshExporter {
+public:
+  MeshExporter(func_t function, ExportSettings settings, std::optional<batch_t> batch = std::nullopt);
+
+  // binary little endian PLY
+  void exportPly(const std::string& path);
+  // glTF 2.0, the JSON goes to path and the buffer to path with .bin suffix
+  void exportGltf(const std::string& path);
+  // picks the format from the extension of path
+  void exportFile(const std::string& path);
+
+  // record written for every vertex, shared by both formats
+  struct ExportVertex {
+    float position[3];
+    float normal[3];
+    uint8_t color[4];
+  };
+
+private:
+  func_t function;
+  std::optional<batch_t> batch;
+  ExportSettings settings;
+  float spacing;
+  uint32_t tiles_per_side;
+
+  glm::vec3 bounds_min, bounds_max;
+
+  uint64_t vertexCount() const;
+  uint64_t triangleCount() const;
+  uint32_t tileWidth(uint32_t t) const;
+  // index of grid vertex (x, y) in the tile-major order the vertices are written
+  uint32_t vertexIndex(uint32_t x, uint32_t y) const;
+
+  std::vector<ExportVertex> evaluateTile(uint32_t tx, uint32_t ty) const;
+  std::vector<uint32_t> tileTriangles(uint32_t tx, uint32_t ty) const;
+
+  // evaluates all tiles in parallel and hands them to write in order
+  template <class Writer>
+  void streamVertices(Writer write);
+  template <class Writer>
+  void streamTriangles(Writer write);
+};
+
+#endif // MESHEXPORTER_HPP
@@ -11,66 +11,308 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/matrix_operation.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+#include "AllocationCounter.hpp"
+#include "Mesh.hpp"
 #include "asset.hpp"
 #include "glError.hpp"
 
-struct VertexType {
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec4 color;
-};
+void MyApplication::createGraph(MeshJob& job) {
+  Profiler::Scope scope(profiler.get(), "mesh");
+  glm::vec3 center = job.center;
 
-float sigmoid(float x) {
-  return 1.0 / (1.0 + exp(-x));
+  // creation of the mesh ------------------------------------------------------
+  // a coarser layout than size x size covers the same region with fewer quads
+  const int grid = job.mesh->layout->getSize();
+  int level = std::max(1.0f, glm::round(job.camera_distance));
+  float unit = 0.004f * size / grid;
+  float diff = level * unit;
+
+  // the graph is sampled on the lattice of multiples of diff, an extra row and
+  // column of heights gives the normals of the last vertices
+  const int n = grid + 2;
+  int i0 = int(glm::round(center.x / diff)) - grid / 2;
+  int j0 = int(glm::round(center.y / diff)) - grid / 2;
+  // the samples of a function that changed are dropped
+  if (job.invalidate || job.slice != graph_slice || job.surrogate != graph_surrogate) {
+    progressive_grid->invalidate();
+    if (hermite_grid)
+      hermite_grid->invalidate();
+    quiver_field->invalidate();
+    normal_map->invalidate();
+  }
+  graph_slice = job.slice;
+  graph_surrogate = job.surrogate;
+  const float* heights;
+  if (surface_stream) {
+    streamGraph(job, diff, i0, j0);
+    heights = surface_stream->heights();
+  }
+  else if (tile_pager) {
+    graph_heights.resize(n * n);
+    tile_pager->collect();
+    tile_pager->fill(level, diff, i0, j0, n, n, graph_heights.data());
+    tile_pager->prefetch(level, diff, i0, j0, n, n, glm::vec2(center - last_graph_position));
+    heights = graph_heights.data();
+    assembleGraph(job, heights, i0, j0, diff, false, nullptr);
+  }
+  else if (job.hermite) {
+    // patches of a sparse lattice, split where they miss the function; the
+    // tiles of the previous graph are of the other grid after a switch
+    hermite_grid->refine(n, level, unit, i0, j0);
+    job.hermite_stats = hermite_grid->statistics();
+    heights = hermite_grid->heights();
+    assembleGraph(job, heights, i0, j0, diff, !hermite_grid->refreshedAll() && graph_hermite,
+                  [this](int x0, int y0, int x1, int y1) { return hermite_grid->changed(x0, y0, x1, y1); });
+  }
+  else {
+    // coarse to fine within the budget of the job, the tiles whose heights
+    // did not change are copied from the previous graph
+    progressive_grid->refine(n, level, unit, i0, j0, job.budget);
+    job.pending_samples = progressive_grid->pendingCount();
+    job.pending_stride = progressive_grid->pendingStride();
+    heights = progressive_grid->heights();
+    assembleGraph(job, heights, i0, j0, diff, !progressive_grid->refreshedAll() && !graph_hermite,
+                  [this](int x0, int y0, int x1, int y1) { return progressive_grid->changed(x0, y0, x1, y1); });
+  }
+  graph_hermite = job.hermite;
+  last_graph_position = center;
+  // the heights of the vertices, without the extra row and column
+  job.pyramid->build(heights, n, grid + 1, diff * glm::vec2(i0, j0), diff);
+
+  // the same heights for the heat map, which needs no samples of its own
+  SurfaceMesh& mesh = *job.mesh;
+  mesh.heights.clear();
+  if (job.heat_map) {
+    mesh.samples = grid + 1;
+    mesh.origin = diff * glm::vec2(i0, j0);
+    mesh.spacing = diff;
+    mesh.heights.resize(size_t(mesh.samples) * mesh.samples);
+    float lowest = INFINITY, highest = -INFINITY;
+    for (int y = 0; y < mesh.samples; ++y) {
+      std::copy_n(heights + size_t(y) * n, mesh.samples, mesh.heights.data() + size_t(y) * mesh.samples);
+      for (int x = 0; x < mesh.samples; ++x) {
+        float h = heights[size_t(y) * n + x];
+        if (std::isfinite(h)) {
+          lowest = std::min(lowest, h);
+          highest = std::max(highest, h);
+        }
+      }
+    }
+    mesh.height_range = lowest <= highest ? glm::vec2(lowest, highest) : glm::vec2(0.0f);
+  }
+
+  // gradient overlay, the gradients of a timed function change with t
+  mesh.arrows.clear();
+  if (job.quiver) {
+    if (job.t != quiver_t)
+      quiver_field->invalidate();
+    quiver_t = job.t;
+    quiver_field->update(n, level, unit, i0, j0, [this, &job, diff](const glm::vec2* points, glm::vec2* out, size_t count) {
+      evaluateGradients(job, 0.01f * diff, points, out, count);
+    });
+    job.gradient_range = quiver_field->arrows(heights, mesh.arrows);
+  }
+
+  // normal map, the gradients it did not evaluate within the budget of the job
+  // are the slopes of the heights until a later job gets to them
+  mesh.normal_side = 0;
+  if (job.normal_map) {
+    float spacing = diff / NormalMap::factor;
+    normal_map->update(grid, level, unit, i0, j0, heights,
+                       [this, &job, spacing](const glm::vec2* points, glm::vec2* out, size_t count) {
+                         evaluateGradients(job, 0.01f * spacing, points, out, count);
+                       },
+                       job.budget, job.version);
+    job.pending_normals = normal_map->pendingCount();
+    // the mesh was recycled, only the blocks that changed since it was filled
+    // are copied
+    const int side = normal_map->side(), blocks = side / NormalMap::block;
+    const auto& texels = normal_map->texels();
+    const auto& versions = normal_map->blockVersions();
+    bool all = mesh.normal_versions.size() != versions.size();
+    mesh.normal_texels.resize(texels.size());
+    mesh.normal_versions.resize(versions.size());
+    for (int b = 0; b < blocks * blocks; ++b) {
+      if (!all && mesh.normal_versions[b] == versions[b])
+        continue;
+      mesh.normal_versions[b] = versions[b];
+      size_t first = size_t(b / blocks) * NormalMap::block * side + size_t(b % blocks) * NormalMap::block;
+      for (int y = 0; y < NormalMap::block; ++y)
+        std::copy_n(texels.data() + first + size_t(y) * side, NormalMap::block,
+                    mesh.normal_texels.data() + first + size_t(y) * side);
+    }
+    mesh.normal_side = side;
+    mesh.normal_spacing = normal_map->spacing();
+    // as the normals of the vertices, from the differences of the heights
+    mesh.normal_scale = 100.0f * diff;
+  }
+}
+
+void MyApplication::evaluateGradients(const MeshJob& job, float step, const glm::vec2* points, glm::vec2* out,
+                                      size_t count) {
+  if (job.surrogate) {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = job.surrogate->gradient(points[i]);
+    return;
+  }
+  if (timed_function && timed_function->gradient) {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = (*timed_function->gradient)(points[i], job.t);
+    return;
+  }
+  if (gradient && !timed_function && !job.slice) {
+    for (size_t i = 0; i < count; ++i)
+      out[i] = (*gradient)(points[i]);
+    return;
+  }
+  // central differences, evaluated in batches of a few points
+  const size_t batch_points = 64;
+  glm::vec2 probes[4 * batch_points];
+  float values[4 * batch_points];
+  for (size_t first = 0; first < count; first += batch_points) {
+    size_t points_in_batch = std::min(batch_points, count - first);
+    for (size_t i = 0; i < points_in_batch; ++i) {
+      glm::vec2 p = points[first + i];
+      probes[4 * i] = p + glm::vec2(step, 0.0f);
+      probes[4 * i + 1] = p - glm::vec2(step, 0.0f);
+      probes[4 * i + 2] = p + glm::vec2(0.0f, step);
+      probes[4 * i + 3] = p - glm::vec2(0.0f, step);
+    }
+    size_t probe_count = 4 * points_in_batch;
+    if (timed_function)
+      timed_function->evaluate(probes, job.t, values, probe_count);
+    else if (job.slice)
+      slice_view->evaluate(*job.slice, probes, values, probe_count);
+    else
+      evaluateBatch(function, batch, probes, values, probe_count);
+    for (size_t i = 0; i < points_in_batch; ++i)
+      out[first + i] = glm::vec2(values[4 * i] - values[4 * i + 1], values[4 * i + 2] - values[4 * i + 3]) / (2.0f * step);
+  }
 }
 
-VertexType getHeightMap(const glm::vec2 position, float diff, std::function<float(glm::vec2)> func) {
-  const glm::vec2 dx(1.0, 0.0);
-  const glm::vec2 dy(0.0, 1.0);
+void MyApplication::streamGraph(MeshJob& job, float diff, int i0, int j0) {
+  // the heights that fit in the budget move to the t of the job, only the
+  // tiles that read them are assembled again
+  const int n = size + 2;
+  if (job.invalidate)
+    surface_stream->invalidate();
+  surface_stream->refresh(n, diff, i0, j0, job.t, animation.budget);
+  job.stale_blocks = surface_stream->staleCount();
+  assembleGraph(job, surface_stream->heights(), i0, j0, diff, !surface_stream->refreshedAll(),
+                [this](int x0, int y0, int x1, int y1) { return surface_stream->changed(x0, y0, x1, y1); });
+}
 
-  VertexType v;
-  float h = func(position);
-  float hx = 100.f * (func(position + diff * dx) - h);
-  float hy = 100.f * (func(position + diff * dy) - h);
+void MyApplication::assembleGraph(MeshJob& job, const float* heights, int i0, int j0, float diff, bool reuse,
+                                  const std::function<bool(int, int, int, int)>& changed) {
+  // vertices tile by tile in the order of the layout, into a recycled mesh
+  // whose vertices keep their capacity
+  SurfaceMesh& mesh = *job.mesh;
+  const SurfaceLayout& layout = *mesh.layout;
+  const SurfaceMesh* previous = job.previous.get();
+  reuse = reuse && previous && previous->layout == mesh.layout;
+  mesh.vertices.resize(layout.vertexCount());
+  mesh.version = job.version;
+  mesh.tile_versions.resize(layout.getTiles().size());
+  graph_pool->parallelFor(0, layout.getTiles().size(), [&](size_t i) {
+    const auto &tile = layout.getTiles()[i];
+    const auto &pattern = layout.getPatterns()[tile.pattern];
+    // the vertices of a tile read the heights up to one past its last quad
+    if (reuse && !changed(tile.x0, tile.y0, tile.x0 + pattern.w + 2, tile.y0 + pattern.h + 2)) {
+      std::copy_n(previous->vertices.data() + tile.base_vertex, pattern.vertices.size(),
+                  mesh.vertices.data() + tile.base_vertex);
+      mesh.tile_versions[i] = previous->tile_versions[i];
+    }
+    else {
+      assembleTile(layout, i, heights, i0, j0, diff, mesh.vertices.data());
+      mesh.tile_versions[i] = job.version;
+    }
+  });
+}
 
-  v.position = glm::vec3(position, h);
-  v.normal = glm::normalize(glm::vec3(-hx, -hy, 1.0));
+std::shared_ptr<SurfaceMesh> MyApplication::recycledMesh() {
+  for (auto &mesh : mesh_pool) {
+    if (mesh.use_count() == 1) {
+      // the render thread let go of it, its reads happen before our writes
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return mesh;
+    }
+  }
+  mesh_pool.push_back(std::make_shared<SurfaceMesh>());
+  return mesh_pool.back();
+}
 
-  float c = sigmoid(0.1f * h);
-  float c2 = sigmoid(h);
-  v.color = glm::vec4(c2, 1.0 - c2, c, 1.0);
-  return v;
+void MyApplication::setSurfaceLayout(SurfaceLayout::Mode mode) {
+  surface_layout = std::make_shared<SurfaceLayout>(size, 32, mode);
+  std::cout << "[Info] Surface layout: " << SurfaceLayout::modeName(mode) << ", "
+            << surface_layout->getTiles().size() << " tiles, "
+            << surface_layout->indexCount() * sizeof(GLushort)
+            << " index bytes, ACMR " << surface_layout->acmr() << std::endl;
 }
 
-void MyApplication::createGraph() {
-  // creation of the mesh ------------------------------------------------------
-  std::vector<VertexType> vertices;
-  std::vector<GLuint> index;
+void MyApplication::uploadLayout(std::shared_ptr<const SurfaceLayout> layout) {
+  uploaded_layout = layout;
+
+  // one draw per tile, all issued by a single multi draw call
+  surface_counts.clear();
+  surface_offsets.clear();
+  surface_base_vertices.clear();
+  for (auto &tile : layout->getTiles()) {
+    const auto &pattern = layout->getPatterns()[tile.pattern];
+    surface_counts.push_back(pattern.index.size());
+    surface_offsets.push_back((const GLvoid*)(pattern.index_offset * sizeof(GLushort)));
+    surface_base_vertices.push_back(tile.base_vertex);
+  }
 
-  float diff = glm::round(getCameraDistance()) * 0.004f;
+  size_t index_count = layout->indexCount();
+  GLushort* index = frame_arena.allocate<GLushort>(index_count);
+  layout->copyIndexData(index);
+  glBindVertexArray(surface_buffers[0].vao);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLushort),
+               index, GL_STATIC_DRAW);
+  glBindVertexArray(0);
+}
 
-  for (int y = 0; y <= size; ++y)
-    for (int x = 0; x <= size; ++x) {
-      float xx = (x - size / 2) * diff + glm::round(point_position.x / diff) * diff; // round to the nearest multiple of diff
-      float yy = (y - size / 2) * diff + glm::round(point_position.y / diff) * diff; // round to the nearest multiple of diff
-      vertices.push_back(getHeightMap({xx, yy}, diff, function));
-    }
+void MyApplication::createBuffers() {
+  // surface: the vertices change with every refresh, the indices only with
+  // the layout and are shared by both vertex buffers
+  glGenBuffers(1, &ibo);
+  for (auto &buffer : surface_buffers) {
+    glGenBuffers(1, &buffer.vbo);
+    glGenVertexArrays(1, &buffer.vao);
+    glBindVertexArray(buffer.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
+    shaderProgram.setAttribute("position", 3, sizeof(VertexType),
+                               offsetof(VertexType, position));
+    shaderProgram.setAttribute("normal", 3, sizeof(VertexType),
+                               offsetof(VertexType, normal));
+    shaderProgram.setAttribute("color", 4, sizeof(VertexType),
+                               offsetof(VertexType, color));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  }
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  for (int y = 0; y < size; ++y)
-    for (int x = 0; x < size; ++x) {
-      index.push_back((x + 0) + (size + 1) * (y + 0));
-      index.push_back((x + 1) + (size + 1) * (y + 0));
-      index.push_back((x + 1) + (size + 1) * (y + 1));
+  glEnable(GL_PRIMITIVE_RESTART);
+  glPrimitiveRestartIndex(SurfaceLayout::restartIndex);
 
-      index.push_back((x + 1) + (size + 1) * (y + 1));
-      index.push_back((x + 0) + (size + 1) * (y + 1));
-      index.push_back((x + 0) + (size + 1) * (y + 0));
-    }
+  // helpers: fixed geometry placed with the model matrix
+  std::vector<VertexType> vertices;
+  std::vector<GLushort> index;
+  auto range = [&](GLenum mode, size_t first) {
+    return DrawRange{mode, GLsizei(index.size() - first), first * sizeof(GLushort)};
+  };
 
   // Add the axes lines
+  size_t first = index.size();
   const float axis_length = 100.0;
   vertices.push_back({glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), glm::vec4(1, 0, 0, 1)});
   vertices.push_back({glm::vec3(axis_length, 0, 0), glm::vec3(0, 0, 1), glm::vec4(1, 0, 0, 1)});
@@ -80,8 +322,10 @@ void MyApplication::createGraph() {
   vertices.push_back({glm::vec3(0, 0, axis_length), glm::vec3(0, 0, 1), glm::vec4(0, 0, 1, 1)});
   for (int i = 0; i < 6; ++i)
     index.push_back(vertices.size() - 6 + i);
+  axes_range = range(GL_LINES, first);
 
   // Add axes lines at the point position
+  first = index.size();
   vertices.push_back({glm::vec3(0, 0, -axis_length), glm::vec3(0, 0, 1), glm::vec4(1, 1, 1, 1)});
   vertices.push_back({glm::vec3(0, 0, axis_length), glm::vec3(0, 0, 1), glm::vec4(1, 1, 1, 1)});
   vertices.push_back({glm::vec3(0, -axis_length, 0), glm::vec3(0, 0, 1), glm::vec4(1, 1, 1, 1)});
@@ -90,8 +334,10 @@ void MyApplication::createGraph() {
   vertices.push_back({glm::vec3(axis_length, 0, 0), glm::vec3(0, 0, 1), glm::vec4(1, 1, 1, 1)});
   for (int i = 0; i < 6; ++i)
     index.push_back(vertices.size() - 6 + i);
+  point_axes_range = range(GL_LINES, first);
 
   // Add a sphere at 0
+  first = index.size();
   int current_index = vertices.size();
   const float sphere_radius = 1.0;
   const int sphere_resolution = 20;
@@ -122,83 +368,775 @@ void MyApplication::createGraph() {
       index.push_back(current_index + i * sphere_resolution + j);
     }
   }
+  sphere_range = range(GL_TRIANGLES, first);
 
-  // add line from (0, 0, 0) to (1, 0, 0)
-  vertices.push_back({glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), sphere_color});
-  vertices.push_back({glm::vec3(1, 0, 0), glm::vec3(0, 0, 1), sphere_color});
-  for (int i = 0; i < 2; ++i)
-    index.push_back(vertices.size() - 2 + i);
-
-  // creation of the vertex array buffer----------------------------------------
-
-  // vbo
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glGenBuffers(1, &vbohelpers);
+  glBindBuffer(GL_ARRAY_BUFFER, vbohelpers);
   glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexType),
                vertices.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // ibo
-  glGenBuffers(1, &ibo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(GLuint),
+  glGenBuffers(1, &ibohelpers);
+  glGenVertexArrays(1, &vaohelpers);
+  glBindVertexArray(vaohelpers);
+  shaderProgram.setAttribute("position", 3, sizeof(VertexType),
+                             offsetof(VertexType, position));
+  shaderProgram.setAttribute("normal", 3, sizeof(VertexType),
+                             offsetof(VertexType, normal));
+  shaderProgram.setAttribute("color", 4, sizeof(VertexType),
+                             offsetof(VertexType, color));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibohelpers);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(GLushort),
                index.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  // vao
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  // bind vbo
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  // optimizer trajectory, streamed every frame as one line strip
+  glGenBuffers(1, &vbotrajectory);
+  glGenVertexArrays(1, &vaotrajectory);
+  glBindVertexArray(vaotrajectory);
+  glBindBuffer(GL_ARRAY_BUFFER, vbotrajectory);
+  shaderProgram.setAttribute("position", 3, sizeof(VertexType),
+                             offsetof(VertexType, position));
+  shaderProgram.setAttribute("normal", 3, sizeof(VertexType),
+                             offsetof(VertexType, normal));
+  shaderProgram.setAttribute("color", 4, sizeof(VertexType),
+                             offsetof(VertexType, color));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  // map vbo to shader attributes
+  // markers of the critical points, replaced when they change
+  glGenBuffers(1, &vbocritical);
+  glGenVertexArrays(1, &vaocritical);
+  glBindVertexArray(vaocritical);
+  glBindBuffer(GL_ARRAY_BUFFER, vbocritical);
   shaderProgram.setAttribute("position", 3, sizeof(VertexType),
                              offsetof(VertexType, position));
   shaderProgram.setAttribute("normal", 3, sizeof(VertexType),
                              offsetof(VertexType, normal));
   shaderProgram.setAttribute("color", 4, sizeof(VertexType),
                              offsetof(VertexType, color));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // gradient arrows: the shape of an arrow along x, and one instance of the
+  // base and vector of every arrow
+  instancing = GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays;
+  if (instancing) {
+    const glm::vec2 shape[arrow_vertices] = {
+      {0.0f, -0.5f}, {0.65f, -0.5f}, {0.65f, 0.5f},
+      {0.0f, -0.5f}, {0.65f, 0.5f}, {0.0f, 0.5f},
+      {0.65f, -1.5f}, {1.0f, 0.0f}, {0.65f, 1.5f},
+    };
+    glGenBuffers(1, &vboarrowshape);
+    glGenBuffers(1, &vboarrows);
+    glGenVertexArrays(1, &vaoarrows);
+    glBindVertexArray(vaoarrows);
+    glBindBuffer(GL_ARRAY_BUFFER, vboarrowshape);
+    glBufferData(GL_ARRAY_BUFFER, sizeof shape, shape, GL_STATIC_DRAW);
+    shaderProgramArrows.setAttribute("shape", 2, sizeof(glm::vec2), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, vboarrows);
+    shaderProgramArrows.setAttribute("arrow_base", 4, sizeof(QuiverArrow), offsetof(QuiverArrow, base));
+    shaderProgramArrows.setAttribute("arrow_vector", 4, sizeof(QuiverArrow), offsetof(QuiverArrow, vector));
+    for (const char* name : {"arrow_base", "arrow_vector"}) {
+      if (GLEW_VERSION_3_3)
+        glVertexAttribDivisor(shaderProgramArrows.attribute(name), 1);
+      else
+        glVertexAttribDivisorARB(shaderProgramArrows.attribute(name), 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // population of an optimizer: the vertices and indices of the helper
+    // sphere, and one instance of every member
+    glGenBuffers(1, &vbopopulation);
+    glGenVertexArrays(1, &vaopopulation);
+    glBindVertexArray(vaopopulation);
+    glBindBuffer(GL_ARRAY_BUFFER, vbohelpers);
+    shaderProgramPopulation.setAttribute("position", 3, sizeof(VertexType), offsetof(VertexType, position));
+    shaderProgramPopulation.setAttribute("normal", 3, sizeof(VertexType), offsetof(VertexType, normal));
+    glBindBuffer(GL_ARRAY_BUFFER, vbopopulation);
+    shaderProgramPopulation.setAttribute("member", 4, sizeof(glm::vec4), 0);
+    if (GLEW_VERSION_3_3)
+      glVertexAttribDivisor(shaderProgramPopulation.attribute("member"), 1);
+    else
+      glVertexAttribDivisorARB(shaderProgramPopulation.attribute("member"), 1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibohelpers);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
 
+  // text
   glGenBuffers(1, &vbotext);
   glGenVertexArrays(1, &vaotext);
-  glBindVertexArray(vaotext);
   glGenBuffers(1, &ibotext);
 
-  // bind the ibo
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  // heat map: the quad comes from the vertex ids, the heights are filtered
+  // linearly between the samples
+  glGenVertexArrays(1, &vaoheatmap);
+  glGenTextures(1, &heat_texture);
+  glBindTexture(GL_TEXTURE_2D, heat_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // normal map: the texels wrap around like the lattice they cover
+  glGenTextures(1, &normal_texture);
+  glBindTexture(GL_TEXTURE_2D, normal_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-  // vao end
-  glBindVertexArray(0);
+void MyApplication::uploadMesh(const SurfaceMesh& mesh) {
+  SurfaceBuffer& buffer = surface_buffers[1 - surface_front];
+  glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
+  if (buffer.layout != mesh.layout || buffer.version == 0) {
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(VertexType),
+                 mesh.vertices.data(), GL_DYNAMIC_DRAW);
+  }
+  else {
+    // runs of consecutive tiles changed since the buffer was filled, tiles
+    // are stored one after another in the order of the layout
+    const auto &tiles = mesh.layout->getTiles();
+    const auto &patterns = mesh.layout->getPatterns();
+    for (size_t i = 0; i < tiles.size();) {
+      if (mesh.tile_versions[i] <= buffer.version) {
+        ++i;
+        continue;
+      }
+      size_t first = tiles[i].base_vertex, last = first;
+      for (; i < tiles.size() && mesh.tile_versions[i] > buffer.version; ++i)
+        last = tiles[i].base_vertex + patterns[tiles[i].pattern].vertices.size();
+      glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(VertexType), (last - first) * sizeof(VertexType),
+                      mesh.vertices.data() + first);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  buffer.layout = mesh.layout;
+  buffer.version = mesh.version;
+  surface_front = 1 - surface_front;
+}
+
+void MyApplication::uploadHeatMap(const SurfaceMesh& mesh) {
+  // one float texel per sample, the texture is only reallocated when the
+  // layout changes its size
+  glBindTexture(GL_TEXTURE_2D, heat_texture);
+  if (mesh.samples != heat_samples)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, mesh.samples, mesh.samples, 0, GL_RED, GL_FLOAT, mesh.heights.data());
+  else
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mesh.samples, mesh.samples, GL_RED, GL_FLOAT, mesh.heights.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+  heat_samples = mesh.samples;
+}
+
+void MyApplication::uploadNormalMap(const SurfaceMesh& mesh) {
+  // RG16F halves the upload, the gradients need no more precision for shading
+  const int side = mesh.normal_side, blocks = side / NormalMap::block;
+  glBindTexture(GL_TEXTURE_2D, normal_texture);
+  if (side != normal_side) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, side, side, 0, GL_RG, GL_FLOAT, mesh.normal_texels.data());
+    normal_side = side;
+    normal_uploaded = mesh.normal_versions;
+  }
+  else {
+    // runs of changed blocks along a row of blocks, one call each
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, side);
+    for (int by = 0; by < blocks; ++by) {
+      const uint64_t* versions = mesh.normal_versions.data() + size_t(by) * blocks;
+      uint64_t* uploaded = normal_uploaded.data() + size_t(by) * blocks;
+      for (int bx = 0; bx < blocks;) {
+        if (versions[bx] == uploaded[bx]) {
+          ++bx;
+          continue;
+        }
+        int first = bx;
+        for (; bx < blocks && versions[bx] != uploaded[bx]; ++bx)
+          uploaded[bx] = versions[bx];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, first * NormalMap::block, by * NormalMap::block,
+                        (bx - first) * NormalMap::block, NormalMap::block, GL_RG, GL_FLOAT,
+                        mesh.normal_texels.data() + size_t(by) * NormalMap::block * side + first * NormalMap::block);
+      }
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void MyApplication::drawHeatMap(const FrameSnapshot& frame, int x, int width, int height) {
+  const SurfaceMesh& mesh = *uploaded_mesh;
+  glViewport(x, 0, width, height);
+  // the region of the mesh from above, as large as fits and centered
+  float side = mesh.spacing * (heat_samples - 1);
+  glm::vec2 center = mesh.origin + glm::vec2(0.5f * side);
+  float aspect = float(width) / std::max(height, 1);
+  glm::vec2 half = 0.5f * side * glm::vec2(std::max(aspect, 1.0f), std::max(1.0f / aspect, 1.0f));
+  glm::mat4 top = glm::ortho(center.x - half.x, center.x + half.x, center.y - half.y, center.y + half.y,
+                             -1e4f, 1e4f);
+
+  glDisable(GL_DEPTH_TEST);
+  shaderProgramHeatMap.use();
+  shaderProgramHeatMap.setUniform("projection", top);
+  shaderProgramHeatMap.setUniform("region", glm::vec4(mesh.origin.x, mesh.origin.y, side, float(heat_samples)));
+  shaderProgramHeatMap.setUniform("lowest", mesh.height_range.x);
+  shaderProgramHeatMap.setUniform("highest", mesh.height_range.y);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, heat_texture);
+  shaderProgramHeatMap.setUniform("heights", 0);
+  glBindVertexArray(vaoheatmap);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  shaderProgramHeatMap.unuse();
+  glEnable(GL_DEPTH_TEST);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  glCheckError(__FILE__, __LINE__);
+
+  // the center of the view, the trajectory and the picked point on top, the
+  // trajectory buffer was filled by the 3D view of this frame
+  shaderProgram.use();
+  shaderProgram.setUniform("projection", top);
+  shaderProgram.setUniform("view", glm::mat4(1.0));
+  glBindVertexArray(vaohelpers);
+  shaderProgram.setUniform("model", glm::translate(glm::mat4(1.0), frame.point_position));
+  drawHelper(point_axes_range);
+  for (auto &point : frame.points) {
+    shaderProgram.setUniform("model", glm::scale(glm::translate(glm::mat4(1.0), point), 0.006f * side * glm::vec3(1.0)));
+    drawHelper(sphere_range);
+  }
+  if (frame.picked_point) {
+    shaderProgram.setUniform("model",
+      glm::scale(glm::translate(glm::mat4(1.0), *frame.picked_point), 0.009f * side * glm::vec3(1.0)));
+    drawHelper(sphere_range);
+  }
+  if (frame.points.size() > 1) {
+    shaderProgram.setUniform("model", glm::mat4(1.0));
+    glBindVertexArray(vaotrajectory);
+    glDrawArrays(GL_LINE_STRIP, 0, frame.points.size());
+  }
+  shaderProgram.unuse();
+  glCheckError(__FILE__, __LINE__);
+}
+
+void MyApplication::drawHelper(const DrawRange& range) {
+  glDrawElements(range.mode, range.count, GL_UNSIGNED_SHORT, (GLvoid*)range.offset);
 }
 
-MyApplication::MyApplication(func_t func, std::optional<grad_t> grad, std::optional<hess_t> hess)
+MyApplication::MyApplication(func_t func, std::optional<grad_t> grad, std::optional<hess_t> hess,
+                             std::optional<batch_t> batch, std::string cache_path, int size)
     : Application(),
       function(func),
       gradient(grad),
       hessian(hess),
-      vertexShader(SHADER_DIR "/shader.vert.glsl", GL_VERTEX_SHADER),
-      fragmentShader(SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER),
-      shaderProgram({vertexShader, fragmentShader}),
-      vertexShaderText(SHADER_DIR "/text.vert.glsl", GL_VERTEX_SHADER),
-      fragmentShaderText(SHADER_DIR "/text.frag.glsl", GL_FRAGMENT_SHADER),
-      shaderProgramText({vertexShaderText, fragmentShaderText}) {
+      batch(batch),
+      size(size),
+      cache_path(cache_path),
+      shaderProgram({{SHADER_DIR "/shader.vert.glsl", GL_VERTEX_SHADER},
+                     {SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER}},
+                    ShaderProgram::defaultCacheDirectory()),
+      shaderProgramText({{SHADER_DIR "/text.vert.glsl", GL_VERTEX_SHADER},
+                         {SHADER_DIR "/text.frag.glsl", GL_FRAGMENT_SHADER}},
+                        ShaderProgram::defaultCacheDirectory()),
+      shaderProgramArrows({{SHADER_DIR "/arrow.vert.glsl", GL_VERTEX_SHADER},
+                           {SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER}},
+                          ShaderProgram::defaultCacheDirectory()),
+      shaderProgramHeatMap({{SHADER_DIR "/heatmap.vert.glsl", GL_VERTEX_SHADER},
+                            {SHADER_DIR "/heatmap.frag.glsl", GL_FRAGMENT_SHADER}},
+                           ShaderProgram::defaultCacheDirectory()),
+      shaderProgramPopulation({{SHADER_DIR "/population.vert.glsl", GL_VERTEX_SHADER},
+                               {SHADER_DIR "/shader.frag.glsl", GL_FRAGMENT_SHADER}},
+                              ShaderProgram::defaultCacheDirectory()) {
   glCheckError(__FILE__, __LINE__);
+  if (shaderProgram.fromCache() && shaderProgramText.fromCache() && shaderProgramArrows.fromCache() &&
+      shaderProgramHeatMap.fromCache() && shaderProgramPopulation.fromCache())
+    std::cout << "[Info] Shader programs loaded from the program binary cache" << std::endl;
 
-  if(FT_Init_FreeType(&ft)) {
-    fprintf(stderr, "Could not init freetype library\n");
+  loadFont();
+  createBuffers();
+
+  glfwSetWindowUserPointer(getWindow(), this);
+  glfwSetKeyCallback(getWindow(), onKey);
+  glfwSetMouseButtonCallback(getWindow(), onMouseButton);
+  glfwSetCursorPosCallback(getWindow(), onCursorPos);
+  input.width = getWidth();
+  input.height = getHeight();
+  presented_events.reserve(max_pending_events);
+
+  camera_position = glm::vec3(15.0, 15.0, 15.0);
+  view = glm::lookAt(camera_position, point_position, glm::vec3(0, 0, 1));
+
+  // the first frame already shows the first pass of the progressive grid (the
+  // tile cache fills the whole lattice), the update thread starts with the
+  // first loop() once the plugin and interval functions are set and refines it
+  setSurfaceLayout(SurfaceLayout::Mode::OptimizedTriangles);
+  openTileCache();
+  graph_pool = std::make_unique<ThreadPool>();
+  progressive_grid = std::make_unique<ProgressiveGrid>(
+    [this](const glm::vec2* points, float* values, size_t count) {
+      if (graph_slice)
+        slice_view->evaluate(*graph_slice, points, values, count);
+      else if (graph_surrogate)
+        graph_surrogate->evaluate(points, values, count);
+      else
+        evaluateBatch(this->function, this->batch, points, values, count);
+    },
+    *graph_pool);
+  if (gradient)
+    hermite_grid = std::make_unique<HermiteGrid>(
+      [this](const glm::vec2* points, size_t count, float* values, glm::vec2* gradients, float* twists) {
+        evaluateBatch(this->function, this->batch, points, values, count);
+        if (!gradients)
+          return;
+        for (size_t i = 0; i < count; ++i) {
+          gradients[i] = (*this->gradient)(points[i]);
+          twists[i] = this->hessian ? (*this->hessian)(points[i])[0][1] : NAN;
+        }
+      },
+      *graph_pool);
+  quiver_field = std::make_unique<QuiverField>(*graph_pool);
+  normal_map = std::make_unique<NormalMap>(*graph_pool);
+  MeshJob job{point_position, getCameraDistance(), recycledMesh(), ++mesh_version};
+  job.mesh->layout = surface_layout;
+  job.pyramid = std::make_unique<HeightPyramid>();
+  job.normal_map = normal_mapping;
+  createGraph(job);
+  surface_mesh = job.mesh;
+  height_pyramid = std::move(job.pyramid);
+  pending_samples = job.pending_samples;
+  pending_stride = job.pending_stride;
+  pending_normals = job.pending_normals;
+  last_refresh_time = -1.0;
+  mesh_worker = std::make_unique<BackgroundWorker<MeshJob>>([this](MeshJob& job) { createGraph(job); });
+  publishFrame(input);
+}
+
+void MyApplication::openTileCache() {
+  if (cache_path.empty())
     return;
+  // the pager refers to the store
+  tile_pager = nullptr;
+  tile_store = std::make_unique<TileStore>(cache_path, 64, gradient.has_value(), functionFingerprint(function));
+  tile_pager = std::make_unique<TilePager>(*tile_store, function, gradient, batch);
+  std::cout << "[Info] Tile cache " << cache_path << " holds " << tile_store->tileCount() << " tiles" << std::endl;
+}
+
+MyApplication::~MyApplication() {
+  update_running = false;
+  if (update_thread.joinable())
+    update_thread.join();
+  if (global_minimizer)
+    global_minimizer->cancel();
+  // the running mesh job uses the tile cache
+  mesh_worker = nullptr;
+  critical_worker = nullptr;
+  surrogate_worker = nullptr;
+  if (region_integrator)
+    region_integrator->cancel();
+  region_worker = nullptr;
+
+  if (replay) {
+    if (replay->divergences())
+      std::cout << "[Info] Replay diverged from the recording in " << replay->divergences() << " optimizer events" << std::endl;
+    else
+      std::cout << "[Info] Replay matched the recording" << std::endl;
   }
-  if(FT_New_Face(ft, SHADER_DIR "/liberation-sans.ttf", 0, &face)) {
-    fprintf(stderr, "Could not open font\n");
+  if (profiler) {
+    profiler->print();
+    try {
+      if (!profile_path.empty())
+        profiler->writeJson(profile_path);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+    }
+  }
+}
+
+void MyApplication::recordSession(const std::string& path) {
+  recorder = std::make_unique<InputRecorder>(path, update_period);
+}
+
+void MyApplication::replaySession(const std::string& path, bool as_fast_as_possible) {
+  replay = std::make_unique<InputReplay>(path);
+  if (replay->updatePeriod() != update_period)
+    std::cout << "[Info] The session was recorded with another update rate, the replay will differ" << std::endl;
+  replay_fast = as_fast_as_possible;
+  if (!profiler)
+    profiler = std::make_unique<Profiler>();
+}
+
+void MyApplication::profile(const std::string& path) {
+  profiler = std::make_unique<Profiler>();
+  profile_path = path;
+}
+
+void MyApplication::optimizerEvent(OptimizerEvent event, glm::vec2 point) {
+  if (recorder)
+    recorder->event(update_count, event, point);
+  if (replay)
+    replay->check(update_count, event, point);
+}
+
+void MyApplication::watchPlugin(std::shared_ptr<Plugin> plugin) {
+  this->plugin = plugin;
+}
+
+void MyApplication::setIntervalFunction(interval_func_t function, std::optional<interval_grad_t> gradient) {
+  interval_function = function;
+  interval_gradient = gradient;
+}
+
+void MyApplication::animate(TimedFunction function, Animation animation) {
+  this->animation = animation;
+  this->animation.t = animation.begin;
+  timed_function = function;
+  // the update thread alone reads animation.t
+  this->function = [this](glm::vec2 p) { return timed_function->value(p, this->animation.t); };
+  gradient.reset();
+  if (function.gradient)
+    gradient = [this](glm::vec2 p) { return (*timed_function->gradient)(p, this->animation.t); };
+  hessian.reset();
+  if (function.hessian)
+    hessian = [this](glm::vec2 p) { return (*timed_function->hessian)(p, this->animation.t); };
+  batch.reset();
+  surface_stream = std::make_unique<SurfaceStream>(function, *graph_pool);
+  last_refresh_time = -1.0;
+}
+
+void MyApplication::advanceAnimation(const InputState& input) {
+  if (!timed_function)
     return;
+  float t = animation.t;
+  if (animation.playing)
+    animation.advance(update_period);
+  // comma and period scrub through t at the speed of the playback
+  if (input.key(GLFW_KEY_COMMA))
+    animation.advance(-update_period);
+  if (input.key(GLFW_KEY_PERIOD))
+    animation.advance(update_period);
+  if (tracking && optimizer && animation.t != t)
+    stepOptimizer();
+}
+
+void MyApplication::viewSlices(NdFunction function) {
+  slice_view = std::make_unique<SliceView>(function);
+  // the update thread alone reads slice
+  this->function = [this](glm::vec2 p) { return slice_view->value(*slice, p, slice_scratch); };
+  gradient.reset();
+  hessian.reset();
+  batch.reset();
+  std::vector<double> origin(function.dimension, 0.0);
+  setSlice(origin.data());
+}
+
+void MyApplication::useSurrogate(std::shared_ptr<Surrogate> surrogate) {
+  this->surrogate = surrogate;
+  surrogate_pool = std::make_unique<ThreadPool>();
+  surrogate_worker = std::make_unique<BackgroundWorker<SurrogateJob>>([this](SurrogateJob& job) { fitSurrogate(job); });
+  surrogate_text.clear();
+  surrogate_text << "Surrogate: no true values yet";
+  last_refresh_time = -1.0;
+}
+
+void MyApplication::fitSurrogate(SurrogateJob& job) {
+  Profiler::Scope scope(profiler.get(), "surrogate");
+  job.deviation = job.model->mostUncertain(job.lower, job.upper, job.count, job.seed, job.points);
+  // one point per task, a true value may take long
+  job.values.resize(job.points.size());
+  surrogate_pool->parallelFor(0, job.points.size(), [&](size_t i) {
+    surrogate->evaluate(&job.points[i], &job.values[i], 1);
+  });
+  std::vector<SurrogateModel::Sample> samples;
+  for (size_t i = 0; i < job.points.size(); ++i)
+    if (std::isfinite(job.values[i]))
+      samples.push_back({job.points[i], job.values[i]});
+  job.model = job.model->refit(samples.data(), samples.size());
+}
+
+void MyApplication::verifyFrom(std::optional<glm::vec2> start) {
+  ++optimizer_run;
+  verified_point.reset();
+  check_points.clear();
+  check_predicted.clear();
+  if (surrogate && start) {
+    check_points.push_back(*start);
+    check_predicted.push_back(function(*start));
   }
-  FT_Set_Pixel_Sizes(face, 0, 16);
+}
 
-  createGraph();
+void MyApplication::updateSurrogate() {
+  if (!surrogate)
+    return;
+  // the region covered by the graph
+  float diff = std::max(1.0f, glm::round(getCameraDistance())) * 0.004f;
+  glm::vec2 lower = glm::vec2(point_position) - float(size / 2) * diff;
+  glm::vec2 upper = glm::vec2(point_position) + float(size / 2) * diff;
+
+  if (surrogate_worker->finish(surrogate_job)) {
+    surrogate->setModel(surrogate_job.model);
+    const SurrogateModel& model = *surrogate_job.model;
+    if (surrogate_job.deviation <= surrogate_tolerance * model.priorDeviation()) {
+      settled_lower = surrogate_job.lower;
+      settled_upper = surrogate_job.upper;
+    }
+    surrogate_text.clear();
+    surrogate_text << "Surrogate: " << model.sampleCount() << " true values, deviation up to "
+                   << surrogate_job.deviation << (settled_lower != settled_upper ? ", settled" : "");
+    // the iterates in the order they were taken, until one went uphill
+    for (size_t i = 0; i < surrogate_job.predicted.size() && surrogate_job.run == optimizer_run && optimizer; ++i) {
+      glm::vec2 point = surrogate_job.points[i];
+      float value = surrogate_job.values[i];
+      surrogate_text << "; step f: " << value << " (model " << surrogate_job.predicted[i] << ")";
+      if (!verified_point || value <= verified_point->z) {
+        verified_point = glm::vec3(point, value);
+        continue;
+      }
+      // the steps after it started from a rejected iterate, the refitted
+      // model knows better
+      surrogate_text << ", rejected";
+      glm::vec2 back = glm::vec2(*verified_point);
+      optimizer->reset(back);
+      optimizerEvent(OptimizerEvent::StepFailed, back);
+      check_points.clear();
+      check_predicted.clear();
+      if (points.size() == max_trajectory_points)
+        points.erase(points.begin());
+      points.push_back(glm::vec3(back, function(back)));
+      break;
+    }
+    // the graph shows the new model
+    last_refresh_time = -1.0;
+  }
 
-  camera_position = glm::vec3(15.0, 15.0, 15.0);
+  bool settled = settled_lower != settled_upper && lower.x >= settled_lower.x && lower.y >= settled_lower.y &&
+                 upper.x <= settled_upper.x && upper.y <= settled_upper.y;
+  if (surrogate_worker->idle() && (!settled || !check_points.empty())) {
+    SurrogateJob& job = surrogate_job;
+    job.model = surrogate->model();
+    job.lower = lower;
+    job.upper = upper;
+    job.count = settled ? 0 : 2 * surrogate_pool->size();
+    job.seed = ++surrogate_seed;
+    job.points.assign(check_points.begin(), check_points.end());
+    job.predicted.assign(check_predicted.begin(), check_predicted.end());
+    job.run = optimizer_run;
+    check_points.clear();
+    check_predicted.clear();
+    if (!settled)
+      settled_lower = settled_upper = glm::vec2(0.0f);
+    surrogate_worker->start(std::move(job));
+  }
+}
+
+void MyApplication::setSlice(const double* origin) {
+  slice = slice_view->plane(origin);
+  // the origin is the center of the graph, the camera keeps its offset
+  glm::vec3 offset = camera_position - point_position;
+  point_position = glm::vec3(0.0f, 0.0f, function(glm::vec2(0.0f)));
+  camera_position = point_position + offset;
   view = glm::lookAt(camera_position, point_position, glm::vec3(0, 0, 1));
+
+  // the trajectory projected onto the slice
+  points.clear();
+  for (auto &x : nd_points) {
+    glm::vec2 p = slice->project(x.data());
+    points.push_back(glm::vec3(p, function(p)));
+  }
+  slice_text.clear();
+  slice_text << "Slice: " << slice_view->describe();
+  picked_point.reset();
+  last_refresh_time = -1.0;
+}
+
+void MyApplication::changeSlice(const InputState& input) {
+  // the slice moves to the point at the center of the graph
+  std::vector<double> origin(slice_view->dimension());
+  slice->point(glm::vec2(point_position), origin.data());
+  if (input.key(GLFW_KEY_D)) {
+    switch (slice_view->getDirections()) {
+      case SliceView::Directions::Axes:
+        slice_view->setDirections(SliceView::Directions::Random);
+        break;
+      case SliceView::Directions::Random:
+        slice_view->setDirections(SliceView::Directions::Principal);
+        break;
+      case SliceView::Directions::Principal:
+        slice_view->setDirections(SliceView::Directions::Axes);
+        break;
+    }
+  }
+  else {
+    slice_view->setDirections(SliceView::Directions::Axes);
+    slice_view->nextAxis(input.key(GLFW_KEY_Y));
+  }
+  setSlice(origin.data());
+}
+
+void MyApplication::startNdOptimizer(std::shared_ptr<NdOptimizer> optimizer, OptimizerEvent event) {
+  // from the selected point of the slice
+  std::vector<double> start(slice_view->dimension());
+  slice->point(selectedPoint(), start.data());
+  nd_optimizer = optimizer;
+  optimizer_name = optimizer->toString();
+  nd_optimizer->reset(start.data());
+  optimizerEvent(event, glm::vec2(start[0], start[1]));
+  nd_value = slice_view->getFunction().value(start.data());
+  nd_points.clear();
+  nd_points.push_back(std::move(start));
+  setSlice(nd_points.back().data());
+}
+
+void MyApplication::stepNdOptimizer() {
+  const std::vector<double>& x = nd_optimizer->step();
+  if (!std::all_of(x.begin(), x.end(), [](double v) { return std::isfinite(v); })) {
+    std::cout << "Iteration failed" << std::endl;
+    optimizerEvent(OptimizerEvent::StepFailed, glm::vec2(point_position));
+    return;
+  }
+  optimizerEvent(OptimizerEvent::Step, glm::vec2(x[0], x[1]));
+  nd_value = slice_view->getFunction().value(x.data());
+  if (nd_points.size() == max_trajectory_points)
+    nd_points.erase(nd_points.begin());
+  nd_points.push_back(x);
+  // the slice follows the iterate
+  setSlice(x.data());
+}
+
+void MyApplication::startGlobalSearch() {
+  if (!interval_function) {
+    std::cout << "Interval extension of the function is not defined" << std::endl;
+    return;
+  }
+  // search the region covered by the graph
+  float diff = std::max(1.0f, glm::round(getCameraDistance())) * 0.004f;
+  float half = size / 2 * diff;
+  GlobalSearchSettings settings;
+  settings.domain = {Interval(point_position.x - half, point_position.x + half),
+                     Interval(point_position.y - half, point_position.y + half)};
+  settings.tolerance = diff;
+  global_minimizer = std::make_shared<GlobalMinimizer>(interval_function.value(), interval_gradient, settings);
+  global_result.reset();
+  search_boxes = nullptr;
+  global_search_start_time = update_time;
+
+  global_search = std::async(std::launch::async, [minimizer = global_minimizer, function = function]() {
+    GlobalSearchResult result = minimizer->run();
+    // outline every recorded box on the graph
+    std::vector<VertexType> lines;
+    for (auto &visited : result.visited) {
+      glm::vec4 color =
+        visited.status == GlobalSearchResult::Status::Candidate ? glm::vec4(0.2, 1.0, 0.2, 1.0) :
+        visited.status == GlobalSearchResult::Status::Pruned ? glm::vec4(1.0, 0.2, 0.2, 1.0) :
+                                                               glm::vec4(0.3, 0.3, 1.0, 1.0);
+      const SearchBox& b = visited.box;
+      float x0 = b.x.lo, x1 = b.x.hi, y0 = b.y.lo, y1 = b.y.hi;
+      float z = function(glm::vec2(b.x.mid(), b.y.mid()));
+      glm::vec3 corners[] = {{x0, y0, z}, {x1, y0, z}, {x1, y1, z}, {x0, y1, z}};
+      for (int i = 0; i < 4; ++i) {
+        lines.push_back({corners[i], glm::vec3(0, 0, 1), color});
+        lines.push_back({corners[(i + 1) % 4], glm::vec3(0, 0, 1), color});
+      }
+    }
+    return std::make_pair(std::move(result), std::move(lines));
+  });
+}
+
+void MyApplication::toggleCriticalPoints() {
+  if (critical_finder) {
+    critical_finder = nullptr;
+    critical_markers = nullptr;
+    critical_cache.clear();
+    return;
+  }
+  if (timed_function || surrogate) {
+    std::cout << "Critical points of timed functions and surrogates are not searched" << std::endl;
+    return;
+  }
+  if (!gradient) {
+    std::cout << "Gradient is not defined" << std::endl;
+    return;
+  }
+  if (!critical_worker)
+    critical_worker = std::make_unique<BackgroundWorker<CriticalJob>>(
+      [](CriticalJob& job) { job.finder->find(job.regions, job.points); });
+  resetCriticalPoints();
+}
+
+void MyApplication::resetCriticalPoints() {
+  // a running job of the previous finder is dropped when it finishes
+  critical_finder =
+    std::make_shared<CriticalPointFinder>(function, gradient.value(), hessian, interval_gradient, *graph_pool);
+  critical_cache.clear();
+  shown_regions.clear();
+  ++critical_version;
+}
+
+void MyApplication::updateCriticalPoints() {
+  // collect finished jobs even when stopped, so that the worker becomes idle
+  if (critical_worker && critical_worker->finish(critical_job) && critical_job.finder == critical_finder) {
+    if (critical_cache.size() > max_cached_regions)
+      critical_cache.clear();
+    for (size_t i = 0; i < critical_job.regions.size(); ++i)
+      critical_cache[critical_job.regions[i]] = critical_job.points[i];
+    ++critical_version;
+  }
+  if (!critical_finder)
+    return;
+
+  // the regions under the graph at its zoom level, the missing ones are
+  // searched a batch at a time
+  int level = std::max(1.0f, glm::round(getCameraDistance()));
+  float half = size / 2 * level * 0.004f;
+  visible_regions.clear();
+  CriticalPointFinder::regionsOver(level, glm::vec2(point_position) - half, glm::vec2(point_position) + half,
+                                   visible_regions);
+  size_t missing = std::count_if(visible_regions.begin(), visible_regions.end(),
+                                 [&](const CriticalRegion& region) { return !critical_cache.count(region); });
+  if (missing && critical_worker->idle()) {
+    critical_job.finder = critical_finder;
+    critical_job.regions.clear();
+    for (auto &region : visible_regions)
+      if (!critical_cache.count(region) && critical_job.regions.size() < max_critical_regions)
+        critical_job.regions.push_back(region);
+    critical_worker->start(std::move(critical_job));
+  }
+
+  if (visible_regions == shown_regions && critical_version == shown_version)
+    return;
+  shown_regions = visible_regions;
+  shown_version = critical_version;
+  // a cross at every point: green minima, red maxima, yellow saddles
+  auto markers = std::make_shared<std::vector<VertexType>>();
+  int counts[4] = {0, 0, 0, 0};
+  float arm = level * 0.03f;
+  for (auto &region : visible_regions) {
+    auto it = critical_cache.find(region);
+    if (it == critical_cache.end())
+      continue;
+    for (auto &point : it->second) {
+      glm::vec4 color =
+        point.kind == CriticalPoint::Kind::Minimum ? glm::vec4(0.2, 1.0, 0.2, 1.0) :
+        point.kind == CriticalPoint::Kind::Maximum ? glm::vec4(1.0, 0.2, 0.2, 1.0) :
+        point.kind == CriticalPoint::Kind::Saddle ? glm::vec4(1.0, 1.0, 0.2, 1.0) :
+                                                    glm::vec4(0.6, 0.6, 0.6, 1.0);
+      glm::vec3 center(point.position, point.value);
+      for (int axis = 0; axis < 3; ++axis) {
+        glm::vec3 offset(0.0f);
+        offset[axis] = arm;
+        markers->push_back({center - offset, glm::vec3(0, 0, 1), color});
+        markers->push_back({center + offset, glm::vec3(0, 0, 1), color});
+      }
+      ++counts[int(point.kind)];
+    }
+  }
+  critical_markers = markers;
+  critical_text.clear();
+  critical_text << "Critical points: " << counts[0] << " minima, " << counts[1] << " maxima, " << counts[2]
+                << " saddles";
+  if (counts[3])
+    critical_text << ", " << counts[3] << " degenerate";
+  if (missing)
+    critical_text << ", " << missing << " regions searching";
 }
 
 glm::vec3 MyApplication::getCameraDirection() {
@@ -209,30 +1147,30 @@ float MyApplication::getCameraDistance() {
   return glm::length(getCameraDirection());
 }
 
-void MyApplication::moveView() {
-  // get arrow keys state
-  int left = glfwGetKey(getWindow(), GLFW_KEY_LEFT);
-  int right = glfwGetKey(getWindow(), GLFW_KEY_RIGHT);
-  int forward = glfwGetKey(getWindow(), GLFW_KEY_UP);
-  int backward = glfwGetKey(getWindow(), GLFW_KEY_DOWN);
-  int up = glfwGetKey(getWindow(), GLFW_KEY_PAGE_UP);
-  int down = glfwGetKey(getWindow(), GLFW_KEY_PAGE_DOWN);
+void MyApplication::lookAt(glm::vec3 point, float distance) {
+  camera_position = point + distance * glm::normalize(getCameraDirection());
+  point_position = point;
+  view = glm::lookAt(camera_position, point_position, glm::vec3(0, 0, 1));
+  last_refresh_time = -1.0;
+}
 
-  float speed = glm::round(getCameraDistance()) * 0.002f;
+void MyApplication::moveView(const InputState& input) {
+  // the original speed was per frame at 60 frames per second
+  float speed = glm::round(getCameraDistance()) * 0.002f * float(update_period * 60.0);
 
   // compute new view matrix
   glm::vec3 translation(0, 0, 0);
-  if (left == GLFW_PRESS)
+  if (input.key(GLFW_KEY_LEFT))
     translation.x += speed;
-  if (right == GLFW_PRESS)
+  if (input.key(GLFW_KEY_RIGHT))
     translation.x -= speed;
-  if (forward == GLFW_PRESS)
+  if (input.key(GLFW_KEY_UP))
     translation.y += speed;
-  if (backward == GLFW_PRESS)
+  if (input.key(GLFW_KEY_DOWN))
     translation.y -= speed;
-  if (up == GLFW_PRESS)
+  if (input.key(GLFW_KEY_PAGE_UP))
     translation.z -= speed;
-  if (down == GLFW_PRESS)
+  if (input.key(GLFW_KEY_PAGE_DOWN))
     translation.z += speed;
 
   glm::vec3 camera_direction = glm::normalize(getCameraDirection());
@@ -251,11 +1189,10 @@ void MyApplication::moveView() {
   view = glm::translate(view, translation);
 }
 
-void MyApplication::rotateView() {
-  if (glfwGetMouseButton(getWindow(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+void MyApplication::rotateView(const InputState& input) {
+  if (input.mouse_left) {
     // get mouse position
-    double x_mouse_pos_current, y_mouse_pos_current;
-    glfwGetCursorPos(getWindow(), &x_mouse_pos_current, &y_mouse_pos_current);
+    double x_mouse_pos_current = input.cursor_x, y_mouse_pos_current = input.cursor_y;
 
     // update mouse state
     if (!mouse_pressed) {
@@ -264,8 +1201,8 @@ void MyApplication::rotateView() {
       y_mouse_pos = y_mouse_pos_current;
     }
 
-    float delta_xi = (x_mouse_pos_current - x_mouse_pos) / getWidth();
-    float delta_eta = (y_mouse_pos_current - y_mouse_pos) / getHeight();
+    float delta_xi = (x_mouse_pos_current - x_mouse_pos) / input.width;
+    float delta_eta = (y_mouse_pos_current - y_mouse_pos) / input.height;
     x_mouse_pos = x_mouse_pos_current;
     y_mouse_pos = y_mouse_pos_current;
     if (abs(delta_xi) < 0.001) {
@@ -302,11 +1239,10 @@ void MyApplication::rotateView() {
   }
 }
 
-void MyApplication::zoomView() {
-  if (glfwGetMouseButton(getWindow(), GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+void MyApplication::zoomView(const InputState& input) {
+  if (input.mouse_right) {
     // get mouse position
-    double x_mouse_pos_current, y_mouse_pos_current;
-    glfwGetCursorPos(getWindow(), &x_mouse_pos_current, &y_mouse_pos_current);
+    double y_mouse_pos_current = input.cursor_y;
 
     // update mouse state
 
@@ -315,7 +1251,7 @@ void MyApplication::zoomView() {
       y_mouse_pos_right = y_mouse_pos_current;
     }
 
-    float delta_eta = (y_mouse_pos_current - y_mouse_pos_right) / getHeight();
+    float delta_eta = (y_mouse_pos_current - y_mouse_pos_right) / input.height;
     y_mouse_pos_right = y_mouse_pos_current;
     if (abs(delta_eta) < 0.001) {
       delta_eta = 0;
@@ -332,147 +1268,861 @@ void MyApplication::zoomView() {
   }
 }
 
-void MyApplication::renderText(std::string text, float x, float y, float sx, float sy) {
-  const char *p;
-  FT_GlyphSlot &g = face->glyph;
+void MyApplication::toggleRegionStatistics() {
+  if (region_integrator || region_statistics) {
+    // a running job is dropped when it finishes
+    if (region_integrator)
+      region_integrator->cancel();
+    region_integrator = nullptr;
+    region_statistics.reset();
+    return;
+  }
+  if (timed_function || slice_view) {
+    std::cout << "Region statistics of timed and N-D functions are not computed" << std::endl;
+    return;
+  }
+  RegionIntegrator::Settings settings;
+  if (picked_point && previous_picked_point) {
+    settings.lower = glm::min(glm::vec2(*picked_point), glm::vec2(*previous_picked_point));
+    settings.upper = glm::max(glm::vec2(*picked_point), glm::vec2(*previous_picked_point));
+    if (settings.lower.x == settings.upper.x || settings.lower.y == settings.upper.y) {
+      std::cout << "The box between the picked points is empty" << std::endl;
+      return;
+    }
+  }
+  else {
+    float half = size / 2 * std::max(1.0f, glm::round(getCameraDistance())) * 0.004f;
+    settings.lower = glm::vec2(point_position) - half;
+    settings.upper = glm::vec2(point_position) + half;
+  }
+  settings.threshold = function(selectedPoint());
+
+  // a surrogate is integrated as shown, the model it has now
+  func_t region_function = function;
+  std::optional<batch_t> region_batch = batch;
+  if (surrogate) {
+    region_function = [model = surrogate->model()](glm::vec2 p) { return model->value(p); };
+    region_batch.reset();
+  }
+  // the heights of the graph are true values once it is refined, unless
+  // reconstructed from Hermite patches
+  std::shared_ptr<SampleLattice> lattice;
+  if (height_pyramid && !height_pyramid->empty() && !pending_samples && !surrogate && !hermite) {
+    lattice = std::make_shared<SampleLattice>();
+    lattice->origin = height_pyramid->sampleOrigin();
+    lattice->spacing = height_pyramid->sampleSpacing();
+    lattice->samples = height_pyramid->sampleCount();
+    lattice->heights = height_pyramid->samples();
+  }
+  region_integrator =
+    std::make_shared<RegionIntegrator>(region_function, region_batch, *graph_pool, settings, std::move(lattice));
+  if (!region_worker)
+    region_worker = std::make_unique<BackgroundWorker<RegionJob>>([](RegionJob& job) {
+      job.done = job.integrator->refine(region_budget);
+      job.statistics = job.integrator->statistics();
+    });
+}
 
-  GLuint tex;
-	glActiveTexture(GL_TEXTURE0);
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-  shaderProgramText.setUniform("tex", 0);
+void MyApplication::updateRegionStatistics() {
+  // collect finished jobs even when stopped, so that the worker becomes idle
+  if (region_worker && region_worker->finish(region_job) && region_job.integrator == region_integrator &&
+      region_integrator) {
+    region_statistics = region_job.statistics;
+    if (region_job.done)
+      region_integrator = nullptr;
+  }
+  if (region_integrator && region_worker->idle()) {
+    region_job.integrator = region_integrator;
+    region_worker->start(std::move(region_job));
+  }
+}
 
-  /* We require 1 byte alignment when uploading texture data */
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+void MyApplication::pick(const InputState& input) {
+  hover_point.reset();
+  int width = viewWidth(input);
+  if (height_pyramid && !height_pyramid->empty() && width > 0 && input.height > 0 && input.cursor_x < width) {
+    // the cursor on the near and far planes, back in world coordinates
+    glm::vec2 ndc(2.0 * input.cursor_x / width - 1.0, 1.0 - 2.0 * input.cursor_y / input.height);
+    glm::mat4 inverse = glm::inverse(projection * view);
+    glm::vec4 near_point = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 far_point = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+    hover_point = height_pyramid->intersect(origin, glm::vec3(far_point) / far_point.w - origin);
+  }
 
-	/* Clamping to edges is important to prevent artifacts when scaling */
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  // a click picks, a drag rotates
+  if (input.mouse_left && !pick_pressed) {
+    press_x = input.cursor_x;
+    press_y = input.cursor_y;
+  }
+  std::optional<glm::vec3> picked;
+  if (!input.mouse_left && pick_pressed &&
+      std::abs(input.cursor_x - press_x) + std::abs(input.cursor_y - press_y) < 4.0)
+    picked = hover_point;
+  pick_pressed = input.mouse_left;
+  // the hover point depends on the mesh job that finished last, a replay
+  // takes the recorded pick so that the optimizers start where they did
+  if (replay && replay->hasPicks())
+    picked = replay->picked(update_count);
+  if (!picked)
+    return;
+  previous_picked_point = picked_point;
+  picked_point = picked;
+  if (recorder)
+    recorder->pick(update_count, *picked);
+}
+
+glm::vec2 MyApplication::selectedPoint() const {
+  return picked_point ? glm::vec2(*picked_point) : glm::vec2(point_position);
+}
+
+void MyApplication::loadFont() {
+  try {
+    font = FontAtlas::load(FONT_ATLAS);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << ", no text is drawn" << std::endl;
+    return;
+  }
+  glGenTextures(1, &font_texture);
+  glBindTexture(GL_TEXTURE_2D, font_texture);
+  // rows of the glyph bitmaps are not aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, font.width, font.height, 0, GL_RED, GL_UNSIGNED_BYTE, font.pixels.data());
+  // clamping to edges prevents artifacts when scaling, linear filtering looks
+  // best for text
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-	/* Linear filtering usually looks best for text */
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void MyApplication::renderText(const char* text, float x, float y, float sx, float sy) {
+  if (!font_texture)
+    return;
+  // the quads of all characters in one draw, staged in the frame arena
+  GLfloat* vertices = frame_arena.allocate<GLfloat>(24 * strlen(text));
+  size_t count = font.layout(text, x, y, sx, sy, vertices);
 
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, font_texture);
+  shaderProgramText.setUniform("tex", 0);
   shaderProgramText.setAttribute("coord", 4, 4 * sizeof(GLfloat), 0);
 
-    // Enable alpha blending
   glEnable(GL_BLEND);
-
-  // Set the blend function
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  for(p = text.c_str(); *p; p++) {
-    if(FT_Load_Char(face, *p, FT_LOAD_RENDER))
-        continue;
- 
-    glTexImage2D(
-      GL_TEXTURE_2D,
-      0,
-      GL_RED,
-      g->bitmap.width,
-      g->bitmap.rows,
-      0,
-      GL_RED,
-      GL_UNSIGNED_BYTE,
-      g->bitmap.buffer
-    );
- 
-    float x2 = x + g->bitmap_left * sx;
-    float y2 = -y - g->bitmap_top * sy;
-    float w = g->bitmap.width * sx;
-    float h = g->bitmap.rows * sy;
- 
-    GLfloat box[4][4] = {
-        {x2,     -y2    , 0, 0},
-        {x2 + w, -y2    , 1, 0},
-        {x2,     -y2 - h, 0, 1},
-        {x2 + w, -y2 - h, 1, 1},
-    };
- 
-    glBufferData(GL_ARRAY_BUFFER, sizeof box, box, GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
- 
-    x += (g->advance.x/64) * sx;
-    y += (g->advance.y/64) * sy;
-  }
-
+  glBufferData(GL_ARRAY_BUFFER, count * 4 * sizeof(GLfloat), vertices, GL_STREAM_DRAW);
+  glDrawArrays(GL_TRIANGLES, 0, count);
   glDisable(GL_BLEND);
-	glDeleteTextures(1, &tex);
 }
 
-void MyApplication::changeOptimizer() {
-  if (glfwGetKey(getWindow(), GLFW_KEY_1) == GLFW_PRESS) {
+void MyApplication::changeOptimizer(const InputState& input) {
+  if (input.key(GLFW_KEY_1)) {
     if (button_pressed)
       return;
     button_pressed = true;
     optimizer = nullptr;
+    nd_optimizer = nullptr;
+    population_optimizer = nullptr;
+    population_markers = nullptr;
+    nd_points.clear();
     points.clear();
+    picked_point.reset();
+    previous_picked_point.reset();
+    optimizerEvent(OptimizerEvent::Cleared, point_position);
+    verifyFrom(std::nullopt);
   }
-  else if (glfwGetKey(getWindow(), GLFW_KEY_2) == GLFW_PRESS) {
+  else if (input.key(GLFW_KEY_2)) {
     if (button_pressed)
       return;
     button_pressed = true;
+    if (slice_view) {
+      if (!slice_view->getFunction().gradient) {
+        std::cout << "Gradient is not defined" << std::endl;
+        return;
+      }
+      startNdOptimizer(std::make_shared<NdNewtonCG>(slice_view->getFunction()), OptimizerEvent::Newton);
+      return;
+    }
     if (!gradient || !hessian) {
       std::cout << "Gradient or Hessian are not defined" << std::endl;
       return;
     }
+    glm::vec2 start = selectedPoint();
     optimizer = std::make_shared<Newton>(function, gradient.value(), hessian.value());
-    optimizer->reset(point_position);
+    optimizer_name = optimizer->toString();
+    optimizer->reset(start);
+    optimizerEvent(OptimizerEvent::Newton, start);
     points.clear();
-    points.push_back(glm::vec3(point_position.x, point_position.y, function(glm::vec2(point_position.x, point_position.y))));
+    points.push_back(glm::vec3(start, function(start)));
+    verifyFrom(start);
   }
-  else if (glfwGetKey(getWindow(), GLFW_KEY_3) == GLFW_PRESS) {
+  else if (input.key(GLFW_KEY_3)) {
     if (button_pressed)
       return;
     button_pressed = true;
+    if (slice_view) {
+      if (!slice_view->getFunction().gradient) {
+        std::cout << "Gradient is not defined" << std::endl;
+        return;
+      }
+      startNdOptimizer(std::make_shared<NdGradientDescent>(slice_view->getFunction(), 0.1), OptimizerEvent::GradientDescent);
+      return;
+    }
     if (!gradient) {
       std::cout << "Gradient is not defined" << std::endl;
       return;
     }
+    glm::vec2 start = selectedPoint();
     optimizer = std::make_shared<GradientDescent>(function, gradient.value(), 0.1f);
-    optimizer->reset(point_position);
+    optimizer_name = optimizer->toString();
+    optimizer->reset(start);
+    optimizerEvent(OptimizerEvent::GradientDescent, start);
     points.clear();
-    points.push_back(glm::vec3(point_position.x, point_position.y, function(glm::vec2(point_position.x, point_position.y))));
+    points.push_back(glm::vec3(start, function(start)));
+    verifyFrom(start);
   }
-  else if (glfwGetKey(getWindow(), GLFW_KEY_SPACE) == GLFW_PRESS) {
+  else if (input.key(GLFW_KEY_4) || input.key(GLFW_KEY_5)) {
     if (button_pressed)
       return;
     button_pressed = true;
-    if (optimizer) {
-      glm::vec2 new_point = optimizer->step();
-      if (new_point.x != new_point.x || new_point.y != new_point.y) {
-        std::cout << "Iteration failed" << std::endl;
-        return;
-      }
-      glm::vec3 new_point_position = glm::vec3(new_point, function(new_point));
-      camera_position = new_point_position + getCameraDirection();
-      point_position = new_point_position;
-      view = glm::lookAt(camera_position, point_position, glm::vec3(0, 0, 1));
-      points.push_back(new_point_position);
+    if (slice_view) {
+      std::cout << "CMA-ES and differential evolution are 2D only" << std::endl;
+      return;
+    }
+    // the first population spreads over the region covered by the graph
+    float half = size / 2 * std::max(1.0f, glm::round(getCameraDistance())) * 0.004f;
+    PopulationSettings settings;
+    settings.seed = population_seed++;
+    if (input.key(GLFW_KEY_4)) {
+      settings.spread = half / 3;
+      startPopulation(std::make_shared<CmaEs>(function, batch, graph_pool.get(), settings), OptimizerEvent::CmaEs);
+    }
+    else {
+      settings.spread = half;
+      startPopulation(std::make_shared<DifferentialEvolution>(function, batch, graph_pool.get(), settings),
+                      OptimizerEvent::DifferentialEvolution);
+    }
+  }
+  else if (input.key(GLFW_KEY_G)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    if (global_search.valid())
+      global_minimizer->cancel();
+    else
+      startGlobalSearch();
+  }
+  else if (input.key(GLFW_KEY_C)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    toggleCriticalPoints();
+  }
+  else if (input.key(GLFW_KEY_I)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    toggleRegionStatistics();
+  }
+  else if (input.key(GLFW_KEY_V)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    if (!instancing) {
+      std::cout << "[Info] The gradient overlay needs instanced arrays (OpenGL 3.3)" << std::endl;
+      return;
+    }
+    quiver = !quiver;
+    last_refresh_time = -1.0;
+  }
+  else if (input.key(GLFW_KEY_H)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    // the next mesh brings its heights along
+    heat_map = !heat_map;
+    last_refresh_time = -1.0;
+  }
+  else if (input.key(GLFW_KEY_N)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    normal_mapping = !normal_mapping;
+    if (timed_function || surrogate)
+      std::cout << "[Info] The normal map is off for timed functions and surrogates" << std::endl;
+    last_refresh_time = -1.0;
+  }
+  else if (input.key(GLFW_KEY_R)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    if (!hermite_grid || tile_pager || timed_function || slice_view || surrogate) {
+      std::cout << "[Info] Hermite patches need the gradient and no tile cache, animation, slices or surrogate"
+                << std::endl;
+      return;
     }
+    hermite = !hermite;
+    last_refresh_time = -1.0;
+  }
+  else if (input.key(GLFW_KEY_L)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    // cycle through the index layouts of the graph
+    switch (surface_layout->getMode()) {
+      case SurfaceLayout::Mode::Triangles:
+        setSurfaceLayout(SurfaceLayout::Mode::OptimizedTriangles);
+        break;
+      case SurfaceLayout::Mode::OptimizedTriangles:
+        setSurfaceLayout(SurfaceLayout::Mode::Strips);
+        break;
+      case SurfaceLayout::Mode::Strips:
+        setSurfaceLayout(SurfaceLayout::Mode::Triangles);
+        break;
+    }
+    last_refresh_time = -1.0;
+  }
+  else if (input.key(GLFW_KEY_SPACE)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    if (nd_optimizer)
+      stepNdOptimizer();
+    else if (population_optimizer)
+      evolving = !evolving;
+    else if (optimizer)
+      stepOptimizer();
+  }
+  else if (slice_view && (input.key(GLFW_KEY_D) || input.key(GLFW_KEY_X) || input.key(GLFW_KEY_Y))) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    changeSlice(input);
+  }
+  else if (timed_function && input.key(GLFW_KEY_P)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    animation.playing = !animation.playing;
+  }
+  else if (timed_function && input.key(GLFW_KEY_T)) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    tracking = !tracking;
+  }
+  else if (timed_function && (input.key(GLFW_KEY_MINUS) || input.key(GLFW_KEY_EQUAL))) {
+    if (button_pressed)
+      return;
+    button_pressed = true;
+    animation.speed *= input.key(GLFW_KEY_MINUS) ? 0.5f : 2.0f;
   }
   else {
     button_pressed = false;
   }
 }
 
+void MyApplication::stepOptimizer() {
+  glm::vec2 new_point = optimizer->step();
+  if (new_point.x != new_point.x || new_point.y != new_point.y) {
+    std::cout << "Iteration failed" << std::endl;
+    optimizerEvent(OptimizerEvent::StepFailed, point_position);
+    return;
+  }
+  optimizerEvent(OptimizerEvent::Step, new_point);
+  // a population optimizer has evaluated its best point already
+  float value = population_optimizer ? population_optimizer->bestValue() : function(new_point);
+  glm::vec3 new_point_position = glm::vec3(new_point, value);
+  camera_position = new_point_position + getCameraDirection();
+  point_position = new_point_position;
+  view = glm::lookAt(camera_position, point_position, glm::vec3(0, 0, 1));
+  // a tracking optimizer steps at the update rate, keep the recent part
+  if (points.size() == max_trajectory_points)
+    points.erase(points.begin());
+  points.push_back(new_point_position);
+  if (surrogate) {
+    check_points.push_back(new_point);
+    check_predicted.push_back(new_point_position.z);
+  }
+}
+
+void MyApplication::startPopulation(std::shared_ptr<PopulationOptimizer> optimizer, OptimizerEvent event) {
+  glm::vec2 start = selectedPoint();
+  this->optimizer = optimizer;
+  population_optimizer = optimizer;
+  optimizer_name = optimizer->toString();
+  optimizer->reset(start);
+  optimizerEvent(event, start);
+  points.clear();
+  points.push_back(glm::vec3(start, function(start)));
+  population_markers = nullptr;
+  evolving = true;
+  verifyFrom(start);
+  if (!instancing)
+    std::cout << "[Info] The population is not drawn without instanced arrays (OpenGL 3.3)" << std::endl;
+}
+
+void MyApplication::evolvePopulation() {
+  // another optimizer took over, e.g. after the plugin was reloaded
+  if (population_optimizer && population_optimizer != optimizer) {
+    population_optimizer = nullptr;
+    population_markers = nullptr;
+  }
+  if (!population_optimizer || !evolving)
+    return;
+  stepOptimizer();
+
+  // the members ranked by value, those without one are not shown
+  const std::vector<glm::vec2>& members = population_optimizer->population();
+  const std::vector<float>& values = population_optimizer->populationValues();
+  std::vector<size_t> order;
+  for (size_t i = 0; i < members.size(); ++i)
+    if (std::isfinite(values[i]))
+      order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+  auto markers = std::make_shared<std::vector<glm::vec4>>(order.size());
+  for (size_t k = 0; k < order.size(); ++k)
+    (*markers)[k] = glm::vec4(members[order[k]], values[order[k]],
+                              order.size() > 1 ? float(k) / (order.size() - 1) : 0.0f);
+  population_markers = std::move(markers);
+
+  // converged when the population fits in a hundredth of the spacing of the vertices
+  float diff = std::max(1.0f, glm::round(getCameraDistance())) * 0.004f;
+  size_t generations = population_optimizer->history().size();
+  bool converged = population_optimizer->converged(0.01f * diff);
+  if (converged || generations >= max_generations) {
+    evolving = false;
+    std::cout << "[Info] " << optimizer_name << (converged ? " converged after " : " stopped after ") << generations
+              << " generations, " << population_optimizer->evaluationCount() << " evaluations, best f: "
+              << population_optimizer->bestValue() << std::endl;
+  }
+}
+
+void MyApplication::update(const InputState& input) {
+  changeOptimizer(input);
+  advanceAnimation(input);
+  evolvePopulation();
+
+  // set matrix : projection + view
+  projection = glm::perspective(float(2.0 * atan(input.height / 1920.f)),
+                                float(viewWidth(input)) / std::max(input.height, 1), 0.1f, 1000.f);
+  moveView(input);
+  rotateView(input);
+  zoomView(input);
+  pick(input);
+
+  if (global_search.valid() &&
+      global_search.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    auto [result, lines] = global_search.get();
+    global_result = std::move(result);
+    search_boxes = std::make_shared<const std::vector<VertexType>>(std::move(lines));
+  }
+
+  if (mesh_worker->finish(finished_mesh_job)) {
+    surface_mesh = std::move(finished_mesh_job.mesh);
+    finished_mesh_job.previous = nullptr;
+    // the pyramid of the previous graph is refilled by the next job
+    spare_pyramid = std::move(height_pyramid);
+    height_pyramid = std::move(finished_mesh_job.pyramid);
+    stale_blocks = finished_mesh_job.stale_blocks;
+    pending_samples = finished_mesh_job.pending_samples;
+    pending_stride = finished_mesh_job.pending_stride;
+    pending_normals = finished_mesh_job.pending_normals;
+    gradient_range = finished_mesh_job.gradient_range;
+    hermite_stats = finished_mesh_job.hermite_stats;
+  }
+  bool mesh_idle = mesh_worker->idle();
+  // the plugin is only swapped while no mesh job uses the tile cache
+  if (plugin && mesh_idle && (!critical_worker || critical_worker->idle()) &&
+      (!surrogate_worker || surrogate_worker->idle()) && (!region_worker || region_worker->idle()) &&
+      update_time - last_plugin_check_time > 0.5) {
+    last_plugin_check_time = update_time;
+    if (plugin->reloadIfChanged()) {
+      // samples and trajectory belong to the previous version of the function
+      openTileCache();
+      optimizer = nullptr;
+      points.clear();
+      picked_point.reset();
+      previous_picked_point.reset();
+      region_integrator = nullptr;
+      region_statistics.reset();
+      if (critical_finder)
+        resetCriticalPoints();
+      if (surrogate) {
+        surrogate->setModel(std::make_shared<const SurrogateModel>());
+        settled_lower = settled_upper = glm::vec2(0.0f);
+        verifyFrom(std::nullopt);
+      }
+      mesh_invalid = true;
+      last_refresh_time = -1.0;
+    }
+  }
+  if (tile_pager && mesh_idle) {
+    cache_text.clear();
+    cache_text << "Cache: " << tile_store->tileCount() << " tiles stored, "
+               << tile_pager->residentCount() << " resident, " << tile_pager->pendingCount() << " prefetching";
+  }
+  updateSurrogate();
+  // a playing animation or a graph being refined refreshes the graph as often
+  // as the jobs allow
+  bool t_changed = timed_function && animation.t != mesh_t;
+  if (mesh_idle && (t_changed || pending_samples || pending_normals || update_time - last_refresh_time > 0.1)) {
+    MeshJob job{point_position, getCameraDistance(), recycledMesh(), ++mesh_version};
+    job.mesh->layout = surface_layout;
+    job.t = mesh_t = animation.t;
+    job.invalidate = mesh_invalid;
+    job.previous = surface_mesh;
+    job.slice = slice;
+    job.surrogate = surrogate ? surrogate->model() : nullptr;
+    job.pyramid = spare_pyramid ? std::move(spare_pyramid) : std::make_unique<HeightPyramid>();
+    // the model is cheap next to the true function and changes with every
+    // fit, its graph is sampled in full rather than coarse to fine
+    job.budget = job.surrogate ? 1.0 : refine_budget;
+    job.quiver = quiver;
+    job.heat_map = heat_map;
+    job.hermite = hermite && hermite_grid && !tile_pager && !timed_function && !slice && !job.surrogate;
+    job.normal_map = normal_mapping && !timed_function && !job.surrogate && !job.hermite;
+    mesh_invalid = false;
+    mesh_worker->start(std::move(job));
+    last_refresh_time = update_time;
+  }
+  updateCriticalPoints();
+  updateRegionStatistics();
+}
+
+void MyApplication::publishFrame(const InputState& input) {
+  FrameSnapshot& frame = frame_buffer.back();
+  frame.projection = projection;
+  frame.view = view;
+  frame.point_position = point_position;
+  frame.camera_distance = getCameraDistance();
+  frame.mesh = surface_mesh;
+  frame.points = points;
+  frame.best_point.reset();
+  if (global_result)
+    frame.best_point = glm::vec3(global_result->best_point, global_result->minimum.hi);
+  frame.search_boxes = global_result ? search_boxes : nullptr;
+  frame.picked_point = picked_point;
+  frame.critical_markers = critical_markers;
+  frame.population = population_markers;
+  frame.heat_map = heat_map;
+  frame.input_sequence = input.sequence;
+  frame.update_count = update_count;
+
+  float sx = 2.0 / std::max(input.width, 1);
+  float sy = 2.0 / std::max(input.height, 1);
+  frame.text_lines = 0;
+  frame.addText(-1 + 8 * sx, -1 + 10 * sy)
+    << "x:" << point_position.x << ", y:" << point_position.y << ", z: " << point_position.z
+    << ", f(x,y): " << function(glm::vec2(point_position.x, point_position.y));
+  auto& optimizer_text = frame.addText(-1 + 8 * sx, 1 - 12 * sy) << "Optimizer: ";
+  if (nd_optimizer)
+    optimizer_text << optimizer_name << ", " << nd_points.size() - 1 << " steps, f: " << nd_value;
+  else if (optimizer)
+    optimizer_text << optimizer_name << " at (" << points.back().x << ", " << points.back().y << ")";
+  else
+    optimizer_text << "None";
+  if (global_search.valid()) {
+    float elapsed = update_time - global_search_start_time;
+    frame.addText(-1 + 8 * sx, 1 - 48 * sy)
+      << "Global search: " << global_minimizer->processedCount() << " boxes, "
+      << int(global_minimizer->processedCount() / std::max(elapsed, 1e-3f)) << " boxes/s";
+  }
+  else if (global_result) {
+    frame.addText(-1 + 8 * sx, 1 - 48 * sy)
+      << (global_result->complete ? "Global min" : "Global min (stopped)") << " in ["
+      << global_result->minimum.lo << ", " << global_result->minimum.hi << "] at ("
+      << global_result->best_point.x << ", " << global_result->best_point.y << "), "
+      << global_result->processed << " boxes, " << global_result->pruned << " pruned, "
+      << int(global_result->boxesPerSecond()) << " boxes/s";
+  }
+  if (population_optimizer && !population_optimizer->history().empty()) {
+    // evaluations to the best value so far, and to the global minimum when it is known
+    const std::vector<GenerationStats>& history = population_optimizer->history();
+    float best = population_optimizer->bestValue();
+    double seconds = 0.0;
+    for (auto &generation : history)
+      seconds += generation.seconds;
+    auto& population_text = frame.addText(-1 + 8 * sx, 1 - 138 * sy)
+      << optimizer_name << (evolving ? ": generation " : " (stopped): generation ") << history.size() << ", "
+      << population_optimizer->evaluationCount() << " evaluations, best f: " << best << " after "
+      << population_optimizer->evaluationsTo(best) << ", " << 1000.0 * history.back().seconds << " ms per generation ("
+      << 1000.0 * seconds / history.size() << " on average)";
+    if (global_result) {
+      double hi = global_result->minimum.hi;
+      float target = float(hi + 1e-4 * std::max(1.0, std::abs(hi)));
+      if (size_t evaluations = population_optimizer->evaluationsTo(target))
+        population_text << ", global min after " << evaluations;
+      else
+        population_text << ", global min not reached";
+    }
+  }
+  if (region_statistics) {
+    const RegionStatistics& region = *region_statistics;
+    frame.addText(-1 + 8 * sx, 1 - 156 * sy)
+      << "Region [" << region.lower.x << ", " << region.upper.x << "] x [" << region.lower.y << ", "
+      << region.upper.y << "]: integral " << region.integral.value << " +- " << Scientific{region.integral.error}
+      << ", mean " << region.mean.value << " +- " << Scientific{region.mean.error} << ", f in [" << region.min
+      << ", " << region.max << "]" << (region_integrator ? ", refining" : "");
+    frame.addText(-1 + 8 * sx, 1 - 174 * sy)
+      << "Above f = " << region.threshold << ": volume " << region.volume.value << " +- "
+      << Scientific{region.volume.error} << ", area " << region.qmc_area.value << " +- "
+      << Scientific{region.qmc_area.error} << ", QMC integral " << region.qmc_integral.value << " +- "
+      << Scientific{region.qmc_integral.error} << ", " << region.evaluations << " evaluations ("
+      << region.reused << " reused)";
+  }
+  if (hermite && hermite_stats.heights) {
+    const HermiteStats& patches = hermite_stats;
+    frame.addText(-1 + 8 * sx, 1 - 192 * sy)
+      << "Hermite: " << patches.values << " values and " << patches.gradients << " gradients for "
+      << patches.heights << " heights (" << double(patches.heights) / std::max<size_t>(patches.values, 1)
+      << "x fewer), " << patches.patches << " patches, " << patches.split << " split, worst check "
+      << patches.worst_error << " of " << patches.tolerance;
+  }
+  if (hover_point || picked_point) {
+    auto& pick_text = frame.addText(-1 + 8 * sx, -1 + 46 * sy);
+    if (hover_point)
+      pick_text << "Cursor: (" << hover_point->x << ", " << hover_point->y
+                << "), f: " << function(glm::vec2(*hover_point)) << "  ";
+    if (picked_point)
+      pick_text << "Picked: (" << picked_point->x << ", " << picked_point->y
+                << "), f: " << function(glm::vec2(*picked_point));
+  }
+  if (tile_pager)
+    frame.addText(-1 + 8 * sx, 1 - 30 * sy) << cache_text.view();
+  else if (pending_samples)
+    frame.addText(-1 + 8 * sx, 1 - 30 * sy)
+      << "Refining: stride " << pending_stride << ", " << pending_samples << " samples left";
+  else if (pending_normals)
+    frame.addText(-1 + 8 * sx, 1 - 30 * sy) << "Refining: " << pending_normals << " normals left";
+  if (critical_finder)
+    frame.addText(-1 + 8 * sx, 1 - 84 * sy) << critical_text.view();
+  if (surrogate)
+    frame.addText(-1 + 8 * sx, 1 - 120 * sy) << surrogate_text.view();
+  if (quiver)
+    frame.addText(-1 + 8 * sx, 1 - 102 * sy)
+      << "Gradient: |grad f| from " << gradient_range.x << " to " << gradient_range.y;
+  if (slice_view)
+    frame.addText(-1 + 8 * sx, 1 - 66 * sy) << slice_text.view();
+  if (timed_function) {
+    auto& animation_text = frame.addText(-1 + 8 * sx, 1 - 66 * sy)
+      << "t: " << animation.t << (animation.playing ? ", playing at " : ", paused at ")
+      << animation.speed << " t/s";
+    if (tracking)
+      animation_text << ", tracking";
+    if (stale_blocks)
+      animation_text << ", " << stale_blocks << " blocks behind";
+  }
+
+  frame.update_allocations = threadAllocationCount() - step_allocations;
+  frame_buffer.publish();
+}
+
+void MyApplication::updateLoop() {
+  auto next = std::chrono::steady_clock::now();
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(update_period));
+  while (update_running) {
+    input_buffer.update();
+    InputState input = input_buffer.front();
+    update_time += update_period;
+    ++update_count;
+    if (replay) {
+      if (!replay->apply(update_count, input)) {
+        replay_finished = true;
+        return;
+      }
+    }
+    else if (recorder)
+      recorder->record(update_count, input);
+
+    {
+      Profiler::Scope scope(profiler.get(), "update");
+      step_allocations = threadAllocationCount();
+      update(input);
+      publishFrame(input);
+    }
+
+    if (replay && replay_fast)
+      continue;
+    // fixed rate, a late step does not make the next ones hurry
+    next += period;
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+      next = now;
+    std::this_thread::sleep_until(next);
+  }
+}
+
+void MyApplication::onKey(GLFWwindow* window, int key, int, int action, int) {
+  auto app = static_cast<MyApplication*>(glfwGetWindowUserPointer(window));
+  if (key < 0 || key >= InputState::key_count || action == GLFW_REPEAT)
+    return;
+  app->input.keys[key] = action == GLFW_PRESS;
+  app->inputEvent();
+}
+
+void MyApplication::onMouseButton(GLFWwindow* window, int button, int action, int) {
+  auto app = static_cast<MyApplication*>(glfwGetWindowUserPointer(window));
+  if (button == GLFW_MOUSE_BUTTON_LEFT)
+    app->input.mouse_left = action == GLFW_PRESS;
+  else if (button == GLFW_MOUSE_BUTTON_RIGHT)
+    app->input.mouse_right = action == GLFW_PRESS;
+  else
+    return;
+  app->inputEvent();
+}
+
+void MyApplication::onCursorPos(GLFWwindow* window, double x, double y) {
+  auto app = static_cast<MyApplication*>(glfwGetWindowUserPointer(window));
+  app->input.cursor_x = x;
+  app->input.cursor_y = y;
+  // moving the cursor only changes the view while dragging
+  if (app->input.mouse_left || app->input.mouse_right)
+    app->inputEvent();
+}
+
+void MyApplication::inputEvent() {
+  ++input.sequence;
+  // the update thread is stuck, keep the oldest events only
+  if (pending_count == max_pending_events)
+    return;
+  pending_events[(pending_first + pending_count) % max_pending_events] = {input.sequence, glfwGetTime()};
+  ++pending_count;
+}
+
+void MyApplication::measureFrame(double now, const FrameSnapshot& frame) {
+  // loop() runs right after the swap of the previous frame
+  for (double time : presented_events) {
+    double latency = now - time;
+    statistics.latency_sum += latency;
+    statistics.latency_max = std::max(statistics.latency_max, latency);
+    ++statistics.latency_count;
+  }
+  presented_events.clear();
+  ++statistics.frames;
+  statistics.update_allocations = std::max(statistics.update_allocations, frame.update_allocations);
+
+  double elapsed = now - statistics.window_start;
+  if (elapsed < 1.0)
+    return;
+  statistics.text.clear();
+  statistics.text << "Render " << int(glm::round(statistics.frames / elapsed)) << " fps, update "
+                  << int(glm::round((frame.update_count - statistics.first_update) / elapsed)) << " Hz";
+  if (statistics.latency_count)
+    statistics.text << ", input to photon "
+                    << int(glm::round(1000.0 * statistics.latency_sum / statistics.latency_count)) << " ms avg, "
+                    << int(glm::round(1000.0 * statistics.latency_max)) << " ms max";
+  if (counting_allocations)
+    statistics.text << ", allocations " << statistics.frame_allocations << " per frame, "
+                    << statistics.update_allocations << " per update";
+  statistics.window_start = now;
+  statistics.frames = 0;
+  statistics.first_update = frame.update_count;
+  statistics.latency_count = 0;
+  statistics.latency_sum = 0.0;
+  statistics.latency_max = 0.0;
+  statistics.frame_allocations = 0;
+  statistics.update_allocations = 0;
+}
+
 void MyApplication::loop() {
-  // exit on window close button pressed
-  if (glfwWindowShouldClose(getWindow()))
+  // exit on window close button pressed or at the end of a replay
+  if (glfwWindowShouldClose(getWindow()) || replay_finished)
     exit();
 
-  changeOptimizer();
+  if (!update_thread.joinable()) {
+    update_running = true;
+    update_thread = std::thread(&MyApplication::updateLoop, this);
+  }
 
-  // set matrix : projection + view
-  projection = glm::perspective(float(2.0 * atan(getHeight() / 1920.f)),
-                                getWindowRatio(), 0.1f, 1000.f);
-  moveView();
-  rotateView();
-  zoomView();
-  float t = getTime();
-  if (t - last_refresh_time > 0.1f) {
-    createGraph();
-    last_refresh_time = t;
+  // hand the input to the update thread, draw the newest snapshot
+  double now = glfwGetTime();
+  if (profiler && last_frame_time > 0.0)
+    profiler->add("frame interval", now - last_frame_time);
+  last_frame_time = now;
+  // loop() runs right after the swap of the previous frame, GLFW counts
+  // time from its initialization
+  if (frames_drawn++ == 1) {
+    std::cout << "[Info] First frame on screen " << int(glm::round(1000.0 * now)) << " ms after startup" << std::endl;
+    if (profiler)
+      profiler->add("first frame", now);
+    if (exit_after_first_frame)
+      exit();
+  }
+  Profiler::Scope scope(profiler.get(), "frame");
+  uint64_t allocations = threadAllocationCount();
+  frame_arena.reset();
+  input.time = now;
+  input.width = getWidth();
+  input.height = getHeight();
+  input_buffer.back() = input;
+  input_buffer.publish();
+
+  frame_buffer.update();
+  const FrameSnapshot& frame = frame_buffer.front();
+  measureFrame(now, frame);
+  while (pending_count && pending_events[pending_first].first <= frame.input_sequence) {
+    presented_events.push_back(pending_events[pending_first].second);
+    pending_first = (pending_first + 1) % max_pending_events;
+    --pending_count;
+  }
+
+  if (frame.mesh && frame.mesh->layout != uploaded_layout)
+    uploadLayout(frame.mesh->layout);
+  if (frame.mesh != uploaded_mesh) {
+    uploaded_mesh = frame.mesh;
+    uploadMesh(*uploaded_mesh);
+    arrow_count = uploaded_mesh->arrows.size();
+    if (arrow_count) {
+      glBindBuffer(GL_ARRAY_BUFFER, vboarrows);
+      glBufferData(GL_ARRAY_BUFFER, arrow_count * sizeof(QuiverArrow), uploaded_mesh->arrows.data(), GL_STREAM_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    // the samples of the graph are the texels of the heat map
+    if (uploaded_mesh->heights.empty())
+      heat_samples = 0;
+    else
+      uploadHeatMap(*uploaded_mesh);
+    if (uploaded_mesh->normal_side)
+      uploadNormalMap(*uploaded_mesh);
+  }
+  if (frame.search_boxes && frame.search_boxes != uploaded_boxes) {
+    uploaded_boxes = frame.search_boxes;
+    if (!vaoboxes) {
+      glGenVertexArrays(1, &vaoboxes);
+      glGenBuffers(1, &vboboxes);
+      glBindVertexArray(vaoboxes);
+      glBindBuffer(GL_ARRAY_BUFFER, vboboxes);
+      shaderProgram.setAttribute("position", 3, sizeof(VertexType), offsetof(VertexType, position));
+      shaderProgram.setAttribute("normal", 3, sizeof(VertexType), offsetof(VertexType, normal));
+      shaderProgram.setAttribute("color", 4, sizeof(VertexType), offsetof(VertexType, color));
+      glBindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vboboxes);
+    glBufferData(GL_ARRAY_BUFFER, uploaded_boxes->size() * sizeof(VertexType), uploaded_boxes->data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    search_box_vertices = uploaded_boxes->size();
+  }
+
+  if (frame.population != uploaded_population) {
+    uploaded_population = frame.population;
+    population_count = uploaded_population && instancing ? uploaded_population->size() : 0;
+    if (population_count) {
+      glBindBuffer(GL_ARRAY_BUFFER, vbopopulation);
+      glBufferData(GL_ARRAY_BUFFER, population_count * sizeof(glm::vec4), uploaded_population->data(), GL_STREAM_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+  }
+
+  if (frame.critical_markers && frame.critical_markers != uploaded_critical) {
+    uploaded_critical = frame.critical_markers;
+    glBindBuffer(GL_ARRAY_BUFFER, vbocritical);
+    glBufferData(GL_ARRAY_BUFFER, uploaded_critical->size() * sizeof(VertexType), uploaded_critical->data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    critical_vertices = uploaded_critical->size();
   }
 
   // clear
@@ -480,45 +2130,58 @@ void MyApplication::loop() {
   glClearColor(0.0, 0.0, 0.0, 0.0);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+  // the split view draws the graph on the left half, the heat map on the right
+  int width = getWidth(), height = getHeight();
+  int view_width = frame.heat_map ? width / 2 : width;
+  glViewport(0, 0, view_width, height);
+
   shaderProgram.use();
 
   // send uniforms
-  shaderProgram.setUniform("projection", projection);
-  shaderProgram.setUniform("view", view);
+  shaderProgram.setUniform("projection", frame.projection);
+  shaderProgram.setUniform("view", frame.view);
   shaderProgram.setUniform("model", glm::mat4(1.0));
 
   glCheckError(__FILE__, __LINE__);
 
-  glBindVertexArray(vao);
+  if (uploaded_mesh) {
+    glBindVertexArray(surface_buffers[surface_front].vao);
+    // the helpers below keep the normals of their vertices
+    bool mapped = uploaded_mesh->normal_side != 0;
+    shaderProgram.setUniform("normal_mapping", int(mapped));
+    if (mapped) {
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, normal_texture);
+      shaderProgram.setUniform("normal_map", 1);
+      shaderProgram.setUniform("normal_texels", float(normal_side));
+      shaderProgram.setUniform("normal_spacing", uploaded_mesh->normal_spacing);
+      shaderProgram.setUniform("normal_scale", uploaded_mesh->normal_scale);
+    }
 
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glCheckError(__FILE__, __LINE__);
+    glMultiDrawElementsBaseVertex(
+      uploaded_layout->getMode() == SurfaceLayout::Mode::Strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES,
+      surface_counts.data(), GL_UNSIGNED_SHORT, surface_offsets.data(),
+      surface_counts.size(), surface_base_vertices.data());
+    if (mapped) {
+      shaderProgram.setUniform("normal_mapping", 0);
+      glBindTexture(GL_TEXTURE_2D, 0);
+      glActiveTexture(GL_TEXTURE0);
+    }
+  }
 
-  glCheckError(__FILE__, __LINE__);
-  glDrawElements(GL_TRIANGLES,         // mode
-                 size * size * 2 * 3,  // count
-                 GL_UNSIGNED_INT,      // type
-                 NULL                  // element array buffer offset
-  );
+  glBindVertexArray(vaohelpers);
 
   // draw the axes
   glCheckError(__FILE__, __LINE__);
-  glDrawElements(GL_LINES,  // mode
-                 6,         // count
-                 GL_UNSIGNED_INT,  // type
-                 (GLvoid*)(size * size * 2 * 3 * sizeof(GLuint))  // element array buffer offset
-  );
+  drawHelper(axes_range);
 
   // draw the axes at the point position
-  shaderProgram.setUniform("model", glm::translate(glm::mat4(1.0), point_position));
+  shaderProgram.setUniform("model", glm::translate(glm::mat4(1.0), frame.point_position));
   glCheckError(__FILE__, __LINE__);
-  glDrawElements(GL_LINES,  // mode
-                 6,         // count
-                 GL_UNSIGNED_INT,  // type
-                 (GLvoid*)((size * size * 2 * 3 + 6) * sizeof(GLuint))  // element array buffer offset
-  );
+  drawHelper(point_axes_range);
 
-  for (auto &point : points) {
+  for (auto &point : frame.points) {
     // draw sphere
     shaderProgram.setUniform(
       "model", 
@@ -526,45 +2189,88 @@ void MyApplication::loop() {
         glm::translate(
           glm::mat4(1.0), 
           point
-        ), getCameraDistance() * 0.008f * glm::vec3(1.0, 1.0, 1.0)
+        ), frame.camera_distance * 0.008f * glm::vec3(1.0, 1.0, 1.0)
       )
     );
     glCheckError(__FILE__, __LINE__);
-    glDrawElements(GL_TRIANGLES,  // mode
-                  6 * 20 * 20,   // count
-                  GL_UNSIGNED_INT,  // type
-                  (GLvoid*)((size * size * 2 * 3 + 6 + 6) * sizeof(GLuint))  // element array buffer offset
-    );
+    drawHelper(sphere_range);
   }
 
-  for (size_t i = 1; i < points.size(); ++i) {
-    // draw line
-    glm::vec3 p1 = points[i - 1];
-    glm::vec3 p2 = points[i];
-    // create the model matrix for the line from p1 to p2 based on line from (0, 0, 0) to (1, 0, 0)
-    glm::vec3 translation = p1;
-    float scale = glm::length(p2 - p1);
-    glm::vec3 direction = glm::normalize(p2 - p1);
-    glm::vec3 axis = glm::cross(glm::vec3(1.0f, 0.0f, 0.0f), direction);
-    float angle = glm::acos(glm::dot(glm::vec3(1.0f, 0.0f, 0.0f), direction));
-
-    // Create the model matrix
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, translation);
-    model = glm::rotate(model, angle, axis);
-    model = glm::scale(model, glm::vec3(scale, 1.0f, 1.0f));
-    shaderProgram.setUniform("model", model);
+  if (frame.points.size() > 1) {
+    // draw the trajectory, staged in the frame arena
+    size_t count = frame.points.size();
+    VertexType* line = frame_arena.allocate<VertexType>(count);
+    for (size_t i = 0; i < count; ++i)
+      line[i] = {frame.points[i], glm::vec3(0, 0, 1), glm::vec4(0.0, 1.0, 1.0, 1.0)};
+    glBindBuffer(GL_ARRAY_BUFFER, vbotrajectory);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(VertexType), line, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    shaderProgram.setUniform("model", glm::mat4(1.0));
+    glBindVertexArray(vaotrajectory);
+    glDrawArrays(GL_LINE_STRIP, 0, count);
+    glCheckError(__FILE__, __LINE__);
+    glBindVertexArray(vaohelpers);
+  }
 
+  if (frame.critical_markers) {
+    shaderProgram.setUniform("model", glm::mat4(1.0));
+    glBindVertexArray(vaocritical);
+    glDrawArrays(GL_LINES, 0, critical_vertices);
     glCheckError(__FILE__, __LINE__);
-    glDrawElements(GL_LINES,  // mode
-                  2,         // count
-                  GL_UNSIGNED_INT,  // type
-                  (GLvoid*)((size * size * 2 * 3 + 6 + 6 + 6 * 20 * 20) * sizeof(GLuint))  // element array buffer offset
-    );
+    glBindVertexArray(vaohelpers);
+  }
+
+  if (frame.picked_point) {
+    shaderProgram.setUniform("model",
+      glm::scale(glm::translate(glm::mat4(1.0), *frame.picked_point), frame.camera_distance * 0.012f * glm::vec3(1.0, 1.0, 1.0)));
+    drawHelper(sphere_range);
+  }
+
+  if (frame.best_point) {
+    // sphere at the best point found by the global search
+    shaderProgram.setUniform("model",
+      glm::scale(glm::translate(glm::mat4(1.0), *frame.best_point), frame.camera_distance * 0.012f * glm::vec3(1.0, 1.0, 1.0)));
+    drawHelper(sphere_range);
+
+    // visited boxes
+    if (frame.search_boxes) {
+      shaderProgram.setUniform("model", glm::mat4(1.0));
+      glBindVertexArray(vaoboxes);
+      glDrawArrays(GL_LINES, 0, search_box_vertices);
+      glCheckError(__FILE__, __LINE__);
+    }
   }
 
   shaderProgram.unuse();
 
+  if (arrow_count) {
+    // every arrow of the gradient overlay in one call
+    shaderProgramArrows.use();
+    shaderProgramArrows.setUniform("projection", frame.projection);
+    shaderProgramArrows.setUniform("view", frame.view);
+    glBindVertexArray(vaoarrows);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, arrow_vertices, arrow_count);
+    glCheckError(__FILE__, __LINE__);
+    shaderProgramArrows.unuse();
+  }
+
+  if (population_count) {
+    // every member of the population in one call
+    shaderProgramPopulation.use();
+    shaderProgramPopulation.setUniform("projection", frame.projection);
+    shaderProgramPopulation.setUniform("view", frame.view);
+    shaderProgramPopulation.setUniform("radius", frame.camera_distance * 0.006f);
+    glBindVertexArray(vaopopulation);
+    glDrawElementsInstanced(sphere_range.mode, sphere_range.count, GL_UNSIGNED_SHORT, (GLvoid*)sphere_range.offset,
+                            population_count);
+    glCheckError(__FILE__, __LINE__);
+    shaderProgramPopulation.unuse();
+  }
+
+  if (frame.heat_map && heat_samples)
+    drawHeatMap(frame, view_width, width - view_width, height);
+  glViewport(0, 0, width, height);
+
   glCheckError(__FILE__, __LINE__);
   glBindVertexArray(vaotext);
   glBindBuffer(GL_ARRAY_BUFFER, vbotext);
@@ -575,21 +2281,18 @@ void MyApplication::loop() {
 
   shaderProgramText.setUniform("color", glm::vec4(1.0, 1.0, 1.0, 1.0));
 
-  std::string point_position_str = "x:" + std::to_string(point_position.x) + ", y:" + std::to_string(point_position.y) + ", z: " + 
-    std::to_string(point_position.z) + ", f(x,y): " + std::to_string(function(glm::vec2(point_position.x, point_position.y)));
-  std::string optimizer_str = "Optimizer: " + (optimizer 
-    ? (optimizer->toString() + " at (" + std::to_string(points[points.size() - 1].x) + ", " + std::to_string(points[points.size() - 1].y)) + ")" 
-    : "None");
-
   float sx = 2.0 / getWidth();
   float sy = 2.0 / getHeight();
-  renderText(point_position_str,
-              -1 + 8 * sx, -1 + 10 * sy, sx, sy);
-  renderText(optimizer_str,
-              -1 + 8 * sx, 1 - 12 * sy, sx, sy);
+  for (int i = 0; i < frame.text_lines; ++i)
+    renderText(frame.text[i].text.c_str(), frame.text[i].x, frame.text[i].y, sx, sy);
+  if (!statistics.text.empty())
+    renderText(statistics.text.c_str(),
+                -1 + 8 * sx, -1 + 28 * sy, sx, sy);
 
   shaderProgramText.unuse();
 
   glCheckError(__FILE__, __LINE__); 
   glBindVertexArray(0);
+
+  statistics.frame_allocations = std::max(statistics.frame_allocations, threadAllocationCount() - allocations);
 }
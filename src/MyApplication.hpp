@@ -11,69 +11,471 @@
 
 #include "Application.hpp"
 #include "Shader.hpp"
-#include <ft2build.h>
-#include FT_FREETYPE_H
 #include <utils.hpp>
+#include <Animation.hpp>
+#include <BackgroundWorker.hpp>
+#include <CriticalPoints.hpp>
+#include <FrameArena.hpp>
+#include <FontAtlas.hpp>
+#include <FrameState.hpp>
+#include <GlobalMinimizer.hpp>
+#include <HeightPyramid.hpp>
+#include <HermiteGrid.hpp>
+#include <InputLog.hpp>
+#include <Mesh.hpp>
+#include <NdOptimizers.hpp>
 #include <Optimizers.hpp>
+#include <PopulationOptimizers.hpp>
+#include <Plugin.hpp>
+#include <Profiler.hpp>
+#include <ProgressiveGrid.hpp>
+#include <NormalMap.hpp>
+#include <QuiverField.hpp>
+#include <RegionStats.hpp>
+#include <SliceView.hpp>
+#include <SurfaceLayout.hpp>
+#include <SurfaceStream.hpp>
+#include <Surrogate.hpp>
+#include <TextBuffer.hpp>
+#include <TileCache.hpp>
+#include <TripleBuffer.hpp>
+#include <atomic>
+#include <future>
+#include <map>
 #include <optional>
 #include <memory>
+#include <thread>
 
 
 class MyApplication : public Application {
 public:
-  MyApplication(func_t function, std::optional<grad_t> gradient, std::optional<hess_t> hessian);
+  // cache_path names the tile cache file, no cache is used when empty; the
+  // graph has size x size quads
+  MyApplication(func_t function, std::optional<grad_t> gradient, std::optional<hess_t> hessian,
+                std::optional<batch_t> batch = std::nullopt, std::string cache_path = "", int size = 200);
+
+  ~MyApplication();
+
+  // reload the plugin the function comes from when its file changes
+  void watchPlugin(std::shared_ptr<Plugin> plugin);
+  // interval extensions of the function, enable the global search
+  void setIntervalFunction(interval_func_t function, std::optional<interval_grad_t> gradient);
+  // animate the graph of a timed function over t, instead of the function
+  // given to the constructor
+  void animate(TimedFunction function, Animation animation);
+  // show 2D slices of an N-D function through the iterate of the optimizer,
+  // instead of the function given to the constructor
+  void viewSlices(NdFunction function);
+  // show the graph of the current model of surrogate and run the optimizers
+  // on it, the function given to the constructor is its function(); true
+  // values are evaluated in the background
+  void useSurrogate(std::shared_ptr<Surrogate> surrogate);
+
+  // write the input of the session to path
+  void recordSession(const std::string& path);
+  // replay a recorded session instead of the live input, in real time or as
+  // fast as possible, profile it and exit at its end
+  void replaySession(const std::string& path, bool as_fast_as_possible);
+  // time the update steps, mesh jobs and frames; the summary is printed and
+  // written to path (when not empty) at exit
+  void profile(const std::string& path);
+  // exit once the first frame is on screen, to measure the startup
+  void exitAfterFirstFrame() { exit_after_first_frame = true; }
+  // seconds every mesh job samples the graph for after its first pass
+  void setRefineBudget(double budget) { refine_budget = budget; }
+  // reconstruct the graph from Hermite patches of a sparse lattice of values
+  // and gradients rather than sampling every vertex; needs the gradient
+  void useHermitePatches() { hermite = true; }
+  // center the view on point, from distance along the current direction
+  void lookAt(glm::vec3 point, float distance);
 
 protected:
+  // render thread: samples the input, draws the latest frame snapshot
   virtual void loop();
 
 private:
+  // The update thread owns everything below up to the render thread part:
+  // the function, the camera, the optimizer and the mesh jobs. It runs at a
+  // fixed rate and publishes a FrameSnapshot after every step.
+  static constexpr double update_period = 1.0 / 120.0;
+  std::thread update_thread;
+  std::atomic<bool> update_running{false};
+  double update_time = 0.0;  // simulated, advances by update_period
+  uint64_t update_count = 0;
+  uint64_t step_allocations = 0;  // allocation count at the start of the step
+  void updateLoop();
+  void update(const InputState& input);
+  void publishFrame(const InputState& input);
+
+  TripleBuffer<InputState> input_buffer;
+  TripleBuffer<FrameSnapshot> frame_buffer;
+
+  // session recording and replay, by update step
+  std::unique_ptr<InputRecorder> recorder;
+  std::unique_ptr<InputReplay> replay;
+  bool replay_fast = false;
+  std::atomic<bool> replay_finished{false};
+  void optimizerEvent(OptimizerEvent event, glm::vec2 point);
+
+  // used by every thread, set before run()
+  std::unique_ptr<Profiler> profiler;
+  std::string profile_path;
+
   // function
   func_t function;
   std::optional<grad_t> gradient;
   std::optional<hess_t> hessian;
+  std::optional<batch_t> batch;
+  std::shared_ptr<Plugin> plugin;
+  double last_plugin_check_time = 0.0;
+
+  // timed function, function and its derivatives above are taken at the
+  // current t; mesh jobs get their t with the job
+  std::optional<TimedFunction> timed_function;
+  Animation animation;
+  void advanceAnimation(const InputState& input);
+
+  // N-D function seen through a slice, function above is the current slice;
+  // mesh jobs get their plane with the job
+  std::unique_ptr<SliceView> slice_view;
+  std::shared_ptr<const SlicePlane> slice;
+  std::vector<double> slice_scratch;
+  TextBuffer<128> slice_text;
+  void setSlice(const double* origin);
+  void changeSlice(const InputState& input);
+
+  // optimizer of the N-D function, its trajectory is projected on the slice
+  std::shared_ptr<NdOptimizer> nd_optimizer;
+  std::vector<std::vector<double>> nd_points;
+  double nd_value = 0.0;
+  void startNdOptimizer(std::shared_ptr<NdOptimizer> optimizer, OptimizerEvent event);
+  void stepNdOptimizer();
 
   // optimizer
   std::shared_ptr<Optimizer> optimizer;
-  void changeOptimizer();
+  std::string optimizer_name;
+  void changeOptimizer(const InputState& input);
+  void stepOptimizer();
   bool button_pressed = false;
+  bool tracking = false;  // step whenever t changes
+  static constexpr size_t max_trajectory_points = 4096;
   std::vector<glm::vec3> points;
 
-  // graphics variables
-  const int size = 200;
-  float last_refresh_time = 0.0;
+  // CMA-ES or differential evolution, also the optimizer above: evolves a
+  // generation every update step until it converges, its generations are
+  // evaluated on the graph pool
+  std::shared_ptr<PopulationOptimizer> population_optimizer;
+  bool evolving = false;
+  uint32_t population_seed = 0;  // changes with every start
+  static constexpr size_t max_generations = 1000;
+  std::shared_ptr<const std::vector<glm::vec4>> population_markers;
+  void startPopulation(std::shared_ptr<PopulationOptimizer> optimizer, OptimizerEvent event);
+  void evolvePopulation();
+
+  // surrogate of an expensive function: the surrogate worker evaluates the
+  // true function where the model is least certain in the region of the
+  // graph and refits the model; the iterates of the optimizer are verified
+  // against the true function, a step that went uphill is taken again from
+  // the last verified iterate on the refitted model
+  struct SurrogateJob {
+    std::shared_ptr<const SurrogateModel> model;  // refitted by the job
+    glm::vec2 lower, upper;  // of the region searched
+    size_t count = 0;  // points to choose
+    uint32_t seed = 0;
+    std::vector<glm::vec2> points;  // the iterates to verify, then the chosen points
+    std::vector<float> predicted;  // of the iterates, by the model they were taken on
+    uint64_t run = 0;  // of the optimizer the iterates come from
+    std::vector<float> values;  // result, true values at points
+    float deviation = 0.0f;  // result, largest of the candidates before the job
+  };
+  static constexpr float surrogate_tolerance = 1e-3f;  // of the prior deviation, in a settled region
+  std::shared_ptr<Surrogate> surrogate;
+  std::unique_ptr<ThreadPool> surrogate_pool;
+  std::unique_ptr<BackgroundWorker<SurrogateJob>> surrogate_worker;
+  SurrogateJob surrogate_job;
+  uint32_t surrogate_seed = 0;
+  std::vector<glm::vec2> check_points;  // iterates waiting for their true value
+  std::vector<float> check_predicted;
+  uint64_t optimizer_run = 0;  // changes with every start of the optimizer
+  std::optional<glm::vec3> verified_point;  // z: its true value
+  glm::vec2 settled_lower = glm::vec2(0.0f), settled_upper = glm::vec2(0.0f);  // none while empty
+  TextBuffer<192> surrogate_text;
+  // the iterates from start on are verified, none without start
+  void verifyFrom(std::optional<glm::vec2> start);
+  void fitSurrogate(SurrogateJob& job);
+  void updateSurrogate();
+
+  // global search over the visible region
+  std::optional<interval_func_t> interval_function;
+  std::optional<interval_grad_t> interval_gradient;
+  std::shared_ptr<GlobalMinimizer> global_minimizer;
+  std::future<std::pair<GlobalSearchResult, std::vector<VertexType>>> global_search;
+  std::optional<GlobalSearchResult> global_result;
+  std::shared_ptr<const std::vector<VertexType>> search_boxes;
+  double global_search_start_time = 0.0;
+  void startGlobalSearch();
+
+  // critical points around the graph, found region by region on the
+  // critical worker and cached per region and zoom level
+  struct CriticalJob {
+    std::shared_ptr<CriticalPointFinder> finder;
+    std::vector<CriticalRegion> regions;
+    std::vector<std::vector<CriticalPoint>> points;  // result
+  };
+  static constexpr size_t max_critical_regions = 16;  // per job
+  static constexpr size_t max_cached_regions = 4096;
+  std::shared_ptr<CriticalPointFinder> critical_finder;
+  std::unique_ptr<BackgroundWorker<CriticalJob>> critical_worker;
+  CriticalJob critical_job;
+  std::map<CriticalRegion, std::vector<CriticalPoint>> critical_cache;
+  uint64_t critical_version = 0;  // changes of the cache
+  std::vector<CriticalRegion> visible_regions, shown_regions;
+  uint64_t shown_version = 0;
+  std::shared_ptr<const std::vector<VertexType>> critical_markers;
+  TextBuffer<160> critical_text;
+  // starts the search, or stops it when running
+  void toggleCriticalPoints();
+  // searches the function anew, after it changed
+  void resetCriticalPoints();
+  void updateCriticalPoints();
+
+  // integral, mean, extremes and volume above a threshold over the visible
+  // region or the box between the last two picked points, refined a budget
+  // at a time on the region worker
+  struct RegionJob {
+    std::shared_ptr<RegionIntegrator> integrator;
+    bool done = false;  // result
+    RegionStatistics statistics;  // result
+  };
+  static constexpr double region_budget = 0.05;  // per job, in seconds
+  std::shared_ptr<RegionIntegrator> region_integrator;
+  std::unique_ptr<BackgroundWorker<RegionJob>> region_worker;
+  RegionJob region_job;
+  std::optional<RegionStatistics> region_statistics;
+  // starts the statistics, or stops and hides them when shown
+  void toggleRegionStatistics();
+  void updateRegionStatistics();
+
+  // camera
+  const int size;
   double x_mouse_pos, y_mouse_pos;
   bool mouse_pressed = false;
   double y_mouse_pos_right;
   bool mouse_pressed_right = false;
   glm::vec3 point_position = glm::vec3(0.0, 0.0, 0.0);
   glm::vec3 camera_position = glm::vec3(0.0, 0.0, 0.0);
+  glm::mat4 projection = glm::mat4(1.0);
+  glm::mat4 view = glm::mat4(1.0);
+  void moveView(const InputState& input);
+  void rotateView(const InputState& input);
+  void zoomView(const InputState& input);
 
-  void moveView();
-  void rotateView();
-  void zoomView();
+  // picking: the cursor ray against the heights of the graph shown, a click
+  // that does not rotate the camera picks the point under the cursor
+  std::unique_ptr<HeightPyramid> height_pyramid, spare_pyramid;
+  std::optional<glm::vec3> hover_point, picked_point, previous_picked_point;
+  bool pick_pressed = false;
+  double press_x = 0.0, press_y = 0.0;
+  void pick(const InputState& input);
+  // the start of the optimizers: the picked point, or the point at the
+  // center of the graph
+  glm::vec2 selectedPoint() const;
+  // width of the 3D view, the left half of the window in the split view
+  int viewWidth(const InputState& input) const { return heat_map ? input.width / 2 : input.width; }
   glm::vec3 getCameraDirection();
   float getCameraDistance();
-  void createGraph();
 
-  FT_Library ft;
-  FT_Face face;
-  void renderText(std::string text, float x, float y, float sx, float sy);
+  // tile cache
+  std::string cache_path;
+  std::unique_ptr<TileStore> tile_store;
+  std::unique_ptr<TilePager> tile_pager;
+  TextBuffer<128> cache_text;  // read between mesh jobs, they use the pager
+  void openTileCache();
 
-  // shader
-  Shader vertexShader;
-  Shader fragmentShader;
-  ShaderProgram shaderProgram;
+  // graph, rebuilt by one mesh job at a time on the mesh worker
+  struct MeshJob {
+    glm::vec3 center;
+    float camera_distance;
+    std::shared_ptr<SurfaceMesh> mesh;  // with its layout set, filled by the job
+    uint64_t version = 0;
+    // of a timed function
+    float t = 0.0f;
+    bool invalidate = false;  // the function changed
+    std::shared_ptr<const SurfaceMesh> previous;  // unchanged tiles are copied from it
+    std::shared_ptr<const SlicePlane> slice;  // of an N-D function
+    std::shared_ptr<const SurrogateModel> surrogate;  // shown instead of the function
+    std::unique_ptr<HeightPyramid> pyramid;  // of the heights, filled by the job
+    double budget = 0.0;  // of the progressive grid, in seconds
+    bool quiver = false;  // with the arrows of the gradient overlay
+    bool heat_map = false;  // with the heights of the vertices
+    bool normal_map = false;  // with the texels of the normal map
+    bool hermite = false;  // heights from the Hermite grid
+    size_t stale_blocks = 0;  // result
+    size_t pending_samples = 0;  // result
+    int pending_stride = 1;  // result
+    size_t pending_normals = 0;  // result
+    glm::vec2 gradient_range = glm::vec2(0.0f);  // result, of the overlay
+    HermiteStats hermite_stats;  // result
+  };
+  std::shared_ptr<const SurfaceLayout> surface_layout;
+  std::shared_ptr<const SurfaceMesh> surface_mesh;
+  // meshes are reused once no snapshot refers to them anymore
+  std::vector<std::shared_ptr<SurfaceMesh>> mesh_pool;
+  std::shared_ptr<SurfaceMesh> recycledMesh();
+  std::unique_ptr<BackgroundWorker<MeshJob>> mesh_worker;
+  MeshJob finished_mesh_job;
+  uint64_t mesh_version = 0;
+  float mesh_t = 0.0f;
+  bool mesh_invalid = false;
+  size_t stale_blocks = 0;
+  // a graph being refined gets a job every update step
+  double refine_budget = 0.008;
+  size_t pending_samples = 0;
+  int pending_stride = 1;
+  // gradient overlay, its arrows come with the mesh
+  bool quiver = false;
+  glm::vec2 gradient_range = glm::vec2(0.0f);
+  // split view: the graph on the left, the heat map of the same heights on
+  // the right
+  bool heat_map = false;
+  // the graph is shaded from the gradients of the normal map rather than from
+  // the normals of its vertices; off for timed functions and surrogates, whose
+  // gradients change with every graph
+  bool normal_mapping = true;
+  size_t pending_normals = 0;
+  // the graph is reconstructed from Hermite patches, with the normals of its
+  // vertices: the normal map would evaluate the gradients at every texel
+  bool hermite = false;
+  HermiteStats hermite_stats;
+  double last_refresh_time = 0.0;
+  void setSurfaceLayout(SurfaceLayout::Mode mode);
 
-  Shader vertexShaderText;
-  Shader fragmentShaderText;
-  ShaderProgram shaderProgramText;
+  // used by the mesh job only
+  glm::vec3 last_graph_position = glm::vec3(0.0, 0.0, 0.0);
+  std::vector<float> graph_heights;
+  std::unique_ptr<ThreadPool> graph_pool;
+  std::unique_ptr<ProgressiveGrid> progressive_grid;
+  std::unique_ptr<HermiteGrid> hermite_grid;  // when the gradient is given
+  bool graph_hermite = false;  // the heights of the previous graph came from it
+  std::shared_ptr<const SlicePlane> graph_slice;  // of the samples above
+  std::shared_ptr<const SurrogateModel> graph_surrogate;  // of the samples above
+  std::unique_ptr<QuiverField> quiver_field;
+  float quiver_t = 0.0f;
+  std::unique_ptr<NormalMap> normal_map;
+  std::unique_ptr<SurfaceStream> surface_stream;  // of the timed function
+  void createGraph(MeshJob& job);
+  void streamGraph(MeshJob& job, float diff, int i0, int j0);
+  // changed(x0, y0, x1, y1) tells whether heights of the rectangle changed
+  // since the previous graph, whose tiles are copied otherwise
+  void assembleGraph(MeshJob& job, const float* heights, int i0, int j0, float diff, bool reuse,
+                     const std::function<bool(int, int, int, int)>& changed);
+  // gradients of the function of the job, from central differences with step
+  // when the gradient is not given; thread safe
+  void evaluateGradients(const MeshJob& job, float step, const glm::vec2* points, glm::vec2* out, size_t count);
 
-  // shader matrix uniform
-  glm::mat4 projection = glm::mat4(1.0);
-  glm::mat4 view = glm::mat4(1.0);
+  // Render thread: owns the GL context and talks to GLFW.
+  InputState input;  // kept up to date by the GLFW callbacks
+  static void onKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+  static void onMouseButton(GLFWwindow* window, int button, int action, int mods);
+  static void onCursorPos(GLFWwindow* window, double x, double y);
+  void inputEvent();
+
+  // input to photon latency: an event is on screen once the first frame
+  // built from it has been swapped
+  static constexpr size_t max_pending_events = 1024;
+  std::pair<uint64_t, double> pending_events[max_pending_events];  // sequence, time
+  size_t pending_first = 0, pending_count = 0;
+  std::vector<double> presented_events;  // times, swapped after the last loop()
+  struct FrameStatistics {
+    double window_start = 0.0;
+    int frames = 0;
+    uint64_t first_update = 0;
+    int latency_count = 0;
+    double latency_sum = 0.0, latency_max = 0.0;
+    uint64_t frame_allocations = 0, update_allocations = 0;  // most in one
+    TextBuffer<192> text;
+  } statistics;
+  double last_frame_time = 0.0;
+  uint64_t frames_drawn = 0;
+  bool exit_after_first_frame = false;
+  void measureFrame(double now, const FrameSnapshot& frame);
+
+  // temporaries of the frame being drawn
+  FrameArena frame_arena{1 << 20};
+
+  // graph buffers of the snapshot drawn last. The graph is drawn from one of
+  // two vertex buffers while the other receives the tiles that changed since
+  // it was filled, so an upload never waits for the draw of the last frame.
+  struct SurfaceBuffer {
+    GLuint vao, vbo;
+    std::shared_ptr<const SurfaceLayout> layout;
+    uint64_t version = 0;  // of the mesh it holds, 0 when empty
+  };
+  SurfaceBuffer surface_buffers[2];
+  int surface_front = 0;
+  void uploadMesh(const SurfaceMesh& mesh);
+  std::shared_ptr<const SurfaceLayout> uploaded_layout;
+  std::shared_ptr<const SurfaceMesh> uploaded_mesh;
+  std::shared_ptr<const std::vector<VertexType>> uploaded_boxes;
+  std::vector<GLsizei> surface_counts;
+  std::vector<const GLvoid*> surface_offsets;
+  std::vector<GLint> surface_base_vertices;
+  void uploadLayout(std::shared_ptr<const SurfaceLayout> layout);
+  void createBuffers();
+
+  // part of the helper index buffer drawn with one call
+  struct DrawRange {
+    GLenum mode;
+    GLsizei count;
+    size_t offset;  // in bytes
+  };
+  DrawRange axes_range, point_axes_range, sphere_range;
+  void drawHelper(const DrawRange& range);
+
+  // glyphs baked at build time, in one texture
+  FontAtlas font;
+  GLuint font_texture = 0;
+  void loadFont();
+  void renderText(const char* text, float x, float y, float sx, float sy);
+
+  // shader, loaded from the program binary cache when possible
+  ShaderProgram shaderProgram;
+  ShaderProgram shaderProgramText;
+  ShaderProgram shaderProgramArrows;
+  ShaderProgram shaderProgramHeatMap;
+  ShaderProgram shaderProgramPopulation;
 
   // VBO/VAO/ibo
-  GLuint vao, vbo, ibo, vbotext, vaotext, ibotext;
+  GLuint ibo, vbotext, vaotext, ibotext;
+  GLuint vaohelpers, vbohelpers, ibohelpers;
+  GLuint vaoboxes = 0, vboboxes = 0;
+  GLuint vaocritical, vbocritical;
+  std::shared_ptr<const std::vector<VertexType>> uploaded_critical;
+  GLsizei critical_vertices = 0;
+  GLuint vaotrajectory, vbotrajectory;
+  // gradient arrows, one instance each; needs instanced arrays
+  bool instancing = false;
+  GLuint vaoarrows = 0, vboarrowshape = 0, vboarrows = 0;
+  GLsizei arrow_count = 0;
+  static constexpr GLsizei arrow_vertices = 9;
+  // population of an optimizer: the helper sphere, one instance per member
+  GLuint vaopopulation = 0, vbopopulation = 0;
+  std::shared_ptr<const std::vector<glm::vec4>> uploaded_population;
+  GLsizei population_count = 0;
+  GLsizei search_box_vertices = 0;
+  // heat map: the heights of the mesh in a float texture, drawn without
+  // vertex attributes, with the trajectory over it
+  GLuint vaoheatmap = 0, heat_texture = 0;
+  int heat_samples = 0;
+  void uploadHeatMap(const SurfaceMesh& mesh);
+  void drawHeatMap(const FrameSnapshot& frame, int x, int width, int height);
+  // normal map: two half floats per texel, on texture unit 1 while the graph
+  // is drawn; the blocks whose version differs from the uploaded one are
+  // replaced
+  GLuint normal_texture = 0;
+  int normal_side = 0;
+  std::vector<uint64_t> normal_uploaded;
+  void uploadNormalMap(const SurfaceMesh& mesh);
 };
 
 #endif  // OPENGL_CMAKE_SKELETON_MYAPPLICATION
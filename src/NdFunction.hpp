@@ -0,0 +1,53 @@
+#ifndef NDFUNCTION_HPP
+#define NDFUNCTION_HPP
+
+#include <VectorKernels.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Function of n parameters. Points, gradients and directions are contiguous
+// arrays of n doubles. Second derivatives are only used through Hessian-vector
+// products, so no n x n matrix is ever formed.
+struct NdFunction {
+  using value_t = std::function<double(const double* x)>;
+  using gradient_t = std::function<void(const double* x, double* gradient)>;
+  using hessian_vector_t = std::function<void(const double* x, const double* v, double* product)>;
+
+  size_t dimension = 0;
+  value_t value;
+  std::optional<gradient_t> gradient;
+  // H(x) v, approximated with the gradient when absent
+  std::optional<hessian_vector_t> hessian_vector;
+
+  // H(x) v written to product, scratch holds the temporaries of the
+  // approximation; needs the gradient when hessian_vector is absent
+  void hessianVector(const double* x, const double* v, double* product, std::vector<double>& scratch) const {
+    if (hessian_vector) {
+      (*hessian_vector)(x, v, product);
+      return;
+    }
+    // forward difference of the gradient along v
+    size_t n = dimension;
+    double length = norm(v, n);
+    if (length == 0.0) {
+      std::fill(product, product + n, 0.0);
+      return;
+    }
+    double h = std::sqrt(1e-16) * std::max(1.0, norm(x, n)) / length;
+    scratch.resize(2 * n);
+    double* shifted = scratch.data();
+    double* base = shifted + n;
+    std::copy(x, x + n, shifted);
+    axpy(h, v, shifted, n);
+    (*gradient)(shifted, product);
+    (*gradient)(x, base);
+    axpy(-1.0, base, product, n);
+    scale(1.0 / h, product, n);
+  }
+};
+
+#endif // NDFUNCTION_HPP
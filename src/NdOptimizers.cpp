@@ -0,0 +1,72 @@
+#include "NdOptimizers.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+NdGradientDescent::NdGradientDescent(NdFunction function, double step_size)
+    : function(std::move(function)), step_size(step_size) {
+  if (!this->function.gradient)
+    throw std::invalid_argument("NdGradientDescent: the function has no gradient");
+  x.resize(this->function.dimension);
+  gradient.resize(this->function.dimension);
+}
+
+void NdGradientDescent::reset(const double* start) {
+  std::copy(start, start + x.size(), x.begin());
+}
+
+const std::vector<double>& NdGradientDescent::step() {
+  (*function.gradient)(x.data(), gradient.data());
+  axpy(-step_size, gradient.data(), x.data(), x.size());
+  return x;
+}
+
+NdNewtonCG::NdNewtonCG(NdFunction function, size_t max_iterations, double tolerance)
+    : function(std::move(function)), max_iterations(max_iterations), tolerance(tolerance) {
+  if (!this->function.gradient)
+    throw std::invalid_argument("NdNewtonCG: the function has no gradient");
+  size_t n = this->function.dimension;
+  if (this->max_iterations == 0)
+    this->max_iterations = std::min<size_t>(n, 100);
+  for (auto *v : {&x, &gradient, &p, &r, &d, &hd})
+    v->resize(n);
+}
+
+void NdNewtonCG::reset(const double* start) {
+  std::copy(start, start + x.size(), x.begin());
+}
+
+const std::vector<double>& NdNewtonCG::step() {
+  const size_t n = x.size();
+  (*function.gradient)(x.data(), gradient.data());
+
+  // solve H p = -g from p = 0
+  std::fill(p.begin(), p.end(), 0.0);
+  std::copy(gradient.begin(), gradient.end(), r.begin());
+  scale(-1.0, r.data(), n);
+  std::copy(r.begin(), r.end(), d.begin());
+  double rr = dot(r.data(), r.data(), n);
+  double stop = tolerance * tolerance * rr;
+  last_iterations = 0;
+  while (last_iterations < max_iterations && rr > stop) {
+    function.hessianVector(x.data(), d.data(), hd.data(), scratch);
+    double curvature = dot(d.data(), hd.data(), n);
+    ++last_iterations;
+    if (curvature <= 0.0) {
+      // not a descent direction of the quadratic model
+      if (last_iterations == 1)
+        std::copy(d.begin(), d.end(), p.begin());
+      break;
+    }
+    double alpha = rr / curvature;
+    axpy(alpha, d.data(), p.data(), n);
+    axpy(-alpha, hd.data(), r.data(), n);
+    double next_rr = dot(r.data(), r.data(), n);
+    // d = r + beta d
+    scale(next_rr / rr, d.data(), n);
+    axpy(1.0, r.data(), d.data(), n);
+    rr = next_rr;
+  }
+  axpy(1.0, p.data(), x.data(), n);
+  return x;
+}
@@ -0,0 +1,58 @@
+#ifndef NDOPTIMIZERS_HPP
+#define NDOPTIMIZERS_HPP
+
+#include <NdFunction.hpp>
+#include <string>
+#include <vector>
+
+// Optimizers of NdFunction over the contiguous array of the iterate. Their
+// work per step is a few gradients and Hessian-vector products plus O(n)
+// vector kernels, so they scale to thousands of parameters.
+class NdOptimizer {
+public:
+  virtual ~NdOptimizer() = default;
+  virtual void reset(const double* start) = 0;
+  // one iteration, returns the new iterate
+  virtual const std::vector<double>& step() = 0;
+  virtual std::string toString() = 0;
+};
+
+class NdGradientDescent : public NdOptimizer {
+public:
+  NdGradientDescent(NdFunction function, double step_size);
+
+  void reset(const double* start) override;
+  const std::vector<double>& step() override;
+  std::string toString() override { return "Gradient Descent"; }
+
+private:
+  NdFunction function;
+  double step_size;
+  std::vector<double> x, gradient;
+};
+
+// Newton's method that solves H p = -g by conjugate gradients on
+// Hessian-vector products. CG stops at a tolerance relative to |g| or at a
+// direction of negative curvature; the first direction then is -g, so every
+// step descends.
+class NdNewtonCG : public NdOptimizer {
+public:
+  // max_iterations of CG per step, 0 for min(n, 100)
+  NdNewtonCG(NdFunction function, size_t max_iterations = 0, double tolerance = 1e-6);
+
+  void reset(const double* start) override;
+  const std::vector<double>& step() override;
+  std::string toString() override { return "Newton-CG"; }
+
+  // CG iterations of the last step
+  size_t lastIterations() const { return last_iterations; }
+
+private:
+  NdFunction function;
+  size_t max_iterations;
+  double tolerance;
+  size_t last_iterations = 0;
+  std::vector<double> x, gradient, p, r, d, hd, scratch;
+};
+
+#endif // NDOPTIMIZERS_HPP
@@ -0,0 +1,153 @@
+#include "NormalMap.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+// the texel of lattice point a, also for negative a
+int wrap(int a, int side) {
+  int s = a % side;
+  return s < 0 ? s + side : s;
+}
+
+} // namespace
+
+NormalMap::NormalMap(ThreadPool& pool) : pool(pool) {}
+
+void NormalMap::markStale(int x, int y) {
+  uint8_t& state = states[size_t(y) * texture_side + x];
+  size_t b = size_t(y / block) * blocks + x / block;
+  inexact[b] += state == Exact;
+  stale[b] = 1;
+  state = Stale;
+}
+
+void NormalMap::moveTo(int grid, int level, float unit, int a0, int b0) {
+  bool reuse = valid && grid == this->grid && level == this->level && unit == this->unit;
+  int old_a0 = this->a0, old_b0 = this->b0;
+  this->grid = grid;
+  this->level = level;
+  this->unit = unit;
+  this->a0 = a0;
+  this->b0 = b0;
+  texel_spacing = level * unit / factor;
+  if (!reuse) {
+    // a margin of a texel around the graph, for the filtering at its border
+    texture_side = (factor * grid + 3 + block - 1) / block * block;
+    blocks = texture_side / block;
+    gradients.assign(size_t(texture_side) * texture_side, glm::vec2(0.0f));
+    states.assign(gradients.size(), Stale);
+    versions.assign(size_t(blocks) * blocks, 0);
+    inexact.assign(versions.size(), block * block);
+    stale.assign(versions.size(), 1);
+    valid = true;
+    return;
+  }
+  // a texel keeps its gradient when its lattice point was in view before,
+  // the rows and columns that came into view are stale
+  const int side = texture_side;
+  auto kept = [side](int s, int first, int old_first) {
+    int a = first + wrap(s - first, side);
+    return a >= old_first && a < old_first + side;
+  };
+  for (int y = 0; y < side; ++y) {
+    if (!kept(y, b0, old_b0)) {
+      for (int x = 0; x < side; ++x)
+        markStale(x, y);
+      continue;
+    }
+    for (int x = 0; x < side; ++x)
+      if (!kept(x, a0, old_a0))
+        markStale(x, y);
+  }
+}
+
+void NormalMap::update(int grid, int level, float unit, int i0, int j0, const float* heights,
+                       const gradient_t& gradient, double budget, uint64_t version) {
+  int a0 = factor * i0 - 1, b0 = factor * j0 - 1;
+  if (!valid || grid != this->grid || level != this->level || unit != this->unit || a0 != this->a0 || b0 != this->b0)
+    moveTo(grid, level, unit, a0, b0);
+
+  // the stale texels take the slope between the heights of the vertices
+  // around them, interpolated bilinearly
+  const int side = texture_side, n = grid + 2;
+  const float diff = level * unit;
+  auto slope = [&](int x, int y) {
+    float h = heights[y * n + x];
+    return glm::vec2(heights[y * n + x + 1] - h, heights[(y + 1) * n + x] - h) / diff;
+  };
+  missing.clear();
+  for (int b = 0; b < blocks * blocks; ++b) {
+    if (stale[b]) {
+      stale[b] = 0;
+      versions[b] = version;
+      int bx = b % blocks, by = b / blocks;
+      for (int y = by * block; y < (by + 1) * block; ++y)
+        for (int x = bx * block; x < (bx + 1) * block; ++x) {
+          uint8_t& state = states[size_t(y) * side + x];
+          if (state != Stale)
+            continue;
+          state = Slope;
+          // the lattice point of the texel, in quads of the graph from (i0, j0)
+          int a = a0 + wrap(x - a0, side), c = b0 + wrap(y - b0, side);
+          float u = std::clamp(float(a) / factor - i0, 0.0f, float(grid));
+          float v = std::clamp(float(c) / factor - j0, 0.0f, float(grid));
+          int cx = std::min(int(u), grid - 1), cy = std::min(int(v), grid - 1);
+          u -= cx;
+          v -= cy;
+          gradients[size_t(y) * side + x] =
+            (1.0f - v) * ((1.0f - u) * slope(cx, cy) + u * slope(cx + 1, cy)) +
+            v * ((1.0f - u) * slope(cx, cy + 1) + u * slope(cx + 1, cy + 1));
+        }
+    }
+    if (inexact[b])
+      missing.push_back(uint32_t(b));
+  }
+  // the blocks under the center of the graph first
+  int center = wrap(a0 + side / 2, side) / block, middle = wrap(b0 + side / 2, side) / block;
+  auto distance = [&](uint32_t b) {
+    int dx = std::abs(int(b % blocks) - center), dy = std::abs(int(b / blocks) - middle);
+    return std::min(dx, blocks - dx) + std::min(dy, blocks - dy);
+  };
+  std::sort(missing.begin(), missing.end(), [&](uint32_t p, uint32_t q) { return distance(p) < distance(q); });
+
+  auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+  std::atomic<size_t> next{0};
+  std::atomic<uint64_t> count{0};
+  if (!missing.empty())
+    pool.parallelFor(0, pool.size(), [&](size_t) {
+      glm::vec2 points[block * block], results[block * block];
+      uint32_t indices[block * block];
+      while (std::chrono::steady_clock::now() < deadline) {
+        size_t k = next.fetch_add(1);
+        if (k >= missing.size())
+          return;
+        int bx = missing[k] % blocks, by = missing[k] / blocks;
+        size_t m = 0;
+        for (int y = by * block; y < (by + 1) * block; ++y)
+          for (int x = bx * block; x < (bx + 1) * block; ++x) {
+            size_t i = size_t(y) * side + x;
+            if (states[i] == Exact)
+              continue;
+            indices[m] = uint32_t(i);
+            points[m++] = texel_spacing * glm::vec2(a0 + wrap(x - a0, side), b0 + wrap(y - b0, side));
+          }
+        gradient(points, results, m);
+        for (size_t j = 0; j < m; ++j) {
+          gradients[indices[j]] = results[j];
+          states[indices[j]] = Exact;
+        }
+        inexact[missing[k]] = 0;
+        versions[missing[k]] = version;
+        count += m;
+      }
+    });
+  evaluated += count;
+
+  pending = 0;
+  for (uint32_t b : missing)
+    pending += inexact[b];
+}
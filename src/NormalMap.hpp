@@ -0,0 +1,76 @@
+#ifndef NORMALMAP_HPP
+#define NORMALMAP_HPP
+
+#include <ThreadPool.hpp>
+#include <utils.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Gradients of the graph on a lattice factor times finer than its vertices,
+// the texels of the normal map the graph is shaded with. The texels wrap
+// around: lattice point (a, b) is texel (a mod side, b mod side), so a pan
+// keeps every texel still in view where it is and only the new rows and
+// columns are evaluated and uploaded. Texels are evaluated block by block on
+// the threads of a pool within a budget; the ones not evaluated yet take the
+// slope between the heights of the vertices around them.
+class NormalMap {
+public:
+  static constexpr int factor = 4;
+  static constexpr int block = 32;  // texels per side of a block
+
+  using gradient_t = std::function<void(const glm::vec2* points, glm::vec2* gradients, size_t count)>;
+
+  explicit NormalMap(ThreadPool& pool);
+
+  NormalMap(const NormalMap&) = delete;
+  NormalMap& operator=(const NormalMap&) = delete;
+
+  // the texels over the graph of grid x grid quads at the lattice points
+  // (i0, j0) + (x, y) of spacing level * unit, whose (grid + 2)^2 heights are
+  // given; gradient is called on the threads of the pool until the budget
+  // (in seconds) is spent. Blocks that change get version.
+  void update(int grid, int level, float unit, int i0, int j0, const float* heights,
+              const gradient_t& gradient, double budget, uint64_t version);
+  // the texels are evaluated anew by the next update, e.g. after the function changed
+  void invalidate() { valid = false; }
+
+  int side() const { return texture_side; }
+  // of the lattice of the texels
+  float spacing() const { return texel_spacing; }
+  // side x side gradients, row by row
+  const std::vector<glm::vec2>& texels() const { return gradients; }
+  // version of every block, row by row, that last changed its texels
+  const std::vector<uint64_t>& blockVersions() const { return versions; }
+  // texels of the graph not evaluated yet
+  size_t pendingCount() const { return pending; }
+  // gradients evaluated by all update() calls so far
+  uint64_t evaluatedCount() const { return evaluated; }
+
+private:
+  ThreadPool& pool;
+
+  int grid = 0, level = 0;
+  float unit = 0.0f;
+  int a0 = 0, b0 = 0;  // lattice point of the first texel in view
+  int texture_side = 0, blocks = 0;
+  float texel_spacing = 0.0f;
+  bool valid = false;
+  size_t pending = 0;
+  uint64_t evaluated = 0;
+
+  enum State : uint8_t { Stale, Slope, Exact };  // Slope: taken from the heights
+
+  std::vector<glm::vec2> gradients;
+  std::vector<uint8_t> states;
+  std::vector<uint64_t> versions;
+  // of every block: the texels not exact, whether some are stale
+  std::vector<uint32_t> inexact;
+  std::vector<uint8_t> stale;
+  std::vector<uint32_t> missing;  // blocks with texels not evaluated, nearest to the center first
+
+  void moveTo(int grid, int level, float unit, int a0, int b0);
+  void markStale(int x, int y);
+};
+
+#endif // NORMALMAP_HPP
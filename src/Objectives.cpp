@@ -0,0 +1,97 @@
+#include "Objectives.hpp"
+
+#include <cmath>
+#include <vector>
+
+Objective defaultObjective() {
+  // written for any number type, the same expressions on intervals give the
+  // interval extensions used by the global search
+  auto objective = [](auto x, auto y) {
+    return 0.0001f * pow(x, 4) + 0.0001f * pow(y, 4) + sin(x + y);
+  };
+  auto objective_dx = [](auto x, auto y) {
+    return 0.0001f * 4 * pow(x, 3) + cos(x + y);
+  };
+  auto objective_dy = [](auto x, auto y) {
+    return 0.0001f * 4 * pow(y, 3) + cos(x + y);
+  };
+
+  Objective result;
+  result.function = [objective](glm::vec2 position) {
+    return objective(position.x, position.y);
+  };
+  result.gradient = [objective_dx, objective_dy](glm::vec2 position) {
+    return glm::vec2(objective_dx(position.x, position.y), objective_dy(position.x, position.y));
+  };
+  result.hessian = [](glm::vec2 position) {
+    return glm::mat2(
+      0.0001f * 12.0 * pow(position.x, 2) - sin(position.x + position.y),
+      -sin(position.x + position.y),
+      -sin(position.x + position.y),
+      0.0001f * 12.0 * pow(position.y, 2) - sin(position.x + position.y)
+    );
+  };
+  result.interval_function = [objective](Interval x, Interval y) {
+    return objective(x, y);
+  };
+  result.interval_gradient = [objective_dx, objective_dy](Interval x, Interval y) {
+    return std::array<Interval, 2>{objective_dx(x, y), objective_dy(x, y)};
+  };
+  return result;
+}
+
+TimedFunction waveObjective() {
+  TimedFunction wave;
+  wave.value = [](glm::vec2 p, float t) {
+    return 0.0001f * pow(p.x, 4) + 0.0001f * pow(p.y, 4) + sin(p.x + p.y + t);
+  };
+  wave.gradient = [](glm::vec2 p, float t) {
+    return glm::vec2(0.0001f * 4 * pow(p.x, 3) + cos(p.x + p.y + t), 0.0001f * 4 * pow(p.y, 3) + cos(p.x + p.y + t));
+  };
+  wave.hessian = [](glm::vec2 p, float t) {
+    float s = sin(p.x + p.y + t);
+    return glm::mat2(0.0001f * 12.0f * p.x * p.x - s, -s, -s, 0.0001f * 12.0f * p.y * p.y - s);
+  };
+  return wave;
+}
+
+NdFunction neighborObjective(size_t n) {
+  NdFunction function;
+  function.dimension = n;
+  function.value = [n](const double* x) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+      sum += 0.0001 * std::pow(x[i], 4);
+    for (size_t i = 0; i + 1 < n; ++i)
+      sum += std::sin(x[i] + x[i + 1]);
+    return sum;
+  };
+  function.gradient = [n](const double* x, double* gradient) {
+    for (size_t i = 0; i < n; ++i)
+      gradient[i] = 0.0004 * std::pow(x[i], 3);
+    for (size_t i = 0; i + 1 < n; ++i) {
+      double c = std::cos(x[i] + x[i + 1]);
+      gradient[i] += c;
+      gradient[i + 1] += c;
+    }
+  };
+  function.hessian_vector = [n](const double* x, const double* v, double* product) {
+    for (size_t i = 0; i < n; ++i)
+      product[i] = 0.0012 * x[i] * x[i] * v[i];
+    for (size_t i = 0; i + 1 < n; ++i) {
+      double s = std::sin(x[i] + x[i + 1]) * (v[i] + v[i + 1]);
+      product[i] -= s;
+      product[i + 1] -= s;
+    }
+  };
+  return function;
+}
+
+func_t firstAxes(NdFunction function) {
+  return [nd = std::move(function)](glm::vec2 p) {
+    std::vector<double> x(nd.dimension, 0.0);
+    x[0] = p.x;
+    x[1] = p.y;
+    return float(nd.value(x.data()));
+  };
+}
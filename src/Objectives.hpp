@@ -0,0 +1,37 @@
+#ifndef OBJECTIVES_HPP
+#define OBJECTIVES_HPP
+
+#include <utils.hpp>
+#include <Animation.hpp>
+#include <Interval.hpp>
+#include <NdFunction.hpp>
+#include <optional>
+
+// A function of the plane with what is known about it: the derivatives and
+// the batch entry point when given, the interval extensions for the global
+// search and the critical points
+struct Objective {
+  func_t function;
+  std::optional<grad_t> gradient;
+  std::optional<hess_t> hessian;
+  std::optional<batch_t> batch;
+  std::optional<interval_func_t> interval_function;
+  std::optional<interval_grad_t> interval_gradient;
+};
+
+// the function shown when no plugin is given:
+//   f(x, y) = 0.0001 x^4 + 0.0001 y^4 + sin(x + y)
+Objective defaultObjective();
+
+// a wave moving over the default objective, the same at t = 0
+TimedFunction waveObjective();
+
+// the default objective summed over neighboring coordinates, in n dimensions:
+//   f(x) = sum 0.0001 x_i^4 + sum sin(x_i + x_i+1)
+// which is the same function for n = 2
+NdFunction neighborObjective(size_t n);
+
+// the plane of the first two axes of an N-D function, through the origin
+func_t firstAxes(NdFunction function);
+
+#endif // OBJECTIVES_HPP
@@ -0,0 +1,174 @@
+#include "Plugin.hpp"
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float), "points are passed to plugins as float pairs");
+
+struct Plugin::Library {
+  void* handle = nullptr;
+  std::string copy_path;
+  fgi_value_t value = nullptr;
+  fgi_gradient_t gradient = nullptr;
+  fgi_hessian_t hessian = nullptr;
+  fgi_value_batch_t value_batch = nullptr;
+  fgi_value_at_t value_at = nullptr;
+  fgi_gradient_at_t gradient_at = nullptr;
+  fgi_hessian_at_t hessian_at = nullptr;
+  fgi_value_batch_at_t value_batch_at = nullptr;
+
+  ~Library() {
+    if (handle)
+      dlclose(handle);
+    if (!copy_path.empty())
+      unlink(copy_path.c_str());
+  }
+};
+
+Plugin::Plugin(std::string path) : path(path) {
+  version = fileVersion(path);
+  libraries.push_back(load());
+  library.store(libraries.back().get(), std::memory_order_release);
+}
+
+Plugin::~Plugin() = default;
+
+std::optional<Plugin::FileVersion> Plugin::fileVersion(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return std::nullopt;
+  return FileVersion{st.st_mtim.tv_sec, st.st_mtim.tv_nsec, uint64_t(st.st_size), uint64_t(st.st_ino)};
+}
+
+std::unique_ptr<const Plugin::Library> Plugin::load() {
+  // dlopen hands out the already loaded library for a known path, so every
+  // load goes through a fresh copy of the file
+  auto lib = std::make_unique<Library>();
+  lib->copy_path = (std::filesystem::temp_directory_path() /
+                    ("graphs-plugin-" + std::to_string(getpid()) + "-" + std::to_string(loads++) + ".so"))
+                       .string();
+  std::error_code error;
+  std::filesystem::copy_file(path, lib->copy_path, std::filesystem::copy_options::overwrite_existing, error);
+  if (error) {
+    lib->copy_path.clear();
+    throw std::runtime_error("Plugin: could not copy " + path + ": " + error.message());
+  }
+
+  lib->handle = dlopen(lib->copy_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!lib->handle)
+    throw std::runtime_error(std::string("Plugin: ") + dlerror());
+
+  auto version = reinterpret_cast<fgi_abi_version_t>(dlsym(lib->handle, "fgi_abi_version"));
+  if (!version || version() != FGI_PLUGIN_ABI_VERSION)
+    throw std::runtime_error("Plugin: " + path + " was not built for ABI version " +
+                             std::to_string(FGI_PLUGIN_ABI_VERSION));
+  lib->value = reinterpret_cast<fgi_value_t>(dlsym(lib->handle, "fgi_value"));
+  if (!lib->value)
+    throw std::runtime_error("Plugin: " + path + " does not export fgi_value");
+  lib->gradient = reinterpret_cast<fgi_gradient_t>(dlsym(lib->handle, "fgi_gradient"));
+  lib->hessian = reinterpret_cast<fgi_hessian_t>(dlsym(lib->handle, "fgi_hessian"));
+  lib->value_batch = reinterpret_cast<fgi_value_batch_t>(dlsym(lib->handle, "fgi_value_batch"));
+  lib->value_at = reinterpret_cast<fgi_value_at_t>(dlsym(lib->handle, "fgi_value_at"));
+  lib->gradient_at = reinterpret_cast<fgi_gradient_at_t>(dlsym(lib->handle, "fgi_gradient_at"));
+  lib->hessian_at = reinterpret_cast<fgi_hessian_at_t>(dlsym(lib->handle, "fgi_hessian_at"));
+  lib->value_batch_at = reinterpret_cast<fgi_value_batch_at_t>(dlsym(lib->handle, "fgi_value_batch_at"));
+  return lib;
+}
+
+bool Plugin::reloadIfChanged() {
+  std::optional<FileVersion> changed = fileVersion(path);
+  if (!changed || changed == version)
+    return false;
+  version = changed;
+
+  try {
+    auto lib = load();
+    const Library* old = current();
+    if ((old->gradient && !lib->gradient) || (old->hessian && !lib->hessian) ||
+        (old->value_at && !lib->value_at) || (old->gradient_at && !lib->gradient_at) ||
+        (old->hessian_at && !lib->hessian_at))
+      throw std::runtime_error("Plugin: " + path + " lost an entry point, keeping the loaded version");
+    libraries.push_back(std::move(lib));
+    library.store(libraries.back().get(), std::memory_order_release);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
+  std::cout << "[Info] Reloaded plugin " << path << std::endl;
+  return true;
+}
+
+func_t Plugin::function() const {
+  return [this](glm::vec2 p) { return current()->value(p.x, p.y); };
+}
+
+std::optional<grad_t> Plugin::gradient() const {
+  if (!current()->gradient)
+    return std::nullopt;
+  return [this](glm::vec2 p) {
+    glm::vec2 g;
+    current()->gradient(p.x, p.y, &g.x);
+    return g;
+  };
+}
+
+std::optional<hess_t> Plugin::hessian() const {
+  if (!current()->hessian)
+    return std::nullopt;
+  return [this](glm::vec2 p) {
+    float h[4];
+    current()->hessian(p.x, p.y, h);
+    return glm::mat2(h[0], h[1], h[2], h[3]);
+  };
+}
+
+batch_t Plugin::batch() const {
+  return {&Plugin::batchEntry, this};
+}
+
+std::optional<TimedFunction> Plugin::timedFunction() const {
+  const Library* lib = current();
+  if (!lib->value_at)
+    return std::nullopt;
+  TimedFunction timed;
+  timed.value = [this](glm::vec2 p, float t) { return current()->value_at(p.x, p.y, t); };
+  if (lib->gradient_at)
+    timed.gradient = [this](glm::vec2 p, float t) {
+      glm::vec2 g;
+      current()->gradient_at(p.x, p.y, t, &g.x);
+      return g;
+    };
+  if (lib->hessian_at)
+    timed.hessian = [this](glm::vec2 p, float t) {
+      float h[4];
+      current()->hessian_at(p.x, p.y, t, h);
+      return glm::mat2(h[0], h[1], h[2], h[3]);
+    };
+  timed.batch = timed_batch_t{&Plugin::timedBatchEntry, this};
+  return timed;
+}
+
+void Plugin::timedBatchEntry(const void* context, const glm::vec2* points, float t, float* values, size_t count) {
+  const Library* lib = static_cast<const Plugin*>(context)->current();
+  if (lib->value_batch_at) {
+    lib->value_batch_at(reinterpret_cast<const float*>(points), t, values, count);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+    values[i] = lib->value_at(points[i].x, points[i].y, t);
+}
+
+void Plugin::batchEntry(const void* context, const glm::vec2* points, float* values, size_t count) {
+  const Library* lib = static_cast<const Plugin*>(context)->current();
+  if (lib->value_batch) {
+    lib->value_batch(reinterpret_cast<const float*>(points), values, count);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+    values[i] = lib->value(points[i].x, points[i].y);
+}
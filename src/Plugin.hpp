@@ -0,0 +1,70 @@
+#ifndef PLUGIN_HPP
+#define PLUGIN_HPP
+
+#include <utils.hpp>
+#include <Animation.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "PluginAbi.h"
+
+// Function loaded from a shared object implementing PluginAbi.h. The library
+// can be reloaded when the file changes. The functions returned below refer to
+// the plugin, which has to outlive them, and always call the latest library.
+class Plugin {
+public:
+  explicit Plugin(std::string path);
+  ~Plugin();
+
+  Plugin(const Plugin&) = delete;
+  Plugin& operator=(const Plugin&) = delete;
+
+  // reload when the file was modified since the last attempt, a library that
+  // fails to load or lacks an entry point of the current one is rejected and
+  // the current one stays; returns true when the library was replaced
+  bool reloadIfChanged();
+
+  const std::string& getPath() const { return path; }
+
+  func_t function() const;
+  std::optional<grad_t> gradient() const;
+  std::optional<hess_t> hessian() const;
+  batch_t batch() const;
+  // when the plugin exports fgi_value_at
+  std::optional<TimedFunction> timedFunction() const;
+
+private:
+  struct Library;
+  // tells a rebuilt file apart even within the second of the last load
+  struct FileVersion {
+    int64_t seconds = 0, nanoseconds = 0;
+    uint64_t size = 0, inode = 0;
+
+    bool operator==(const FileVersion& other) const {
+      return seconds == other.seconds && nanoseconds == other.nanoseconds && size == other.size &&
+             inode == other.inode;
+    }
+  };
+
+  std::string path;
+  std::optional<FileVersion> version;
+  unsigned loads = 0;
+  // every version loaded so far, the last one is current; the functions
+  // call through a plain pointer to it, as the reloads come while no
+  // worker evaluates, and an older one stays loaded for a call still running
+  std::vector<std::unique_ptr<const Library>> libraries;
+  std::atomic<const Library*> library{nullptr};
+
+  static std::optional<FileVersion> fileVersion(const std::string& path);
+  std::unique_ptr<const Library> load();
+  const Library* current() const { return library.load(std::memory_order_acquire); }
+
+  static void batchEntry(const void* context, const glm::vec2* points, float* values, size_t count);
+  static void timedBatchEntry(const void* context, const glm::vec2* points, float t, float* values, size_t count);
+};
+
+#endif // PLUGIN_HPP
@@ -0,0 +1,38 @@
+/*
+ * C interface of function plugins, shared objects loaded with --plugin.
+ *
+ * A plugin exports fgi_value and fgi_abi_version, the other entry points are
+ * optional. Points are (x, y) pairs of floats, a Hessian is written column by
+ * column (fxx, fyx, fxy, fyy) like glm::mat2. Entry points may be called from
+ * several threads at once.
+ *
+ * A function of a parameter t as well (animated with --animate) exports
+ * fgi_value_at, and optionally fgi_gradient_at, fgi_hessian_at and
+ * fgi_value_batch_at; fgi_value is then the function at t = 0.
+ */
+#ifndef PLUGINABI_H
+#define PLUGINABI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FGI_PLUGIN_ABI_VERSION 1
+
+#ifdef __cplusplus
+#define FGI_EXPORT extern "C" __attribute__((visibility("default")))
+#else
+#define FGI_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef uint32_t (*fgi_abi_version_t)(void);
+typedef float (*fgi_value_t)(float x, float y);
+typedef void (*fgi_gradient_t)(float x, float y, float* gradient);
+typedef void (*fgi_hessian_t)(float x, float y, float* hessian);
+typedef void (*fgi_value_batch_t)(const float* points, float* values, size_t count);
+
+typedef float (*fgi_value_at_t)(float x, float y, float t);
+typedef void (*fgi_gradient_at_t)(float x, float y, float t, float* gradient);
+typedef void (*fgi_hessian_at_t)(float x, float y, float t, float* hessian);
+typedef void (*fgi_value_batch_at_t)(const float* points, float t, float* values, size_t count);
+
+#endif /* PLUGINABI_H */
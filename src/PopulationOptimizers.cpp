@@ -0,0 +1,272 @@
+#include "PopulationOptimizers.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+// the value a method ranks, NaN last
+double ranked(float value) {
+  return value == value ? double(value) : kInfinity;
+}
+
+} // namespace
+
+PopulationOptimizer::PopulationOptimizer(func_t function, std::optional<batch_t> batch, ThreadPool* pool,
+                                         PopulationSettings settings)
+    : settings(settings), function(std::move(function)), batch(batch), pool(pool), random(settings.seed) {}
+
+double PopulationOptimizer::uniform() {
+  // 53 random bits
+  uint64_t a = random() >> 5, b = random() >> 6;
+  return (a * 67108864.0 + b) * (1.0 / 9007199254740992.0);
+}
+
+double PopulationOptimizer::normal() {
+  if (spare_normal) {
+    double x = *spare_normal;
+    spare_normal.reset();
+    return x;
+  }
+  // Box-Muller, 1 - uniform() is in (0, 1]
+  double r = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+  double angle = 2.0 * M_PI * uniform();
+  spare_normal = r * std::sin(angle);
+  return r * std::cos(angle);
+}
+
+void PopulationOptimizer::reset(glm::vec2 start) {
+  random.seed(settings.seed);
+  spare_normal.reset();
+  best_point = start;
+  best_value = std::numeric_limits<float>::infinity();
+  evaluations = 0;
+  stats.clear();
+  members.clear();
+  member_values.clear();
+  this->start(start);
+}
+
+glm::vec2 PopulationOptimizer::step() {
+  auto begin = std::chrono::steady_clock::now();
+  ask(candidates);
+  values.resize(candidates.size());
+  evaluate();
+  evaluations += candidates.size();
+  for (size_t i = 0; i < candidates.size(); ++i)
+    if (values[i] < best_value) {
+      best_value = values[i];
+      best_point = candidates[i];
+    }
+  tell(candidates, values);
+  GenerationStats generation;
+  generation.generation = stats.size() + 1;
+  generation.evaluations = evaluations;
+  generation.best = best_value;
+  generation.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  stats.push_back(generation);
+  return best_point;
+}
+
+void PopulationOptimizer::evaluate() {
+  size_t count = candidates.size();
+  size_t parts = pool ? std::min<size_t>(count, pool->size()) : 1;
+  if (parts <= 1) {
+    evaluateBatch(function, batch, candidates.data(), values.data(), count);
+    return;
+  }
+  // a contiguous part of the generation per thread, each in one batch call
+  pool->parallelFor(0, parts, [&](size_t k) {
+    size_t begin = count * k / parts, end = count * (k + 1) / parts;
+    evaluateBatch(function, batch, candidates.data() + begin, values.data() + begin, end - begin);
+  });
+}
+
+size_t PopulationOptimizer::evaluationsTo(float target) const {
+  for (auto &generation : stats)
+    if (generation.best <= target)
+      return generation.evaluations;
+  return 0;
+}
+
+CmaEs::CmaEs(func_t function, std::optional<batch_t> batch, ThreadPool* pool, PopulationSettings settings)
+    : PopulationOptimizer(std::move(function), batch, pool, settings) {
+  const double n = 2.0;
+  // twice the default 4 + 3 ln n of the method, which is small for rugged functions
+  lambda = settings.population ? std::max<size_t>(settings.population, 4) : 12;
+  mu = lambda / 2;
+  weights.resize(mu);
+  for (size_t i = 0; i < mu; ++i)
+    weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+  double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  double squares = 0.0;
+  for (auto &w : weights) {
+    w /= sum;
+    squares += w * w;
+  }
+  mu_eff = 1.0 / squares;
+  c_sigma = (mu_eff + 2.0) / (n + mu_eff + 5.0);
+  d_sigma = 1.0 + 2.0 * std::max(0.0, std::sqrt((mu_eff - 1.0) / (n + 1.0)) - 1.0) + c_sigma;
+  c_c = (4.0 + mu_eff / n) / (n + 4.0 + 2.0 * mu_eff / n);
+  c_1 = 2.0 / ((n + 1.3) * (n + 1.3) + mu_eff);
+  c_mu = std::min(1.0 - c_1, 2.0 * (mu_eff - 2.0 + 1.0 / mu_eff) / ((n + 2.0) * (n + 2.0) + mu_eff));
+  chi_n = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+}
+
+void CmaEs::start(glm::vec2 start) {
+  m[0] = start.x;
+  m[1] = start.y;
+  sigma = settings.spread;
+  C[0][0] = C[1][1] = 1.0;
+  C[0][1] = C[1][0] = 0.0;
+  p_sigma[0] = p_sigma[1] = p_c[0] = p_c[1] = 0.0;
+  generation = 0;
+}
+
+void CmaEs::decompose() {
+  // the eigenvectors of a symmetric 2 x 2 matrix are a rotation
+  double a = C[0][0], b = 0.5 * (C[0][1] + C[1][0]), d = C[1][1];
+  double angle = 0.5 * std::atan2(2.0 * b, a - d);
+  double c = std::cos(angle), s = std::sin(angle);
+  double e1 = a * c * c + 2.0 * b * s * c + d * s * s;
+  double e2 = a * s * s - 2.0 * b * s * c + d * c * c;
+  B[0][0] = c;
+  B[1][0] = s;
+  B[0][1] = -s;
+  B[1][1] = c;
+  D[0] = std::sqrt(std::max(e1, 1e-300));
+  D[1] = std::sqrt(std::max(e2, 1e-300));
+}
+
+void CmaEs::ask(std::vector<glm::vec2>& candidates) {
+  decompose();
+  candidates.resize(lambda);
+  z.resize(lambda);
+  for (size_t k = 0; k < lambda; ++k) {
+    z[k].x = normal();
+    z[k].y = normal();
+    double y0 = B[0][0] * D[0] * z[k].x + B[0][1] * D[1] * z[k].y;
+    double y1 = B[1][0] * D[0] * z[k].x + B[1][1] * D[1] * z[k].y;
+    candidates[k] = glm::vec2(m[0] + sigma * y0, m[1] + sigma * y1);
+  }
+}
+
+void CmaEs::tell(const std::vector<glm::vec2>& candidates, const std::vector<float>& values) {
+  std::vector<size_t> order(lambda);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return ranked(values[a]) < ranked(values[b]); });
+
+  // the weighted mean of the best mu steps, y = B D z
+  double z_w[2] = {0.0, 0.0}, y_w[2] = {0.0, 0.0};
+  std::vector<glm::dvec2> y(mu);
+  for (size_t i = 0; i < mu; ++i) {
+    const glm::dvec2& zi = z[order[i]];
+    y[i].x = B[0][0] * D[0] * zi.x + B[0][1] * D[1] * zi.y;
+    y[i].y = B[1][0] * D[0] * zi.x + B[1][1] * D[1] * zi.y;
+    z_w[0] += weights[i] * zi.x;
+    z_w[1] += weights[i] * zi.y;
+    y_w[0] += weights[i] * y[i].x;
+    y_w[1] += weights[i] * y[i].y;
+  }
+  m[0] += sigma * y_w[0];
+  m[1] += sigma * y_w[1];
+
+  // evolution paths, C^-1/2 y_w = B z_w
+  ++generation;
+  double scale = std::sqrt(c_sigma * (2.0 - c_sigma) * mu_eff);
+  p_sigma[0] = (1.0 - c_sigma) * p_sigma[0] + scale * (B[0][0] * z_w[0] + B[0][1] * z_w[1]);
+  p_sigma[1] = (1.0 - c_sigma) * p_sigma[1] + scale * (B[1][0] * z_w[0] + B[1][1] * z_w[1]);
+  double p_sigma_norm = std::hypot(p_sigma[0], p_sigma[1]);
+  bool h_sigma = p_sigma_norm / std::sqrt(1.0 - std::pow(1.0 - c_sigma, 2.0 * generation)) / chi_n < 1.4 + 2.0 / 3.0;
+  scale = h_sigma ? std::sqrt(c_c * (2.0 - c_c) * mu_eff) : 0.0;
+  p_c[0] = (1.0 - c_c) * p_c[0] + scale * y_w[0];
+  p_c[1] = (1.0 - c_c) * p_c[1] + scale * y_w[1];
+
+  // rank one update from the path, rank mu update from the steps
+  double delta = h_sigma ? 0.0 : c_c * (2.0 - c_c);
+  for (int r = 0; r < 2; ++r)
+    for (int c = 0; c < 2; ++c) {
+      double rank_mu = 0.0;
+      for (size_t i = 0; i < mu; ++i)
+        rank_mu += weights[i] * y[i][r] * y[i][c];
+      C[r][c] = (1.0 - c_1 - c_mu) * C[r][c] + c_1 * (p_c[r] * p_c[c] + delta * C[r][c]) + c_mu * rank_mu;
+    }
+  sigma *= std::exp(std::min(1.0, c_sigma / d_sigma * (p_sigma_norm / chi_n - 1.0)));
+
+  members = candidates;
+  member_values = values;
+}
+
+bool CmaEs::converged(float tolerance) const {
+  // the deviation along the longest axis of the distribution, D of the last
+  // decomposition is close enough
+  double spread = sigma * std::max(D[0], D[1]);
+  return generation > 0 && !(spread >= tolerance);
+}
+
+DifferentialEvolution::DifferentialEvolution(func_t function, std::optional<batch_t> batch, ThreadPool* pool,
+                                             PopulationSettings settings)
+    : PopulationOptimizer(std::move(function), batch, pool, settings),
+      size(settings.population ? std::max<size_t>(settings.population, 4) : 20) {}
+
+void DifferentialEvolution::start(glm::vec2 start) {
+  // the start is a member, so the result is never worse than it
+  members.resize(size);
+  members[0] = start;
+  for (size_t i = 1; i < size; ++i)
+    members[i] = start + settings.spread * glm::vec2(2.0 * uniform() - 1.0, 2.0 * uniform() - 1.0);
+  member_values.assign(size, std::numeric_limits<float>::quiet_NaN());
+  evaluated = false;
+}
+
+void DifferentialEvolution::ask(std::vector<glm::vec2>& candidates) {
+  if (!evaluated) {
+    candidates = members;
+    return;
+  }
+  candidates.resize(size);
+  auto pick = [&]() { return std::min(size - 1, size_t(uniform() * size)); };
+  for (size_t i = 0; i < size; ++i) {
+    size_t a, b, c;
+    do a = pick(); while (a == i);
+    do b = pick(); while (b == i || b == a);
+    do c = pick(); while (c == i || c == a || c == b);
+    glm::vec2 mutant = members[a] + weight * (members[b] - members[c]);
+    // at least one coordinate comes from the mutant
+    int forced = uniform() < 0.5 ? 0 : 1;
+    for (int k = 0; k < 2; ++k)
+      candidates[i][k] = uniform() < crossover || k == forced ? mutant[k] : members[i][k];
+  }
+}
+
+void DifferentialEvolution::tell(const std::vector<glm::vec2>& candidates, const std::vector<float>& values) {
+  if (!evaluated) {
+    member_values = values;
+    evaluated = true;
+    return;
+  }
+  for (size_t i = 0; i < size; ++i)
+    if (ranked(values[i]) <= ranked(member_values[i]) && values[i] == values[i]) {
+      members[i] = candidates[i];
+      member_values[i] = values[i];
+    }
+}
+
+bool DifferentialEvolution::converged(float tolerance) const {
+  if (!evaluated)
+    return false;
+  size_t best = 0;
+  for (size_t i = 1; i < size; ++i)
+    if (ranked(member_values[i]) < ranked(member_values[best]))
+      best = i;
+  for (auto &member : members)
+    if (!(glm::length(member - members[best]) < tolerance))
+      return false;
+  return true;
+}
@@ -0,0 +1,146 @@
+#ifndef POPULATIONOPTIMIZERS_HPP
+#define POPULATIONOPTIMIZERS_HPP
+
+#include <Optimizers.hpp>
+#include <ThreadPool.hpp>
+#include <utils.hpp>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct PopulationSettings {
+  size_t population = 0;  // members, 0 for the default of the method
+  float spread = 1.0f;    // of the first population around the start
+  uint32_t seed = 0;
+};
+
+// of one generation
+struct GenerationStats {
+  size_t generation = 0;   // from 1
+  size_t evaluations = 0;  // of the function so far
+  float best = 0.0f;       // value so far
+  double seconds = 0.0;    // wall time of the generation
+};
+
+// Derivative free optimizer that evolves a population of points, for rugged
+// functions without a usable gradient. A step is one generation: the points
+// the method asks for are evaluated as one batch, split across the threads of
+// the pool when given, and the method is told their values. The random
+// numbers come from a generator seeded by the settings and are drawn on the
+// calling thread, so a run does not depend on the pool.
+class PopulationOptimizer : public Optimizer {
+public:
+  PopulationOptimizer(func_t function, std::optional<batch_t> batch, ThreadPool* pool, PopulationSettings settings);
+
+  // the best point so far
+  glm::vec2 step() override;
+  void reset(glm::vec2 start) override;
+
+  // the spread of the population is below tolerance
+  virtual bool converged(float tolerance) const = 0;
+
+  // the members of the population, with their values; NaN for a member not
+  // evaluated yet
+  const std::vector<glm::vec2>& population() const { return members; }
+  const std::vector<float>& populationValues() const { return member_values; }
+  glm::vec2 best() const { return best_point; }
+  float bestValue() const { return best_value; }
+  size_t evaluationCount() const { return evaluations; }
+  const std::vector<GenerationStats>& history() const { return stats; }
+  // evaluations when the best value first reached target, 0 when it has not
+  size_t evaluationsTo(float target) const;
+
+protected:
+  PopulationSettings settings;
+  std::vector<glm::vec2> members;
+  std::vector<float> member_values;
+
+  // uniform in [0, 1) and standard normal, the same on every platform unlike
+  // the distributions of the standard library
+  double uniform();
+  double normal();
+
+  // the first population around start, set to members
+  virtual void start(glm::vec2 start) = 0;
+  // the points of the next generation
+  virtual void ask(std::vector<glm::vec2>& candidates) = 0;
+  // their values, NaN taken as +inf; updates members
+  virtual void tell(const std::vector<glm::vec2>& candidates, const std::vector<float>& values) = 0;
+
+private:
+  func_t function;
+  std::optional<batch_t> batch;
+  ThreadPool* pool;
+  std::mt19937 random;
+  std::optional<double> spare_normal;
+
+  std::vector<glm::vec2> candidates;
+  std::vector<float> values;
+  glm::vec2 best_point = glm::vec2(0.0f);
+  float best_value = 0.0f;
+  size_t evaluations = 0;
+  std::vector<GenerationStats> stats;
+
+  // values of the candidates
+  void evaluate();
+};
+
+// The covariance matrix adaptation evolution strategy, (mu/mu_w, lambda):
+// samples from a normal distribution whose mean, step size and covariance
+// follow the best samples of every generation. spread is the first step size.
+class CmaEs : public PopulationOptimizer {
+public:
+  CmaEs(func_t function, std::optional<batch_t> batch, ThreadPool* pool, PopulationSettings settings);
+
+  bool converged(float tolerance) const override;
+  std::string toString() override { return "CMA-ES"; }
+
+  glm::vec2 mean() const { return glm::vec2(m[0], m[1]); }
+  double stepSize() const { return sigma; }
+
+protected:
+  void start(glm::vec2 start) override;
+  void ask(std::vector<glm::vec2>& candidates) override;
+  void tell(const std::vector<glm::vec2>& candidates, const std::vector<float>& values) override;
+
+private:
+  size_t lambda, mu;
+  std::vector<double> weights;
+  double mu_eff, c_sigma, d_sigma, c_c, c_1, c_mu, chi_n;
+
+  double m[2], sigma;
+  double C[2][2], B[2][2], D[2];  // C = B diag(D)^2 B^T
+  double p_sigma[2], p_c[2];
+  size_t generation = 0;
+  std::vector<glm::dvec2> z;  // of the candidates, standard normal
+
+  void decompose();
+};
+
+// Differential evolution, DE/rand/1/bin: every member competes with a trial
+// point, a mix of itself and a third member moved by the difference of two
+// others. The first population is uniform in the square of half side spread
+// around the start.
+class DifferentialEvolution : public PopulationOptimizer {
+public:
+  static constexpr float weight = 0.7f;     // of the difference
+  static constexpr float crossover = 0.9f;  // probability to take a coordinate of the mutant
+
+  DifferentialEvolution(func_t function, std::optional<batch_t> batch, ThreadPool* pool, PopulationSettings settings);
+
+  bool converged(float tolerance) const override;
+  std::string toString() override { return "Differential Evolution"; }
+
+protected:
+  void start(glm::vec2 start) override;
+  void ask(std::vector<glm::vec2>& candidates) override;
+  void tell(const std::vector<glm::vec2>& candidates, const std::vector<float>& values) override;
+
+private:
+  size_t size;
+  bool evaluated = false;  // the first population
+};
+
+#endif // POPULATIONOPTIMIZERS_HPP
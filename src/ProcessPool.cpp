@@ -0,0 +1,387 @@
+#include "ProcessPool.hpp"
+
+#include <CommandLine.hpp>
+#include <Objectives.hpp>
+#include <Plugin.hpp>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// one chunk of points and its results, written by the pool and the worker in turn
+struct ProcessPool::Slot {
+  uint32_t kind;
+  uint32_t count;
+  glm::vec2 points[chunk];
+  float out[4 * chunk];
+};
+
+struct ProcessPool::Call {
+  size_t remaining;  // points not done yet
+};
+
+namespace {
+
+enum Capability : uint32_t { HasGradient = 1, HasHessian = 2 };
+
+size_t floatsPerPoint(ProcessPool::Kind kind) {
+  return kind == ProcessPool::Kind::Value ? 1 : kind == ProcessPool::Kind::Gradient ? 2 : 4;
+}
+
+// one message: the number of a slot, or the capabilities of a worker
+bool receive(int socket, uint32_t& message) {
+  ssize_t n;
+  do
+    n = recv(socket, &message, sizeof message, 0);
+  while (n < 0 && errno == EINTR);
+  return n == sizeof message;
+}
+
+bool sendMessage(int socket, uint32_t message) {
+  ssize_t n;
+  do
+    n = send(socket, &message, sizeof message, MSG_NOSIGNAL);
+  while (n < 0 && errno == EINTR);
+  return n == sizeof message;
+}
+
+std::string systemError(const std::string& what) {
+  return "ProcessPool: " + what + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+ProcessPool::ProcessPool(std::string plugin_path, unsigned count) : plugin_path(plugin_path) {
+  if (count == 0)
+    count = std::max(1u, std::thread::hardware_concurrency());
+  // the workers run the executable of this process
+  char path[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof path - 1);
+  if (length <= 0)
+    throw std::runtime_error(systemError("could not find the executable"));
+  executable.assign(path, length);
+
+  try {
+    for (unsigned i = 0; i < count; ++i) {
+      workers.push_back(std::make_unique<Worker>());
+      Worker& worker = *workers.back();
+      worker.memory = memfd_create("graphs-worker", MFD_CLOEXEC);
+      if (worker.memory < 0 || ftruncate(worker.memory, sizeof(Slot) * slots) != 0)
+        throw std::runtime_error(systemError("could not create the shared memory"));
+      void* mapped = mmap(nullptr, sizeof(Slot) * slots, PROT_READ | PROT_WRITE, MAP_SHARED, worker.memory, 0);
+      if (mapped == MAP_FAILED)
+        throw std::runtime_error(systemError("could not map the shared memory"));
+      worker.slots = static_cast<Slot*>(mapped);
+      uint32_t capabilities = start(worker);
+      has_gradient = capabilities & HasGradient;
+      has_hessian = capabilities & HasHessian;
+    }
+  } catch (...) {
+    for (auto &worker : workers) {
+      stop(*worker);
+      if (worker->slots)
+        munmap(worker->slots, sizeof(Slot) * slots);
+      if (worker->memory >= 0)
+        close(worker->memory);
+    }
+    throw;
+  }
+  for (auto &worker : workers) {
+    Worker* driven = worker.get();
+    worker->driver = std::thread([this, driven]() { drive(*driven); });
+  }
+}
+
+ProcessPool::~ProcessPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_ready.notify_all();
+  for (auto &worker : workers) {
+    if (worker->driver.joinable())
+      worker->driver.join();
+    stop(*worker);
+    munmap(worker->slots, sizeof(Slot) * slots);
+    close(worker->memory);
+  }
+}
+
+uint32_t ProcessPool::start(Worker& worker) {
+  int ends[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ends) != 0)
+    throw std::runtime_error(systemError("could not create a socket"));
+  // the arguments are put together before the fork, the child only execs
+  std::vector<std::string> args{executable, "--eval-worker", "--socket", std::to_string(ends[1]),
+                                "--memory", std::to_string(worker.memory)};
+  if (!plugin_path.empty()) {
+    args.push_back("--plugin");
+    args.push_back(plugin_path);
+  }
+  std::vector<char*> argv;
+  for (auto &arg : args)
+    argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(ends[0]);
+    close(ends[1]);
+    throw std::runtime_error(systemError("could not start a worker"));
+  }
+  if (pid == 0) {
+    // only the two descriptors of the worker survive the exec
+    fcntl(ends[1], F_SETFD, 0);
+    fcntl(worker.memory, F_SETFD, 0);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  close(ends[1]);
+  worker.pid = pid;
+  worker.socket = ends[0];
+
+  // the worker reports what the function has once it is loaded
+  pollfd ready{worker.socket, POLLIN, 0};
+  uint32_t capabilities = 0;
+  if (poll(&ready, 1, 30000) != 1 || !receive(worker.socket, capabilities)) {
+    stop(worker);
+    throw std::runtime_error("ProcessPool: a worker of " + executable + " did not start");
+  }
+  return capabilities;
+}
+
+void ProcessPool::stop(Worker& worker) {
+  if (worker.socket >= 0)
+    close(worker.socket);
+  worker.socket = -1;
+  if (worker.pid <= 0)
+    return;
+  // the worker exits when the socket closes, unless it is stuck in the function
+  int status;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (waitpid(worker.pid, &status, WNOHANG) == 0) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      kill(worker.pid, SIGKILL);
+      waitpid(worker.pid, &status, 0);
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  worker.pid = -1;
+}
+
+void ProcessPool::drive(Worker& worker) {
+  while (true) {
+    size_t sent = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (worker.in_flight.empty())
+        work_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (stopping)
+        return;
+      while (worker.in_flight.size() < size_t(slots) && !tasks.empty()) {
+        // the slots are taken in turn, so the next one is free
+        int slot = worker.in_flight.empty() ? 0 : (worker.in_flight.back().first + 1) % slots;
+        worker.in_flight.emplace_back(slot, tasks.front());
+        tasks.pop_front();
+        ++sent;
+      }
+    }
+    bool alive = true;
+    for (size_t k = worker.in_flight.size() - sent; k < worker.in_flight.size() && alive; ++k) {
+      auto &[slot, task] = worker.in_flight[k];
+      Slot& shared = worker.slots[slot];
+      shared.kind = uint32_t(task.kind);
+      shared.count = uint32_t(task.count);
+      std::copy_n(task.points, task.count, shared.points);
+      alive = sendMessage(worker.socket, uint32_t(slot));
+    }
+    // the worker answers in the order of the slots sent
+    uint32_t done;
+    if (alive && receive(worker.socket, done) && done == uint32_t(worker.in_flight.front().first)) {
+      Task task = worker.in_flight.front().second;
+      worker.in_flight.pop_front();
+      std::copy_n(worker.slots[done].out, task.count * floatsPerPoint(task.kind), task.out);
+      finish(task);
+    }
+    else
+      recover(worker);
+  }
+}
+
+void ProcessPool::recover(Worker& worker) {
+  // the chunks the worker answered before it died are done, their answers
+  // are still in the socket
+  uint32_t done;
+  while (!worker.in_flight.empty() && recv(worker.socket, &done, sizeof done, MSG_DONTWAIT) == sizeof done &&
+         done == uint32_t(worker.in_flight.front().first)) {
+    Task task = worker.in_flight.front().second;
+    worker.in_flight.pop_front();
+    std::copy_n(worker.slots[done].out, task.count * floatsPerPoint(task.kind), task.out);
+    finish(task);
+  }
+  pid_t pid = worker.pid;
+  stop(worker);
+  ++restarts;
+  std::cerr << "[Info] ProcessPool: worker " << pid << " died, starting it again" << std::endl;
+
+  // the first chunk left was being evaluated, it is sent again point by
+  // point; a point that crashed twice is NaN
+  std::deque<Task> again;
+  for (size_t k = 0; k < worker.in_flight.size(); ++k) {
+    Task task = worker.in_flight[k].second;
+    if (k > 0) {
+      again.push_back(task);
+      continue;
+    }
+    ++task.crashes;
+    size_t floats = floatsPerPoint(task.kind);
+    if (task.count > 1)
+      for (size_t i = 0; i < task.count; ++i)
+        again.push_back({task.kind, task.points + i, task.out + i * floats, 1, task.call, 0});
+    else if (task.crashes < 2)
+      again.push_back(task);
+    else {
+      std::cerr << "[Info] ProcessPool: the function crashed at (" << task.points->x << ", " << task.points->y
+                << "), taken as NaN" << std::endl;
+      std::fill_n(task.out, floats, NAN);
+      finish(task);
+    }
+  }
+  worker.in_flight.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.insert(tasks.begin(), again.begin(), again.end());
+  }
+  work_ready.notify_all();
+
+  // the other workers take the chunks meanwhile
+  while (true) {
+    try {
+      start(worker);
+      return;
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (work_ready.wait_for(lock, std::chrono::seconds(1), [this]() { return stopping; }))
+      return;
+  }
+}
+
+void ProcessPool::finish(const Task& task) {
+  std::lock_guard<std::mutex> lock(mutex);
+  task.call->remaining -= task.count;
+  if (task.call->remaining == 0)
+    call_done.notify_all();
+}
+
+void ProcessPool::evaluate(Kind kind, const glm::vec2* points, float* out, size_t count) {
+  if (count == 0)
+    return;
+  Call call{count};
+  std::unique_lock<std::mutex> lock(mutex);
+  for (size_t first = 0; first < count; first += chunk)
+    tasks.push_back({kind, points + first, out + first * floatsPerPoint(kind), std::min(chunk, count - first), &call, 0});
+  work_ready.notify_all();
+  call_done.wait(lock, [&call]() { return call.remaining == 0; });
+}
+
+func_t ProcessPool::function() {
+  return [this](glm::vec2 p) {
+    float value;
+    evaluate(Kind::Value, &p, &value, 1);
+    return value;
+  };
+}
+
+std::optional<grad_t> ProcessPool::gradient() {
+  if (!has_gradient)
+    return std::nullopt;
+  return [this](glm::vec2 p) {
+    glm::vec2 g;
+    evaluate(Kind::Gradient, &p, &g.x, 1);
+    return g;
+  };
+}
+
+std::optional<hess_t> ProcessPool::hessian() {
+  if (!has_hessian)
+    return std::nullopt;
+  return [this](glm::vec2 p) {
+    float h[4];
+    evaluate(Kind::Hessian, &p, h, 1);
+    return glm::mat2(h[0], h[1], h[2], h[3]);
+  };
+}
+
+batch_t ProcessPool::batch() {
+  return {&ProcessPool::batchEntry, this};
+}
+
+void ProcessPool::batchEntry(const void* context, const glm::vec2* points, float* values, size_t count) {
+  const_cast<ProcessPool*>(static_cast<const ProcessPool*>(context))->evaluate(Kind::Value, points, values, count);
+}
+
+int ProcessPool::workerMain(std::vector<std::string> args) {
+  try {
+    int socket = std::stoi(takeOption(args, "--socket"));
+    int memory = std::stoi(takeOption(args, "--memory"));
+    std::string plugin_path = takeOption(args, "--plugin");
+    void* mapped = mmap(nullptr, sizeof(Slot) * slots, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if (mapped == MAP_FAILED)
+      throw std::runtime_error(systemError("could not map the shared memory"));
+    Slot* shared = static_cast<Slot*>(mapped);
+
+    Objective objective = defaultObjective();
+    std::unique_ptr<Plugin> plugin;
+    if (!plugin_path.empty()) {
+      plugin = std::make_unique<Plugin>(plugin_path);
+      objective = Objective{plugin->function(), plugin->gradient(), plugin->hessian(), plugin->batch()};
+    }
+    if (!sendMessage(socket, (objective.gradient ? HasGradient : 0) | (objective.hessian ? HasHessian : 0)))
+      return 1;
+
+    uint32_t message;
+    while (receive(socket, message)) {
+      // the viewer reloads its plugin when the file changes, so does the worker
+      if (plugin)
+        plugin->reloadIfChanged();
+      Slot& slot = shared[message % slots];
+      size_t count = std::min<size_t>(slot.count, chunk);
+      Kind kind = Kind(slot.kind);
+      if (kind == Kind::Value)
+        evaluateBatch(objective.function, objective.batch, slot.points, slot.out, count);
+      else if (kind == Kind::Gradient)
+        for (size_t i = 0; i < count; ++i) {
+          glm::vec2 g = objective.gradient ? (*objective.gradient)(slot.points[i]) : glm::vec2(NAN);
+          slot.out[2 * i] = g.x;
+          slot.out[2 * i + 1] = g.y;
+        }
+      else
+        for (size_t i = 0; i < count; ++i) {
+          glm::mat2 h = objective.hessian ? (*objective.hessian)(slot.points[i]) : glm::mat2(NAN, NAN, NAN, NAN);
+          std::copy_n(&h[0][0], 4, slot.out + 4 * i);
+        }
+      if (!sendMessage(socket, message))
+        break;
+    }
+    return 0;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,106 @@
+#ifndef PROCESSPOOL_HPP
+#define PROCESSPOOL_HPP
+
+#include <utils.hpp>
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Evaluates a function in worker processes rather than threads, for functions
+// that are not thread safe or may crash, such as simulation code behind a
+// plugin. A worker is the running executable started again with
+// --eval-worker (see workerMain), which loads the plugin, or takes the
+// default function of Objectives.cpp, and evaluates the chunks of points written to a ring
+// of slots in memory shared with it; a Unix socket carries the number of
+// every slot filled and done. One driver thread per worker keeps its slots
+// busy, so calls from many threads spread over all workers.
+//
+// A worker that dies is started again and the chunks it had are sent again,
+// the one it was evaluating point by point: a point that crashes the function
+// twice gets NaN instead of taking the graph down. The functions returned
+// below are thread safe and refer to the pool, which has to outlive them.
+class ProcessPool {
+public:
+  static constexpr int slots = 4;  // chunks in flight per worker
+  static constexpr size_t chunk = 256;  // points per slot
+
+  enum class Kind : uint32_t { Value, Gradient, Hessian };
+
+  // workers processes evaluating the plugin at plugin_path, or the default
+  // function of Objectives.cpp when it is empty; throws when a worker does not start
+  ProcessPool(std::string plugin_path, unsigned workers);
+  ~ProcessPool();
+
+  ProcessPool(const ProcessPool&) = delete;
+  ProcessPool& operator=(const ProcessPool&) = delete;
+
+  // writes 1, 2 or 4 floats per point by kind to out (a value, a gradient, a
+  // Hessian column by column), blocking until all are done
+  void evaluate(Kind kind, const glm::vec2* points, float* out, size_t count);
+
+  func_t function();
+  // when the function has them
+  std::optional<grad_t> gradient();
+  std::optional<hess_t> hessian();
+  batch_t batch();
+
+  unsigned size() const { return unsigned(workers.size()); }
+  // workers started again after they died
+  uint64_t restartCount() const { return restarts; }
+
+  // the worker process, args are the ones after --eval-worker; returns the
+  // exit code
+  static int workerMain(std::vector<std::string> args);
+
+private:
+  struct Call;
+  // a chunk of points of a call
+  struct Task {
+    Kind kind;
+    const glm::vec2* points;
+    float* out;
+    size_t count;
+    Call* call;
+    int crashes;
+  };
+  struct Slot;
+  struct Worker {
+    pid_t pid = -1;
+    int socket = -1;
+    int memory = -1;  // of the slots, kept when the process is started again
+    Slot* slots = nullptr;
+    std::deque<std::pair<int, Task>> in_flight;  // slot, task; in the order sent
+    std::thread driver;
+  };
+
+  std::string executable, plugin_path;
+  std::vector<std::unique_ptr<Worker>> workers;
+  bool has_gradient = false, has_hessian = false;
+  std::atomic<uint64_t> restarts{0};
+
+  std::mutex mutex;
+  std::condition_variable work_ready, call_done;
+  std::deque<Task> tasks;
+  bool stopping = false;
+
+  // starts the process of worker, returns the capabilities it reported
+  uint32_t start(Worker& worker);
+  void stop(Worker& worker);
+  void drive(Worker& worker);
+  // worker died: its chunks go back to the queue, the one it was
+  // evaluating point by point, a point that crashed twice is NaN
+  void recover(Worker& worker);
+  void finish(const Task& task);
+
+  static void batchEntry(const void* context, const glm::vec2* points, float* values, size_t count);
+};
+
+#endif // PROCESSPOOL_HPP
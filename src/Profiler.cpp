@@ -0,0 +1,50 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+void Profiler::add(const std::string& section, double seconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  sections[section].push_back(seconds * 1e9);
+}
+
+std::vector<Profiler::Summary> Profiler::summary() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<Summary> result;
+  for (auto& [name, durations] : sections) {
+    std::vector<double> sorted = durations;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double duration : sorted)
+      sum += duration;
+    result.push_back({name, sorted.size(), sorted[sorted.size() / 2],
+                      sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)], sum / sorted.size(),
+                      sorted.front()});
+  }
+  return result;
+}
+
+void Profiler::print() const {
+  std::printf("%-24s %10s %12s %12s %12s\n", "section", "count", "median", "p99", "mean");
+  for (auto& s : summary())
+    std::printf("%-24s %10zu %10.3fms %10.3fms %10.3fms\n", s.name.c_str(), s.count, s.median * 1e-6,
+                s.p99 * 1e-6, s.mean * 1e-6);
+}
+
+void Profiler::writeJson(const std::string& path) const {
+  std::ofstream file(path);
+  if (!file)
+    throw std::runtime_error("Profiler: could not write " + path);
+  file.precision(10);
+  file << "{\n  \"benchmarks\": [";
+  bool first = true;
+  for (auto& s : summary()) {
+    file << (first ? "\n" : ",\n") << "    {\"name\": \"" << s.name << "\", \"repetitions\": " << s.count
+         << ", \"iterations\": 1, \"median_ns\": " << s.median << ", \"p99_ns\": " << s.p99
+         << ", \"mean_ns\": " << s.mean << ", \"min_ns\": " << s.min << "}";
+    first = false;
+  }
+  file << "\n  ]\n}\n";
+}
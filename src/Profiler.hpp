@@ -0,0 +1,50 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Collects the durations of named sections from any thread. The summary has
+// the median and 99th percentile of every section and is written in the JSON
+// format of graphs_bench, so `graphs_bench --compare` can check a profile of
+// a replayed session against a baseline.
+class Profiler {
+public:
+  void add(const std::string& section, double seconds);
+
+  // adds the time from construction to destruction to a section
+  class Scope {
+  public:
+    Scope(Profiler* profiler, const char* section)
+        : profiler(profiler), section(section), start(std::chrono::steady_clock::now()) {}
+    ~Scope() {
+      if (profiler)
+        profiler->add(section, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+  private:
+    Profiler* profiler;
+    const char* section;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  void print() const;
+  void writeJson(const std::string& path) const;
+
+private:
+  struct Summary {
+    std::string name;
+    size_t count;
+    // nanoseconds
+    double median, p99, mean, min;
+  };
+  std::vector<Summary> summary() const;
+
+  mutable std::mutex mutex;
+  std::map<std::string, std::vector<double>> sections;
+};
+
+#endif // PROFILER_HPP
@@ -0,0 +1,134 @@
+#include "ProgressiveGrid.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// stride of the pass of the lattice point (a, b): the largest power of two up
+// to the coarsest stride dividing both
+int strideOf(int a, int b) {
+  int bits = (a | b) & (ProgressiveGrid::coarsest - 1);
+  return bits ? bits & -bits : ProgressiveGrid::coarsest;
+}
+
+} // namespace
+
+ProgressiveGrid::ProgressiveGrid(evaluate_t evaluate, ThreadPool& pool)
+    : evaluate(std::move(evaluate)), pool(pool) {}
+
+void ProgressiveGrid::moveTo(const LatticeWindow& to) {
+  // the samples of the old region at the lattice points of the new one
+  LatticeRegion old = region;
+  region = LatticeRegion::around(to, coarsest);
+  values.swap(old_values);
+  sampled.swap(old_sampled);
+  values.assign(region.size(), 0.0f);
+  sampled.assign(region.size(), 0);
+  if (valid)
+    region.forEachKept(old, columns, rows, [&](size_t i, size_t old_i) {
+      if (old_sampled[old_i]) {
+        values[i] = old_values[old_i];
+        sampled[i] = 1;
+      }
+    });
+  window.resize(size_t(to.n) * to.n);
+  valid = true;
+}
+
+void ProgressiveGrid::refine(int n, int level, float unit, int i0, int j0, double budget) {
+  LatticeWindow to{n, level, unit, i0, j0};
+  refreshed_all = !valid || to != region.window;
+  if (refreshed_all)
+    moveTo(to);
+
+  // the lattice points not sampled, pass by pass: the first pass over the
+  // region, the others over the window only
+  const int width = region.width, height = region.height;
+  const int x0 = i0 - region.a0, y0 = j0 - region.b0;
+  pending.clear();
+  for (int b = 0; b < height; b += coarsest)
+    for (int a = 0; a < width; a += coarsest)
+      if (!sampled[size_t(b) * width + a])
+        pending.push_back(uint32_t(size_t(b) * width + a));
+  size_t first_pass = pending.size();
+  for (int stride = coarsest / 2; stride >= 1; stride /= 2) {
+    for (int b = floorTo(y0 + stride - 1, stride); b < y0 + n; b += stride)
+      for (int a = floorTo(x0 + stride - 1, stride); a < x0 + n; a += stride)
+        if (strideOf(a, b) == stride && !sampled[size_t(b) * width + a])
+          pending.push_back(uint32_t(size_t(b) * width + a));
+  }
+  positions.resize(pending.size());
+  staged.resize(pending.size());
+  for (size_t k = 0; k < pending.size(); ++k)
+    positions[k] = region.position(pending[k]);
+
+  size_t count = sample(0, first_pass, std::chrono::steady_clock::time_point::max());
+  auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+  count += sample(first_pass, pending.size(), deadline);
+  evaluated += count;
+
+  pending_count = 0;
+  pending_stride = 1;
+  for (uint32_t i : pending) {
+    if (sampled[i])
+      continue;
+    if (pending_count++ == 0)
+      pending_stride = strideOf(int(i % width), int(i / width));
+  }
+
+  blocks.reset(n, refreshed_all);
+  if (!refreshed_all && count == 0)
+    return;
+  interpolate();
+  blocks.copy(values.data(), width, x0, y0, window.data());
+}
+
+size_t ProgressiveGrid::sample(size_t begin, size_t end, std::chrono::steady_clock::time_point deadline) {
+  // a few points at a time, so that a slow function overruns the deadline by
+  // little
+  const size_t chunk = 32;
+  std::atomic<size_t> next{begin}, count{0};
+  if (begin < end)
+    pool.parallelFor(0, pool.size(), [&](size_t) {
+      while (std::chrono::steady_clock::now() < deadline) {
+        size_t k = next.fetch_add(chunk);
+        if (k >= end)
+          return;
+        size_t last = std::min(k + chunk, end);
+        evaluate(positions.data() + k, staged.data() + k, last - k);
+        for (size_t i = k; i < last; ++i) {
+          values[pending[i]] = staged[i];
+          sampled[pending[i]] = 1;
+        }
+        count += last - k;
+      }
+    });
+  return count;
+}
+
+void ProgressiveGrid::interpolate() {
+  // pass by pass, the points of a pass not sampled are the mean of their 2 or
+  // 4 neighbours on the passes before, which is bilinear interpolation
+  const int width = region.width, height = region.height;
+  for (int stride = coarsest; stride > 1; stride /= 2) {
+    int h = stride / 2;
+    for (int b = 0; b < height; b += h) {
+      bool odd_b = b % stride != 0;
+      float* row = values.data() + size_t(b) * width;
+      for (int a = 0; a < width; a += h) {
+        bool odd_a = a % stride != 0;
+        if ((!odd_a && !odd_b) || sampled[size_t(b) * width + a])
+          continue;
+        if (odd_a && odd_b)
+          row[a] = 0.25f * (row[a - h - h * width] + row[a + h - h * width] +
+                            row[a - h + h * width] + row[a + h + h * width]);
+        else if (odd_a)
+          row[a] = 0.5f * (row[a - h] + row[a + h]);
+        else
+          row[a] = 0.5f * (row[a - h * width] + row[a + h * width]);
+      }
+    }
+  }
+}
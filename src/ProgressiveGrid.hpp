@@ -0,0 +1,78 @@
+#ifndef PROGRESSIVEGRID_HPP
+#define PROGRESSIVEGRID_HPP
+
+#include <LatticeRegion.hpp>
+#include <ThreadPool.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Heights of the graph sampled coarse to fine: every 8th lattice point first,
+// then every 4th, every 2nd and the remaining ones, each refine() sampling as
+// much as fits in its time budget. The first pass is always sampled in full,
+// the heights not sampled yet are interpolated bilinearly from the points of
+// the passes before. Samples are kept when the grid moves: after a pan only
+// the new rows and columns are sampled, after a zoom the lattice points of
+// the new level that coincide with ones of the old level are kept.
+class ProgressiveGrid {
+public:
+  static constexpr int coarsest = 8;  // stride of the first pass
+  static constexpr int block = WindowBlocks::block;  // heights per side of a block of changed()
+
+  using evaluate_t = std::function<void(const glm::vec2* points, float* values, size_t count)>;
+
+  // evaluate is called on the threads of pool, with a few points at a time
+  ProgressiveGrid(evaluate_t evaluate, ThreadPool& pool);
+
+  ProgressiveGrid(const ProgressiveGrid&) = delete;
+  ProgressiveGrid& operator=(const ProgressiveGrid&) = delete;
+
+  // moves the grid to the n x n lattice points level * unit * (i0 + x, j0 + y)
+  // and samples it for budget seconds after the first pass
+  void refine(int n, int level, float unit, int i0, int j0, double budget);
+  // the samples are dropped by the next refine, e.g. after the function changed
+  void invalidate() { valid = false; }
+
+  // n x n heights, row by row
+  const float* heights() const { return window.data(); }
+  // whether a height of [x0, x1) x [y0, y1) changed in the last refine
+  bool changed(int x0, int y0, int x1, int y1) const { return blocks.changed(x0, y0, x1, y1); }
+  // the last refine moved the grid, every height changed
+  bool refreshedAll() const { return refreshed_all; }
+  // lattice points of the grid not sampled yet, 0 once it is refined in full
+  size_t pendingCount() const { return pending_count; }
+  // stride of the pass the next refine continues, 1 for the last pass
+  int pendingStride() const { return pending_stride; }
+  // samples evaluated by all refine() calls so far
+  uint64_t evaluatedCount() const { return evaluated; }
+
+private:
+  evaluate_t evaluate;
+  ThreadPool& pool;
+
+  // the window of the graph, within a lattice region whose corners are on
+  // the first pass, so that every height can be interpolated
+  LatticeRegion region;
+  WindowBlocks blocks;
+  bool valid = false, refreshed_all = false;
+  size_t pending_count = 0;
+  int pending_stride = coarsest;
+  uint64_t evaluated = 0;
+
+  std::vector<float> values, old_values;        // of the region
+  std::vector<uint8_t> sampled, old_sampled;
+  std::vector<int> columns, rows;               // of the old region, -1 when none
+  std::vector<uint32_t> pending;                // indices into the region, by pass
+  std::vector<glm::vec2> positions;             // of pending
+  std::vector<float> staged;
+  std::vector<float> window;
+
+  void moveTo(const LatticeWindow& to);
+  // samples pending[begin, end) until deadline, returns the count sampled
+  size_t sample(size_t begin, size_t end, std::chrono::steady_clock::time_point deadline);
+  void interpolate();
+};
+
+#endif // PROGRESSIVEGRID_HPP
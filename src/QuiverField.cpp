@@ -0,0 +1,81 @@
+#include "QuiverField.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+QuiverField::QuiverField(ThreadPool& pool) : pool(pool) {}
+
+void QuiverField::moveTo(const LatticeWindow& to) {
+  LatticeRegion old = region;
+  region = LatticeRegion::within(to, stride);
+  gradients.swap(old_gradients);
+  known.swap(old_known);
+  gradients.assign(region.size(), glm::vec2(0.0f));
+  known.assign(region.size(), 0);
+  if (valid)
+    region.forEachKept(old, column_map, row_map, [&](size_t i, size_t old_i) {
+      if (old_known[old_i]) {
+        gradients[i] = old_gradients[old_i];
+        known[i] = 1;
+      }
+    });
+}
+
+void QuiverField::update(int n, int level, float unit, int i0, int j0, const gradient_t& gradient) {
+  LatticeWindow to{n, level, unit, i0, j0};
+  if (!valid || to != region.window)
+    moveTo(to);
+  valid = true;
+
+  missing.clear();
+  for (uint32_t i = 0; i < known.size(); ++i)
+    if (!known[i])
+      missing.push_back(i);
+  if (missing.empty())
+    return;
+  positions.resize(missing.size());
+  results.resize(missing.size());
+  for (size_t k = 0; k < missing.size(); ++k)
+    positions[k] = region.position(missing[k]);
+  const size_t chunk = 64;
+  pool.parallelFor(0, (missing.size() + chunk - 1) / chunk, [&](size_t c) {
+    size_t begin = c * chunk, end = std::min(missing.size(), begin + chunk);
+    gradient(positions.data() + begin, results.data() + begin, end - begin);
+  });
+  for (size_t k = 0; k < missing.size(); ++k) {
+    gradients[missing[k]] = results[k];
+    known[missing[k]] = 1;
+  }
+  evaluated += missing.size();
+}
+
+glm::vec2 QuiverField::arrows(const float* heights, std::vector<QuiverArrow>& out) const {
+  float smallest = INFINITY, largest = 0.0f;
+  for (glm::vec2 g : gradients) {
+    float m = glm::length(g);
+    if (std::isfinite(m)) {
+      smallest = std::min(smallest, m);
+      largest = std::max(largest, m);
+    }
+  }
+  out.clear();
+  if (!(largest > 0.0f))
+    return glm::vec2(0.0f);
+  const LatticeWindow& window = region.window;
+  float diff = window.level * window.unit;
+  float longest = 0.9f * stride * diff;
+  for (int y = 0; y < region.height; ++y)
+    for (int x = 0; x < region.width; ++x) {
+      glm::vec2 g = gradients[size_t(y) * region.width + x];
+      float m = glm::length(g);
+      if (!(m > 0.0f) || !std::isfinite(m))
+        continue;
+      int a = region.a0 + x * stride, b = region.b0 + y * stride;
+      // lifted off the graph a little, uphill along the tangent over g
+      float z = heights[size_t(b - window.j0) * window.n + (a - window.i0)] + 0.5f * diff;
+      glm::vec3 along = glm::normalize(glm::vec3(g / m, m));
+      out.push_back({glm::vec4(diff * a, diff * b, z, 0.1f * stride * diff),
+                     glm::vec4(longest * m / largest * along, m / largest)});
+    }
+  return glm::vec2(smallest, largest);
+}
@@ -0,0 +1,58 @@
+#ifndef QUIVERFIELD_HPP
+#define QUIVERFIELD_HPP
+
+#include <LatticeRegion.hpp>
+#include <Mesh.hpp>
+#include <ThreadPool.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Gradients of the graph at the lattice points whose indices are multiples of
+// stride, the arrows of the gradient overlay. The missing gradients are
+// evaluated as one batch split across the threads of a pool; gradients are
+// kept while their lattice points stay on the graph, so a pan evaluates the
+// new rows and columns only and a zoom keeps the points of the old level
+// that are on the new one.
+class QuiverField {
+public:
+  static constexpr int stride = 8;
+
+  using gradient_t = std::function<void(const glm::vec2* points, glm::vec2* gradients, size_t count)>;
+
+  explicit QuiverField(ThreadPool& pool);
+
+  QuiverField(const QuiverField&) = delete;
+  QuiverField& operator=(const QuiverField&) = delete;
+
+  // the gradients at the lattice points level * unit * (a, b) of the n x n
+  // window at (i0, j0), gradient is called on the threads of the pool
+  void update(int n, int level, float unit, int i0, int j0, const gradient_t& gradient);
+  // the gradients are dropped by the next update, e.g. after the function changed
+  void invalidate() { valid = false; }
+
+  // arrows on the graph of the n x n heights of the window, written to out;
+  // the longest is 0.9 stride lattice steps long. Returns the smallest and
+  // largest magnitude of the gradients.
+  glm::vec2 arrows(const float* heights, std::vector<QuiverArrow>& out) const;
+
+  // gradients evaluated by all update() calls so far
+  uint64_t evaluatedCount() const { return evaluated; }
+
+private:
+  ThreadPool& pool;
+
+  LatticeRegion region;  // the multiples of stride in the window
+  bool valid = false;
+  uint64_t evaluated = 0;
+
+  std::vector<glm::vec2> gradients, old_gradients;
+  std::vector<uint8_t> known, old_known;
+  std::vector<int> column_map, row_map;  // of the old points, -1 when none
+  std::vector<uint32_t> missing;
+  std::vector<glm::vec2> positions, results;  // of missing
+
+  void moveTo(const LatticeWindow& to);
+};
+
+#endif // QUIVERFIELD_HPP
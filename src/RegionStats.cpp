@@ -0,0 +1,349 @@
+#include "RegionStats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+
+namespace {
+
+// the Gauss-Kronrod pair of 7 and 15 points on [-1, 1], the nodes of the
+// Kronrod rule from the end to the center; the odd ones are the Gauss nodes
+const double kKronrodNodes[8] = {
+  0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+  0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+  0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+  0.207784955007898467600689403773245, 0.000000000000000000000000000000000,
+};
+const double kKronrodWeights[8] = {
+  0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+  0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+  0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+  0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+const double kGaussWeights[4] = {
+  0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+  0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+
+// node k of the 15 on [-1, 1], its Kronrod and Gauss weights (0 off the Gauss nodes)
+double node(int k) {
+  return k < 7 ? -kKronrodNodes[k] : kKronrodNodes[14 - k];
+}
+double kronrodWeight(int k) {
+  return kKronrodWeights[std::min(k, 14 - k)];
+}
+double gaussWeight(int k) {
+  int j = std::min(k, 14 - k);
+  return j % 2 ? kGaussWeights[j / 2] : 0.0;
+}
+
+// the plastic number, R2 steps by its inverse powers
+const double kPlastic = 1.32471795724474602596;
+const double kStep[2] = {1.0 / kPlastic, 1.0 / (kPlastic * kPlastic)};
+
+// first QMC points per shift, then doubled every round up to the most
+const size_t kFirstQmcPoints = 1024;
+const size_t kMostQmcPoints = 16384;
+// points of a QMC round evaluated by one batch call
+const size_t kQmcChunk = 4096;
+// the first boxes of the cubature per side
+const int kFirstBoxes = 4;
+// boxes are not split below this fraction of the side of the region
+const double kSmallestBox = 1e-6;
+
+double fraction(double x) {
+  return x - std::floor(x);
+}
+
+// value and one standard error of the mean of the estimates of the shifts
+RegionEstimate spread(const double* estimates, int count) {
+  CompensatedSum sum;
+  for (int i = 0; i < count; ++i)
+    sum.add(estimates[i]);
+  double mean = sum.value() / count;
+  double squares = 0.0;
+  for (int i = 0; i < count; ++i)
+    squares += (estimates[i] - mean) * (estimates[i] - mean);
+  return {mean, std::sqrt(squares / (count - 1) / count)};
+}
+
+} // namespace
+
+bool SampleLattice::lookup(glm::vec2 p, float& value) const {
+  glm::vec2 q = (p - origin) / spacing;
+  int x = int(std::lround(q.x)), y = int(std::lround(q.y));
+  if (x < 0 || y < 0 || x >= samples || y >= samples)
+    return false;
+  // the lattice points are rounded to floats like the points evaluated
+  if (std::abs(q.x - x) > 1e-5f || std::abs(q.y - y) > 1e-5f)
+    return false;
+  value = heights[size_t(y) * samples + x];
+  return true;
+}
+
+RegionIntegrator::RegionIntegrator(func_t function, std::optional<batch_t> batch, ThreadPool& pool,
+                                   Settings settings, std::shared_ptr<const SampleLattice> lattice)
+    : function(std::move(function)), batch(batch), pool(pool), settings(settings), lattice(std::move(lattice)) {
+  stats.lower = settings.lower;
+  stats.upper = settings.upper;
+  stats.threshold = settings.threshold;
+  stats.min = INFINITY;
+  stats.max = -INFINITY;
+  std::mt19937 random(settings.seed);
+  for (auto &shift : qmc_shift) {
+    shift.x = random() * (1.0 / 4294967296.0);
+    shift.y = random() * (1.0 / 4294967296.0);
+  }
+  // the extremes start from the lattice points in the region
+  if (this->lattice)
+    for (int y = 0; y < this->lattice->samples; ++y)
+      for (int x = 0; x < this->lattice->samples; ++x) {
+        glm::vec2 p = this->lattice->origin + this->lattice->spacing * glm::vec2(x, y);
+        if (p.x >= settings.lower.x && p.x <= settings.upper.x &&
+            p.y >= settings.lower.y && p.y <= settings.upper.y) {
+          float value = this->lattice->heights[size_t(y) * this->lattice->samples + x];
+          extend(value, p, value, p);
+        }
+      }
+}
+
+void RegionIntegrator::extend(float min, glm::vec2 argmin, float max, glm::vec2 argmax) {
+  if (min < stats.min) {
+    stats.min = min;
+    stats.argmin = argmin;
+  }
+  if (max > stats.max) {
+    stats.max = max;
+    stats.argmax = argmax;
+  }
+}
+
+bool RegionIntegrator::refine(double budget) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(budget);
+  do {
+    if (cancelled)
+      break;
+    if (!cubature_done) {
+      if (boxes.empty() && !final_boxes)
+        startCubature();
+      else
+        cubatureRound();
+    }
+    if (!qmc_done)
+      qmcRound();
+    updateStatistics();
+    finished = cubature_done && qmc_done;
+  } while (!finished && std::chrono::steady_clock::now() < deadline);
+  return finished || cancelled;
+}
+
+void RegionIntegrator::evaluateBox(Box& box) const {
+  glm::dvec2 center = 0.5 * (glm::dvec2(box.lower) + glm::dvec2(box.upper));
+  glm::dvec2 half = 0.5 * (glm::dvec2(box.upper) - glm::dvec2(box.lower));
+  glm::vec2 points[nodes * nodes];
+  float values[nodes * nodes];
+  // the nodes not on the lattice are evaluated in one batch
+  glm::vec2 missing[nodes * nodes];
+  int missing_index[nodes * nodes];
+  int missing_count = 0;
+  box.reused = 0;
+  for (int j = 0; j < nodes; ++j)
+    for (int i = 0; i < nodes; ++i) {
+      int k = j * nodes + i;
+      points[k] = glm::vec2(center.x + half.x * node(i), center.y + half.y * node(j));
+      if (lattice && lattice->lookup(points[k], values[k])) {
+        ++box.reused;
+        continue;
+      }
+      missing[missing_count] = points[k];
+      missing_index[missing_count++] = k;
+    }
+  float evaluated[nodes * nodes];
+  evaluateBatch(function, batch, missing, evaluated, missing_count);
+  for (int m = 0; m < missing_count; ++m)
+    values[missing_index[m]] = evaluated[m];
+  box.evaluated = missing_count;
+
+  double kronrod = 0.0, gauss = 0.0, kronrod_volume = 0.0, gauss_volume = 0.0;
+  box.min = INFINITY;
+  box.max = -INFINITY;
+  for (int j = 0; j < nodes; ++j)
+    for (int i = 0; i < nodes; ++i) {
+      int k = j * nodes + i;
+      double f = values[k];
+      double above = std::max(f - settings.threshold, 0.0);
+      double wk = kronrodWeight(i) * kronrodWeight(j), wg = gaussWeight(i) * gaussWeight(j);
+      kronrod += wk * f;
+      gauss += wg * f;
+      kronrod_volume += wk * above;
+      gauss_volume += wg * above;
+      if (values[k] < box.min) {
+        box.min = values[k];
+        box.argmin = points[k];
+      }
+      if (values[k] > box.max) {
+        box.max = values[k];
+        box.argmax = points[k];
+      }
+    }
+  double area = 4.0 * half.x * half.y;
+  box.integral = area / 4.0 * kronrod;
+  box.volume = area / 4.0 * kronrod_volume;
+  box.integral_error = area / 4.0 * std::abs(kronrod - gauss);
+  box.volume_error = area / 4.0 * std::abs(kronrod_volume - gauss_volume);
+}
+
+void RegionIntegrator::evaluateBoxes(std::vector<Box>& evaluated) {
+  pool.parallelFor(0, evaluated.size(), [&](size_t i) { evaluateBox(evaluated[i]); });
+  for (auto &box : evaluated) {
+    integral.add(box.integral);
+    volume.add(box.volume);
+    integral_error.add(box.integral_error);
+    volume_error.add(box.volume_error);
+    stats.evaluations += box.evaluated;
+    stats.reused += box.reused;
+    extend(box.min, box.argmin, box.max, box.argmax);
+  }
+}
+
+void RegionIntegrator::startCubature() {
+  std::vector<Box> first(kFirstBoxes * kFirstBoxes);
+  glm::vec2 side = (settings.upper - settings.lower) / float(kFirstBoxes);
+  for (int j = 0; j < kFirstBoxes; ++j)
+    for (int i = 0; i < kFirstBoxes; ++i) {
+      Box& box = first[j * kFirstBoxes + i];
+      box.lower = settings.lower + side * glm::vec2(i, j);
+      box.upper = settings.lower + side * glm::vec2(i + 1, j + 1);
+      if (i + 1 == kFirstBoxes)
+        box.upper.x = settings.upper.x;
+      if (j + 1 == kFirstBoxes)
+        box.upper.y = settings.upper.y;
+    }
+  evaluateBoxes(first);
+  // the boxes are ranked by their errors relative to the first estimates, a
+  // zero volume (the threshold above the graph) is measured against the integral
+  double area = double(settings.upper.x - settings.lower.x) * (settings.upper.y - settings.lower.y);
+  double floor = std::max(1e-300, 1e-3 * area * std::max(double(stats.max - stats.min), 1e-300));
+  integral_scale = std::max(std::abs(integral.value()), floor);
+  volume_scale = std::max(std::abs(volume.value()), floor);
+  for (auto &box : first) {
+    box.error = box.integral_error / integral_scale + box.volume_error / volume_scale;
+    if (!(box.error == box.error))
+      box.error = INFINITY;
+    boxes.push(box);
+  }
+}
+
+void RegionIntegrator::cubatureRound() {
+  glm::vec2 region = settings.upper - settings.lower;
+  std::vector<Box> children;
+  std::vector<Box> parents;
+  while (!boxes.empty() && parents.size() < round_boxes) {
+    Box box = boxes.top();
+    boxes.pop();
+    // halves across the longer side, relative to the region
+    glm::vec2 side = (box.upper - box.lower) / region;
+    int axis = side.x >= side.y ? 0 : 1;
+    if (side[axis] < kSmallestBox) {
+      ++final_boxes;
+      continue;
+    }
+    Box a = box, b = box;
+    float middle = 0.5f * (box.lower[axis] + box.upper[axis]);
+    a.upper[axis] = middle;
+    b.lower[axis] = middle;
+    children.push_back(a);
+    children.push_back(b);
+    parents.push_back(box);
+  }
+  for (auto &box : parents) {
+    integral.add(-box.integral);
+    volume.add(-box.volume);
+    integral_error.add(-box.integral_error);
+    volume_error.add(-box.volume_error);
+  }
+  evaluateBoxes(children);
+  for (auto &box : children) {
+    box.error = box.integral_error / integral_scale + box.volume_error / volume_scale;
+    if (!(box.error == box.error))
+      box.error = INFINITY;
+    boxes.push(box);
+  }
+}
+
+void RegionIntegrator::qmcRound() {
+  // every shift gets the next points of the sequence, doubling them
+  size_t count = std::min(std::max(kFirstQmcPoints, qmc_count), kMostQmcPoints);
+  size_t chunks = (count + kQmcChunk - 1) / kQmcChunk;
+  std::vector<QmcPart> parts(shifts * chunks);
+  glm::dvec2 lower(settings.lower), extent = glm::dvec2(settings.upper) - lower;
+  pool.parallelFor(0, parts.size(), [&](size_t p) {
+    int shift = int(p / chunks);
+    size_t begin = qmc_count + (p % chunks) * kQmcChunk;
+    size_t end = std::min(begin + kQmcChunk, qmc_count + count);
+    glm::vec2 points[kQmcChunk];
+    float values[kQmcChunk];
+    for (size_t n = begin; n < end; ++n) {
+      glm::dvec2 u(fraction(qmc_shift[shift].x + n * kStep[0]), fraction(qmc_shift[shift].y + n * kStep[1]));
+      points[n - begin] = glm::vec2(lower + extent * u);
+    }
+    evaluateBatch(function, batch, points, values, end - begin);
+    QmcPart& part = parts[p];
+    for (size_t i = 0; i < end - begin; ++i) {
+      double f = values[i];
+      part.values.add(f);
+      part.volume.add(std::max(f - settings.threshold, 0.0));
+      part.above += f > settings.threshold;
+      if (values[i] < part.min) {
+        part.min = values[i];
+        part.argmin = points[i];
+      }
+      if (values[i] > part.max) {
+        part.max = values[i];
+        part.argmax = points[i];
+      }
+    }
+  });
+  for (size_t p = 0; p < parts.size(); ++p) {
+    QmcPart& sums = qmc_sums[p / chunks];
+    sums.values.add(parts[p].values);
+    sums.volume.add(parts[p].volume);
+    sums.above += parts[p].above;
+    extend(parts[p].min, parts[p].argmin, parts[p].max, parts[p].argmax);
+  }
+  qmc_count += count;
+  stats.evaluations += shifts * count;
+}
+
+void RegionIntegrator::updateStatistics() {
+  double area = double(settings.upper.x - settings.lower.x) * (settings.upper.y - settings.lower.y);
+  stats.integral = {integral.value(), integral_error.value()};
+  stats.mean = {stats.integral.value / area, stats.integral.error / area};
+  stats.volume = {volume.value(), volume_error.value()};
+  stats.boxes = boxes.size() + final_boxes;
+  // an integral near zero is measured against the scale of the first estimates
+  double integral_floor = std::max(std::abs(stats.integral.value), integral_scale);
+  double volume_floor = std::max(std::abs(stats.volume.value), integral_scale);
+  bool converged = stats.integral.error <= settings.tolerance * integral_floor &&
+                   stats.volume.error <= settings.tolerance * volume_floor;
+  stats.converged = converged;
+  cubature_done = converged || boxes.empty() || stats.evaluations >= settings.max_evaluations;
+
+  if (qmc_count) {
+    double integrals[shifts], volumes[shifts], areas[shifts];
+    for (int s = 0; s < shifts; ++s) {
+      integrals[s] = area * qmc_sums[s].values.value() / qmc_count;
+      volumes[s] = area * qmc_sums[s].volume.value() / qmc_count;
+      areas[s] = area * double(qmc_sums[s].above) / qmc_count;
+    }
+    stats.qmc_integral = spread(integrals, shifts);
+    stats.qmc_volume = spread(volumes, shifts);
+    stats.qmc_area = spread(areas, shifts);
+  }
+  stats.qmc_points = qmc_count;
+  // the area above the threshold has QMC alone, it goes on after the
+  // cubature until its error is a ten thousandth of the region
+  qmc_done = (cubature_done && stats.qmc_area.error <= 1e-4 * area) || qmc_count >= max_qmc_points ||
+             stats.evaluations >= settings.max_evaluations;
+}
@@ -0,0 +1,156 @@
+#ifndef REGIONSTATS_HPP
+#define REGIONSTATS_HPP
+
+#include <ThreadPool.hpp>
+#include <utils.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <vector>
+
+// Sum of doubles with the error of every addition carried along (Neumaier's
+// variant of Kahan summation), so that millions of terms add up to the
+// rounding of the result alone
+class CompensatedSum {
+public:
+  void add(double x) {
+    double t = sum + x;
+    compensation += std::abs(sum) >= std::abs(x) ? (sum - t) + x : (x - t) + sum;
+    sum = t;
+  }
+  void add(const CompensatedSum& other) {
+    add(other.sum);
+    add(other.compensation);
+  }
+  double value() const { return sum + compensation; }
+
+private:
+  double sum = 0.0, compensation = 0.0;
+};
+
+// Values of the function already known on a lattice, e.g. the vertices of
+// the graph: samples x samples heights at origin + spacing * (x, y), row by row
+struct SampleLattice {
+  glm::vec2 origin = glm::vec2(0.0f);
+  float spacing = 1.0f;
+  int samples = 0;
+  std::vector<float> heights;
+
+  // the height at p when p is a lattice point
+  bool lookup(glm::vec2 p, float& value) const;
+};
+
+struct RegionEstimate {
+  double value = 0.0;
+  double error = 0.0;  // estimated absolute error, one standard error for QMC
+};
+
+struct RegionStatistics {
+  glm::vec2 lower = glm::vec2(0.0f), upper = glm::vec2(0.0f);
+  float threshold = 0.0f;
+  // adaptive cubature: the integral of f, its mean over the region and the
+  // volume between the graph and the plane at threshold where f is above it
+  RegionEstimate integral, mean, volume;
+  // quasi-Monte Carlo, the same and the area where f is above threshold,
+  // whose integrand is not smooth enough for the cubature
+  RegionEstimate qmc_integral, qmc_volume, qmc_area;
+  // of the evaluated points and the lattice inside the region
+  float min = 0.0f, max = 0.0f;
+  glm::vec2 argmin = glm::vec2(0.0f), argmax = glm::vec2(0.0f);
+  size_t evaluations = 0;  // of the function
+  size_t reused = 0;       // points taken from the lattice
+  size_t boxes = 0;        // of the cubature
+  size_t qmc_points = 0;   // per shift
+  bool converged = false;
+};
+
+// Integral, mean, extremes and volume above a threshold of a function over a
+// rectangle, by two estimators refined side by side on the threads of a pool:
+// adaptive cubature, which splits the boxes with the largest error estimate of
+// a tensor Gauss-Kronrod rule (G7, K15) in halves, and quasi-Monte Carlo on
+// randomly shifted copies of the R2 sequence, whose spread gives its error
+// bar. Sums are compensated and results do not depend on the number of
+// threads. refine() may be called repeatedly, cancel() from any thread.
+class RegionIntegrator {
+public:
+  static constexpr int nodes = 15;           // per axis of the rule
+  static constexpr size_t round_boxes = 16;  // split per round of the cubature
+  static constexpr int shifts = 8;           // of the QMC sequence
+  static constexpr size_t max_qmc_points = size_t(1) << 20;  // per shift
+
+  struct Settings {
+    glm::vec2 lower = glm::vec2(-1.0f), upper = glm::vec2(1.0f);
+    float threshold = 0.0f;
+    double tolerance = 1e-6;  // relative, of the integral and the volume
+    size_t max_evaluations = size_t(1) << 24;
+    uint32_t seed = 0;  // of the QMC shifts
+  };
+
+  // lattice, when given, provides the values at its points in the region
+  RegionIntegrator(func_t function, std::optional<batch_t> batch, ThreadPool& pool, Settings settings,
+                   std::shared_ptr<const SampleLattice> lattice = nullptr);
+
+  // refines both estimators for about budget seconds; returns whether they
+  // are done, converged or out of evaluations
+  bool refine(double budget);
+  void cancel() { cancelled = true; }
+  bool done() const { return finished; }
+
+  const RegionStatistics& statistics() const { return stats; }
+
+private:
+  struct Box {
+    glm::vec2 lower, upper;
+    double integral, volume;  // Kronrod estimates
+    double integral_error, volume_error;  // Kronrod minus Gauss
+    double error;  // priority, of both relative to the first estimates
+    // of the nodes
+    float min, max;
+    glm::vec2 argmin, argmax;
+    size_t evaluated, reused;
+  };
+  struct ByError {
+    bool operator()(const Box& a, const Box& b) const { return a.error < b.error; }
+  };
+  // the part of a QMC round of one shift
+  struct QmcPart {
+    CompensatedSum values, volume;
+    size_t above = 0;
+    float min = INFINITY, max = -INFINITY;
+    glm::vec2 argmin = glm::vec2(0.0f), argmax = glm::vec2(0.0f);
+  };
+
+  func_t function;
+  std::optional<batch_t> batch;
+  ThreadPool& pool;
+  Settings settings;
+  std::shared_ptr<const SampleLattice> lattice;
+  std::atomic<bool> cancelled{false};
+  bool finished = false;
+  RegionStatistics stats;
+
+  std::priority_queue<Box, std::vector<Box>, ByError> boxes;
+  size_t final_boxes = 0;  // too small to split, only in the totals
+  CompensatedSum integral, volume, integral_error, volume_error;  // of all boxes
+  double integral_scale = 0.0, volume_scale = 0.0;  // of the first estimates
+  bool cubature_done = false;
+
+  glm::dvec2 qmc_shift[shifts];
+  QmcPart qmc_sums[shifts];
+  size_t qmc_count = 0;  // points per shift so far
+  bool qmc_done = false;
+
+  // the rule on the boxes, in parallel, added to the totals and the queue
+  void evaluateBoxes(std::vector<Box>& boxes);
+  void evaluateBox(Box& box) const;
+  void startCubature();
+  void cubatureRound();
+  void qmcRound();
+  void updateStatistics();
+  void extend(float min, glm::vec2 argmin, float max, glm::vec2 argmax);
+};
+
+#endif // REGIONSTATS_HPP
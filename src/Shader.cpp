@@ -9,6 +9,9 @@
 #include "Shader.hpp"
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -92,6 +95,108 @@ ShaderProgram::ShaderProgram(std::initializer_list<Shader> shaderList)
   link();
 }
 
+ShaderProgram::ShaderProgram(std::initializer_list<std::pair<std::string, GLenum>> files,
+                             const std::string& cache_dir)
+    : ShaderProgram() {
+  // key of the binary: the sources and the driver that compiled them
+  uint64_t hash = 1469598103934665603ull;  // FNV-1a
+  auto add = [&](const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= uint8_t(data[i]);
+      hash *= 1099511628211ull;
+    }
+  };
+  vector<char> source;
+  for (auto& file : files) {
+    getFileContents(file.first.c_str(), source);
+    add(source.data(), source.size());
+    add(reinterpret_cast<const char*>(&file.second), sizeof(file.second));
+    source.clear();
+  }
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    const char* value = reinterpret_cast<const char*>(glGetString(name));
+    if (value)
+      add(value, strlen(value) + 1);
+  }
+
+  GLint formats = 0;
+  if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  string path;
+  if (!cache_dir.empty() && formats > 0) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    path = cache_dir + "/" + name;
+  }
+
+  // format and binary, as returned by glGetProgramBinary
+  if (!path.empty()) {
+    ifstream file(path, ios_base::binary);
+    GLenum format;
+    vector<char> binary;
+    if (file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+      binary.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+      glProgramBinary(handle, format, binary.data(), GLsizei(binary.size()));
+      GLint status = GL_FALSE;
+      glGetProgramiv(handle, GL_LINK_STATUS, &status);
+      if (status == GL_TRUE) {
+        from_cache = true;
+        return;
+      }
+      cout << "[Info] Program binary " << path << " rejected by the driver, compiling" << endl;
+    }
+  }
+
+  for (auto& file : files) {
+    Shader shader(file.first, file.second);
+    glAttachShader(handle, shader.getHandle());
+  }
+  if (!path.empty())
+    glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  link();
+  if (path.empty())
+    return;
+
+  GLint length = 0, status = GL_FALSE;
+  glGetProgramiv(handle, GL_LINK_STATUS, &status);
+  glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (status != GL_TRUE || length <= 0)
+    return;
+  vector<char> binary(length);
+  GLenum format;
+  glGetProgramBinary(handle, length, &length, &format, binary.data());
+  // written aside and renamed, a concurrent launch never reads half a file
+  try {
+    filesystem::create_directories(cache_dir);
+    string temporary = path + ".tmp";
+    {
+      ofstream file(temporary, ios_base::binary | ios_base::trunc);
+      file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+      file.write(binary.data(), length);
+      if (!file)
+        throw runtime_error("write failed");
+    }
+    filesystem::rename(temporary, path);
+  } catch (const exception& e) {
+    cout << "[Info] Program binary not cached in " << cache_dir << ": " << e.what() << endl;
+  }
+}
+
+string ShaderProgram::defaultCacheDirectory() {
+  if (const char* dir = getenv("GRAPHS_CACHE_DIR"))
+    return dir;
+#ifdef _WIN32
+  if (const char* dir = getenv("LOCALAPPDATA"))
+    return string(dir) + "/graphs/programs";
+#else
+  if (const char* dir = getenv("XDG_CACHE_HOME"))
+    return string(dir) + "/graphs/programs";
+  if (const char* dir = getenv("HOME"))
+    return string(dir) + "/.cache/graphs/programs";
+#endif
+  return "";
+}
+
 void ShaderProgram::link() {
   glLinkProgram(handle);
   GLint result;
@@ -14,6 +14,7 @@
 #include <initializer_list>
 #include <map>
 #include <string>
+#include <utility>
 
 class Shader;
 class ShaderProgram;
@@ -46,6 +47,19 @@ class ShaderProgram {
   // constructor
   ShaderProgram(std::initializer_list<Shader> shaderList);
 
+  // Compiles and links the shader files, or loads the program binary the
+  // driver returned for the same sources earlier. Binaries are kept in
+  // cache_dir under a hash of the sources and the driver strings; with an
+  // empty cache_dir, without program binaries or when the driver rejects a
+  // binary, the sources are compiled as usual.
+  ShaderProgram(std::initializer_list<std::pair<std::string, GLenum>> files, const std::string& cache_dir);
+
+  // whether the program was loaded from the cache
+  bool fromCache() const { return from_cache; }
+
+  // the per-user cache directory of program binaries, empty when unknown
+  static std::string defaultCacheDirectory();
+
   // bind the program
   void use() const;
   void unuse() const;
@@ -88,6 +102,7 @@ class ShaderProgram {
 
   // opengl id
   GLuint handle;
+  bool from_cache = false;
 
   void link();
 };
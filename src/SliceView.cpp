@@ -0,0 +1,150 @@
+#include "SliceView.hpp"
+
+#include <VectorKernels.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// removes the component along the unit vector u from v and normalizes v,
+// returns false when nothing is left
+bool orthonormalize(std::vector<double>& v, const std::vector<double>* u) {
+  size_t n = v.size();
+  if (u)
+    axpy(-dot(u->data(), v.data(), n), u->data(), v.data(), n);
+  double length = norm(v.data(), n);
+  if (!(length > 1e-300))
+    return false;
+  scale(1.0 / length, v.data(), n);
+  return true;
+}
+
+} // namespace
+
+void SlicePlane::point(glm::vec2 p, double* out) const {
+  size_t n = origin.size();
+  std::copy(origin.begin(), origin.end(), out);
+  axpy(double(p.x), u.data(), out, n);
+  axpy(double(p.y), v.data(), out, n);
+}
+
+glm::vec2 SlicePlane::project(const double* x) const {
+  // u.(x - origin) without a temporary
+  size_t n = origin.size();
+  double px = dot(u.data(), x, n) - dot(u.data(), origin.data(), n);
+  double py = dot(v.data(), x, n) - dot(v.data(), origin.data(), n);
+  return glm::vec2(px, py);
+}
+
+SliceView::SliceView(NdFunction function, unsigned threads) : function(std::move(function)), pool(threads) {
+  if (this->function.dimension < 2)
+    throw std::invalid_argument("SliceView: slices need at least 2 dimensions");
+}
+
+void SliceView::setDirections(Directions directions) {
+  this->directions = directions;
+  if (directions != Directions::Random)
+    return;
+  size_t n = function.dimension;
+  std::normal_distribution<double> normal;
+  random_u.resize(n);
+  random_v.resize(n);
+  do {
+    for (auto &x : random_u)
+      x = normal(random);
+    for (auto &x : random_v)
+      x = normal(random);
+  } while (!orthonormalize(random_u, nullptr) || !orthonormalize(random_v, &random_u));
+}
+
+void SliceView::nextAxis(bool second) {
+  size_t n = function.dimension;
+  size_t& axis = second ? axis_v : axis_u;
+  size_t other = second ? axis_u : axis_v;
+  axis = (axis + 1) % n;
+  if (axis == other)
+    axis = (axis + 1) % n;
+}
+
+std::string SliceView::describe() const {
+  switch (directions) {
+    case Directions::Axes:
+      return "axes " + std::to_string(axis_u) + " and " + std::to_string(axis_v) + " of " +
+             std::to_string(function.dimension);
+    case Directions::Random:
+      return "random directions in " + std::to_string(function.dimension) + " dimensions";
+    case Directions::Principal:
+      return "principal curvature directions in " + std::to_string(function.dimension) + " dimensions";
+  }
+  return "";
+}
+
+std::shared_ptr<const SlicePlane> SliceView::plane(const double* origin) {
+  size_t n = function.dimension;
+  auto plane = std::make_shared<SlicePlane>();
+  plane->origin.assign(origin, origin + n);
+  switch (directions) {
+    case Directions::Axes:
+      plane->u.assign(n, 0.0);
+      plane->v.assign(n, 0.0);
+      plane->u[axis_u] = 1.0;
+      plane->v[axis_v] = 1.0;
+      break;
+    case Directions::Random:
+      plane->u = random_u;
+      plane->v = random_v;
+      break;
+    case Directions::Principal:
+      principalDirections(origin, plane->u, plane->v);
+      break;
+  }
+  return plane;
+}
+
+void SliceView::principalDirections(const double* origin, std::vector<double>& u, std::vector<double>& v) const {
+  const size_t n = function.dimension;
+  const int iterations = 50;
+  std::vector<double> product(n), scratch;
+  std::mt19937_64 start(0x5eed);
+  std::normal_distribution<double> normal;
+
+  // power iteration, the second vector is kept orthogonal to the first
+  auto dominant = [&](std::vector<double>& w, const std::vector<double>* first) {
+    w.resize(n);
+    for (auto &x : w)
+      x = normal(start);
+    orthonormalize(w, first);
+    for (int k = 0; k < iterations; ++k) {
+      function.hessianVector(origin, w.data(), product.data(), scratch);
+      w.swap(product);
+      if (!orthonormalize(w, first)) {
+        // w is in the null space, any orthogonal direction will do
+        std::fill(w.begin(), w.end(), 0.0);
+        w[first && std::abs((*first)[0]) > 0.5 ? 1 : 0] = 1.0;
+        orthonormalize(w, first);
+        return;
+      }
+    }
+  };
+  dominant(u, nullptr);
+  dominant(v, &u);
+}
+
+void SliceView::evaluate(const SlicePlane& plane, const glm::vec2* points, float* values, size_t count) const {
+  const size_t chunk = 256;
+  pool.parallelFor(0, (count + chunk - 1) / chunk, [&](size_t c) {
+    std::vector<double> x(function.dimension);
+    size_t end = std::min(count, (c + 1) * chunk);
+    for (size_t i = c * chunk; i < end; ++i) {
+      plane.point(points[i], x.data());
+      values[i] = function.value(x.data());
+    }
+  });
+}
+
+float SliceView::value(const SlicePlane& plane, glm::vec2 p, std::vector<double>& scratch) const {
+  scratch.resize(function.dimension);
+  plane.point(p, scratch.data());
+  return function.value(scratch.data());
+}
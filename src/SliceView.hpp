@@ -0,0 +1,62 @@
+#ifndef SLICEVIEW_HPP
+#define SLICEVIEW_HPP
+
+#include <NdFunction.hpp>
+#include <ThreadPool.hpp>
+#include <glm/glm.hpp>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Plane through origin in R^n spanned by the orthonormal u and v, the graph
+// coordinates (x, y) stand for origin + x u + y v
+struct SlicePlane {
+  std::vector<double> origin, u, v;
+
+  void point(glm::vec2 p, double* out) const;
+  // coordinates of the orthogonal projection of x
+  glm::vec2 project(const double* x) const;
+};
+
+// 2D slices of an NdFunction for the function graph. The directions of a
+// slice are two coordinate axes, two random directions, or the principal
+// curvature directions at its origin: the eigenvectors of the two largest
+// eigenvalues (in magnitude) of the Hessian, found by power iteration on
+// Hessian-vector products.
+class SliceView {
+public:
+  enum class Directions { Axes, Random, Principal };
+
+  explicit SliceView(NdFunction function, unsigned threads = 0);
+
+  const NdFunction& getFunction() const { return function; }
+  size_t dimension() const { return function.dimension; }
+
+  Directions getDirections() const { return directions; }
+  // new random directions every time they are chosen
+  void setDirections(Directions directions);
+  // next pair of axes, first or second axis
+  void nextAxis(bool second);
+  std::string describe() const;
+
+  // the slice through origin along the current directions
+  std::shared_ptr<const SlicePlane> plane(const double* origin);
+
+  // values of the slice at count points, in parallel; thread safe
+  void evaluate(const SlicePlane& plane, const glm::vec2* points, float* values, size_t count) const;
+  // scratch holds the point in R^n
+  float value(const SlicePlane& plane, glm::vec2 p, std::vector<double>& scratch) const;
+
+private:
+  NdFunction function;
+  mutable ThreadPool pool;
+  Directions directions = Directions::Axes;
+  size_t axis_u = 0, axis_v = 1;
+  std::mt19937_64 random{0x5eed};
+  std::vector<double> random_u, random_v;
+
+  void principalDirections(const double* origin, std::vector<double>& u, std::vector<double>& v) const;
+};
+
+#endif // SLICEVIEW_HPP
@@ -0,0 +1,242 @@
+#include "SurfaceLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <stdexcept>
+
+namespace {
+
+const int kCacheSize = 32;
+
+float vertexScore(int cache_position, int remaining_triangles) {
+  // constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+  const float cache_decay_power = 1.5f;
+  const float last_triangle_score = 0.75f;
+  const float valence_boost_scale = 2.0f;
+  const float valence_boost_power = 0.5f;
+
+  if (remaining_triangles == 0)
+    return -1.0f;
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3)
+      score = last_triangle_score;
+    else
+      score = std::pow(1.0f - float(cache_position - 3) / (kCacheSize - 3), cache_decay_power);
+  }
+  return score + valence_boost_scale * std::pow(float(remaining_triangles), -valence_boost_power);
+}
+
+} // namespace
+
+void optimizeVertexCache(std::vector<uint16_t>& index, size_t vertex_count) {
+  const size_t triangle_count = index.size() / 3;
+  std::vector<std::vector<uint32_t>> triangles_of(vertex_count);
+  for (size_t t = 0; t < triangle_count; ++t)
+    for (int k = 0; k < 3; ++k)
+      triangles_of[index[3 * t + k]].push_back(t);
+
+  std::vector<int> remaining(vertex_count), cache_position(vertex_count, -1);
+  std::vector<float> score(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    remaining[v] = triangles_of[v].size();
+    score[v] = vertexScore(-1, remaining[v]);
+  }
+  std::vector<float> triangle_score(triangle_count);
+  std::vector<bool> emitted(triangle_count, false);
+  for (size_t t = 0; t < triangle_count; ++t)
+    triangle_score[t] = score[index[3 * t]] + score[index[3 * t + 1]] + score[index[3 * t + 2]];
+
+  std::vector<uint16_t> result;
+  result.reserve(index.size());
+  std::vector<uint16_t> cache;
+  size_t scan_from = 0;
+
+  auto best_remaining = [&]() {
+    // full scan, only needed when no triangle touches the cache
+    int64_t best = -1;
+    for (size_t t = scan_from; t < triangle_count; ++t)
+      if (!emitted[t] && (best < 0 || triangle_score[t] > triangle_score[best]))
+        best = t;
+    while (scan_from < triangle_count && emitted[scan_from])
+      ++scan_from;
+    return best;
+  };
+
+  int64_t best = best_remaining();
+  while (best >= 0) {
+    emitted[best] = true;
+    std::vector<uint16_t> new_cache;
+    for (int k = 0; k < 3; ++k) {
+      uint16_t v = index[3 * best + k];
+      result.push_back(v);
+      new_cache.push_back(v);
+      --remaining[v];
+      auto &list = triangles_of[v];
+      list.erase(std::find(list.begin(), list.end(), uint32_t(best)));
+    }
+    for (uint16_t v : cache)
+      if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end())
+        new_cache.push_back(v);
+
+    // update the vertices that were or are in the cache
+    for (size_t i = 0; i < new_cache.size(); ++i) {
+      uint16_t v = new_cache[i];
+      cache_position[v] = i < size_t(kCacheSize) ? int(i) : -1;
+      score[v] = vertexScore(cache_position[v], remaining[v]);
+    }
+    if (new_cache.size() > size_t(kCacheSize))
+      new_cache.resize(kCacheSize);
+    cache = std::move(new_cache);
+
+    best = -1;
+    for (uint16_t v : cache)
+      for (uint32_t t : triangles_of[v]) {
+        triangle_score[t] = score[index[3 * t]] + score[index[3 * t + 1]] + score[index[3 * t + 2]];
+        if (best < 0 || triangle_score[t] > triangle_score[best])
+          best = t;
+      }
+    if (best < 0)
+      best = best_remaining();
+  }
+  index = std::move(result);
+}
+
+float averageCacheMissRatio(const std::vector<uint16_t>& index, size_t cache_size) {
+  std::deque<uint16_t> cache;
+  size_t misses = 0;
+  for (uint16_t v : index) {
+    if (std::find(cache.begin(), cache.end(), v) != cache.end())
+      continue;
+    ++misses;
+    cache.push_back(v);
+    if (cache.size() > cache_size)
+      cache.pop_front();
+  }
+  return index.empty() ? 0.0f : float(misses) / (index.size() / 3);
+}
+
+SurfaceLayout::SurfaceLayout(int size, int tile, Mode mode) : size(size), tile(tile), mode(mode) {
+  if ((tile + 1) * (tile + 1) >= restartIndex)
+    throw std::invalid_argument("SurfaceLayout: tiles do not fit 16-bit indices");
+
+  size_t index_offset = 0;
+  for (int y0 = 0; y0 < size; y0 += tile)
+    for (int x0 = 0; x0 < size; x0 += tile) {
+      int w = std::min(tile, size - x0), h = std::min(tile, size - y0);
+      auto it = std::find_if(patterns.begin(), patterns.end(),
+                             [&](const Pattern& p) { return p.w == w && p.h == h; });
+      if (it == patterns.end()) {
+        patterns.push_back(makePattern(w, h));
+        patterns.back().index_offset = index_offset;
+        index_offset += patterns.back().index.size();
+        it = patterns.end() - 1;
+      }
+      tiles.push_back({x0, y0, int(it - patterns.begin()), int32_t(vertex_count)});
+      vertex_count += it->vertices.size();
+    }
+}
+
+SurfaceLayout::Pattern SurfaceLayout::makePattern(int w, int h) const {
+  Pattern pattern;
+  pattern.w = w;
+  pattern.h = h;
+  auto local = [&](int x, int y) { return uint16_t(x + (w + 1) * y); };
+
+  if (mode == Mode::Strips) {
+    // rows as strips (x, y + 1), (x, y), (x + 1, y + 1), ... keep the
+    // diagonal and winding of the triangle list
+    for (int y = 0; y < h; ++y) {
+      if (y > 0)
+        pattern.index.push_back(restartIndex);
+      for (int x = 0; x <= w; ++x) {
+        pattern.index.push_back(local(x, y + 1));
+        pattern.index.push_back(local(x, y));
+      }
+    }
+  }
+  else {
+    for (int y = 0; y < h; ++y)
+      for (int x = 0; x < w; ++x) {
+        pattern.index.insert(pattern.index.end(), {local(x, y), local(x + 1, y), local(x + 1, y + 1),
+                                                   local(x + 1, y + 1), local(x, y + 1), local(x, y)});
+      }
+    if (mode == Mode::OptimizedTriangles)
+      optimizeVertexCache(pattern.index, (w + 1) * (h + 1));
+  }
+
+  // number the vertices in order of first use
+  std::vector<int> remap((w + 1) * (h + 1), -1);
+  for (auto &i : pattern.index) {
+    if (i == restartIndex)
+      continue;
+    if (remap[i] < 0) {
+      remap[i] = pattern.vertices.size();
+      pattern.vertices.push_back({uint16_t(i % (w + 1)), uint16_t(i / (w + 1))});
+    }
+    i = remap[i];
+  }
+
+  if (mode == Mode::Strips) {
+    // a strip of n vertices issues n - 2 triangles through the cache
+    std::vector<uint16_t> list;
+    std::vector<uint16_t> strip;
+    auto flush = [&]() {
+      for (size_t k = 2; k < strip.size(); ++k)
+        list.insert(list.end(), {strip[k - 2], strip[k - 1], strip[k]});
+      strip.clear();
+    };
+    for (uint16_t i : pattern.index) {
+      if (i == restartIndex)
+        flush();
+      else
+        strip.push_back(i);
+    }
+    flush();
+    pattern.acmr = averageCacheMissRatio(list);
+  }
+  else
+    pattern.acmr = averageCacheMissRatio(pattern.index);
+  return pattern;
+}
+
+std::vector<uint16_t> SurfaceLayout::indexData() const {
+  std::vector<uint16_t> data(indexCount());
+  copyIndexData(data.data());
+  return data;
+}
+
+size_t SurfaceLayout::indexCount() const {
+  size_t count = 0;
+  for (auto &pattern : patterns)
+    count += pattern.index.size();
+  return count;
+}
+
+void SurfaceLayout::copyIndexData(uint16_t* out) const {
+  for (auto &pattern : patterns)
+    out = std::copy(pattern.index.begin(), pattern.index.end(), out);
+}
+
+float SurfaceLayout::acmr() const {
+  double misses = 0.0, triangles = 0.0;
+  for (auto &t : tiles) {
+    const Pattern& p = patterns[t.pattern];
+    misses += p.acmr * 2 * p.w * p.h;
+    triangles += 2 * p.w * p.h;
+  }
+  return triangles > 0.0 ? misses / triangles : 0.0f;
+}
+
+std::string SurfaceLayout::modeName(Mode mode) {
+  switch (mode) {
+    case Mode::Triangles:
+      return "triangles";
+    case Mode::OptimizedTriangles:
+      return "cache optimized triangles";
+    case Mode::Strips:
+      return "strips";
+  }
+  return "";
+}
@@ -0,0 +1,72 @@
+#ifndef SURFACELAYOUT_HPP
+#define SURFACELAYOUT_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Splits the grid of (size + 1) x (size + 1) vertices of the graph into tiles
+// of at most tile x tile quads. Every tile has its own copy of its vertices,
+// so the triangles of a tile are described by 16-bit indices relative to the
+// first vertex of the tile (the base vertex). Tiles of the same dimensions
+// share one index pattern, whose triangles are ordered for the post-transform
+// vertex cache and whose vertices are ordered by first use.
+class SurfaceLayout {
+public:
+  enum class Mode {
+    Triangles,           // row by row triangle list
+    OptimizedTriangles,  // triangle list reordered for the vertex cache
+    Strips               // one strip per row, separated by restartIndex
+  };
+
+  struct Pattern {
+    int w, h;  // quads
+    std::vector<uint16_t> index;
+    // grid offset (x, y) inside the tile of every vertex, in buffer order
+    std::vector<std::pair<uint16_t, uint16_t>> vertices;
+    size_t index_offset;  // in the concatenated index data, in indices
+    float acmr;           // average cache misses per triangle
+  };
+
+  struct Tile {
+    int x0, y0;  // first quad of the tile in the grid
+    int pattern;
+    int32_t base_vertex;
+  };
+
+  static constexpr uint16_t restartIndex = 0xFFFF;
+
+  SurfaceLayout(int size, int tile, Mode mode);
+
+  Mode getMode() const { return mode; }
+  int getSize() const { return size; }
+  const std::vector<Pattern>& getPatterns() const { return patterns; }
+  const std::vector<Tile>& getTiles() const { return tiles; }
+  size_t vertexCount() const { return vertex_count; }
+  // the index patterns one after another
+  std::vector<uint16_t> indexData() const;
+  size_t indexCount() const;
+  // writes indexCount() indices to out
+  void copyIndexData(uint16_t* out) const;
+  // cache misses per triangle over all tiles
+  float acmr() const;
+
+  static std::string modeName(Mode mode);
+
+private:
+  int size, tile;
+  Mode mode;
+  std::vector<Pattern> patterns;
+  std::vector<Tile> tiles;
+  size_t vertex_count = 0;
+
+  Pattern makePattern(int w, int h) const;
+};
+
+// Forsyth's linear-speed vertex cache optimisation of a triangle list
+void optimizeVertexCache(std::vector<uint16_t>& index, size_t vertex_count);
+// average cache misses per triangle of a triangle list on a FIFO cache
+float averageCacheMissRatio(const std::vector<uint16_t>& index, size_t cache_size = 32);
+
+#endif // SURFACELAYOUT_HPP
@@ -0,0 +1,77 @@
+#include "SurfaceStream.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+SurfaceStream::SurfaceStream(TimedFunction function, ThreadPool& pool)
+    : function(std::move(function)), pool(pool) {}
+
+void SurfaceStream::refresh(int n, float diff, int i0, int j0, float t, double budget) {
+  ++refreshes;
+  refreshed_all = !valid || n != this->n || diff != this->diff || i0 != this->i0 || j0 != this->j0;
+  if (refreshed_all) {
+    this->n = n;
+    this->diff = diff;
+    this->i0 = i0;
+    this->j0 = j0;
+    blocks = (n + block - 1) / block;
+    values.resize(n * n);
+    positions.resize(n * n);
+    block_t.assign(blocks * blocks, t);
+    block_refresh.assign(blocks * blocks, 0);
+    valid = true;
+  }
+  this->t = t;
+
+  // blocks behind t, the ones refreshed longest ago first
+  order.clear();
+  for (uint32_t b = 0; b < block_t.size(); ++b)
+    if (refreshed_all || block_t[b] != t)
+      order.push_back(b);
+  std::stable_sort(order.begin(), order.end(),
+                   [this](uint32_t a, uint32_t b) { return block_refresh[a] < block_refresh[b]; });
+
+  auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+  std::atomic<size_t> next{0};
+  pool.parallelFor(0, pool.size(), [&](size_t) {
+    for (size_t k = next++; k < order.size(); k = next++) {
+      // a moved grid has no heights to keep, and every refresh makes progress
+      if (!refreshed_all && k > 0 && std::chrono::steady_clock::now() > deadline)
+        return;
+      evaluateBlock(order[k]);
+    }
+  });
+}
+
+void SurfaceStream::evaluateBlock(uint32_t index) {
+  int x0 = index % blocks * block, y0 = index / blocks * block;
+  int x1 = std::min(x0 + block, n), y1 = std::min(y0 + block, n);
+  for (int y = y0; y < y1; ++y) {
+    glm::vec2* row = positions.data() + y * n;
+    for (int x = x0; x < x1; ++x)
+      row[x] = diff * glm::vec2(i0 + x, j0 + y);
+    function.evaluate(row + x0, t, values.data() + y * n + x0, x1 - x0);
+  }
+  block_t[index] = t;
+  block_refresh[index] = refreshes;
+}
+
+bool SurfaceStream::changed(int x0, int y0, int x1, int y1) const {
+  if (refreshed_all)
+    return true;
+  x0 = std::max(x0, 0) / block;
+  y0 = std::max(y0, 0) / block;
+  x1 = (std::min(x1, n) - 1) / block;
+  y1 = (std::min(y1, n) - 1) / block;
+  for (int by = y0; by <= y1; ++by)
+    for (int bx = x0; bx <= x1; ++bx)
+      if (block_refresh[by * blocks + bx] == refreshes)
+        return true;
+  return false;
+}
+
+size_t SurfaceStream::staleCount() const {
+  return std::count_if(block_t.begin(), block_t.end(), [this](float block_t) { return block_t != t; });
+}
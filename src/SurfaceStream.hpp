@@ -0,0 +1,57 @@
+#ifndef SURFACESTREAM_HPP
+#define SURFACESTREAM_HPP
+
+#include <Animation.hpp>
+#include <ThreadPool.hpp>
+#include <cstdint>
+#include <vector>
+
+// Heights of a timed function on the grid of the graph, kept up to date with
+// t within a time budget per refresh. The grid is split into blocks evaluated
+// in parallel, those refreshed longest ago first; blocks that do not fit in
+// the budget keep their heights until a later refresh. A grid that moved is
+// evaluated in full.
+class SurfaceStream {
+public:
+  static constexpr int block = 32;  // heights per side of a block
+
+  // blocks are evaluated on pool
+  SurfaceStream(TimedFunction function, ThreadPool& pool);
+
+  SurfaceStream(const SurfaceStream&) = delete;
+  SurfaceStream& operator=(const SurfaceStream&) = delete;
+
+  // refreshes the n x n heights at the multiples diff * (i0 + x, j0 + y) to t
+  void refresh(int n, float diff, int i0, int j0, float t, double budget);
+  // the next refresh evaluates every block, e.g. after the function changed
+  void invalidate() { valid = false; }
+
+  const float* heights() const { return values.data(); }
+  // whether a height of [x0, x1) x [y0, y1) changed in the last refresh
+  bool changed(int x0, int y0, int x1, int y1) const;
+  // the last refresh evaluated the whole grid
+  bool refreshedAll() const { return refreshed_all; }
+  // blocks whose heights are not at the t of the last refresh
+  size_t staleCount() const;
+
+private:
+  TimedFunction function;
+  ThreadPool& pool;
+
+  int n = 0, blocks = 0;  // blocks per side
+  float diff = 0.0f;
+  int i0 = 0, j0 = 0;
+  float t = 0.0f;
+  bool valid = false, refreshed_all = false;
+  uint64_t refreshes = 0;
+
+  std::vector<float> values;
+  std::vector<glm::vec2> positions;
+  std::vector<float> block_t;           // t of the heights of every block
+  std::vector<uint64_t> block_refresh;  // refresh that evaluated it last
+  std::vector<uint32_t> order;
+
+  void evaluateBlock(uint32_t index);
+};
+
+#endif // SURFACESTREAM_HPP
@@ -0,0 +1,361 @@
+#include "Surrogate.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// samples per bin of the neighbor search, on average
+const size_t kSamplesPerBin = 4;
+// variance of the noise on the samples, relative to the variance of the
+// process; keeps the kernel matrix of close samples invertible
+const double kNugget = 1e-6;
+// candidates per side of the rectangle searched by mostUncertain()
+const int kCandidates = 32;
+// samples predicted by each length scale tried by a fit
+const size_t kChecked = 256;
+
+// uniform in [0, 1) from a lattice point and a seed
+float jitter(uint32_t i, uint32_t j, uint32_t seed) {
+  uint32_t h = i * 0x9e3779b1u ^ (j + 0x7f4a7c15u) * 0x85ebca77u ^ seed * 0xc2b2ae3du;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  h *= 0x297a2d39u;
+  h ^= h >> 15;
+  return (h >> 8) * (1.0f / (1u << 24));
+}
+
+} // namespace
+
+SurrogateModel::SurrogateModel(std::vector<Sample> input) {
+  if (input.empty())
+    return;
+  size_t n = input.size();
+  double sum = 0.0, squares = 0.0;
+  glm::vec2 upper = input[0].position;
+  lower = input[0].position;
+  for (auto &sample : input) {
+    sum += sample.value;
+    squares += double(sample.value) * sample.value;
+    lower = glm::min(lower, sample.position);
+    upper = glm::max(upper, sample.position);
+  }
+  mean = sum / n;
+  variance = std::max(squares / n - double(mean) * mean, 1e-12 * (1.0 + double(mean) * mean));
+
+  // bins of a few samples each, about square
+  glm::vec2 extent = glm::max(upper - lower, glm::vec2(1e-6f * std::max(1.0f, glm::length(upper - lower))));
+  double bins = std::max<size_t>(1, n / kSamplesPerBin);
+  bins_x = std::clamp(int(std::ceil(std::sqrt(bins * extent.x / extent.y))), 1, 4096);
+  bins_y = std::clamp(int(std::ceil(bins / bins_x)), 1, 4096);
+  cell = extent / glm::vec2(bins_x, bins_y);
+  auto binOf = [&](glm::vec2 p) {
+    int x = std::min(int((p.x - lower.x) / cell.x), bins_x - 1);
+    int y = std::min(int((p.y - lower.y) / cell.y), bins_y - 1);
+    return size_t(y) * bins_x + x;
+  };
+  offsets.assign(size_t(bins_x) * bins_y + 1, 0);
+  for (auto &sample : input)
+    ++offsets[binOf(sample.position) + 1];
+  for (size_t b = 1; b < offsets.size(); ++b)
+    offsets[b] += offsets[b - 1];
+  samples.resize(n);
+  std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+  for (auto &sample : input)
+    samples[next[binOf(sample.position)]++] = sample;
+
+  // the length scale of the kernel is the multiple of the median distance
+  // between neighbors that predicts the samples best, each from its
+  // neighbors without it, checked on a subset of them
+  std::vector<float> spacing;
+  spacing.reserve(n);
+  const Sample* found[neighbors + 1];
+  float distances[neighbors + 1];
+  for (auto &sample : samples)
+    if (nearest(sample.position, 2, found, distances) == 2 && distances[1] > 0.0f)
+      spacing.push_back(distances[1]);
+  length = 1.0f;
+  if (spacing.empty() || n <= 2)
+    return;
+  std::nth_element(spacing.begin(), spacing.begin() + spacing.size() / 2, spacing.end());
+  float median = std::sqrt(spacing[spacing.size() / 2]);
+  size_t stride = std::max<size_t>(1, n / kChecked);
+  double best_error = std::numeric_limits<double>::infinity();
+  float best_length = median;
+  Local local;
+  for (float multiple : {1.0f, 2.0f, 4.0f, 8.0f}) {
+    length = multiple * median;
+    double error = 0.0;
+    for (size_t i = 0; i < n; i += stride) {
+      int count = nearest(samples[i].position, neighbors + 1, found, distances);
+      // the sample itself is among the nearest, at distance 0
+      int self = int(std::find(found, found + count, &samples[i]) - found);
+      if (self < count) {
+        std::copy(found + self + 1, found + count, found + self);
+        std::copy(distances + self + 1, distances + count, distances + self);
+        --count;
+      }
+      conditionOn(samples[i].position, found, distances, std::min(count, neighbors), local, nullptr);
+      double predicted = mean;
+      for (int k = 0; k < local.count; ++k)
+        predicted += local.weights[k] * local.kernel[k];
+      error += (predicted - samples[i].value) * (predicted - samples[i].value);
+    }
+    if (error < best_error) {
+      best_error = error;
+      best_length = length;
+    }
+  }
+  length = best_length;
+}
+
+std::shared_ptr<const SurrogateModel> SurrogateModel::refit(const Sample* added, size_t count) const {
+  std::vector<Sample> all(samples);
+  all.insert(all.end(), added, added + count);
+  return std::make_shared<const SurrogateModel>(std::move(all));
+}
+
+int SurrogateModel::nearest(glm::vec2 p, int k, const Sample** found, float* distances) const {
+  // rings of bins around the bin of p, until the next ring is farther than
+  // the farthest neighbor found
+  int cx = int(std::clamp(std::floor((p.x - lower.x) / cell.x), 0.0f, float(bins_x - 1)));
+  int cy = int(std::clamp(std::floor((p.y - lower.y) / cell.y), 0.0f, float(bins_y - 1)));
+  if (!(p.x == p.x) || !(p.y == p.y))
+    cx = cy = 0;
+  int count = 0;
+  auto visit = [&](int bx, int by) {
+    size_t b = size_t(by) * bins_x + bx;
+    for (uint32_t i = offsets[b]; i < offsets[b + 1]; ++i) {
+      glm::vec2 d = samples[i].position - p;
+      float distance = glm::dot(d, d);
+      if (count == k && !(distance < distances[count - 1]))
+        continue;
+      int j = count < k ? count++ : count - 1;
+      for (; j > 0 && distances[j - 1] > distance; --j) {
+        distances[j] = distances[j - 1];
+        found[j] = found[j - 1];
+      }
+      distances[j] = distance;
+      found[j] = &samples[i];
+    }
+  };
+  for (int r = 0;; ++r) {
+    for (int by = cy - r; by <= cy + r; ++by) {
+      if (by < 0 || by >= bins_y)
+        continue;
+      int step = by == cy - r || by == cy + r ? 1 : 2 * r;
+      for (int bx = cx - r; bx <= cx + r; bx += step)
+        if (bx >= 0 && bx < bins_x)
+          visit(bx, by);
+    }
+    if (cx - r <= 0 && cy - r <= 0 && cx + r >= bins_x - 1 && cy + r >= bins_y - 1)
+      break;
+    // the bins left are in up to four strips of the grid around the ring,
+    // a p outside the grid is measured to them and not to the ring itself
+    glm::vec2 grid_hi = lower + cell * glm::vec2(bins_x, bins_y);
+    glm::vec2 ring_lo = lower + cell * glm::vec2(std::max(cx - r, 0), std::max(cy - r, 0));
+    glm::vec2 ring_hi = lower + cell * glm::vec2(std::min(cx + r + 1, bins_x), std::min(cy + r + 1, bins_y));
+    auto boxDistance = [&](glm::vec2 lo, glm::vec2 hi) {
+      glm::vec2 d(std::max(std::max(lo.x - p.x, p.x - hi.x), 0.0f),
+                  std::max(std::max(lo.y - p.y, p.y - hi.y), 0.0f));
+      return glm::dot(d, d);
+    };
+    float reach = std::numeric_limits<float>::infinity();
+    if (cx - r > 0)
+      reach = std::min(reach, boxDistance(lower, glm::vec2(ring_lo.x, grid_hi.y)));
+    if (cx + r < bins_x - 1)
+      reach = std::min(reach, boxDistance(glm::vec2(ring_hi.x, lower.y), grid_hi));
+    if (cy - r > 0)
+      reach = std::min(reach, boxDistance(lower, glm::vec2(grid_hi.x, ring_lo.y)));
+    if (cy + r < bins_y - 1)
+      reach = std::min(reach, boxDistance(glm::vec2(lower.x, ring_hi.y), grid_hi));
+    if (count == k && reach >= distances[count - 1])
+      break;
+  }
+  return count;
+}
+
+void SurrogateModel::condition(glm::vec2 p, Local& local, float* deviation) const {
+  const Sample* found[neighbors];
+  float distances[neighbors];
+  int n = samples.empty() ? 0 : nearest(p, neighbors, found, distances);
+  conditionOn(p, found, distances, n, local, deviation);
+}
+
+void SurrogateModel::conditionOn(glm::vec2 p, const Sample* const* found, const float* distances, int n,
+                                 Local& local, float* deviation) const {
+  local.count = n;
+
+  // Cholesky factor of the kernel matrix of the neighbors, in double: close
+  // samples make it nearly singular
+  double s2 = variance, scale = -0.5 / (double(length) * length);
+  double factor[neighbors][neighbors];
+  for (int i = 0; i < n; ++i) {
+    local.offsets[i] = p - found[i]->position;
+    for (int j = 0; j <= i; ++j) {
+      glm::vec2 d = found[i]->position - found[j]->position;
+      double sum = s2 * std::exp(scale * glm::dot(d, d)) + (i == j ? kNugget * s2 : 0.0);
+      for (int m = 0; m < j; ++m)
+        sum -= factor[i][m] * factor[j][m];
+      factor[i][j] = i == j ? std::sqrt(std::max(sum, 1e-300)) : sum / factor[j][j];
+    }
+    local.kernel[i] = s2 * std::exp(scale * distances[i]);
+  }
+  // weights: the kernel matrix solved for the values minus the mean
+  double z[neighbors];
+  for (int i = 0; i < n; ++i) {
+    double sum = found[i]->value - mean;
+    for (int m = 0; m < i; ++m)
+      sum -= factor[i][m] * z[m];
+    z[i] = sum / factor[i][i];
+  }
+  for (int i = n - 1; i >= 0; --i) {
+    double sum = z[i];
+    for (int m = i + 1; m < n; ++m)
+      sum -= factor[m][i] * local.weights[m];
+    local.weights[i] = sum / factor[i][i];
+  }
+  if (deviation) {
+    // prior variance minus the part explained by the neighbors
+    double explained = 0.0;
+    for (int i = 0; i < n; ++i) {
+      double sum = local.kernel[i];
+      for (int m = 0; m < i; ++m)
+        sum -= factor[i][m] * z[m];
+      z[i] = sum / factor[i][i];
+      explained += z[i] * z[i];
+    }
+    *deviation = std::sqrt(std::max(s2 - explained, 0.0));
+  }
+}
+
+float SurrogateModel::value(glm::vec2 p) const {
+  Local local;
+  condition(p, local, nullptr);
+  double sum = mean;
+  for (int i = 0; i < local.count; ++i)
+    sum += local.weights[i] * local.kernel[i];
+  return sum;
+}
+
+glm::vec2 SurrogateModel::gradient(glm::vec2 p) const {
+  Local local;
+  condition(p, local, nullptr);
+  glm::dvec2 sum(0.0);
+  for (int i = 0; i < local.count; ++i)
+    sum -= local.weights[i] * local.kernel[i] * glm::dvec2(local.offsets[i]);
+  return glm::vec2(sum / (double(length) * length));
+}
+
+glm::mat2 SurrogateModel::hessian(glm::vec2 p) const {
+  Local local;
+  condition(p, local, nullptr);
+  double l2 = double(length) * length;
+  double xx = 0.0, xy = 0.0, yy = 0.0;
+  for (int i = 0; i < local.count; ++i) {
+    double w = local.weights[i] * local.kernel[i] / l2;
+    glm::dvec2 d(local.offsets[i]);
+    xx += w * (d.x * d.x / l2 - 1.0);
+    xy += w * d.x * d.y / l2;
+    yy += w * (d.y * d.y / l2 - 1.0);
+  }
+  return glm::mat2(xx, xy, xy, yy);
+}
+
+float SurrogateModel::deviation(glm::vec2 p) const {
+  Local local;
+  float result;
+  condition(p, local, &result);
+  return result;
+}
+
+void SurrogateModel::evaluate(const glm::vec2* points, float* values, size_t count) const {
+  // points close to each other, such as the lattice of the graph, mostly
+  // have the same neighbors: their weights are reused, in the order of the
+  // samples
+  const Sample* found[neighbors];
+  float distances[neighbors];
+  const Sample* weighted[neighbors];
+  Local local;
+  local.count = -1;
+  double scale = -0.5 / (double(length) * length);
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec2 p = points[i];
+    int n = samples.empty() ? 0 : nearest(p, neighbors, found, distances);
+    std::sort(found, found + n);
+    if (n != local.count || !std::equal(found, found + n, weighted)) {
+      for (int k = 0; k < n; ++k) {
+        glm::vec2 d = p - found[k]->position;
+        distances[k] = glm::dot(d, d);
+      }
+      conditionOn(p, found, distances, n, local, nullptr);
+      for (int k = 0; k < n; ++k)
+        weighted[k] = found[k];
+    }
+    double sum = mean;
+    for (int k = 0; k < n; ++k) {
+      glm::vec2 d = p - found[k]->position;
+      sum += local.weights[k] * variance * std::exp(scale * glm::dot(d, d));
+    }
+    values[i] = sum;
+  }
+}
+
+float SurrogateModel::mostUncertain(glm::vec2 lower, glm::vec2 upper, size_t count, uint32_t seed,
+                                    std::vector<glm::vec2>& out) const {
+  const int n = kCandidates * kCandidates;
+  glm::vec2 candidates[n];
+  float deviations[n], distances[n];
+  float largest = 0.0f;
+  Local local;
+  for (int j = 0; j < kCandidates; ++j)
+    for (int i = 0; i < kCandidates; ++i) {
+      glm::vec2 u = glm::vec2(i + jitter(i, j, seed), j + jitter(j, i, ~seed)) / float(kCandidates);
+      int c = j * kCandidates + i;
+      candidates[c] = lower + u * (upper - lower);
+      condition(candidates[c], local, &deviations[c]);
+      distances[c] = std::numeric_limits<float>::infinity();
+      largest = std::max(largest, deviations[c]);
+    }
+  // greedily the largest deviation, damped near the points taken before so
+  // that a batch spreads out; without samples this is a maximin design
+  glm::vec2 extent = upper - lower;
+  float radius = std::max(length, std::max(extent.x, extent.y) / (2.0f * std::sqrt(float(std::max<size_t>(count, 1)))));
+  float scale = -0.5f / (radius * radius);
+  for (size_t k = 0; k < count; ++k) {
+    int best = -1;
+    float best_score = -1.0f;
+    for (int c = 0; c < n; ++c) {
+      float score = std::isinf(distances[c]) ? deviations[c] : deviations[c] * -std::expm1(scale * distances[c]);
+      // ties, as without samples, go to the candidate farthest from the others
+      if (score > best_score || (score == best_score && best >= 0 && distances[c] > distances[best])) {
+        best = c;
+        best_score = score;
+      }
+    }
+    if (best < 0 || !(best_score > 0.0f))
+      break;
+    out.push_back(candidates[best]);
+    for (int c = 0; c < n; ++c) {
+      glm::vec2 d = candidates[c] - candidates[best];
+      distances[c] = std::min(distances[c], glm::dot(d, d));
+    }
+  }
+  return largest;
+}
+
+Surrogate::Surrogate(func_t function, std::optional<batch_t> batch)
+    : truth(std::move(function)), truth_batch(batch), current(std::make_shared<const SurrogateModel>()) {}
+
+func_t Surrogate::function() const {
+  return [this](glm::vec2 p) { return current->value(p); };
+}
+
+grad_t Surrogate::gradientFunction() const {
+  return [this](glm::vec2 p) { return current->gradient(p); };
+}
+
+hess_t Surrogate::hessianFunction() const {
+  return [this](glm::vec2 p) { return current->hessian(p); };
+}
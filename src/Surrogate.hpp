@@ -0,0 +1,99 @@
+#ifndef SURROGATE_HPP
+#define SURROGATE_HPP
+
+#include <utils.hpp>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Fit of the true values of a function at the points evaluated so far, a
+// local Gaussian process: the value at p is the posterior mean of a process
+// with a squared exponential kernel conditioned on the samples nearest to p,
+// found through a uniform grid of bins. Its deviation is the uncertainty of
+// the fit, 0 at the samples. A model is immutable, so it is shared with the
+// threads that sample it; a refit makes a new one.
+class SurrogateModel {
+public:
+  struct Sample {
+    glm::vec2 position;
+    float value;
+  };
+
+  static constexpr int neighbors = 16;
+
+  SurrogateModel() = default;
+  explicit SurrogateModel(std::vector<Sample> samples);
+
+  // the samples of this model and the given ones, refitted
+  std::shared_ptr<const SurrogateModel> refit(const Sample* added, size_t count) const;
+
+  size_t sampleCount() const { return samples.size(); }
+  float lengthScale() const { return length; }
+  // deviation of the process away from the samples
+  float priorDeviation() const { return std::sqrt(variance); }
+
+  float value(glm::vec2 p) const;
+  glm::vec2 gradient(glm::vec2 p) const;
+  glm::mat2 hessian(glm::vec2 p) const;
+  float deviation(glm::vec2 p) const;
+  void evaluate(const glm::vec2* points, float* values, size_t count) const;
+
+  // appends count points of the rectangle where the deviation is largest to
+  // out, spread apart: the candidates are a jittered 32 x 32 lattice, moved
+  // by seed. Returns the largest deviation of the candidates.
+  float mostUncertain(glm::vec2 lower, glm::vec2 upper, size_t count, uint32_t seed,
+                      std::vector<glm::vec2>& out) const;
+
+private:
+  std::vector<Sample> samples;  // by bin
+  std::vector<uint32_t> offsets;  // of the bins, bins + 1
+  glm::vec2 lower = glm::vec2(0.0f), cell = glm::vec2(1.0f);
+  int bins_x = 0, bins_y = 0;
+  float mean = 0.0f, variance = 1.0f, length = 1.0f;
+
+  // the up to k nearest samples of p, by increasing distance; returns their count
+  int nearest(glm::vec2 p, int k, const Sample** found, float* distances) const;
+
+  // the process conditioned on the neighbors of p: their weights in the mean
+  // and their kernel values at p; returns the count of neighbors, with
+  // deviation set when given
+  struct Local {
+    int count = 0;
+    glm::vec2 offsets[neighbors];  // p minus the sample
+    double weights[neighbors];
+    double kernel[neighbors];
+  };
+  void condition(glm::vec2 p, Local& local, float* deviation) const;
+  void conditionOn(glm::vec2 p, const Sample* const* found, const float* distances, int count, Local& local,
+                   float* deviation) const;
+};
+
+// The stand-in the graph and the optimizers use for an expensive function:
+// the current model, fitted to the true values evaluated in the background.
+// The functions below read the current model; they and setModel() are called
+// by one thread (the update thread), which hands the model to others.
+class Surrogate {
+public:
+  Surrogate(func_t function, std::optional<batch_t> batch);
+
+  // the true function, thread safe when the function is
+  void evaluate(const glm::vec2* points, float* values, size_t count) const {
+    evaluateBatch(truth, truth_batch, points, values, count);
+  }
+
+  const std::shared_ptr<const SurrogateModel>& model() const { return current; }
+  void setModel(std::shared_ptr<const SurrogateModel> model) { current = std::move(model); }
+
+  func_t function() const;
+  grad_t gradientFunction() const;
+  hess_t hessianFunction() const;
+
+private:
+  func_t truth;
+  std::optional<batch_t> truth_batch;
+  std::shared_ptr<const SurrogateModel> current;
+};
+
+#endif // SURROGATE_HPP
@@ -0,0 +1,79 @@
+#ifndef TEXTBUFFER_HPP
+#define TEXTBUFFER_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+// a number written in scientific notation with 2 digits, e.g. an error bar
+struct Scientific {
+  double value;
+};
+
+// Text of fixed capacity built without allocating. Numbers are formatted with
+// std::to_chars, floating point ones with 6 decimals like std::to_string.
+// Whatever does not fit is cut.
+template <size_t N>
+class TextBuffer {
+public:
+  TextBuffer() { data[0] = '\0'; }
+
+  void clear() {
+    length = 0;
+    data[0] = '\0';
+  }
+
+  TextBuffer& operator<<(std::string_view text) {
+    size_t count = std::min(text.size(), N - 1 - length);
+    text.copy(data + length, count);
+    length += count;
+    data[length] = '\0';
+    return *this;
+  }
+
+  TextBuffer& operator<<(const char* text) { return *this << std::string_view(text); }
+
+  TextBuffer& operator<<(char c) { return *this << std::string_view(&c, 1); }
+
+  TextBuffer& operator<<(double value) {
+    return format([&](char* first, char* last) {
+      return std::to_chars(first, last, value, std::chars_format::fixed, 6);
+    });
+  }
+
+  TextBuffer& operator<<(float value) { return *this << double(value); }
+
+  TextBuffer& operator<<(Scientific number) {
+    return format([&](char* first, char* last) {
+      return std::to_chars(first, last, number.value, std::chars_format::scientific, 1);
+    });
+  }
+
+  template <class T, class = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char>>>
+  TextBuffer& operator<<(T value) {
+    return format([&](char* first, char* last) { return std::to_chars(first, last, value); });
+  }
+
+  const char* c_str() const { return data; }
+  std::string_view view() const { return std::string_view(data, length); }
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+private:
+  char data[N];
+  size_t length = 0;
+
+  template <class ToChars>
+  TextBuffer& format(ToChars to_chars) {
+    // numbers are short, a scratch buffer keeps a cut number readable
+    char scratch[64];
+    auto result = to_chars(scratch, scratch + sizeof(scratch));
+    if (result.ec == std::errc())
+      *this << std::string_view(scratch, result.ptr - scratch);
+    return *this;
+  }
+};
+
+#endif // TEXTBUFFER_HPP
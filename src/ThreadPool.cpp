@@ -0,0 +1,52 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < threads; ++i)
+    workers.emplace_back([this]() { work(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+      if (stopping && jobs.empty())
+        return;
+      job = std::move(jobs.front());
+      jobs.pop();
+    }
+    job();
+  }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& body) {
+  if (begin >= end)
+    return;
+  size_t chunks = std::min<size_t>(end - begin, size() * 4);
+  size_t chunk_size = (end - begin + chunks - 1) / chunks;
+  std::vector<std::future<void>> pending;
+  for (size_t first = begin; first < end; first += chunk_size) {
+    size_t last = std::min(end, first + chunk_size);
+    pending.push_back(submit([&body, first, last]() {
+      for (size_t i = first; i < last; ++i)
+        body(i);
+    }));
+  }
+  for (auto &done : pending)
+    done.get();
+}
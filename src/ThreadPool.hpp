@@ -0,0 +1,52 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads executing submitted jobs in FIFO order.
+class ThreadPool {
+public:
+  // threads == 0 means one worker per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned size() const { return workers.size(); }
+
+  template <class F>
+  auto submit(F job) -> std::future<decltype(job())> {
+    using result_t = decltype(job());
+    auto task = std::make_shared<std::packaged_task<result_t()>>(std::move(job));
+    std::future<result_t> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.emplace([task]() { (*task)(); });
+    }
+    condition.notify_one();
+    return result;
+  }
+
+  // run body(i) for i in [begin, end) split into contiguous chunks, blocking
+  // until every chunk is done
+  void parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& body);
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void work();
+};
+
+#endif // THREADPOOL_HPP
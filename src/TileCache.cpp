@@ -0,0 +1,335 @@
+#include "TileCache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char kMagic[8] = {'F', 'G', 'I', 'T', 'I', 'L', 'E', 'S'};
+const uint32_t kVersion = 1;
+const uint64_t kSegmentTiles = 64;
+
+size_t pageSize() {
+  static size_t page = sysconf(_SC_PAGESIZE);
+  return page;
+}
+
+size_t pageAlign(size_t bytes) {
+  return (bytes + pageSize() - 1) / pageSize() * pageSize();
+}
+
+int floorDiv(int a, int b) {
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+} // namespace
+
+struct TileStore::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t tile_size;
+  uint32_t gradients;
+  uint32_t index_capacity;
+  uint64_t function_key;
+  uint64_t tile_count;
+};
+
+struct TileStore::IndexEntry {
+  int32_t level, tx, ty;
+  uint32_t used;
+  uint64_t slot;
+};
+
+TileStore::TileStore(const std::string& path, uint32_t tile_size, bool gradients, uint64_t function_key,
+                     uint32_t index_capacity)
+    : path(path), tile_size(tile_size), gradients(gradients), function_key(function_key),
+      index_capacity(index_capacity) {
+  index_bytes = sizeof(IndexEntry) * index_capacity;
+  payload_bytes = pageAlign(tileFloats() * sizeof(float));
+  data_offset = pageAlign(sizeof(Header) + index_bytes);
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    throw std::runtime_error("TileStore: could not open " + path);
+
+  struct stat st;
+  fstat(fd, &st);
+  bool fresh = st.st_size < off_t(data_offset);
+  if (fresh && ftruncate(fd, data_offset) != 0)
+    throw std::runtime_error("TileStore: could not resize " + path);
+
+  void* head = mmap(nullptr, data_offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (head == MAP_FAILED)
+    throw std::runtime_error("TileStore: could not map " + path);
+  header = static_cast<Header*>(head);
+  index = reinterpret_cast<IndexEntry*>(static_cast<char*>(head) + sizeof(Header));
+
+  bool compatible = !fresh && !memcmp(header->magic, kMagic, sizeof(kMagic)) && header->version == kVersion &&
+                    header->tile_size == tile_size && header->gradients == uint32_t(gradients) &&
+                    header->index_capacity == index_capacity && header->function_key == function_key;
+  if (!compatible)
+    initialize();
+}
+
+TileStore::~TileStore() {
+  size_t segment_bytes = kSegmentTiles * payload_bytes;
+  for (char* s : segments)
+    if (s)
+      munmap(s, segment_bytes);
+  if (header) {
+    msync(header, data_offset, MS_ASYNC);
+    munmap(header, data_offset);
+  }
+  if (fd >= 0)
+    close(fd);
+}
+
+void TileStore::initialize() {
+  memset(static_cast<void*>(header), 0, data_offset);
+  memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->version = kVersion;
+  header->tile_size = tile_size;
+  header->gradients = gradients;
+  header->index_capacity = index_capacity;
+  header->function_key = function_key;
+  header->tile_count = 0;
+  if (ftruncate(fd, data_offset) != 0)
+    throw std::runtime_error("TileStore: could not resize " + path);
+}
+
+void TileStore::clear() {
+  size_t segment_bytes = kSegmentTiles * payload_bytes;
+  for (char* s : segments)
+    if (s)
+      munmap(s, segment_bytes);
+  segments.clear();
+  initialize();
+}
+
+bool TileStore::full() const {
+  // keep the probe sequences short
+  return header->tile_count * 4 >= uint64_t(index_capacity) * 3;
+}
+
+uint64_t TileStore::tileCount() const {
+  return header->tile_count;
+}
+
+TileStore::IndexEntry* TileStore::slot(const TileKey& key) {
+  size_t i = TileKeyHash()(key) % index_capacity;
+  while (index[i].used && !(index[i].level == key.level && index[i].tx == key.tx && index[i].ty == key.ty))
+    i = (i + 1) % index_capacity;
+  return &index[i];
+}
+
+char* TileStore::segment(uint64_t number) {
+  if (number >= segments.size())
+    segments.resize(number + 1, nullptr);
+  if (!segments[number]) {
+    size_t segment_bytes = kSegmentTiles * payload_bytes;
+    off_t offset = data_offset + number * segment_bytes;
+    struct stat st;
+    fstat(fd, &st);
+    if (st.st_size < off_t(offset + segment_bytes) && ftruncate(fd, offset + segment_bytes) != 0)
+      throw std::runtime_error("TileStore: could not resize " + path);
+    void* p = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    if (p == MAP_FAILED)
+      throw std::runtime_error("TileStore: could not map " + path);
+    segments[number] = static_cast<char*>(p);
+  }
+  return segments[number];
+}
+
+const float* TileStore::find(const TileKey& key) {
+  IndexEntry* entry = slot(key);
+  if (!entry->used)
+    return nullptr;
+  char* s = segment(entry->slot / kSegmentTiles);
+  return reinterpret_cast<const float*>(s + (entry->slot % kSegmentTiles) * payload_bytes);
+}
+
+const float* TileStore::insert(const TileKey& key, const float* data) {
+  IndexEntry* entry = slot(key);
+  if (!entry->used) {
+    if (full())
+      return nullptr;
+    entry->level = key.level;
+    entry->tx = key.tx;
+    entry->ty = key.ty;
+    entry->slot = header->tile_count++;
+  }
+  char* s = segment(entry->slot / kSegmentTiles);
+  float* tile = reinterpret_cast<float*>(s + (entry->slot % kSegmentTiles) * payload_bytes);
+  memcpy(tile, data, tileFloats() * sizeof(float));
+  // publish the entry only once the payload is written
+  entry->used = 1;
+  return tile;
+}
+
+void TileStore::release(const float* tile) {
+  // file backed pages are written back by the kernel and re-read on demand
+  madvise(const_cast<float*>(tile), payload_bytes, MADV_DONTNEED);
+}
+
+TilePager::TilePager(TileStore& store, func_t function, std::optional<grad_t> gradient,
+                     std::optional<batch_t> batch, size_t capacity)
+    : store(store), function(function), gradient(store.hasGradients() ? gradient : std::nullopt), batch(batch),
+      capacity(capacity) {
+  if (store.hasGradients() && !gradient)
+    throw std::invalid_argument("TilePager: the store keeps gradients but no gradient was given");
+}
+
+std::vector<float> TilePager::evaluate(const TileKey& key, float spacing) const {
+  const int t = store.tileSize();
+  std::vector<float> data(store.tileFloats());
+  float* heights = data.data();
+  float* gradients = heights + t * t;
+  std::vector<glm::vec2> positions(t * t);
+  for (int y = 0; y < t; ++y)
+    for (int x = 0; x < t; ++x)
+      positions[y * t + x] = spacing * glm::vec2(key.tx * t + x, key.ty * t + y);
+  evaluateBatch(function, batch, positions.data(), heights, positions.size());
+  if (gradient)
+    for (size_t i = 0; i < positions.size(); ++i) {
+      glm::vec2 g = (*gradient)(positions[i]);
+      gradients[2 * i] = g.x;
+      gradients[2 * i + 1] = g.y;
+    }
+  return data;
+}
+
+void TilePager::touch(const TileKey& key, const float* data) {
+  auto it = resident.find(key);
+  if (it != resident.end()) {
+    lru.splice(lru.begin(), lru, it->second.second);
+    return;
+  }
+  lru.push_front(key);
+  resident[key] = {data, lru.begin()};
+  while (resident.size() > capacity) {
+    auto last = resident.find(lru.back());
+    store.release(last->second.first);
+    resident.erase(last);
+    lru.pop_back();
+  }
+}
+
+const float* TilePager::storeTile(const TileKey& key, const std::vector<float>& data) {
+  ++computed;
+  if (store.full()) {
+    // start over rather than growing the index, every resident tile is gone
+    store.clear();
+    resident.clear();
+    lru.clear();
+  }
+  const float* tile = store.insert(key, data.data());
+  touch(key, tile);
+  return tile;
+}
+
+const float* TilePager::acquire(const TileKey& key) {
+  auto it = resident.find(key);
+  if (it != resident.end()) {
+    touch(key, it->second.first);
+    return it->second.first;
+  }
+  if (const float* tile = store.find(key)) {
+    touch(key, tile);
+    return tile;
+  }
+  return nullptr;
+}
+
+void TilePager::fill(int level, float spacing, int i0, int j0, int w, int h, float* heights) {
+  const int t = store.tileSize();
+  int tx0 = floorDiv(i0, t), tx1 = floorDiv(i0 + w - 1, t);
+  int ty0 = floorDiv(j0, t), ty1 = floorDiv(j0 + h - 1, t);
+
+  // evaluate every missing tile at once
+  std::vector<std::pair<TileKey, std::future<std::vector<float>>>> missing;
+  for (int ty = ty0; ty <= ty1; ++ty)
+    for (int tx = tx0; tx <= tx1; ++tx) {
+      TileKey key{level, tx, ty};
+      if (acquire(key))
+        continue;
+      auto job = pending.find(key);
+      if (job != pending.end()) {
+        missing.emplace_back(key, std::move(job->second));
+        pending.erase(job);
+      }
+      else
+        missing.emplace_back(key, pool.submit([this, key, spacing]() { return evaluate(key, spacing); }));
+    }
+  for (auto &[key, job] : missing)
+    storeTile(key, job.get());
+
+  for (int ty = ty0; ty <= ty1; ++ty)
+    for (int tx = tx0; tx <= tx1; ++tx) {
+      TileKey key{level, tx, ty};
+      const float* tile = acquire(key);
+      if (!tile)  // the store was cleared while the missing tiles were stored
+        tile = storeTile(key, evaluate(key, spacing));
+      int x_begin = std::max(i0, tx * t), x_end = std::min(i0 + w, (tx + 1) * t);
+      int y_begin = std::max(j0, ty * t), y_end = std::min(j0 + h, (ty + 1) * t);
+      for (int y = y_begin; y < y_end; ++y)
+        memcpy(heights + size_t(y - j0) * w + (x_begin - i0), tile + (y - ty * t) * t + (x_begin - tx * t),
+               (x_end - x_begin) * sizeof(float));
+    }
+}
+
+void TilePager::prefetch(int level, float spacing, int i0, int j0, int w, int h, glm::vec2 motion) {
+  if (glm::length(motion) == 0.0f)
+    return;
+  const int t = store.tileSize();
+  int tx0 = floorDiv(i0, t), tx1 = floorDiv(i0 + w - 1, t);
+  int ty0 = floorDiv(j0, t), ty1 = floorDiv(j0 + h - 1, t);
+  glm::vec2 center(0.5f * (tx0 + tx1), 0.5f * (ty0 + ty1));
+  glm::vec2 direction = glm::normalize(motion);
+
+  // one tile wide ring around the view, only on the side we are heading to
+  for (int ty = ty0 - 1; ty <= ty1 + 1; ++ty)
+    for (int tx = tx0 - 1; tx <= tx1 + 1; ++tx) {
+      if (tx >= tx0 && tx <= tx1 && ty >= ty0 && ty <= ty1)
+        continue;
+      if (glm::dot(glm::vec2(tx, ty) - center, direction) <= 0.0f)
+        continue;
+      TileKey key{level, tx, ty};
+      if (pending.count(key) || acquire(key))
+        continue;
+      pending.emplace(key, pool.submit([this, key, spacing]() { return evaluate(key, spacing); }));
+    }
+}
+
+void TilePager::collect() {
+  for (auto it = pending.begin(); it != pending.end();) {
+    if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      storeTile(it->first, it->second.get());
+      it = pending.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+uint64_t functionFingerprint(const func_t& function) {
+  const glm::vec2 probes[] = {{0.0, 0.0},   {1.0, 0.0},     {0.0, 1.0},  {-2.5, 3.25},
+                              {7.75, -1.5}, {-13.0, -17.0}, {31.0, 5.5}, {0.125, -0.375}};
+  uint64_t hash = 1469598103934665603ull;  // FNV-1a
+  for (auto &p : probes) {
+    float value = function(p);
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 4; ++i) {
+      hash ^= (bits >> (8 * i)) & 0xff;
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
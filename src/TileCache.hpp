@@ -0,0 +1,131 @@
+#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include <utils.hpp>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+// Samples are taken on the lattice (i * spacing, j * spacing) where the
+// spacing is determined by the level. A tile holds tile x tile consecutive
+// lattice points starting at (tx * tile, ty * tile).
+struct TileKey {
+  int32_t level, tx, ty;
+
+  bool operator==(const TileKey& other) const {
+    return level == other.level && tx == other.tx && ty == other.ty;
+  }
+};
+
+struct TileKeyHash {
+  size_t operator()(const TileKey& key) const {
+    uint64_t h = uint32_t(key.level) * 0x9E3779B97F4A7C15ull;
+    h ^= (uint32_t(key.tx) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2));
+    h ^= (uint32_t(key.ty) + 0x85EBCA77C2B2AE63ull + (h << 6) + (h >> 2));
+    return h;
+  }
+};
+
+// Memory-mapped file of tiles. The file starts with a header and an open
+// addressing index, followed by page aligned tile payloads that are mapped in
+// segments, so pointers returned by find() and insert() stay valid until
+// clear() is called. A tile payload is tile * tile heights, followed by
+// tile * tile (dx, dy) gradients when the store keeps gradients.
+class TileStore {
+public:
+  TileStore(const std::string& path, uint32_t tile_size, bool gradients, uint64_t function_key,
+            uint32_t index_capacity = 1 << 16);
+  ~TileStore();
+
+  TileStore(const TileStore&) = delete;
+  TileStore& operator=(const TileStore&) = delete;
+
+  const float* find(const TileKey& key);
+  // data has tileFloats() elements
+  const float* insert(const TileKey& key, const float* data);
+  // drop the page cache of a tile that is no longer resident
+  void release(const float* tile);
+  void clear();
+
+  bool full() const;
+  uint32_t tileSize() const { return tile_size; }
+  size_t tileFloats() const { return size_t(tile_size) * tile_size * (gradients ? 3 : 1); }
+  bool hasGradients() const { return gradients; }
+  uint64_t tileCount() const;
+
+private:
+  struct Header;
+  struct IndexEntry;
+
+  std::string path;
+  uint32_t tile_size;
+  bool gradients;
+  uint64_t function_key;
+  uint32_t index_capacity;
+
+  int fd = -1;
+  Header* header = nullptr;
+  IndexEntry* index = nullptr;
+  size_t index_bytes;
+  size_t payload_bytes;
+  uint64_t data_offset;
+  std::vector<char*> segments;
+
+  void initialize();
+  IndexEntry* slot(const TileKey& key);
+  char* segment(uint64_t number);
+};
+
+// Keeps the tiles around the camera resident, computing missing tiles on a
+// thread pool and writing them to the store. Tiles in a ring around the view
+// in the direction of motion are prefetched in the background, the least
+// recently used tiles are released once more than capacity are resident.
+class TilePager {
+public:
+  TilePager(TileStore& store, func_t function, std::optional<grad_t> gradient,
+            std::optional<batch_t> batch = std::nullopt, size_t capacity = 512);
+
+  // heights at lattice points (i0 + x, j0 + y) for 0 <= x < w, 0 <= y < h,
+  // stored row by row
+  void fill(int level, float spacing, int i0, int j0, int w, int h, float* heights);
+  // queue background evaluation of the tiles next to the rectangle given to
+  // fill() on the side the camera moves to
+  void prefetch(int level, float spacing, int i0, int j0, int w, int h, glm::vec2 motion);
+  // store the prefetched tiles that are done
+  void collect();
+
+  size_t residentCount() const { return resident.size(); }
+  size_t pendingCount() const { return pending.size(); }
+  uint64_t computedCount() const { return computed; }
+
+private:
+  TileStore& store;
+  func_t function;
+  std::optional<grad_t> gradient;
+  std::optional<batch_t> batch;
+  size_t capacity;
+  ThreadPool pool;
+
+  std::list<TileKey> lru;
+  std::unordered_map<TileKey, std::pair<const float*, std::list<TileKey>::iterator>, TileKeyHash> resident;
+  std::unordered_map<TileKey, std::future<std::vector<float>>, TileKeyHash> pending;
+  uint64_t computed = 0;
+
+  std::vector<float> evaluate(const TileKey& key, float spacing) const;
+  const float* storeTile(const TileKey& key, const std::vector<float>& data);
+  const float* acquire(const TileKey& key);
+  void touch(const TileKey& key, const float* data);
+};
+
+// identifies a function by its values at a few fixed points, so a cache file
+// is reused only for the function it was created with
+uint64_t functionFingerprint(const func_t& function);
+
+#endif // TILECACHE_HPP
@@ -0,0 +1,46 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <atomic>
+
+// Hands the latest value from one producer thread to one consumer thread
+// without locks. The producer writes into back() and publishes it, the
+// consumer switches to the newest published value with update() and reads
+// front(). Neither side ever waits and front() is not touched by the
+// producer until the consumer lets it go, so a published value is immutable.
+template <class T>
+class TripleBuffer {
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // producer side, back() may hold any older value
+  T& back() { return slots[back_index]; }
+  void publish() {
+    int previous = middle.exchange(back_index | fresh, std::memory_order_acq_rel);
+    back_index = previous & index_mask;
+  }
+
+  // consumer side, returns whether a new value was published since the last call
+  bool update() {
+    if (!(middle.load(std::memory_order_acquire) & fresh))
+      return false;
+    int previous = middle.exchange(front_index, std::memory_order_acq_rel);
+    front_index = previous & index_mask;
+    return true;
+  }
+  const T& front() const { return slots[front_index]; }
+
+private:
+  static constexpr int index_mask = 3;
+  static constexpr int fresh = 4;
+
+  T slots[3];
+  int back_index = 0;
+  int front_index = 1;
+  // index of the middle slot and whether it holds an unread value
+  std::atomic<int> middle{2};
+};
+
+#endif // TRIPLEBUFFER_HPP
@@ -0,0 +1,96 @@
+#include "VectorKernels.hpp"
+
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+double dot(const double* a, const double* b, size_t n) {
+  size_t i = 0;
+  double sum = 0.0;
+#ifdef __SSE2__
+  // two accumulators hide the latency of the additions
+  __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < n; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+float dot(const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  float sum = 0.0f;
+#ifdef __SSE2__
+  __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(s0, s1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for (; i < n; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+void axpy(double a, const double* x, double* y, size_t n) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128d va = _mm_set1_pd(a);
+  for (; i + 2 <= n; i += 2)
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+#endif
+  for (; i < n; ++i)
+    y[i] += a * x[i];
+}
+
+void axpy(float a, const float* x, float* y, size_t n) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 va = _mm_set1_ps(a);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+#endif
+  for (; i < n; ++i)
+    y[i] += a * x[i];
+}
+
+void scale(double a, double* x, size_t n) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128d va = _mm_set1_pd(a);
+  for (; i + 2 <= n; i += 2)
+    _mm_storeu_pd(x + i, _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+#endif
+  for (; i < n; ++i)
+    x[i] *= a;
+}
+
+void scale(float a, float* x, size_t n) {
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 va = _mm_set1_ps(a);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(x + i, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+#endif
+  for (; i < n; ++i)
+    x[i] *= a;
+}
+
+double norm(const double* x, size_t n) {
+  return std::sqrt(dot(x, x, n));
+}
+
+float norm(const float* x, size_t n) {
+  return std::sqrt(dot(x, x, n));
+}
@@ -0,0 +1,24 @@
+#ifndef VECTORKERNELS_HPP
+#define VECTORKERNELS_HPP
+
+#include <cstddef>
+
+// Level 1 kernels over contiguous arrays of n numbers, vectorized with SSE2
+// where available. The sums of dot() are split over several accumulators, so
+// their rounding differs slightly from a sequential loop.
+
+double dot(const double* a, const double* b, size_t n);
+float dot(const float* a, const float* b, size_t n);
+
+// y += a * x
+void axpy(double a, const double* x, double* y, size_t n);
+void axpy(float a, const float* x, float* y, size_t n);
+
+// x *= a
+void scale(double a, double* x, size_t n);
+void scale(float a, float* x, size_t n);
+
+double norm(const double* x, size_t n);
+float norm(const float* x, size_t n);
+
+#endif // VECTORKERNELS_HPP
@@ -0,0 +1,113 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Processes a tree of work items on several threads. Every worker keeps its
+// own deque: items it spawns go to the back and are taken from the back
+// (depth first, cache friendly), an idle worker steals from the front of
+// another worker's deque (the oldest, usually largest items).
+template <class T>
+class WorkStealingPool {
+public:
+  // threads == 0 means one worker per hardware thread
+  explicit WorkStealingPool(unsigned threads = 0)
+      : threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+  unsigned size() const { return threads; }
+
+  // process(item, spawn, worker) handles one item and may call spawn(item) to
+  // queue more; returns once every item is processed or stop() was called
+  template <class Process>
+  void run(std::vector<T> initial, Process process) {
+    queues.clear();
+    for (unsigned i = 0; i < threads; ++i)
+      queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < initial.size(); ++i)
+      queues[i % threads]->items.push_back(std::move(initial[i]));
+    outstanding = initial.size();
+    stopped = false;
+
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < threads; ++w)
+      workers.emplace_back([this, w, &process]() { work(w, process); });
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  void stop() { stopped = true; }
+
+  // items left in the queues by stop()
+  template <class F>
+  void forEachRemaining(F f) {
+    for (auto &q : queues)
+      for (auto &item : q->items)
+        f(item);
+  }
+  bool isStopped() const { return stopped; }
+  uint64_t stealCount() const { return steals; }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<T> items;
+  };
+
+  unsigned threads;
+  std::vector<std::unique_ptr<Queue>> queues;
+  // items queued or being processed, the run is over when it drops to 0
+  std::atomic<size_t> outstanding{0};
+  std::atomic<bool> stopped{false};
+  std::atomic<uint64_t> steals{0};
+
+  bool popLocal(unsigned w, T& item) {
+    Queue& q = *queues[w];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.items.empty())
+      return false;
+    item = std::move(q.items.back());
+    q.items.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned w, T& item) {
+    for (unsigned k = 1; k < threads; ++k) {
+      Queue& q = *queues[(w + k) % threads];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (q.items.empty())
+        continue;
+      item = std::move(q.items.front());
+      q.items.pop_front();
+      ++steals;
+      return true;
+    }
+    return false;
+  }
+
+  template <class Process>
+  void work(unsigned w, Process& process) {
+    auto spawn = [this, w](T item) {
+      ++outstanding;
+      std::lock_guard<std::mutex> lock(queues[w]->mutex);
+      queues[w]->items.push_back(std::move(item));
+    };
+    T item;
+    while (!stopped && outstanding > 0) {
+      if (popLocal(w, item) || steal(w, item)) {
+        process(item, spawn, w);
+        --outstanding;
+      }
+      else
+        std::this_thread::yield();
+    }
+  }
+};
+
+#endif // WORKSTEALINGPOOL_HPP
@@ -7,26 +7,196 @@
  */
 
 #include "MyApplication.hpp"
+#include "CommandLine.hpp"
+#include "DataSource.hpp"
+#include "NdFunction.hpp"
+#include "Objectives.hpp"
+#include "Plugin.hpp"
+#include "ProcessPool.hpp"
+#include "Surrogate.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <iostream>
 #include <optional>
+#include <string>
+#include <vector>
 
+// graphs [--plugin <file.so> | --data <file>] [--cache <file>] [--export <file> ...]
+//        [--record <file> | --replay <file> [--fast]] [--profile <file.json>]
+//        [--grid N] [--animate [--t-range BEGIN END] [--speed S] [--budget MS]]
+//        [--dimension N] [--surrogate] [--workers N] [--refine-budget MS] [--hermite] [--first-frame]
 int main(int argc, const char* argv[]) {
-  auto function = [](glm::vec2 position) {
-    return 0.0001f * pow(position.x, 4) + 0.0001f * pow(position.y, 4) + sin(position.x + position.y);
-  };
-  auto gradient = [](glm::vec2 position) {
-    return glm::vec2(0.0001f * 4 * pow(position.x, 3) + cos(position.x + position.y),
-                     0.0001f * 4 * pow(position.y, 3) + cos(position.x + position.y));
-  };
-  auto hessian = [](glm::vec2 position) {
-    return glm::mat2(
-      0.0001f * 12.0 * pow(position.x, 2) - sin(position.x + position.y),
-      -sin(position.x + position.y),
-      -sin(position.x + position.y),
-      0.0001f * 12.0 * pow(position.y, 2) - sin(position.x + position.y)
-    );
-  };
-  MyApplication app = MyApplication(function, std::make_optional(gradient), std::make_optional(hessian));
+  // a process of --workers, see ProcessPool
+  if (argc > 1 && std::string(argv[1]) == "--eval-worker")
+    return ProcessPool::workerMain(std::vector<std::string>(argv + 2, argv + argc));
+
+  Objective objective = defaultObjective();
+  func_t function = objective.function;
+  std::optional<grad_t> gradient = objective.gradient;
+  std::optional<hess_t> hessian = objective.hessian;
+  std::optional<batch_t> batch;
+  std::optional<interval_func_t> interval_function = objective.interval_function;
+  std::optional<interval_grad_t> interval_gradient = objective.interval_gradient;
+
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::shared_ptr<Plugin> plugin;
+  std::shared_ptr<DataSource> data;
+  std::string cache_path, record_path, replay_path, profile_path;
+  bool replay_fast = false, first_frame = false, hermite = false;
+  int size = 200;
+  std::optional<double> refine_budget;
+  std::optional<NdFunction> nd_function;
+  std::optional<TimedFunction> timed_function;
+  Animation animation;
+  std::shared_ptr<Surrogate> surrogate;
+  std::shared_ptr<ProcessPool> process_pool;
+  try {
+    std::string plugin_path = takeOption(args, "--plugin");
+    if (!plugin_path.empty()) {
+      plugin = std::make_shared<Plugin>(plugin_path);
+      function = plugin->function();
+      gradient = plugin->gradient();
+      hessian = plugin->hessian();
+      batch = plugin->batch();
+      interval_function.reset();
+      interval_gradient.reset();
+    }
+    std::string data_path = takeOption(args, "--data");
+    if (!data_path.empty()) {
+      if (plugin)
+        throw std::invalid_argument("--data cannot be combined with --plugin");
+      data = DataSource::open(data_path);
+      function = data->function();
+      gradient = data->gradientFunction();
+      hessian.reset();
+      batch = data->batch();
+      interval_function.reset();
+      interval_gradient.reset();
+    }
+    cache_path = takeOption(args, "--cache");
+    record_path = takeOption(args, "--record");
+    replay_path = takeOption(args, "--replay");
+    replay_fast = takeFlag(args, "--fast");
+    profile_path = takeOption(args, "--profile");
+    first_frame = takeFlag(args, "--first-frame");
+    if (!record_path.empty() && !replay_path.empty())
+      throw std::invalid_argument("--record and --replay cannot be combined");
+    std::string grid = takeOption(args, "--grid");
+    if (!grid.empty())
+      size = std::stoi(grid);
+    if (size < 2 || size > 4096)
+      throw std::invalid_argument("--grid must be between 2 and 4096");
+    takeRange(args, "--t-range", animation.begin, animation.end);
+    std::string speed = takeOption(args, "--speed");
+    if (!speed.empty())
+      animation.speed = std::stof(speed);
+    std::string budget = takeOption(args, "--budget");
+    if (!budget.empty())
+      animation.budget = std::stod(budget) / 1000.0;
+    std::string refine = takeOption(args, "--refine-budget");
+    if (!refine.empty())
+      refine_budget = std::stod(refine) / 1000.0;
+    std::string dimension = takeOption(args, "--dimension");
+    if (!dimension.empty()) {
+      int n = std::stoi(dimension);
+      if (n < 2)
+        throw std::invalid_argument("--dimension must be at least 2");
+      if (plugin || data || !cache_path.empty())
+        throw std::invalid_argument("--dimension cannot be combined with --plugin, --data or --cache");
+      nd_function = neighborObjective(n);
+      // the graph of the first frame and exports show the first two axes
+      function = firstAxes(*nd_function);
+      gradient.reset();
+      hessian.reset();
+      interval_function.reset();
+      interval_gradient.reset();
+    }
+    if (takeFlag(args, "--animate")) {
+      if (nd_function || data)
+        throw std::invalid_argument("--animate cannot be combined with --dimension or --data");
+      timed_function = plugin ? plugin->timedFunction() : waveObjective();
+      if (!timed_function)
+        throw std::invalid_argument("--animate needs a plugin exporting fgi_value_at");
+      if (!cache_path.empty())
+        throw std::invalid_argument("--cache cannot be combined with --animate");
+      // the graph of the first frame and exports show t = begin
+      function = timed_function->at(animation.begin);
+      batch.reset();
+      interval_function.reset();
+      interval_gradient.reset();
+    }
+    std::string workers = takeOption(args, "--workers");
+    if (!workers.empty()) {
+      if (data || nd_function || timed_function)
+        throw std::invalid_argument("--workers cannot be combined with --data, --dimension or --animate");
+      // the plugin of this process only tells when the file changes, the
+      // workers evaluate it
+      process_pool = std::make_shared<ProcessPool>(plugin ? plugin->getPath() : "", std::stoul(workers));
+      function = process_pool->function();
+      gradient = process_pool->gradient();
+      hessian = process_pool->hessian();
+      batch = process_pool->batch();
+    }
+    bool use_surrogate = takeFlag(args, "--surrogate");
+    if (use_surrogate && (nd_function || timed_function || !cache_path.empty()))
+      throw std::invalid_argument("--surrogate cannot be combined with --dimension, --animate or --cache");
+    hermite = takeFlag(args, "--hermite");
+    if (hermite && (!gradient || nd_function || timed_function || use_surrogate || !cache_path.empty()))
+      throw std::invalid_argument("--hermite needs the gradient and cannot be combined with --dimension, --animate, "
+                                  "--surrogate or --cache");
+    if (std::find(args.begin(), args.end(), "--export") != args.end())
+      return exportMesh(function, batch, args);
+    if (!args.empty())
+      throw std::invalid_argument("Unknown option " + args[0]);
+    if (use_surrogate) {
+      // the graph and the optimizers see the model, the first graph is flat
+      surrogate = std::make_shared<Surrogate>(function, batch);
+      function = surrogate->function();
+      gradient = surrogate->gradientFunction();
+      hessian = surrogate->hessianFunction();
+      batch.reset();
+      interval_function.reset();
+      interval_gradient.reset();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  MyApplication app = MyApplication(function, gradient, hessian, batch, cache_path, size);
+  if (plugin)
+    app.watchPlugin(plugin);
+  if (surrogate)
+    app.useSurrogate(surrogate);
+  if (data) {
+    // the whole data in view
+    glm::vec2 center = 0.5f * (data->lower() + data->upper());
+    glm::vec2 extent = data->upper() - data->lower();
+    app.lookAt(glm::vec3(center, function(center)), std::max(1.0f, 1.25f * std::max(extent.x, extent.y)));
+  }
+  if (timed_function)
+    app.animate(timed_function.value(), animation);
+  if (nd_function)
+    app.viewSlices(nd_function.value());
+  if (interval_function)
+    app.setIntervalFunction(interval_function.value(), interval_gradient);
+  if (refine_budget)
+    app.setRefineBudget(refine_budget.value());
+  if (hermite)
+    app.useHermitePatches();
+  if (first_frame)
+    app.exitAfterFirstFrame();
+  try {
+    if (!profile_path.empty())
+      app.profile(profile_path);
+    if (!record_path.empty())
+      app.recordSession(record_path);
+    if (!replay_path.empty())
+      app.replaySession(replay_path, replay_fast);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
   app.run();
   return 0;
 }
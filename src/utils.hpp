@@ -1,11 +1,36 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <cstddef>
 #include <functional>
+#include <optional>
 #include <glm/glm.hpp>
 
 using func_t = std::function<float(glm::vec2)>;
 using grad_t = std::function<glm::vec2(glm::vec2)>;
 using hess_t = std::function<glm::mat2(glm::vec2)>;
 
-#endif // UTILS_HPP
\ No newline at end of file
+// Evaluates a function at count points in one call. It is a plain function
+// pointer and a context rather than a std::function, so sources that can
+// evaluate many points at once (plugins) are called without per point dispatch.
+struct batch_t {
+  void (*evaluate)(const void* context, const glm::vec2* points, float* values, size_t count) = nullptr;
+  const void* context = nullptr;
+
+  void operator()(const glm::vec2* points, float* values, size_t count) const {
+    evaluate(context, points, values, count);
+  }
+};
+
+// values of function at points, in one batch call when batch is given
+inline void evaluateBatch(const func_t& function, const std::optional<batch_t>& batch,
+                          const glm::vec2* points, float* values, size_t count) {
+  if (batch) {
+    (*batch)(points, values, count);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+    values[i] = function(points[i]);
+}
+
+#endif // UTILS_HPP
@@ -0,0 +1,83 @@
+// bake_font <font.ttf> <pixel size> <output.atlas>
+//
+// Rasterizes the printable ASCII characters of a font with FreeType and packs
+// them into the font atlas graphs loads at startup, see src/FontAtlas.hpp.
+
+#include <FontAtlas.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+int main(int argc, const char* argv[]) {
+  if (argc != 4) {
+    std::cerr << "usage: bake_font <font.ttf> <pixel size> <output.atlas>" << std::endl;
+    return 1;
+  }
+  FT_Library ft;
+  FT_Face face;
+  if (FT_Init_FreeType(&ft) || FT_New_Face(ft, argv[1], 0, &face)) {
+    std::cerr << "bake_font: cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  FontAtlas atlas;
+  atlas.pixel_size = std::stoi(argv[2]);
+  FT_Set_Pixel_Sizes(face, 0, atlas.pixel_size);
+
+  // glyphs in rows of a fixed width with one pixel between them, the
+  // height is rounded up to a power of two
+  atlas.width = 256;
+  std::vector<std::vector<uint8_t>> bitmaps;
+  int x = 0, y = 0, row_height = 0;
+  for (char c = FontAtlas::first; c <= FontAtlas::last; ++c) {
+    if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+      std::cerr << "bake_font: no glyph for '" << c << "'" << std::endl;
+      return 1;
+    }
+    FT_GlyphSlot g = face->glyph;
+    int w = g->bitmap.width, h = g->bitmap.rows;
+    if (x + w + 1 > atlas.width) {
+      x = 0;
+      y += row_height + 1;
+      row_height = 0;
+    }
+    FontAtlas::Glyph& glyph = atlas.glyphs[c - FontAtlas::first];
+    glyph.advance = int16_t(g->advance.x / 64);
+    glyph.left = int16_t(g->bitmap_left);
+    glyph.top = int16_t(g->bitmap_top);
+    glyph.width = uint16_t(w);
+    glyph.height = uint16_t(h);
+    glyph.x = uint16_t(x);
+    glyph.y = uint16_t(y);
+    bitmaps.emplace_back();
+    for (int row = 0; row < h; ++row) {
+      const uint8_t* line = g->bitmap.buffer + row * g->bitmap.pitch;
+      bitmaps.back().insert(bitmaps.back().end(), line, line + w);
+    }
+    x += w + 1;
+    row_height = std::max(row_height, h);
+  }
+  atlas.height = 1;
+  while (atlas.height < y + row_height)
+    atlas.height *= 2;
+
+  atlas.pixels.assign(size_t(atlas.width) * atlas.height, 0);
+  for (size_t i = 0; i < bitmaps.size(); ++i) {
+    const FontAtlas::Glyph& glyph = atlas.glyphs[i];
+    for (int row = 0; row < glyph.height; ++row)
+      std::copy_n(bitmaps[i].data() + row * glyph.width, glyph.width,
+                  atlas.pixels.data() + size_t(glyph.y + row) * atlas.width + glyph.x);
+  }
+  try {
+    atlas.save(argv[3]);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  FT_Done_Face(face);
+  FT_Done_FreeType(ft);
+  return 0;
+}